@@ -15,6 +15,7 @@
 #import <Foundation/Foundation.h>
 #import "BMLEnums.h"
 #import "BMLResourceProtocol.h"
+#import "BMLRequestMetrics.h"
 
 /**
  * Provides access to BigML REST API.
@@ -57,6 +58,13 @@
                                    server:(NSString*)serverUrl
                                   version:(NSString*)version;
 
+/**
+ * Receives a trace of every HTTP request made by this connector, and is told
+ * about the retries of bulk operations. Set it to a BMLRequestMetrics to get
+ * latency histograms per resource type and method. Nil by default.
+ */
+@property (nonatomic, strong) id<BMLRequestObserver> requestObserver;
+
 /**
  * Creates a remote resource on BigML.
  * @param type The type of the resource you want to create.
@@ -131,6 +139,35 @@
               filters:(NSDictionary*)filters
            completion:(void(^)(NSArray*, NSError*))completion;
 
+/**
+ * Enumerates all resources of a given type, one page at a time, using the
+ * `limit` and `offset` listing parameters. The next page is requested as soon
+ * as the block starts processing the current one, so that at most two pages
+ * are held in memory at any given time.
+ * @param type The type of the resources you want to list.
+ * See the BMLResourceTypeIdentifier class for a list of allowed types.
+ * @param filters A dictionary containing the filtering and ordering options.
+ * If it contains an `offset`, enumeration starts from there.
+ * @param fields The names of the properties to keep in each resource
+ * definition, e.g., @[@"name", @"created", @"size"], or nil to keep each
+ * object as returned by the server.
+ * @param pageSize The number of resources to request per page; pass 0 for
+ * the default (100).
+ * @param block A block called serially for each page. The block has two
+ * arguments: an array of resources and a pointer to a BOOL that can be set
+ * to YES to stop the enumeration.
+ * @param completion A completion block called once when all pages have been
+ * processed, the enumeration was stopped, or an error occurred. The
+ * completion block has two arguments: the number of resources passed to
+ * block and an NSError.
+ */
+- (void)enumerateResources:(BMLResourceTypeIdentifier*)type
+                   filters:(NSDictionary*)filters
+                    fields:(NSArray*)fields
+                  pageSize:(NSUInteger)pageSize
+                usingBlock:(void(^)(NSArray*, BOOL*))block
+                completion:(void(^)(NSUInteger, NSError*))completion;
+
 /**
  * Deletes a specified resource.
  * @param type The type of the resource you want to create.
@@ -159,6 +196,71 @@
                 values:(NSDictionary*)values
             completion:(void(^)(NSError*))completion;
 
+/**
+ * Creates a collection of remote resources of the same type, running at most
+ * `parallelism` requests at a time. The request creating a resource is only
+ * sent again when it was throttled (429) or no connection could be made, so
+ * that no resource is ever created twice; once a resource exists, requests
+ * polling its status that fail with a 429 or 5xx status code, or with a
+ * transient network error, are retried against it. Retries use exponential
+ * backoff and random jitter.
+ * @param type The type of the resources you want to create.
+ * See the BMLResourceTypeIdentifier class for a list of allowed types.
+ * @param requests An array of NSDictionary, each describing one resource through
+ * the optional keys `name` (an NSString), `options` (an NSDictionary) and
+ * `from` (an id<BMLResource>), with the same meaning as in
+ * createResource:name:options:from:completion:.
+ * @param parallelism The maximum number of requests in flight; pass 0 for the
+ * default (8).
+ * @param maxRetries The maximum number of times a single request is retried.
+ * @param completion A completion block called once all requests are done. The
+ * completion block has two arguments: an array of the created resources, in
+ * the same order as requests and with NSNull for failed ones, and a dictionary
+ * mapping the index of each failed request to its NSError.
+ */
+- (void)createResources:(BMLResourceTypeIdentifier*)type
+               requests:(NSArray*)requests
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSArray*, NSDictionary*))completion;
+
+/**
+ * Deletes a collection of resources, running at most `parallelism` requests
+ * at a time. Requests failing with a 429 or 5xx status code, or with a
+ * transient network error, are retried with exponential backoff and random
+ * jitter.
+ * @param resources An array of id<BMLResource> to delete.
+ * @param parallelism The maximum number of requests in flight; pass 0 for the
+ * default (8).
+ * @param maxRetries The maximum number of times a single request is retried.
+ * @param completion A completion block called once all requests are done. The
+ * completion block has one argument: a dictionary mapping the full UUID of each
+ * resource that could not be deleted to its NSError.
+ */
+- (void)deleteResources:(NSArray*)resources
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSDictionary*))completion;
+
+/**
+ * Updates a collection of resources, running at most `parallelism` requests
+ * at a time. Requests failing with a 429 or 5xx status code, or with a
+ * transient network error, are retried with exponential backoff and random
+ * jitter.
+ * @param values A dictionary mapping the full UUID of each resource to update
+ * to an NSDictionary containing the values you wish to update.
+ * @param parallelism The maximum number of requests in flight; pass 0 for the
+ * default (8).
+ * @param maxRetries The maximum number of times a single request is retried.
+ * @param completion A completion block called once all requests are done. The
+ * completion block has one argument: a dictionary mapping the full UUID of each
+ * resource that could not be updated to its NSError.
+ */
+- (void)updateResources:(NSDictionary*)values
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSDictionary*))completion;
+
 /**
  * Retrieves a specified resource.
  * @param type The type of the resource you want to create.
@@ -171,4 +273,18 @@
                uuid:(BMLResourceUuid*)uuid
          completion:(void(^)(id<BMLResource>, NSError*))completion;
 
+/**
+ * Downloads the JSON definition of a resource to a file, streaming it from the
+ * network without decoding it. This is the cheapest way to fetch large models
+ * that are to be stored and loaded later.
+ * @param type The type of the resource you want to download.
+ * @param uuid The uuid of the resource to download.
+ * @param path The path of the file to write, which is overwritten if it exists.
+ * @param completion A completion block called with an NSError, or nil on success.
+ */
+- (void)downloadResource:(BMLResourceTypeIdentifier*)type
+                    uuid:(BMLResourceUuid*)uuid
+                  toFile:(NSString*)path
+              completion:(void(^)(NSError*))completion;
+
 @end
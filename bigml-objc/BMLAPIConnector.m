@@ -14,6 +14,7 @@
 
 #import "BMLAPIConnector.h"
 #import "BMLHTTPConnector.h"
+#import "BMLHTTPResponse.h"
 #import "BMLResourceTypeIdentifier.h"
 #import "NSError+BMLError.h"
 
@@ -65,6 +66,16 @@ void delay(float delay, dispatch_block_t block) {
     return self;
 }
 
+- (void)setRequestObserver:(id<BMLRequestObserver>)requestObserver {
+    
+    _connector.requestObserver = requestObserver;
+}
+
+- (id<BMLRequestObserver>)requestObserver {
+    
+    return _connector.requestObserver;
+}
+
 - (NSString*)fullUuidFromType:(BMLResourceTypeIdentifier*)type
                          uuid:(BMLResourceUuid*)uuid {
     return [NSString stringWithFormat:@"%@/%@", type.stringValue, uuid];
@@ -125,12 +136,15 @@ void delay(float delay, dispatch_block_t block) {
         completion(nil, error);
 }
 
-- (void)createResource:(BMLResourceTypeIdentifier*)type
-                  name:(NSString*)name
-               options:(NSDictionary*)options
-                  from:(id<BMLResource>)from
-            completion:(void(^)(id<BMLResource>, NSError*))completion
-                  uuid:(void(^)(BMLResourceFullUuid*))uuid {
+/**
+ * Sends the request creating a resource, without tracking its status; the
+ * completion block receives the API response describing the new resource.
+ */
+- (void)postResource:(BMLResourceTypeIdentifier*)type
+                name:(NSString*)name
+             options:(NSDictionary*)options
+                from:(id<BMLResource>)from
+          completion:(void(^)(NSDictionary*, NSError*))completion {
     
     NSAssert(type != nil, @"Wrong type passed to createResource:");
     NSError* e = [self withUri:type.stringValue arguments:@{} runBlock:^(NSURL* url) {
@@ -142,20 +156,11 @@ void delay(float delay, dispatch_block_t block) {
                              filename:name
                              filepath:from.uuid
                                  body:options
-                           completion:^(NSDictionary* dict, NSError* error) {
-                               
-                               if (!error && uuid)
-                                   uuid(dict[@"resource"]);
-                               [self createResourceCompletionBlock:dict
-                                                             error:error
-                                                        completion:completion];
-                           }];
+                           completion:completion];
             } else {
-                NSError* error = [NSError errorWithInfo:@"Input file not found"
-                                                   code:-10301];
-                [self createResourceCompletionBlock:@{}
-                                              error:error
-                                         completion:completion];
+                if (completion)
+                    completion(@{}, [NSError errorWithInfo:@"Input file not found"
+                                                      code:-10301]);
             }
         } else {
             
@@ -164,21 +169,13 @@ void delay(float delay, dispatch_block_t block) {
                 [body setObject:name forKey:@"name"];
             if (from.type == type && type == BMLResourceTypeDataset) {
                 [body setObject:from.fullUuid forKey:@"origin_dataset"];
-            } else if (from.type != BMLResourceTypeProject &&
+            } else if (from &&
+                       from.type != BMLResourceTypeProject &&
                        from.type != BMLResourceTypeWhizzmlSource) {
                 [body setObject:from.fullUuid forKey:from.type.stringValue];
             }
             
-            [_connector postURL:url
-                           body:body
-                     completion:^(NSDictionary* result, NSError* error) {
-                         
-                         if (!error && uuid)
-                             uuid(result[@"resource"]);
-                         [self createResourceCompletionBlock:result
-                                                       error:error
-                                                  completion:completion];
-                     }];
+            [_connector postURL:url body:body completion:completion];
         }
     }];
     
@@ -186,6 +183,27 @@ void delay(float delay, dispatch_block_t block) {
         completion(nil, e);
 }
 
+- (void)createResource:(BMLResourceTypeIdentifier*)type
+                  name:(NSString*)name
+               options:(NSDictionary*)options
+                  from:(id<BMLResource>)from
+            completion:(void(^)(id<BMLResource>, NSError*))completion
+                  uuid:(void(^)(BMLResourceFullUuid*))uuid {
+    
+    [self postResource:type
+                  name:name
+               options:options
+                  from:from
+            completion:^(NSDictionary* result, NSError* error) {
+                
+                if (!error && uuid)
+                    uuid(result[@"resource"]);
+                [self createResourceCompletionBlock:result
+                                              error:error
+                                         completion:completion];
+            }];
+}
+
 - (void)createResource:(BMLResourceTypeIdentifier*)type
                   name:(NSString*)name
                options:(NSDictionary*)options
@@ -203,6 +221,42 @@ void delay(float delay, dispatch_block_t block) {
     [self createResource:type name:name options:options from:nil completion:completion uuid:nil];
 }
 
+- (NSArray*)resourcesFromListObjects:(NSArray*)objects
+                              fields:(NSArray*)fields
+                               error:(NSError**)error {
+    
+    NSMutableArray* resources = [NSMutableArray arrayWithCapacity:objects.count];
+    for (NSDictionary* resource in objects) {
+        NSString* fullUuid = resource[@"resource"] ?: resource[@"resource_uri"];
+        NSArray* components = [fullUuid componentsSeparatedByString:@"/"];
+        fullUuid =
+        [[components subarrayWithRange:NSMakeRange(components.count - 2, 2)]
+         componentsJoinedByString:@"/"];
+        if (fullUuid) {
+            NSDictionary* definition = resource;
+            if (fields) {
+                NSMutableDictionary* projection =
+                [NSMutableDictionary dictionaryWithCapacity:fields.count];
+                for (NSString* field in fields) {
+                    if (resource[field])
+                        projection[field] = resource[field];
+                }
+                definition = projection;
+            }
+            [resources addObject:
+             [[BMLMinimalResource alloc] initWithName:resource[@"name"]
+                                             fullUuid:fullUuid
+                                           definition:definition]];
+        } else {
+            if (error)
+                *error = [NSError errorWithInfo:@"Incomplete results"
+                                           code:-10105];
+            continue;
+        }
+    }
+    return resources;
+}
+
 - (void)listResources:(BMLResourceTypeIdentifier*)type
               filters:(NSDictionary*)filters
            completion:(void(^)(NSArray*, NSError*))completion {
@@ -212,25 +266,11 @@ void delay(float delay, dispatch_block_t block) {
         [_connector getURL:url
                 completion:^(NSDictionary* dict, NSError* error) {
                     
-                    NSMutableArray* resources = [NSMutableArray new];
+                    NSArray* resources = @[];
                     if (!error) {
-                        for (NSDictionary* resource in dict[@"objects"]) {
-                            NSString* fullUuid = resource[@"resource"] ?: resource[@"resource_uri"];
-                            NSArray* components = [fullUuid componentsSeparatedByString:@"/"];
-                            fullUuid =
-                            [[components subarrayWithRange:NSMakeRange(components.count - 2, 2)]
-                             componentsJoinedByString:@"/"];
-                            if (fullUuid) {
-                                [resources addObject:
-                                 [[BMLMinimalResource alloc] initWithName:resource[@"name"]
-                                                                 fullUuid:fullUuid
-                                                               definition:resource]];
-                            } else {
-                                error = [NSError errorWithInfo:@"Incomplete results"
-                                                          code:-10105];
-                                continue;
-                            }
-                        }
+                        resources = [self resourcesFromListObjects:dict[@"objects"]
+                                                            fields:nil
+                                                             error:&error];
                     }
                     completion(resources, error);
                 }];
@@ -240,6 +280,98 @@ void delay(float delay, dispatch_block_t block) {
         completion(nil, e);
 }
 
+- (void)fetchPageOfResources:(BMLResourceTypeIdentifier*)type
+                     filters:(NSDictionary*)filters
+                      offset:(NSUInteger)offset
+                       limit:(NSUInteger)limit
+                  completion:(void(^)(NSArray*, BOOL, NSError*))completion {
+    
+    NSMutableDictionary* arguments = [filters mutableCopy] ?: [NSMutableDictionary new];
+    arguments[@"offset"] = @(offset);
+    arguments[@"limit"] = @(limit);
+    NSError* e = [self withUri:type.stringValue arguments:arguments runBlock:^(NSURL* url) {
+        
+        [_connector getURL:url
+                completion:^(NSDictionary* dict, NSError* error) {
+                    
+                    NSArray* objects = error ? @[] : dict[@"objects"];
+                    if (!error && ![objects isKindOfClass:[NSArray class]]) {
+                        objects = @[];
+                        error = [NSError errorWithInfo:@"Bad response format."
+                                                  code:-10009];
+                    }
+                    NSUInteger total = [dict[@"meta"][@"total_count"] unsignedIntegerValue];
+                    BOOL hasMore = objects.count == limit && (total == 0 || offset + limit < total);
+                    completion(objects, hasMore, error);
+                }];
+    }];
+    
+    if (e)
+        completion(nil, NO, e);
+}
+
+- (void)enumerateResources:(BMLResourceTypeIdentifier*)type
+                   filters:(NSDictionary*)filters
+                    fields:(NSArray*)fields
+                  pageSize:(NSUInteger)pageSize
+                usingBlock:(void(^)(NSArray*, BOOL*))block
+                completion:(void(^)(NSUInteger, NSError*))completion {
+    
+    NSAssert(type != nil, @"Wrong type passed to enumerateResources:");
+    NSUInteger limit = pageSize ?: 100;
+    NSUInteger start = [filters[@"offset"] unsignedIntegerValue];
+    NSMutableDictionary* pageFilters = [filters mutableCopy];
+    [pageFilters removeObjectsForKeys:@[@"offset", @"limit"]];
+    
+    //-- pages are handed to the block on a private serial queue; the next page is
+    //-- requested when the block starts processing the current one, so that no
+    //-- more than two pages are ever alive at once.
+    dispatch_queue_t queue = dispatch_queue_create("com.bigml.enumerateResources", DISPATCH_QUEUE_SERIAL);
+    BOOL __block stop = NO;
+    NSUInteger __block enumerated = 0;
+    void(^__block fetchPage)(NSUInteger) = nil;
+    void(^finish)(NSError*) = ^(NSError* error) {
+        stop = YES;
+        fetchPage = nil;
+        if (completion)
+            completion(enumerated, error);
+    };
+    fetchPage = ^(NSUInteger offset) {
+        
+        [self fetchPageOfResources:type
+                           filters:pageFilters
+                            offset:offset
+                             limit:limit
+                        completion:^(NSArray* objects, BOOL hasMore, NSError* error) {
+                            
+                            dispatch_async(queue, ^{
+                                
+                                if (stop)
+                                    return;
+                                if (error) {
+                                    finish(error);
+                                    return;
+                                }
+                                if (hasMore)
+                                    fetchPage(offset + limit);
+                                
+                                NSError* pageError = nil;
+                                @autoreleasepool {
+                                    NSArray* resources = [self resourcesFromListObjects:objects
+                                                                                 fields:fields
+                                                                                  error:&pageError];
+                                    enumerated += resources.count;
+                                    if (block && resources.count > 0)
+                                        block(resources, &stop);
+                                }
+                                if (stop || pageError || !hasMore)
+                                    finish(pageError);
+                            });
+                        }];
+    };
+    fetchPage(start);
+}
+
 - (void)deleteResource:(BMLResourceTypeIdentifier*)type
                   uuid:(BMLResourceUuid*)uuid
             completion:(void(^)(NSError*))completion {
@@ -279,22 +411,280 @@ void delay(float delay, dispatch_block_t block) {
         completion(e);
 }
 
-- (void)getIntermediateResource:(BMLResourceTypeIdentifier*)type
+#pragma mark Bulk operations
+
+#define BULK_DEFAULT_PARALLELISM 8
+#define BULK_BASE_BACKOFF 0.5
+#define BULK_MAX_BACKOFF 30.0
+
+- (BOOL)isRetriableError:(NSError*)error {
+    
+    if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        return (error.code == NSURLErrorTimedOut ||
+                error.code == NSURLErrorNetworkConnectionLost ||
+                error.code == NSURLErrorCannotConnectToHost);
+    }
+    return error.code == 429 || (error.code >= 500 && error.code < 600);
+}
+
+/**
+ * A creation request may only be sent again when the server certainly did not
+ * act on it: either it was throttled (429) or the connection could not be
+ * established at all. Any other failure might follow an accepted POST, and
+ * retrying it could create a duplicate resource.
+ */
+- (BOOL)isRetriableCreationError:(NSError*)error {
+    
+    if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        return (error.code == NSURLErrorCannotFindHost ||
+                error.code == NSURLErrorCannotConnectToHost ||
+                error.code == NSURLErrorDNSLookupFailed ||
+                error.code == NSURLErrorNotConnectedToInternet);
+    }
+    return error.code == 429;
+}
+
+/**
+ * Runs an asynchronous operation, running it again after a jittered exponential
+ * backoff each time it fails with an error accepted by `retriable`, up to
+ * maxRetries times.
+ */
+- (void)retryOperation:(void(^)(void(^)(id, NSError*)))operation
+            maxRetries:(NSUInteger)maxRetries
+             retriable:(BOOL(^)(NSError*))retriable
+                 retry:(NSUInteger)retry
+            completion:(void(^)(id, NSError*))completion {
+    
+    operation(^(id result, NSError* error) {
+        if (error && retry < maxRetries && retriable(error)) {
+            id<BMLRequestObserver> observer = self.requestObserver;
+            if ([observer respondsToSelector:@selector(requestWillBeRetriedAfterError:)])
+                [observer requestWillBeRetriedAfterError:error];
+            double backoff = MIN(BULK_MAX_BACKOFF, BULK_BASE_BACKOFF * (1 << MIN(retry, 16)));
+            double jitter = backoff * arc4random_uniform(1000) / 1000.0;
+            delay(jitter, ^{
+                [self retryOperation:operation
+                          maxRetries:maxRetries
+                           retriable:retriable
+                               retry:retry + 1
+                          completion:completion];
+            });
+        } else if (completion) {
+            completion(result, error);
+        }
+    });
+}
+
+- (void)retryOperation:(void(^)(void(^)(id, NSError*)))operation
+            maxRetries:(NSUInteger)maxRetries
+            completion:(void(^)(id, NSError*))completion {
+    
+    [self retryOperation:operation
+              maxRetries:maxRetries
+               retriable:^BOOL(NSError* error) { return [self isRetriableError:error]; }
+                   retry:0
+              completion:completion];
+}
+
+/**
+ * Runs `count` asynchronous operations keeping at most `parallelism` of them in
+ * flight. Each operation gets its index and a block to call when it is done;
+ * retrying is left to the operations themselves, since only they know which of
+ * their steps can safely be repeated.
+ */
+- (void)runOperations:(NSUInteger)count
+          parallelism:(NSUInteger)parallelism
+            operation:(void(^)(NSUInteger, void(^)(id, NSError*)))operation
+           completion:(void(^)(NSArray*, NSDictionary*))completion {
+    
+    NSMutableArray* results = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i)
+        [results addObject:[NSNull null]];
+    NSMutableDictionary* errors = [NSMutableDictionary new];
+    if (count == 0) {
+        if (completion)
+            completion(results, errors);
+        return;
+    }
+    
+    //-- all bookkeeping happens on a serial queue, so no locking is needed
+    dispatch_queue_t queue = dispatch_queue_create("com.bigml.bulkOperations", DISPATCH_QUEUE_SERIAL);
+    NSUInteger window = MIN(parallelism ?: BULK_DEFAULT_PARALLELISM, count);
+    NSUInteger __block next = 0;
+    NSUInteger __block finished = 0;
+    void(^__block startNext)(void) = nil;
+    
+    startNext = ^{
+        if (next >= count)
+            return;
+        NSUInteger index = next++;
+        operation(index, ^(id result, NSError* error) {
+            dispatch_async(queue, ^{
+                if (error)
+                    errors[@(index)] = error;
+                else if (result)
+                    results[index] = result;
+                if (++finished == count) {
+                    startNext = nil;
+                    if (completion)
+                        completion(results, errors);
+                } else {
+                    startNext();
+                }
+            });
+        });
+    };
+    dispatch_async(queue, ^{
+        for (NSUInteger i = 0; i < window; ++i)
+            startNext();
+    });
+}
+
+/**
+ * Polls the status of a resource that already exists, retrying transient
+ * failures of the status request itself against the same resource.
+ */
+- (void)trackResourceStatus:(id<BMLResource>)resource
+                 maxRetries:(NSUInteger)maxRetries
+                 completion:(void(^)(id<BMLResource>, NSError*))completion {
+    
+    [self retryOperation:^(void(^done)(id, NSError*)) {
+        [self trackResourceStatus:resource
+                       completion:^(id<BMLResource> resource, NSError* error) {
+                           done(resource, error);
+                       }];
+    }
+              maxRetries:maxRetries
+              completion:completion];
+}
+
+- (void)createResources:(BMLResourceTypeIdentifier*)type
+               requests:(NSArray*)requests
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSArray*, NSDictionary*))completion {
+    
+    NSAssert(type != nil, @"Wrong type passed to createResources:");
+    [self runOperations:requests.count
+            parallelism:parallelism
+              operation:^(NSUInteger index, void(^done)(id, NSError*)) {
+                  
+                  NSDictionary* request = requests[index];
+                  [self retryOperation:^(void(^posted)(id, NSError*)) {
+                      [self postResource:type
+                                    name:request[@"name"]
+                                 options:request[@"options"]
+                                    from:request[@"from"]
+                              completion:posted];
+                  }
+                            maxRetries:maxRetries
+                             retriable:^BOOL(NSError* error) {
+                                 return [self isRetriableCreationError:error];
+                             }
+                                 retry:0
+                            completion:^(NSDictionary* result, NSError* error) {
+                                
+                                if (error) {
+                                    done(nil, error);
+                                    return;
+                                }
+                                //-- from now on the resource exists: only its
+                                //-- status is polled again, it is never re-created
+                                BMLMinimalResource* resource =
+                                [[BMLMinimalResource alloc] initWithName:result[@"name"]
+                                                                fullUuid:result[@"resource"]
+                                                              definition:@{}];
+                                [self trackResourceStatus:resource
+                                               maxRetries:maxRetries
+                                               completion:done];
+                            }];
+              }
+             completion:completion];
+}
+
+- (void)deleteResources:(NSArray*)resources
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSDictionary*))completion {
+    
+    [self runOperations:resources.count
+            parallelism:parallelism
+              operation:^(NSUInteger index, void(^done)(id, NSError*)) {
+                  
+                  id<BMLResource> resource = resources[index];
+                  [self retryOperation:^(void(^deleted)(id, NSError*)) {
+                      [self deleteResource:resource.type
+                                      uuid:resource.uuid
+                                completion:^(NSError* error) {
+                                    deleted(nil, error);
+                                }];
+                  }
+                            maxRetries:maxRetries
+                            completion:done];
+              }
+             completion:^(NSArray* results, NSDictionary* errors) {
+                 
+                 NSMutableDictionary* failures = [NSMutableDictionary new];
+                 for (NSNumber* index in errors) {
+                     id<BMLResource> resource = resources[index.unsignedIntegerValue];
+                     failures[resource.fullUuid] = errors[index];
+                 }
+                 if (completion)
+                     completion(failures);
+             }];
+}
+
+- (void)updateResources:(NSDictionary*)values
+            parallelism:(NSUInteger)parallelism
+             maxRetries:(NSUInteger)maxRetries
+             completion:(void(^)(NSDictionary*))completion {
+    
+    NSArray* fullUuids = values.allKeys;
+    [self runOperations:fullUuids.count
+            parallelism:parallelism
+              operation:^(NSUInteger index, void(^done)(id, NSError*)) {
+                  
+                  BMLResourceFullUuid* fullUuid = fullUuids[index];
+                  [self retryOperation:^(void(^updated)(id, NSError*)) {
+                      [self updateResource:[BMLResourceTypeIdentifier typeFromFullUuid:fullUuid]
+                                      uuid:[BMLResourceTypeIdentifier uuidFromFullUuid:fullUuid]
+                                    values:values[fullUuid]
+                                completion:^(NSError* error) {
+                                    updated(nil, error);
+                                }];
+                  }
+                            maxRetries:maxRetries
+                            completion:done];
+              }
+             completion:^(NSArray* results, NSDictionary* errors) {
+                 
+                 NSMutableDictionary* failures = [NSMutableDictionary new];
+                 for (NSNumber* index in errors) {
+                     failures[fullUuids[index.unsignedIntegerValue]] = errors[index];
+                 }
+                 if (completion)
+                     completion(failures);
+             }];
+}
+
+- (void)getIntermediateResponse:(BMLResourceTypeIdentifier*)type
                            uuid:(BMLResourceUuid*)uuid
-                     completion:(void(^)(NSDictionary*, NSError*))completion {
+                     completion:(void(^)(BMLHTTPResponse*, NSError*))completion {
     
     NSError* e = [self withUri:[self fullUuidFromType:type uuid:uuid]
                      arguments:@{}
                       runBlock:^(NSURL* url) {
         
-        [_connector getURL:url
-                completion:^(NSDictionary* dict, NSError* error) {
+        [_connector getResponseForURL:url
+                           completion:^(BMLHTTPResponse* response, NSError* error) {
                     
                     if (!error) {
-                        if (dict[@"code"]) {
-                            int code = [dict[@"code"] intValue];
+                        id codeValue = [response valueForTopLevelKey:@"code"];
+                        if (codeValue) {
+                            int code = [codeValue intValue];
                             if (code != 200 &&
-                                !(code == 500 && dict[@"resource_uri"] != nil)) {
+                                !(code == 500 &&
+                                  [response valueForTopLevelKey:@"resource_uri"] != nil)) {
                                 
                                 NSString* msg =
                                 [NSString stringWithFormat:@"No data retrieved. Code: %d", code];
@@ -306,7 +696,7 @@ void delay(float delay, dispatch_block_t block) {
                         }
                     }
                     if (completion)
-                        completion(dict, error);
+                        completion(response, error);
                 }];
     }];
     
@@ -314,6 +704,28 @@ void delay(float delay, dispatch_block_t block) {
         completion(nil, e);
 }
 
+- (void)getIntermediateResource:(BMLResourceTypeIdentifier*)type
+                           uuid:(BMLResourceUuid*)uuid
+                     completion:(void(^)(NSDictionary*, NSError*))completion {
+    
+    [self getIntermediateResponse:type
+                             uuid:uuid
+                       completion:^(BMLHTTPResponse* response, NSError* error) {
+                           
+                           NSDictionary* dict = nil;
+                           if (!error) {
+                               id object = [response JSONObjectWithError:&error];
+                               if ([object isKindOfClass:[NSDictionary class]])
+                                   dict = object;
+                               else if (!error)
+                                   error = [NSError errorWithInfo:@"Bad response format."
+                                                             code:-10007];
+                           }
+                           if (completion)
+                               completion(dict, error);
+                       }];
+}
+
 - (void)getResource:(BMLResourceTypeIdentifier*)type
                uuid:(BMLResourceUuid*)uuid
          completion:(void(^)(id<BMLResource>, NSError*))completion {
@@ -346,13 +758,15 @@ void delay(float delay, dispatch_block_t block) {
         if (completion)
             completion(resource, nil);
     } else {
-        [self getIntermediateResource:resource.type
+        //-- while the resource is being processed only its status is decoded;
+        //-- the whole definition is parsed once, when processing has ended
+        [self getIntermediateResponse:resource.type
                                  uuid:resource.uuid
-                           completion:^(NSDictionary* dict, NSError* error) {
+                           completion:^(BMLHTTPResponse* response, NSError* error) {
 
                                //-- the API may return 500 and still provide info about the error
-                               if (!error || dict[@"status"]) {
-                                   NSDictionary* status = dict[@"status"];
+                               NSDictionary* status = response.status;
+                               if (!error || status) {
                                    if (status[@"code"]) {
                                        int statusCode = [status[@"code"] shortValue];
                                        if (statusCode < BMLResourceStatusWaiting) {
@@ -362,16 +776,21 @@ void delay(float delay, dispatch_block_t block) {
                                            }
                                            resource.status = BMLResourceStatusFailed;
                                        } else if (statusCode < BMLResourceStatusEnded) {
+                                           //-- still in progress: keep polling
+                                           error = nil;
                                            delay(1.0, ^{[self trackResourceStatus:resource completion:completion];});
                                            if (resource.status != statusCode) {
                                                resource.status = statusCode;
                                            }
                                        } else if (statusCode == BMLResourceStatusEnded) {
-                                           resource.status = statusCode;
-                                           resource.jsonDefinition = dict;
-                                           completion(resource, error);
+                                           id dict = [response JSONObjectWithError:&error];
+                                           if (!error) {
+                                               resource.status = statusCode;
+                                               resource.jsonDefinition = dict;
+                                               completion(resource, error);
+                                           }
                                        }
-                                   } else {
+                                   } else if (!error) {
                                        error = [NSError errorWithInfo:@"Bad response format."
                                                                  code:-10000];
                                    }
@@ -384,6 +803,22 @@ void delay(float delay, dispatch_block_t block) {
     }
 }
 
+- (void)downloadResource:(BMLResourceTypeIdentifier*)type
+                    uuid:(BMLResourceUuid*)uuid
+                  toFile:(NSString*)path
+              completion:(void(^)(NSError*))completion {
+    
+    NSError* e = [self withUri:[self fullUuidFromType:type uuid:uuid]
+                     arguments:@{}
+                      runBlock:^(NSURL* url) {
+                          
+                          [_connector downloadURL:url toFile:path completion:completion];
+                      }];
+    
+    if (e && completion)
+        completion(e);
+}
+
 @end
 
 
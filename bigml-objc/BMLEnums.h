@@ -50,6 +50,20 @@ typedef enum BMLMissingStrategy {
     
 } BMLMissingStrategy;
 
+/**
+ * Precision of the split thresholds of a QuantizedModel:
+ *
+ *      0 - Float32: single precision, 4 bytes per threshold.
+ *      1 - Float16: half precision, 2 bytes per threshold, with about three
+ *          significant digits and a largest value of 65504.
+ */
+typedef enum BMLThresholdPrecision {
+    
+    BMLThresholdPrecisionFloat32 = 0,
+    BMLThresholdPrecisionFloat16
+    
+} BMLThresholdPrecision;
+
 /**
  The following values must match those at https://bigml.com/developers/status_codes
  Not all values are necessarily to be represented.
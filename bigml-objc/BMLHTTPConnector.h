@@ -14,6 +14,9 @@
 
 #import <Foundation/Foundation.h>
 
+@class BMLHTTPResponse;
+@protocol BMLRequestObserver;
+
 @interface NSHTTPURLResponse (isStrictlyValid)
 
 - (BOOL)isStrictlyValid;
@@ -22,9 +25,28 @@
 
 @interface BMLHTTPConnector : NSObject
 
+/**
+ * Receives a trace of every request made by this connector, nil by default.
+ */
+@property (nonatomic, strong) id<BMLRequestObserver> requestObserver;
+
 - (void)getURL:(NSURL*)url
        completion:(void(^)(NSDictionary*, NSError*))completion;
 
+/**
+ * Like getURL:completion:, but hands over the undecoded response so that
+ * callers can decode only the fields they need.
+ */
+- (void)getResponseForURL:(NSURL*)url
+               completion:(void(^)(BMLHTTPResponse*, NSError*))completion;
+
+/**
+ * Streams the body of a GET request to a file, without keeping it in memory.
+ */
+- (void)downloadURL:(NSURL*)url
+             toFile:(NSString*)path
+         completion:(void(^)(NSError*))completion;
+
 - (void)postURL:(NSURL*)url
           body:(NSDictionary*)body
     completion:(void(^)(NSDictionary*, NSError*))completion;
@@ -50,6 +50,14 @@
     return self;
 }
 
+- (void)setRequestObserver:(id<BMLRequestObserver>)requestObserver {
+    
+    _requestObserver = requestObserver;
+    for (BMLHTTPMethodHandler* handler in @[ _getter, _poster, _putter, _deleter, _uploader ]) {
+        handler.requestObserver = requestObserver;
+    }
+}
+
 - (void)getURL:(NSURL*)url
     completion:(void(^)(NSDictionary*, NSError*))completion {
     
@@ -59,6 +67,19 @@
     }];
 }
 
+- (void)getResponseForURL:(NSURL*)url
+               completion:(void(^)(BMLHTTPResponse*, NSError*))completion {
+    
+    [_getter runWithURL:url data:nil responseHandler:completion];
+}
+
+- (void)downloadURL:(NSURL*)url
+             toFile:(NSString*)path
+         completion:(void(^)(NSError*))completion {
+    
+    [_getter downloadURL:url toFile:path completion:completion];
+}
+
 - (void)postURL:(NSURL*)url
            body:(NSDictionary*)body
      completion:(void(^)(NSDictionary*, NSError*))completion {
@@ -14,15 +14,37 @@
 
 #import <Foundation/Foundation.h>
 
+@class BMLHTTPResponse;
+@protocol BMLRequestObserver;
+
 @interface BMLHTTPMethodHandler : NSObject
 
+/**
+ * Registers an NSURLProtocol subclass to be consulted by the sessions created
+ * from now on, before the system protocols. This allows serving requests from
+ * an in-process stand-in for BigML.io, e.g., in offline tests.
+ */
++ (void)registerProtocolClass:(Class)protocolClass;
+
++ (void)unregisterProtocolClass:(Class)protocolClass;
+
 - (instancetype)initWithMethod:(NSString*)method
                   expectedCode:(NSUInteger)expectedCode;
 
+/**
+ * Receives a trace of every request run by this handler, nil by default.
+ */
+@property (nonatomic, strong) id<BMLRequestObserver> requestObserver;
+
 - (instancetype)initWithMethod:(NSString*)method
                   expectedCode:(NSUInteger)expectedCode
                    contentType:(NSString*)contentType;
 
+/**
+ * Runs the request and decodes the response body. When the body's `code`
+ * differs from the expected code, the decoded body is passed along with the
+ * error, so that the server's error payload can be read.
+ */
 - (void)runWithURL:(NSURL*)url
               data:(NSData*)data
         completion:(void(^)(NSDictionary*, NSError*))completion;
@@ -31,4 +53,20 @@
               body:(NSDictionary*)body
         completion:(void(^)(NSDictionary*, NSError*))completion;
 
+/**
+ * Runs the request and hands over the undecoded response. Only the `code`
+ * field of the body is decoded to check it against the expected code.
+ */
+- (void)runWithURL:(NSURL*)url
+              data:(NSData*)data
+   responseHandler:(void(^)(BMLHTTPResponse*, NSError*))handler;
+
+/**
+ * Runs the request streaming the response body to a file at the given path,
+ * which is overwritten if it exists.
+ */
+- (void)downloadURL:(NSURL*)url
+             toFile:(NSString*)path
+         completion:(void(^)(NSError*))completion;
+
 @end
@@ -13,7 +13,10 @@
 // under the License.
 
 #import "BMLHTTPMethodHandler.h"
+#import "BMLHTTPResponse.h"
 #import "NSError+BMLError.h"
+#import "BMLRequestMetrics.h"
+#import "BMLUtils.h"
 
 @implementation NSHTTPURLResponse (isStrictlyValid)
 
@@ -23,12 +26,137 @@
 
 @end
 
+static NSTimeInterval intervalBetween(NSDate* start, NSDate* end) {
+    
+    return (start && end) ? MAX(0, [end timeIntervalSinceDate:start]) : 0;
+}
+
+/**
+ * Builds request traces from the completion of each task and, where the
+ * system provides them, its NSURLSessionTaskMetrics. Both arrive on the
+ * session's serial delegate queue, in no guaranteed order, so whichever
+ * comes first waits for the other.
+ */
+@interface BMLTraceCollector : NSObject <NSURLSessionTaskDelegate>
+
+@property (atomic, strong) id<BMLRequestObserver> observer;
+
+- (void)taskDidFinish:(NSURLSessionTask*)task
+        responseBytes:(int64_t)responseBytes
+                error:(NSError*)error
+                start:(NSTimeInterval)start;
+
+@end
+
+@implementation BMLTraceCollector {
+    
+    NSMapTable* _pendingTraces;
+    NSMapTable* _pendingMetrics;
+}
+
+- (instancetype)init {
+    
+    if (self = [super init]) {
+        _pendingTraces = [NSMapTable strongToStrongObjectsMapTable];
+        _pendingMetrics = [NSMapTable strongToStrongObjectsMapTable];
+    }
+    return self;
+}
+
++ (NSString*)resourceTypeOfURL:(NSURL*)url {
+    
+    //-- paths look like /[dev/]<version>/<resource type>[/<id>]
+    NSMutableArray* components = [url.pathComponents mutableCopy];
+    [components removeObject:@"/"];
+    if ([components.firstObject isEqualToString:@"dev"])
+        [components removeObjectAtIndex:0];
+    return components.count > 1 ? components[1] : @"";
+}
+
+- (void)addMetrics:(NSURLSessionTaskMetrics*)metrics toTrace:(BMLRequestTrace*)trace {
+    
+    NSURLSessionTaskTransactionMetrics* transaction = metrics.transactionMetrics.lastObject;
+    trace.dnsTime = intervalBetween(transaction.domainLookupStartDate, transaction.domainLookupEndDate);
+    trace.connectTime = intervalBetween(transaction.connectStartDate, transaction.connectEndDate);
+    trace.timeToFirstByte = intervalBetween(transaction.requestStartDate, transaction.responseStartDate);
+    trace.queueWait = MAX(0, intervalBetween(metrics.taskInterval.startDate, transaction.requestStartDate) -
+                          trace.dnsTime - trace.connectTime);
+    if (metrics.taskInterval.duration > 0)
+        trace.totalTime = metrics.taskInterval.duration;
+}
+
+- (void)taskDidFinish:(NSURLSessionTask*)task
+        responseBytes:(int64_t)responseBytes
+                error:(NSError*)error
+                start:(NSTimeInterval)start {
+    
+    //-- traces and metrics are paired even with no observer, which may be set
+    //-- or cleared between the two: nothing is left behind in the tables
+    BMLRequestTrace* trace = [BMLRequestTrace new];
+    NSURLRequest* request = task.originalRequest;
+    trace.method = request.HTTPMethod ?: @"GET";
+    trace.path = request.URL.path;
+    trace.resourceType = [BMLTraceCollector resourceTypeOfURL:request.URL];
+    trace.statusCode = [task.response isKindOfClass:[NSHTTPURLResponse class]] ?
+    [(NSHTTPURLResponse*)task.response statusCode] : 0;
+    trace.error = error;
+    trace.requestBytes = task.countOfBytesSent ?: (int64_t)request.HTTPBody.length;
+    trace.responseBytes = task.countOfBytesReceived ?: responseBytes;
+    trace.totalTime = [BMLUtils monotonicTime] - start;
+    
+    NSURLSessionTaskMetrics* metrics = [_pendingMetrics objectForKey:task];
+    if (metrics) {
+        [_pendingMetrics removeObjectForKey:task];
+        [self addMetrics:metrics toTrace:trace];
+    } else if (NSClassFromString(@"NSURLSessionTaskMetrics")) {
+        [_pendingTraces setObject:trace forKey:task];
+        return;
+    }
+    [self.observer requestDidFinish:trace];
+}
+
+- (void)URLSession:(NSURLSession*)session
+              task:(NSURLSessionTask*)task
+didFinishCollectingMetrics:(NSURLSessionTaskMetrics*)metrics {
+    
+    BMLRequestTrace* trace = [_pendingTraces objectForKey:task];
+    if (trace) {
+        [_pendingTraces removeObjectForKey:task];
+        [self addMetrics:metrics toTrace:trace];
+        [self.observer requestDidFinish:trace];
+    } else {
+        [_pendingMetrics setObject:metrics forKey:task];
+    }
+}
+
+@end
+
 @implementation BMLHTTPMethodHandler {
     
     NSString* _method;
     NSUInteger _expectedCode;
     NSString* _contentType;
     NSURLSession* _session;
+    BMLTraceCollector* _collector;
+}
+
+static NSMutableArray* protocolClasses = nil;
+
++ (void)registerProtocolClass:(Class)protocolClass {
+    
+    @synchronized (self) {
+        if (!protocolClasses)
+            protocolClasses = [NSMutableArray new];
+        if (![protocolClasses containsObject:protocolClass])
+            [protocolClasses insertObject:protocolClass atIndex:0];
+    }
+}
+
++ (void)unregisterProtocolClass:(Class)protocolClass {
+    
+    @synchronized (self) {
+        [protocolClasses removeObject:protocolClass];
+    }
 }
 
 - (instancetype)initWithMethod:(NSString*)method
@@ -39,10 +167,27 @@
         _method = method;
         _expectedCode = expectedCode;
         _contentType = contentType;
+        _collector = [BMLTraceCollector new];
     }
     return self;
 }
 
+- (void)dealloc {
+    
+    //-- sessions keep their delegate until they are invalidated
+    [_session finishTasksAndInvalidate];
+}
+
+- (void)setRequestObserver:(id<BMLRequestObserver>)requestObserver {
+    
+    _collector.observer = requestObserver;
+}
+
+- (id<BMLRequestObserver>)requestObserver {
+    
+    return _collector.observer;
+}
+
 - (instancetype)initWithMethod:(NSString*)method
                   expectedCode:(NSUInteger)expectedCode {
     
@@ -51,6 +196,22 @@
                      contentType:@"application/json; charset=utf-8"];
 }
 
+- (void)runWithURL:(NSURL*)url
+              data:(NSData*)data
+   responseHandler:(void(^)(BMLHTTPResponse*, NSError*))handler {
+    
+    [self handleDataRequestWithMethod:_method
+                                  url:url
+                                 data:data
+                              handler:^(BMLHTTPResponse* response, NSError* error) {
+                                  
+                                  if (!error && response.data.length > 0)
+                                      error = [self errorFromCodeOfResponse:response];
+                                  if (handler)
+                                      handler(response, error);
+                              }];
+}
+
 - (void)runWithURL:(NSURL*)url
               data:(NSData*)data
         completion:(void(^)(NSDictionary*, NSError*))completion {
@@ -58,14 +219,16 @@
     [self handleDataRequestWithMethod:_method
                                   url:url
                                  data:data
-                              handler:^(NSData* data, NSError* error) {
+                              handler:^(BMLHTTPResponse* response, NSError* error) {
                                   
+                                  //-- the body is still returned along with an unexpected code,
+                                  //-- so that callers can read the server's error payload
                                   NSDictionary* jsonDict = nil;
-                                  if (!error && data.length > 0)
-                                      jsonDict = [self responseDictFromData:data
-                                                               expectedCode:_expectedCode
-                                                                      error:&error];
-
+                                  if (!error && response.data.length > 0) {
+                                      jsonDict = [self responseDictFromResponse:response error:&error];
+                                      if (!error)
+                                          error = [self errorFromCodeOfResponse:response];
+                                  }
                                   if (completion)
                                       completion(jsonDict, error);
                               }];
@@ -97,7 +260,12 @@
         NSURLSessionConfiguration* conf =
         [NSURLSessionConfiguration ephemeralSessionConfiguration];
         conf.HTTPAdditionalHeaders = @{@"Content-Type" : @"application/json"};
-        _session = [NSURLSession sessionWithConfiguration:conf];
+        @synchronized ([BMLHTTPMethodHandler class]) {
+            if (protocolClasses.count > 0)
+                conf.protocolClasses =
+                [protocolClasses arrayByAddingObjectsFromArray:conf.protocolClasses];
+        }
+        _session = [NSURLSession sessionWithConfiguration:conf delegate:_collector delegateQueue:nil];
     }
     return _session;
 }
@@ -113,41 +281,98 @@
     return result;
 }
 
+- (NSError*)errorFromCodeOfResponse:(BMLHTTPResponse*)response {
+    
+    NSInteger code = response.code;
+    if (code && code != _expectedCode)
+        return [NSError errorWithStatus:response.status
+                                   code:code
+                             forRequest:nil];
+    return nil;
+}
+
+- (NSError*)errorFromResponse:(NSURLResponse*)resp data:(NSData*)data {
+    
+    if ([resp isKindOfClass:[NSHTTPURLResponse class]]) {
+        
+        NSHTTPURLResponse* response = (id)resp;
+        if (![response isStrictlyValid]) {
+            
+            //-- only the status field is decoded from error bodies
+            BMLHTTPResponse* body = [[BMLHTTPResponse alloc] initWithData:data
+                                                               statusCode:response.statusCode];
+            NSDictionary* status = body.status;
+            if (!status) {
+                id object = [body JSONObjectWithError:nil];
+                status = [object isKindOfClass:[NSDictionary class]] ? object : nil;
+            }
+            return [NSError errorWithStatus:status
+                                       code:response.statusCode
+                                 forRequest:nil];
+        }
+        return nil;
+    }
+    NSString* message =
+    [NSString stringWithFormat:@"Bad response format for URL: %@",
+     resp.URL.absoluteString];
+    return [NSError errorWithInfo:message code:-10001];
+}
+
 - (void)dataWithRequest:(NSURLRequest*)request
-             completion:(void(^)(NSData* data, NSError* error))completion {
+             completion:(void(^)(BMLHTTPResponse* response, NSError* error))completion {
 
-    [[self.session
+    NSTimeInterval start = [BMLUtils monotonicTime];
+    NSURLSessionDataTask* __block task = nil;
+    task = [self.session
       dataTaskWithRequest:request
                      completionHandler:^(NSData* data, NSURLResponse* resp, NSError* error) {
                          
-                         if (!error) {
-                             if ([resp isKindOfClass:[NSHTTPURLResponse class]]) {
-
-                                 NSHTTPURLResponse* response = (id)resp;
-                                 if (![response isStrictlyValid]) {
-                                     
-                                     NSUInteger code = response.statusCode;
-                                     NSDictionary* status = [NSJSONSerialization
-                                                             JSONObjectWithData:data
-                                                             options:NSJSONReadingAllowFragments
-                                                             error:&error];
-                                     if (!error)
-                                         error = [NSError errorWithStatus:status[@"status"] ?: status
-                                                                     code:code
-                                                               forRequest:nil];
-                                 }
-                             } else {
-                                 NSString* message =
-                                 [NSString stringWithFormat:@"Bad response format for URL: %@",
-                                  resp.URL.absoluteString];
-                                 error = [NSError errorWithInfo:message
-                                                           code:-10001];
-                             }
-                         }
+                         [_collector taskDidFinish:task responseBytes:data.length error:error start:start];
+                         task = nil;
+                         if (!error)
+                             error = [self errorFromResponse:resp data:data];
                          if (completion)
-                             completion(data, error);
+                             completion([[BMLHTTPResponse alloc]
+                                         initWithData:data
+                                         statusCode:[resp isKindOfClass:[NSHTTPURLResponse class]] ?
+                                         [(NSHTTPURLResponse*)resp statusCode] : 0],
+                                        error);
                          
-                     }] resume];
+                     }];
+    [task resume];
+}
+
+- (void)downloadURL:(NSURL*)url
+             toFile:(NSString*)path
+         completion:(void(^)(NSError*))completion {
+    
+    NSMutableURLRequest* request = [self requestWithMethod:_method url:url data:nil];
+    NSTimeInterval start = [BMLUtils monotonicTime];
+    NSURLSessionDownloadTask* __block task = nil;
+    task = [self.session
+      downloadTaskWithRequest:request
+      completionHandler:^(NSURL* location, NSURLResponse* resp, NSError* error) {
+          
+          [_collector taskDidFinish:task responseBytes:0 error:error start:start];
+          task = nil;
+          if (!error) {
+              //-- error bodies are small: they are read back only to extract the status
+              NSData* errorData = nil;
+              if ([resp isKindOfClass:[NSHTTPURLResponse class]] &&
+                  ![(NSHTTPURLResponse*)resp isStrictlyValid])
+                  errorData = [NSData dataWithContentsOfURL:location];
+              error = [self errorFromResponse:resp data:errorData];
+          }
+          if (!error) {
+              NSFileManager* fileManager = [NSFileManager defaultManager];
+              NSURL* destination = [NSURL fileURLWithPath:path];
+              [fileManager removeItemAtURL:destination error:nil];
+              [fileManager moveItemAtURL:location toURL:destination error:&error];
+          }
+          if (completion)
+              completion(error);
+      }];
+    [task resume];
 }
 
 - (NSMutableURLRequest*)requestWithMethod:(NSString*)method
@@ -165,7 +390,7 @@
 - (void)handleDataRequestWithMethod:(NSString*)method
                                 url:(NSURL*)url
                                data:(NSData*)data
-                            handler:(void(^)(NSData* data, NSError* error))handler {
+                            handler:(void(^)(BMLHTTPResponse* response, NSError* error))handler {
     
     NSMutableURLRequest* request = [self requestWithMethod:method
                                                        url:url
@@ -173,28 +398,27 @@
     if (request) {
         
         [self dataWithRequest:request
-                   completion:^(NSData* data, NSError* error) {
+                   completion:^(BMLHTTPResponse* response, NSError* error) {
                        if (handler)
-                           handler(data, error);
+                           handler(response, error);
                    }];
     }
 }
 
-- (NSDictionary*)responseDictFromData:(NSData*)data
-                         expectedCode:(NSUInteger)expectedCode
-                                error:(NSError**)error {
+/**
+ * Decodes the whole response body. For backward compatibility, arrays are
+ * returned as dictionaries keyed by their indices; use the BMLHTTPResponse
+ * directly to access them as arrays.
+ */
+- (NSDictionary*)responseDictFromResponse:(BMLHTTPResponse*)response
+                                    error:(NSError**)error {
     
     NSDictionary* jsonDict = nil;
-    id jsonObject = [self JSONObjectWithData:data error:error];
+    id jsonObject = [response JSONObjectWithError:error];
     if (*error == nil) {
         
         if ([jsonObject isKindOfClass:[NSDictionary class]]) {
             jsonDict = jsonObject;
-            NSString* code = jsonDict[@"code"];
-            if (code && [code intValue] != expectedCode)
-                *error = [NSError errorWithStatus:jsonDict[@"status"]
-                                             code:[code intValue]
-                                       forRequest:nil];
         } else if([jsonObject isKindOfClass:[NSArray class]]) {
             
             NSMutableArray* keys = [NSMutableArray array];
@@ -214,84 +438,5 @@
     }
     return jsonDict;
 }
-#pragma mark JSONObjectWithData workaround
-
-//-- workaround for JSONObjectWithData failing with double-precision numbers in scientific notation
-//-- (e.g., 1.0e-128). The regex below is tuned for probabilities. Beware of the risk of a
-//-- resource UUID matching some exponential number (e.g., ..0e12..): the leading [^\\w/] in
-//-- the regex below rules out this possibility.
-//-- Important: the bug seems not to exist for large double precision number, e.g., 1e225.
-//-- Therefore the following regex is only considering negative-signed exponentials.
-
-- (id)JSONObjectWithData:(NSData*)data error:(NSError**)error {
-    
-    id jsonObject =
-    [NSJSONSerialization
-     JSONObjectWithData:data
-     options:NSJSONReadingAllowFragments | NSJSONReadingMutableContainers
-     error:error];
-    
-    if (!jsonObject || *error) {
-        
-        *error = nil;
-        NSString* json = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-        NSRegularExpression* regex = [NSRegularExpression
-                                      regularExpressionWithPattern:@"(-?(?:0|[1-9]\\d*)(?:\\.\\d*)?(?:[eE]-\\d+))"
-                                      options:NSRegularExpressionCaseInsensitive
-                                      error:error];
-        json = [regex stringByReplacingMatchesInString:json
-                                               options:0
-                                                 range:NSMakeRange(0, [json length])
-                                          withTemplate:@"\"$0\""];
-        
-        NSData* d = [json dataUsingEncoding:NSUTF8StringEncoding];
-        jsonObject =
-        [NSJSONSerialization
-         JSONObjectWithData:d
-         options:NSJSONReadingAllowFragments | NSJSONReadingMutableContainers
-         error:error];
-      
-        jsonObject = [self jsonObjectByNormalizingDoubles:jsonObject];
-        
-#ifdef DEBUG
-        if (!jsonObject) {
-            NSLog(@"FAILED TO DECODE RESOURCE JSON: %@", json);
-        }
-#endif
-    }
-    return jsonObject;
-}
-
-- (id)numberFromString:(NSString*)string {
-    
-    if (![string isKindOfClass:[NSString class]])
-        return string;
-    
-    NSNumber* result = nil;
-    NSScanner* scan = [NSScanner scannerWithString:string];
-    double doubleVal;
-    if ([scan scanDouble:&doubleVal] && [scan isAtEnd]) {
-        result = @([string doubleValue]);
-    }
-    return result ?: string;
-}
-
-- (id)jsonObjectByNormalizingDoubles:(id)jsonObject {
-    
-    if ([jsonObject isKindOfClass:[NSMutableArray class]]) {
-        NSMutableArray* array = jsonObject;
-        for (int i = 0; i < array.count; ++i) {
-            [array setObject:[self jsonObjectByNormalizingDoubles:array[i]] atIndexedSubscript:i];
-        }
-    } else if ([jsonObject isKindOfClass:[NSMutableDictionary class]]) {
-        NSMutableDictionary* dict = jsonObject;
-        for (NSString* key in dict.allKeys) {
-            [dict setObject:[self jsonObjectByNormalizingDoubles:dict[key]] forKey:key];
-        }
-    } else if ([jsonObject isKindOfClass:[NSString class]]) {
-        return [self numberFromString:jsonObject];
-    }
-    return jsonObject;
-}
 
 @end
@@ -0,0 +1,61 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * The body of a response from BigML, kept as raw bytes.
+ *
+ * Top-level fields such as `code`, `status` or `resource` are decoded on
+ * demand by scanning the JSON text for the requested key and parsing only
+ * its value, so that reading the status of a large resource does not
+ * require materializing the whole document. The full document is parsed
+ * only when JSONObject is first accessed, and then cached.
+ */
+@interface BMLHTTPResponse : NSObject
+
+/// the raw response body
+@property (nonatomic, readonly) NSData* data;
+
+/// the HTTP status code of the response
+@property (nonatomic, readonly) NSInteger statusCode;
+
+- (instancetype)initWithData:(NSData*)data statusCode:(NSInteger)statusCode;
+
+/**
+ * Returns the value associated to a key of the top-level JSON object,
+ * parsing only the bytes of that value.
+ * @param key The key to look up.
+ * @return The decoded value, or nil if the body is not a JSON object or it
+ *  does not contain the key.
+ */
+- (id)valueForTopLevelKey:(NSString*)key;
+
+/// the `code` field of the body, or 0 if missing
+- (NSInteger)code;
+
+/// the `status` field of the body
+- (NSDictionary*)status;
+
+/// the `resource` field of the body
+- (NSString*)resource;
+
+/**
+ * Parses the whole body. The result is cached.
+ * @param error Set to the parsing error, if any.
+ * @return The decoded JSON object (an NSDictionary or an NSArray).
+ */
+- (id)JSONObjectWithError:(NSError**)error;
+
+@end
@@ -0,0 +1,266 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "BMLHTTPResponse.h"
+
+#pragma mark JSON scanning
+
+//-- The functions below only delimit JSON values, they do not validate them:
+//-- malformed input is detected by NSJSONSerialization when the value is parsed.
+
+static const uint8_t* skipWhitespace(const uint8_t* p, const uint8_t* end) {
+
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        ++p;
+    return p;
+}
+
+static const uint8_t* skipString(const uint8_t* p, const uint8_t* end) {
+
+    for (++p; p < end; ++p) {
+        if (*p == '\\')
+            ++p;
+        else if (*p == '"')
+            return p + 1;
+    }
+    return NULL;
+}
+
+static const uint8_t* skipValue(const uint8_t* p, const uint8_t* end) {
+
+    if (p >= end)
+        return NULL;
+    if (*p == '"')
+        return skipString(p, end);
+    if (*p == '{' || *p == '[') {
+        NSUInteger depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skipString(p, end);
+                if (!p)
+                    return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                ++depth;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0)
+                    return p + 1;
+            }
+            ++p;
+        }
+        return NULL;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+        ++p;
+    return p;
+}
+
+/**
+ * Returns the byte range of the value associated to `key` in the top-level
+ * JSON object contained in bytes, or NSNotFound.
+ */
+static NSRange rangeOfTopLevelValue(const uint8_t* bytes,
+                                    NSUInteger length,
+                                    const char* key,
+                                    size_t keyLength) {
+
+    const uint8_t* end = bytes + length;
+    const uint8_t* p = skipWhitespace(bytes, end);
+    if (p >= end || *p != '{')
+        return NSMakeRange(NSNotFound, 0);
+
+    p = skipWhitespace(p + 1, end);
+    while (p && p < end && *p == '"') {
+        const uint8_t* keyStart = p + 1;
+        p = skipString(p, end);
+        if (!p)
+            break;
+        size_t length = p - 1 - keyStart;
+        p = skipWhitespace(p, end);
+        if (p >= end || *p != ':')
+            break;
+        p = skipWhitespace(p + 1, end);
+        const uint8_t* valueStart = p;
+        p = skipValue(p, end);
+        if (!p)
+            break;
+        if (length == keyLength && memcmp(keyStart, key, keyLength) == 0)
+            return NSMakeRange(valueStart - bytes, p - valueStart);
+        p = skipWhitespace(p, end);
+        if (p >= end || *p != ',')
+            break;
+        p = skipWhitespace(p + 1, end);
+    }
+    return NSMakeRange(NSNotFound, 0);
+}
+
+@implementation BMLHTTPResponse {
+
+    id _jsonObject;
+    NSMutableDictionary* _values;
+}
+
+- (instancetype)initWithData:(NSData*)data statusCode:(NSInteger)statusCode {
+
+    if (self = [super init]) {
+        _data = data ?: [NSData data];
+        _statusCode = statusCode;
+        _values = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (id)valueForTopLevelKey:(NSString*)key {
+
+    @synchronized (self) {
+
+        if (_jsonObject) {
+            return [_jsonObject isKindOfClass:[NSDictionary class]] ? _jsonObject[key] : nil;
+        }
+        id value = _values[key];
+        if (!value) {
+            const char* utf8Key = [key UTF8String];
+            NSRange range = rangeOfTopLevelValue(_data.bytes, _data.length, utf8Key, strlen(utf8Key));
+            if (range.location != NSNotFound) {
+
+                //-- the subdata shares the response buffer; the value does not outlive this scope
+                NSData* valueData =
+                [NSData dataWithBytesNoCopy:(void*)((const uint8_t*)_data.bytes + range.location)
+                                     length:range.length
+                               freeWhenDone:NO];
+                NSError* error = nil;
+                value = [BMLHTTPResponse JSONObjectWithData:valueData error:&error];
+            }
+            _values[key] = value ?: [NSNull null];
+        }
+        return (value == [NSNull null]) ? nil : value;
+    }
+}
+
+- (NSInteger)code {
+
+    id code = [self valueForTopLevelKey:@"code"];
+    return [code respondsToSelector:@selector(integerValue)] ? [code integerValue] : 0;
+}
+
+- (NSDictionary*)status {
+
+    id status = [self valueForTopLevelKey:@"status"];
+    return [status isKindOfClass:[NSDictionary class]] ? status : nil;
+}
+
+- (NSString*)resource {
+
+    id resource = [self valueForTopLevelKey:@"resource"];
+    return [resource isKindOfClass:[NSString class]] ? resource : nil;
+}
+
+- (id)JSONObjectWithError:(NSError**)error {
+
+    @synchronized (self) {
+        if (!_jsonObject && _data.length > 0) {
+            NSError* e = nil;
+            _jsonObject = [BMLHTTPResponse JSONObjectWithData:_data error:&e];
+            if (error)
+                *error = e;
+            if (_jsonObject)
+                _values = nil;
+        }
+        return _jsonObject;
+    }
+}
+
+#pragma mark JSONObjectWithData workaround
+
+//-- workaround for JSONObjectWithData failing with double-precision numbers in scientific notation
+//-- (e.g., 1.0e-128). The regex below is tuned for probabilities. Beware of the risk of a
+//-- resource UUID matching some exponential number (e.g., ..0e12..): the leading [^\\w/] in
+//-- the regex below rules out this possibility.
+//-- Important: the bug seems not to exist for large double precision number, e.g., 1e225.
+//-- Therefore the following regex is only considering negative-signed exponentials.
+
++ (id)JSONObjectWithData:(NSData*)data error:(NSError**)error {
+
+    id jsonObject =
+    [NSJSONSerialization
+     JSONObjectWithData:data
+     options:NSJSONReadingAllowFragments | NSJSONReadingMutableContainers
+     error:error];
+
+    if (!jsonObject || *error) {
+
+        *error = nil;
+        NSString* json = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+        NSRegularExpression* regex = [NSRegularExpression
+                                      regularExpressionWithPattern:@"(-?(?:0|[1-9]\\d*)(?:\\.\\d*)?(?:[eE]-\\d+))"
+                                      options:NSRegularExpressionCaseInsensitive
+                                      error:error];
+        json = [regex stringByReplacingMatchesInString:json
+                                               options:0
+                                                 range:NSMakeRange(0, [json length])
+                                          withTemplate:@"\"$0\""];
+
+        NSData* d = [json dataUsingEncoding:NSUTF8StringEncoding];
+        jsonObject =
+        [NSJSONSerialization
+         JSONObjectWithData:d
+         options:NSJSONReadingAllowFragments | NSJSONReadingMutableContainers
+         error:error];
+
+        jsonObject = [self jsonObjectByNormalizingDoubles:jsonObject];
+
+#ifdef DEBUG
+        if (!jsonObject) {
+            NSLog(@"FAILED TO DECODE RESOURCE JSON: %@", json);
+        }
+#endif
+    }
+    return jsonObject;
+}
+
++ (id)numberFromString:(NSString*)string {
+
+    if (![string isKindOfClass:[NSString class]])
+        return string;
+
+    NSNumber* result = nil;
+    NSScanner* scan = [NSScanner scannerWithString:string];
+    double doubleVal;
+    if ([scan scanDouble:&doubleVal] && [scan isAtEnd]) {
+        result = @([string doubleValue]);
+    }
+    return result ?: string;
+}
+
++ (id)jsonObjectByNormalizingDoubles:(id)jsonObject {
+
+    if ([jsonObject isKindOfClass:[NSMutableArray class]]) {
+        NSMutableArray* array = jsonObject;
+        for (int i = 0; i < array.count; ++i) {
+            [array setObject:[self jsonObjectByNormalizingDoubles:array[i]] atIndexedSubscript:i];
+        }
+    } else if ([jsonObject isKindOfClass:[NSMutableDictionary class]]) {
+        NSMutableDictionary* dict = jsonObject;
+        for (NSString* key in dict.allKeys) {
+            [dict setObject:[self jsonObjectByNormalizingDoubles:dict[key]] forKey:key];
+        }
+    } else if ([jsonObject isKindOfClass:[NSString class]]) {
+        return [self numberFromString:jsonObject];
+    }
+    return jsonObject;
+}
+
+@end
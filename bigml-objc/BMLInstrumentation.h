@@ -0,0 +1,151 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+#import <mach/mach_time.h>
+
+/**
+ * Instrumentation of local scoring: time spent in each stage of a
+ * prediction, and counters kept by each loaded model.
+ *
+ * It is compiled in unless BML_INSTRUMENTATION is defined to 0, and then
+ * disabled until setEnabled: is called: while disabled, each probe costs a
+ * test of a global flag.
+ */
+#ifndef BML_INSTRUMENTATION
+#define BML_INSTRUMENTATION 1
+#endif
+
+typedef enum BMLStage {
+    
+    BMLStageFilter = 0,     //-- FieldResource filteredInputData:byName:
+    BMLStageCast,           //-- FieldResource castInputData:
+    BMLStageTokenize,       //-- FieldResource tokenizedInputData:byName:
+    BMLStageTraversal,      //-- walking decision and anomaly trees
+    BMLStageCombine,        //-- MultiVote combination
+    BMLStageDistance,       //-- nearest centroid search
+    BMLStageCount
+    
+} BMLStage;
+
+/**
+ * Counters of a model, updated atomically.
+ */
+typedef struct BMLModelCounters {
+    
+    uint64_t rows;              //-- rows scored
+    uint64_t nodesVisited;      //-- tree nodes reached, roots included
+    uint64_t depth;             //-- sum of the depths of the reached nodes
+    uint64_t missingBranchHits; //-- predictions stopped above a leaf by a missing value
+    uint64_t earlyStops;        //-- ensemble predictions stopped before the last member
+    
+} BMLModelCounters;
+
+/**
+ * How a model was loaded, recorded once when it is built while
+ * instrumentation is enabled. Not cleared by reset.
+ */
+typedef struct BMLModelLoad {
+    
+    uint64_t parseTicks;        //-- decoding the JSON, when the model was built from JSON data
+    uint64_t buildTicks;        //-- building the local model from the JSON
+    uint64_t nodes;             //-- tree nodes built
+    uint64_t bytes;             //-- heap bytes taken by the nodes, their predicates and arenas
+    uint64_t compiledBytes;     //-- the part of bytes taken by the compiled copy of the trees
+    
+} BMLModelLoad;
+
+/**
+ * The counters of a model, registered with BMLInstrumentation for as long
+ * as the model holds them.
+ */
+@interface BMLModelStats : NSObject
+
+@property (nonatomic, readonly) NSString* label;
+@property (nonatomic, readonly) BMLModelCounters* counters;
+@property (nonatomic, readonly) BMLModelLoad* load;
+
+@end
+
+extern BOOL BMLInstrumentationEnabled;
+
+@interface BMLInstrumentation : NSObject
+
++ (void)setEnabled:(BOOL)enabled;
++ (BOOL)isEnabled;
+
+/**
+ * New counters for a model, included in snapshots while they are alive.
+ * @param label The model's resource id, or any other name for it
+ * @return The counters, or nil when instrumentation is compiled out
+ */
++ (BMLModelStats*)registerModelWithLabel:(NSString*)label;
+
++ (void)recordStage:(BMLStage)stage since:(uint64_t)start;
+
+/**
+ * The current figures, as a JSON-compatible dictionary:
+ * "stages" maps stage names to their call count, total and maximum time
+ * (in ms), and "models" lists the counters of every live model along with
+ * its average depth and, under "load", its parseMs, buildMs, nodes,
+ * bytes and compiledBytes.
+ */
++ (NSDictionary*)snapshot;
+
+/**
+ * Clears stage timers and model counters.
+ */
++ (void)reset;
+
+/**
+ * Writes a snapshot as JSON to a file every `interval` seconds, replacing
+ * the previous one, until stopExporting is called.
+ */
++ (void)startExportingToFile:(NSString*)path interval:(NSTimeInterval)interval;
++ (void)stopExporting;
+
+@end
+
+#if BML_INSTRUMENTATION
+
+#define BML_STAGE_START(name) \
+    uint64_t name = BMLInstrumentationEnabled ? mach_absolute_time() : 0
+
+#define BML_STAGE_END(name, stage) do { \
+    if (name) [BMLInstrumentation recordStage:(stage) since:(name)]; \
+} while (0)
+
+#define BML_STAGE_MARK(name, start) \
+    uint64_t name = (start) ? mach_absolute_time() : 0
+
+#define BML_COUNT(stats, counter, amount) do { \
+    if (BMLInstrumentationEnabled && (stats)) \
+        __atomic_fetch_add(&(stats).counters->counter, (amount), __ATOMIC_RELAXED); \
+} while (0)
+
+#define BML_LOAD_TICKS(stats, phase, start, end) do { \
+    if ((start) && (stats)) \
+        (stats).load->phase = (end) - (start); \
+} while (0)
+
+#else
+
+#define BML_STAGE_START(name)
+#define BML_STAGE_END(name, stage)
+#define BML_STAGE_MARK(name, start)
+#define BML_COUNT(stats, counter, amount)
+#define BML_LOAD_TICKS(stats, phase, start, end)
+
+#endif
@@ -0,0 +1,190 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "BMLInstrumentation.h"
+
+BOOL BMLInstrumentationEnabled = NO;
+
+static uint64_t stageCalls[BMLStageCount];
+static uint64_t stageTicks[BMLStageCount];
+static uint64_t stageMaxTicks[BMLStageCount];
+
+static NSString* const stageNames[BMLStageCount] = {
+    @"filter", @"cast", @"tokenize", @"traversal", @"combine", @"distance"
+};
+
+@implementation BMLModelStats {
+    
+    BMLModelCounters _counters;
+    BMLModelLoad _load;
+}
+
+- (instancetype)initWithLabel:(NSString*)label {
+    
+    if (self = [super init]) {
+        _label = label;
+    }
+    return self;
+}
+
+- (BMLModelCounters*)counters {
+    
+    return &_counters;
+}
+
+- (BMLModelLoad*)load {
+    
+    return &_load;
+}
+
+@end
+
+@implementation BMLInstrumentation
+
++ (NSHashTable*)models {
+    
+    static NSHashTable* models = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        models = [NSHashTable weakObjectsHashTable];
+    });
+    return models;
+}
+
++ (void)setEnabled:(BOOL)enabled {
+    
+    BMLInstrumentationEnabled = enabled && BML_INSTRUMENTATION;
+}
+
++ (BOOL)isEnabled {
+    
+    return BMLInstrumentationEnabled;
+}
+
++ (BMLModelStats*)registerModelWithLabel:(NSString*)label {
+    
+    if (!BML_INSTRUMENTATION)
+        return nil;
+    BMLModelStats* stats = [[BMLModelStats alloc] initWithLabel:label];
+    NSHashTable* models = [self models];
+    @synchronized (models) {
+        [models addObject:stats];
+    }
+    return stats;
+}
+
++ (void)recordStage:(BMLStage)stage since:(uint64_t)start {
+    
+    uint64_t ticks = mach_absolute_time() - start;
+    __atomic_fetch_add(&stageCalls[stage], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stageTicks[stage], ticks, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&stageMaxTicks[stage], __ATOMIC_RELAXED);
+    while (ticks > max &&
+           !__atomic_compare_exchange_n(&stageMaxTicks[stage], &max, ticks, YES,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
++ (NSDictionary*)snapshot {
+    
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double msPerTick = (double)timebase.numer / timebase.denom / NSEC_PER_MSEC;
+    
+    NSMutableDictionary* stages = [NSMutableDictionary dictionaryWithCapacity:BMLStageCount];
+    for (NSUInteger i = 0; i < BMLStageCount; ++i) {
+        stages[stageNames[i]] = @{ @"calls" : @(__atomic_load_n(&stageCalls[i], __ATOMIC_RELAXED)),
+                                   @"totalMs" : @(__atomic_load_n(&stageTicks[i], __ATOMIC_RELAXED) * msPerTick),
+                                   @"maxMs" : @(__atomic_load_n(&stageMaxTicks[i], __ATOMIC_RELAXED) * msPerTick) };
+    }
+    
+    NSMutableArray* models = [NSMutableArray array];
+    NSHashTable* registered = [self models];
+    @synchronized (registered) {
+        for (BMLModelStats* stats in registered) {
+            
+            BMLModelCounters* counters = stats.counters;
+            BMLModelLoad* load = stats.load;
+            uint64_t rows = __atomic_load_n(&counters->rows, __ATOMIC_RELAXED);
+            uint64_t depth = __atomic_load_n(&counters->depth, __ATOMIC_RELAXED);
+            [models addObject:@{ @"model" : stats.label,
+                                 @"rows" : @(rows),
+                                 @"nodesVisited" : @(__atomic_load_n(&counters->nodesVisited, __ATOMIC_RELAXED)),
+                                 @"averageDepth" : @(rows ? (double)depth / rows : 0),
+                                 @"missingBranchHits" : @(__atomic_load_n(&counters->missingBranchHits,
+                                                                          __ATOMIC_RELAXED)),
+                                 @"earlyStops" : @(__atomic_load_n(&counters->earlyStops, __ATOMIC_RELAXED)),
+                                 @"load" : @{ @"parseMs" : @(load->parseTicks * msPerTick),
+                                              @"buildMs" : @(load->buildTicks * msPerTick),
+                                              @"nodes" : @(load->nodes),
+                                              @"bytes" : @(load->bytes),
+                                              @"compiledBytes" : @(load->compiledBytes) } }];
+        }
+    }
+    return @{ @"enabled" : @(BMLInstrumentationEnabled),
+              @"stages" : stages,
+              @"models" : models };
+}
+
++ (void)reset {
+    
+    for (NSUInteger i = 0; i < BMLStageCount; ++i) {
+        __atomic_store_n(&stageCalls[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stageTicks[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stageMaxTicks[i], 0, __ATOMIC_RELAXED);
+    }
+    NSHashTable* registered = [self models];
+    @synchronized (registered) {
+        for (BMLModelStats* stats in registered) {
+            memset(stats.counters, 0, sizeof(BMLModelCounters));
+        }
+    }
+}
+
+#pragma mark Export
+
+static dispatch_source_t exportTimer = nil;
+
++ (void)startExportingToFile:(NSString*)path interval:(NSTimeInterval)interval {
+    
+    [self stopExporting];
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0,
+                                                     dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_timer(timer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+                              (uint64_t)(interval * NSEC_PER_SEC),
+                              (uint64_t)(interval * NSEC_PER_SEC / 10));
+    dispatch_source_set_event_handler(timer, ^{
+        NSMutableDictionary* snapshot = [[self snapshot] mutableCopy];
+        snapshot[@"date"] = [[NSDate date] description];
+        [[NSJSONSerialization dataWithJSONObject:snapshot options:NSJSONWritingPrettyPrinted error:nil]
+         writeToFile:path atomically:YES];
+    });
+    @synchronized (self) {
+        exportTimer = timer;
+    }
+    dispatch_resume(timer);
+}
+
++ (void)stopExporting {
+    
+    @synchronized (self) {
+        if (exportTimer) {
+            dispatch_source_cancel(exportTimer);
+            exportTimer = nil;
+        }
+    }
+}
+
+@end
@@ -0,0 +1,65 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A reference to the current version of a loaded local model (a
+ * PredictiveModel, PredictiveEnsemble, Anomaly, PredictiveCluster or any
+ * other object), which can be replaced by a new version while other threads
+ * keep scoring.
+ *
+ * Readers take no lock: currentModel registers the reader with the current
+ * epoch only for as long as it takes to retain the model, so every reader
+ * gets either the old or the new version, whole, and keeps it for as long as
+ * it holds the reference. Publishing swaps the version atomically, waits for
+ * the readers of older epochs to leave (a few instructions each), then drops
+ * the handle's reference to the old version, which is freed as soon as the
+ * last prediction using it finishes.
+ */
+@interface BMLModelHandle : NSObject
+
+- (instancetype)initWithModel:(id)model;
+
+/**
+ * The current version of the model. Callers should read it once per
+ * prediction (or batch), and use that reference throughout.
+ */
+- (id)currentModel;
+
+/**
+ * The number of versions published, the initial one included.
+ */
+@property (nonatomic, readonly) NSUInteger version;
+
+/**
+ * Makes `model` the current version. Returns once no reader can get the
+ * previous version anymore. Publishers are serialized with each other, but
+ * never block readers.
+ */
+- (void)publishModel:(id)model;
+
+/**
+ * Builds a new version off the calling thread, e.g. from JSON with
+ * PredictiveModel initWithJSONModel:, and publishes it.
+ *
+ * @param builder Called on a background queue; returns the new version, or
+ *        nil to keep the current one
+ * @param completion Called on the same queue, with YES when a version was
+ *        published
+ */
+- (void)publishModelFromBuilder:(id(^)(void))builder
+                     completion:(void(^)(BOOL published))completion;
+
+@end
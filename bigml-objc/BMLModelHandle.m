@@ -0,0 +1,98 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "BMLModelHandle.h"
+#import <stdatomic.h>
+#import <sched.h>
+
+@implementation BMLModelHandle {
+    
+    //-- the current version, retained by the handle
+    _Atomic(uintptr_t) _current;
+    
+    //-- readers register with the parity of the epoch they started in
+    atomic_uint _epoch;
+    atomic_uint _readers[2];
+    
+    atomic_ulong _version;
+}
+
+- (instancetype)initWithModel:(id)model {
+    
+    NSAssert(model, @"initWithModel: contract unfulfilled");
+    if (self = [super init]) {
+        atomic_init(&_current, (uintptr_t)CFBridgingRetain(model));
+        atomic_init(&_epoch, 0);
+        atomic_init(&_readers[0], 0);
+        atomic_init(&_readers[1], 0);
+        atomic_init(&_version, 1);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    CFRelease((CFTypeRef)atomic_load(&_current));
+}
+
+- (id)currentModel {
+    
+    unsigned int parity = atomic_load(&_epoch) & 1;
+    atomic_fetch_add(&_readers[parity], 1);
+    
+    //-- the version cannot be released before this reader leaves its epoch
+    CFTypeRef model = CFRetain((CFTypeRef)atomic_load(&_current));
+    atomic_fetch_sub(&_readers[parity], 1);
+    return CFBridgingRelease(model);
+}
+
+- (NSUInteger)version {
+    
+    return atomic_load(&_version);
+}
+
+- (void)publishModel:(id)model {
+    
+    NSAssert(model, @"publishModel: contract unfulfilled");
+    @synchronized (self) {
+        
+        CFTypeRef previous = (CFTypeRef)atomic_exchange(&_current, (uintptr_t)CFBridgingRetain(model));
+        atomic_fetch_add(&_version, 1);
+        
+        //-- two epochs, as a reader may have read the epoch before the last
+        //-- flip but registered after it
+        for (NSUInteger round = 0; round < 2; ++round) {
+            unsigned int parity = atomic_fetch_add(&_epoch, 1) & 1;
+            while (atomic_load(&_readers[parity]) > 0) {
+                sched_yield();
+            }
+        }
+        CFRelease(previous);
+    }
+}
+
+- (void)publishModelFromBuilder:(id(^)(void))builder
+                     completion:(void(^)(BOOL published))completion {
+    
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        
+        id model = builder();
+        if (model)
+            [self publishModel:model];
+        if (completion)
+            completion(model != nil);
+    });
+}
+
+@end
@@ -0,0 +1,90 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ * The timing and sizes of an HTTP request made to BigML.io.
+ *
+ * The phases come from NSURLSessionTaskMetrics where the system provides them
+ * (iOS 10, macOS 10.12 and later); otherwise they are 0 and only the total
+ * time, measured by the library, is known. Times are in seconds.
+ */
+@interface BMLRequestTrace : NSObject
+
+@property (nonatomic, copy) NSString* method;
+
+/// the resource type in the URL, e.g. "source", or "" if there is none
+@property (nonatomic, copy) NSString* resourceType;
+
+/// the URL path, without the query string holding the credentials
+@property (nonatomic, copy) NSString* path;
+
+/// the HTTP status code, 0 when no response was received
+@property (nonatomic) NSInteger statusCode;
+
+/// the transport error, if any
+@property (nonatomic, strong) NSError* error;
+
+@property (nonatomic) int64_t requestBytes;
+@property (nonatomic) int64_t responseBytes;
+
+/// time between the task start and the request being sent, besides DNS and connection
+@property (nonatomic) NSTimeInterval queueWait;
+@property (nonatomic) NSTimeInterval dnsTime;
+@property (nonatomic) NSTimeInterval connectTime;
+
+/// time from the request being sent to the first byte of the response
+@property (nonatomic) NSTimeInterval timeToFirstByte;
+@property (nonatomic) NSTimeInterval totalTime;
+
+@end
+
+/**
+ * Receives a trace for every request made by a BMLAPIConnector, see its
+ * requestObserver property. Methods are called on a background queue.
+ */
+@protocol BMLRequestObserver <NSObject>
+
+- (void)requestDidFinish:(BMLRequestTrace*)trace;
+
+@optional
+
+/**
+ * Called when a bulk operation is going to retry a request that failed.
+ */
+- (void)requestWillBeRetriedAfterError:(NSError*)error;
+
+@end
+
+/**
+ * A request observer that aggregates traces per resource type and HTTP
+ * method: counts, status codes, bytes, mean time of each phase and a
+ * histogram of the total time.
+ */
+@interface BMLRequestMetrics : NSObject <BMLRequestObserver>
+
+/**
+ * The aggregated metrics as a JSON-compatible dictionary. "operations" maps
+ * keys like "source POST" to their figures, including a histogram of total
+ * times in ms (counts per upper bound, the last bucket being unbounded) and
+ * the p50, p90 and p99 estimated from it. "retries" counts the retries of
+ * bulk operations.
+ */
+- (NSDictionary*)snapshot;
+
+- (void)reset;
+
+@end
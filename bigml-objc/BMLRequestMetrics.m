@@ -0,0 +1,180 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "BMLRequestMetrics.h"
+
+//-- upper bounds, in ms, of the total time histogram buckets
+static const double latencyBounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000 };
+#define LATENCY_BUCKETS (sizeof(latencyBounds) / sizeof(latencyBounds[0]) + 1)
+
+@implementation BMLRequestTrace
+
+@end
+
+/**
+ * The figures of one operation, i.e. resource type and method.
+ */
+@interface BMLOperationMetrics : NSObject
+
+- (void)addTrace:(BMLRequestTrace*)trace;
+- (NSDictionary*)snapshot;
+
+@end
+
+@implementation BMLOperationMetrics {
+    
+    NSUInteger _count;
+    NSUInteger _errors;
+    NSMutableDictionary* _statusCodes;
+    int64_t _requestBytes;
+    int64_t _responseBytes;
+    NSTimeInterval _queueWait;
+    NSTimeInterval _dnsTime;
+    NSTimeInterval _connectTime;
+    NSTimeInterval _timeToFirstByte;
+    NSTimeInterval _totalTime;
+    NSTimeInterval _maxTime;
+    NSUInteger _histogram[LATENCY_BUCKETS];
+}
+
+- (instancetype)init {
+    
+    if (self = [super init]) {
+        _statusCodes = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)addTrace:(BMLRequestTrace*)trace {
+    
+    ++_count;
+    if (trace.error)
+        ++_errors;
+    NSString* status = [NSString stringWithFormat:@"%ld", (long)trace.statusCode];
+    _statusCodes[status] = @([_statusCodes[status] unsignedIntegerValue] + 1);
+    _requestBytes += trace.requestBytes;
+    _responseBytes += trace.responseBytes;
+    _queueWait += trace.queueWait;
+    _dnsTime += trace.dnsTime;
+    _connectTime += trace.connectTime;
+    _timeToFirstByte += trace.timeToFirstByte;
+    _totalTime += trace.totalTime;
+    _maxTime = MAX(_maxTime, trace.totalTime);
+    
+    NSUInteger bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && trace.totalTime * 1000 > latencyBounds[bucket])
+        ++bucket;
+    ++_histogram[bucket];
+}
+
+/**
+ * The upper bound of the bucket holding the given quantile, or the largest
+ * time seen for the unbounded bucket.
+ */
+- (double)quantileMs:(double)quantile {
+    
+    NSUInteger rank = (NSUInteger)ceil(quantile * _count), seen = 0;
+    for (NSUInteger i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += _histogram[i];
+        if (seen >= rank && seen > 0)
+            return i < LATENCY_BUCKETS - 1 ? MIN(latencyBounds[i], _maxTime * 1000) : _maxTime * 1000;
+    }
+    return 0;
+}
+
+- (NSDictionary*)snapshot {
+    
+    double count = MAX(_count, 1);
+    NSMutableDictionary* histogram = [NSMutableDictionary dictionaryWithCapacity:LATENCY_BUCKETS];
+    for (NSUInteger i = 0; i < LATENCY_BUCKETS; ++i) {
+        NSString* bound = i < LATENCY_BUCKETS - 1 ? [NSString stringWithFormat:@"%g", latencyBounds[i]] : @"inf";
+        histogram[bound] = @(_histogram[i]);
+    }
+    return @{ @"count" : @(_count),
+              @"errors" : @(_errors),
+              @"statusCodes" : [_statusCodes copy],
+              @"requestBytes" : @(_requestBytes),
+              @"responseBytes" : @(_responseBytes),
+              @"meanQueueWaitMs" : @(_queueWait * 1000 / count),
+              @"meanDnsMs" : @(_dnsTime * 1000 / count),
+              @"meanConnectMs" : @(_connectTime * 1000 / count),
+              @"meanTimeToFirstByteMs" : @(_timeToFirstByte * 1000 / count),
+              @"meanTotalMs" : @(_totalTime * 1000 / count),
+              @"totalMs" : @(_totalTime * 1000),
+              @"maxMs" : @(_maxTime * 1000),
+              @"p50Ms" : @([self quantileMs:0.5]),
+              @"p90Ms" : @([self quantileMs:0.9]),
+              @"p99Ms" : @([self quantileMs:0.99]),
+              @"histogramMs" : histogram };
+}
+
+@end
+
+@implementation BMLRequestMetrics {
+    
+    NSMutableDictionary* _operations;
+    NSUInteger _retries;
+}
+
+- (instancetype)init {
+    
+    if (self = [super init]) {
+        _operations = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)requestDidFinish:(BMLRequestTrace*)trace {
+    
+    NSString* key = trace.resourceType.length > 0 ?
+    [NSString stringWithFormat:@"%@ %@", trace.resourceType, trace.method] : trace.method;
+    @synchronized (self) {
+        BMLOperationMetrics* operation = _operations[key];
+        if (!operation) {
+            operation = [BMLOperationMetrics new];
+            _operations[key] = operation;
+        }
+        [operation addTrace:trace];
+    }
+}
+
+- (void)requestWillBeRetriedAfterError:(NSError*)error {
+    
+    @synchronized (self) {
+        ++_retries;
+    }
+}
+
+- (NSDictionary*)snapshot {
+    
+    @synchronized (self) {
+        NSMutableDictionary* operations = [NSMutableDictionary dictionaryWithCapacity:_operations.count];
+        for (NSString* key in _operations) {
+            operations[key] = [_operations[key] snapshot];
+        }
+        return @{ @"operations" : operations,
+                  @"retries" : @(_retries) };
+    }
+}
+
+- (void)reset {
+    
+    @synchronized (self) {
+        [_operations removeAllObjects];
+        _retries = 0;
+    }
+}
+
+@end
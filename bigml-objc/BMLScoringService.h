@@ -0,0 +1,80 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A front-end to a loaded local predictor for servers scoring one row per
+ * request from many threads. Rows submitted concurrently are queued and
+ * scored together in batches, each handed to the predictor in one call
+ * (see PredictiveEnsemble predictWithRows:options:), and every caller is
+ * then completed with its own result.
+ *
+ * A batch is scored as soon as it holds maxBatchSize rows, or maxDelay
+ * seconds after its first row was queued, whichever comes first, so that
+ * batching adds at most maxDelay to the latency of a request. Batches are
+ * scored on a concurrent queue: several may be in progress at once.
+ */
+@interface BMLScoringService : NSObject
+
+/**
+ * @param predictor A loaded PredictiveModel, PredictiveEnsemble, Anomaly or
+ *        PredictiveCluster, or a BMLModelHandle to one, whose current version
+ *        is then used for each batch
+ * @param maxBatchSize The number of rows that triggers scoring at once
+ * @param maxDelay The longest time, in seconds, a row waits for its batch to
+ *        fill up
+ */
+- (instancetype)initWithPredictor:(id)predictor
+                     maxBatchSize:(NSUInteger)maxBatchSize
+                         maxDelay:(NSTimeInterval)maxDelay;
+
+@property (nonatomic, readonly) id predictor;
+@property (nonatomic, readonly) NSUInteger maxBatchSize;
+@property (nonatomic, readonly) NSTimeInterval maxDelay;
+
+/**
+ * Queues a row for scoring.
+ *
+ * @param arguments The input data
+ * @param options The options of the predictor's own prediction method; rows
+ *        of a batch with different options are scored in separate calls
+ * @param completion Called on an arbitrary queue with the result, as in
+ *        PredictiveGroup predictWithArguments:options: (the prediction
+ *        dictionary for models and ensembles, the nearest centroid for
+ *        clusters and a dictionary with a "score" for anomaly detectors)
+ */
+- (void)scoreArguments:(NSDictionary*)arguments
+               options:(NSDictionary*)options
+            completion:(void(^)(id result))completion;
+
+/**
+ * Same as scoreArguments:options:completion:, waiting for the result.
+ */
+- (id)scoreArgumentsSync:(NSDictionary*)arguments options:(NSDictionary*)options;
+
+/**
+ * Scores the rows queued so far without waiting for the batch to fill up.
+ */
+- (void)flush;
+
+/**
+ * Batches and rows scored so far, and the mean batch size.
+ */
+@property (nonatomic, readonly) NSUInteger batchCount;
+@property (nonatomic, readonly) NSUInteger rowCount;
+
+- (double)meanBatchSize;
+
+@end
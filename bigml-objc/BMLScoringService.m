@@ -0,0 +1,199 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "BMLScoringService.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "PredictiveCluster.h"
+#import "Anomaly.h"
+#import "BMLModelHandle.h"
+
+/**
+ * A row waiting in a batch.
+ */
+@interface BMLScoringRequest : NSObject
+
+@property (nonatomic, strong) NSDictionary* arguments;
+@property (nonatomic, strong) NSDictionary* options;
+@property (nonatomic, copy) void(^completion)(id result);
+
+@end
+
+@implementation BMLScoringRequest
+@end
+
+@implementation BMLScoringService {
+    
+    //-- the batch being filled and the counters are only accessed on _queue
+    dispatch_queue_t _queue;
+    NSMutableArray* _pending;
+    NSUInteger _generation;
+    NSUInteger _batchCount;
+    NSUInteger _rowCount;
+}
+
+- (instancetype)initWithPredictor:(id)predictor
+                     maxBatchSize:(NSUInteger)maxBatchSize
+                         maxDelay:(NSTimeInterval)maxDelay {
+    
+    NSAssert(predictor && maxBatchSize > 0 && maxDelay >= 0,
+             @"initWithPredictor:maxBatchSize:maxDelay: contract unfulfilled");
+    
+    if (self = [super init]) {
+        _predictor = predictor;
+        _maxBatchSize = maxBatchSize;
+        _maxDelay = maxDelay;
+        _queue = dispatch_queue_create("com.bigml.scoring-service", DISPATCH_QUEUE_SERIAL);
+        _pending = [NSMutableArray arrayWithCapacity:maxBatchSize];
+    }
+    return self;
+}
+
+- (void)scoreArguments:(NSDictionary*)arguments
+               options:(NSDictionary*)options
+            completion:(void(^)(id result))completion {
+    
+    BMLScoringRequest* request = [BMLScoringRequest new];
+    request.arguments = arguments;
+    request.options = options ?: @{};
+    request.completion = completion;
+    
+    dispatch_async(_queue, ^{
+        
+        [_pending addObject:request];
+        if (_pending.count >= _maxBatchSize) {
+            [self scorePending];
+        } else if (_pending.count == 1) {
+            
+            //-- the first row of a batch starts its clock
+            NSUInteger generation = _generation;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_maxDelay * NSEC_PER_SEC)), _queue, ^{
+                if (_generation == generation)
+                    [self scorePending];
+            });
+        }
+    });
+}
+
+- (id)scoreArgumentsSync:(NSDictionary*)arguments options:(NSDictionary*)options {
+    
+    __block id result = nil;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [self scoreArguments:arguments options:options completion:^(id batchResult) {
+        result = batchResult;
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    return result;
+}
+
+- (void)flush {
+    
+    dispatch_async(_queue, ^{
+        [self scorePending];
+    });
+}
+
+//-- runs on _queue
+- (void)scorePending {
+    
+    if (_pending.count == 0)
+        return;
+    NSArray* batch = _pending;
+    _pending = [NSMutableArray arrayWithCapacity:_maxBatchSize];
+    ++_generation;
+    ++_batchCount;
+    _rowCount += batch.count;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [self scoreBatch:batch];
+    });
+}
+
+- (void)scoreBatch:(NSArray*)batch {
+    
+    //-- batches rarely mix options: group rows keeping their order
+    NSMutableArray* optionGroups = [NSMutableArray new];
+    NSMutableArray* requestGroups = [NSMutableArray new];
+    for (BMLScoringRequest* request in batch) {
+        NSUInteger group = [optionGroups indexOfObject:request.options];
+        if (group == NSNotFound) {
+            group = optionGroups.count;
+            [optionGroups addObject:request.options];
+            [requestGroups addObject:[NSMutableArray new]];
+        }
+        [requestGroups[group] addObject:request];
+    }
+    
+    [optionGroups enumerateObjectsUsingBlock:^(NSDictionary* options, NSUInteger group, BOOL* stop) {
+        
+        NSArray* requests = requestGroups[group];
+        NSArray* results = [self resultsForRows:[requests valueForKey:@"arguments"] options:options];
+        [requests enumerateObjectsUsingBlock:^(BMLScoringRequest* request, NSUInteger i, BOOL* stop) {
+            if (request.completion)
+                request.completion(results[i] == [NSNull null] ? nil : results[i]);
+        }];
+    }];
+}
+
+- (NSArray*)resultsForRows:(NSArray*)rows options:(NSDictionary*)options {
+    
+    //-- the whole batch is scored by the same version of a handle's model
+    id predictor = [_predictor isKindOfClass:[BMLModelHandle class]] ? [_predictor currentModel] : _predictor;
+    if ([predictor isKindOfClass:[PredictiveEnsemble class]])
+        return [(PredictiveEnsemble*)predictor predictWithRows:rows options:options];
+    
+    NSMutableArray* results = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        
+        id result = nil;
+        if ([predictor isKindOfClass:[PredictiveModel class]]) {
+            result = [[(PredictiveModel*)predictor predictWithArguments:row options:options] firstObject];
+        } else if ([predictor isKindOfClass:[Anomaly class]]) {
+            result = @{ @"score" : @([(Anomaly*)predictor score:row options:options]) };
+        } else if ([predictor isKindOfClass:[PredictiveCluster class]]) {
+            result = [(PredictiveCluster*)predictor predictWithArguments:row options:options];
+        }
+        [results addObject:result ?: [NSNull null]];
+    }
+    return results;
+}
+
+- (NSUInteger)batchCount {
+    
+    __block NSUInteger batchCount = 0;
+    dispatch_sync(_queue, ^{
+        batchCount = _batchCount;
+    });
+    return batchCount;
+}
+
+- (NSUInteger)rowCount {
+    
+    __block NSUInteger rowCount = 0;
+    dispatch_sync(_queue, ^{
+        rowCount = _rowCount;
+    });
+    return rowCount;
+}
+
+- (double)meanBatchSize {
+    
+    __block double meanBatchSize = 0;
+    dispatch_sync(_queue, ^{
+        meanBatchSize = _batchCount > 0 ? (double)_rowCount / _batchCount : 0;
+    });
+    return meanBatchSize;
+}
+
+@end
@@ -124,6 +124,8 @@
 
 /**
  * Checks expected type in input data values, strips affixes and casts
+ * strings holding numbers to NSNumber for numeric fields. Strings that
+ * do not hold a number are kept, without their affixes.
  *
  * @param inputData
  * @param fields
@@ -131,4 +133,71 @@
  */
 + (NSDictionary*)cast:(NSDictionary*)inputData fields:(NSDictionary*)fields;
 
+/**
+ * Removes a field's prefix and suffix, when present, from a value.
+ */
++ (NSString*)stripAffixesFromValue:(NSString*)value field:(NSDictionary*)field;
+
+/**
+ * Parses a number straight from the UTF-8 bytes of a string, without
+ * creating intermediate objects. Leading and trailing blanks are skipped,
+ * as are the prefix and suffix when present; either the decimal separator
+ * or '.' may introduce the decimals. Digit grouping is not supported.
+ *
+ * @param prefix, suffix The UTF-8 bytes of the field affixes, or nil
+ * @param decimalSeparator The decimal separator of the input locale
+ * @param value Set to the number parsed
+ * @return NO when the string does not hold a number
+ */
++ (BOOL)parseNumber:(NSString*)string
+             prefix:(NSData*)prefix
+             suffix:(NSData*)suffix
+   decimalSeparator:(char)decimalSeparator
+              value:(double*)value;
+
+/**
+ * Reads a CSV file whose first line holds the column names. Values may be
+ * enclosed in double quotes, in which case a double quote is written twice.
+ * A leading UTF-8 byte order mark is skipped.
+ *
+ * @param path The file path
+ * @param error Set when the file cannot be read
+ * @return An array of rows, as dictionaries keyed by column name. Empty
+ *         values are left out.
+ */
++ (NSArray*)rowsFromCSVFile:(NSString*)path error:(NSError**)error;
+
+/**
+ * Same as rowsFromCSVFile:error:, reading the file a buffer at a time and
+ * handing its rows to `block` in batches, so that files of any size can be
+ * processed in bounded memory.
+ *
+ * @param batchSize The number of rows per batch; the last one may be smaller
+ * @param block Called on the calling thread with each batch; setting `stop`
+ *        to YES ends the enumeration
+ * @return NO, setting `error`, when the file cannot be read or is not UTF-8
+ */
++ (BOOL)enumerateRowsOfCSVFile:(NSString*)path
+                     batchSize:(NSUInteger)batchSize
+                         error:(NSError**)error
+                    usingBlock:(void(^)(NSArray* rows, BOOL* stop))block;
+
+/**
+ * A monotonic clock, unaffected by changes to the system time, cheap enough
+ * to be read on prediction hot paths
+ *
+ * @return the current time in seconds from an arbitrary origin
+ */
++ (NSTimeInterval)monotonicTime;
+
+/**
+ * Atomically raises a running maximum of durations, such as the slowest
+ * step seen so far by a predictor shared between threads
+ *
+ * @param maximum The maximum to update
+ * @param duration A new duration; 0 just reads the maximum
+ * @return the maximum, after the update
+ */
++ (NSTimeInterval)raiseMaximum:(NSTimeInterval*)maximum toDuration:(NSTimeInterval)duration;
+
 @end
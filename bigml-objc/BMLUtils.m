@@ -13,10 +13,16 @@
 // under the License.
 
 #import "BMLUtils.h"
+#import "NSError+BMLError.h"
+#import <mach/mach_time.h>
+#import <xlocale.h>
 #import "PredictionTree.h"
 #import "Predicates.h"
 
 #define zDistributionDefault 1.96
+#define CSV_BATCH_SIZE 4096
+#define NUMBER_BUFFER_SIZE 64
+#define CSV_READ_BUFFER 65536
 
 @implementation BMLUtils
 
@@ -259,34 +265,298 @@
 
 + (NSString*)stripAffixesFromValue:(NSString*)value field:(NSDictionary*)field {
     
-    if (field[@"prefix"]) {
-        NSRange r = [value rangeOfString:field[@"prefix"]];
-        if (r.location == 0)
-            value = [value substringFromIndex:r.length];
-    }
+    NSString* prefix = field[@"prefix"];
+    if (prefix.length > 0 && [value hasPrefix:prefix])
+        value = [value substringFromIndex:prefix.length];
+    
+    NSString* suffix = field[@"suffix"];
+    if (suffix.length > 0 && [value hasSuffix:suffix])
+        value = [value substringToIndex:value.length - suffix.length];
+    return value;
+}
+
+static locale_t numericLocale() {
+    
+    //-- strtod_l with the C locale, so that the process locale does not matter
+    static locale_t locale;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        locale = newlocale(LC_NUMERIC_MASK, "C", NULL);
+    });
+    return locale;
+}
 
-    if (field[@"suffix"]) {
-        NSRange r = [value rangeOfString:field[@"suffix"]];
-        if (r.location == value.length - [field[@"suffix"] length])
-            value = [value substringToIndex:r.location - 1];
+static inline BOOL isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
++ (BOOL)parseNumber:(NSString*)string
+             prefix:(NSData*)prefix
+             suffix:(NSData*)suffix
+   decimalSeparator:(char)decimalSeparator
+              value:(double*)value {
+    
+    //-- most strings expose their bytes directly; short ones are copied otherwise
+    char buffer[NUMBER_BUFFER_SIZE];
+    const char* bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    size_t length = 0;
+    if (bytes) {
+        length = strlen(bytes);
+    } else {
+        CFIndex characters = CFStringGetLength((__bridge CFStringRef)string);
+        CFIndex used = 0;
+        CFIndex converted = CFStringGetBytes((__bridge CFStringRef)string,
+                                             CFRangeMake(0, characters),
+                                             kCFStringEncodingUTF8,
+                                             0,
+                                             false,
+                                             (UInt8*)buffer,
+                                             sizeof(buffer),
+                                             &used);
+        if (converted < characters)
+            return NO;
+        bytes = buffer;
+        length = used;
     }
-    return value;
+    
+    const char* start = bytes;
+    const char* end = bytes + length;
+    while (start < end && isBlank(*start))
+        ++start;
+    while (end > start && isBlank(end[-1]))
+        --end;
+    if (prefix.length > 0 && (size_t)(end - start) >= prefix.length &&
+        memcmp(start, prefix.bytes, prefix.length) == 0)
+        start += prefix.length;
+    if (suffix.length > 0 && (size_t)(end - start) >= suffix.length &&
+        memcmp(end - suffix.length, suffix.bytes, suffix.length) == 0)
+        end -= suffix.length;
+    while (start < end && isBlank(*start))
+        ++start;
+    while (end > start && isBlank(end[-1]))
+        --end;
+    
+    //-- only plain decimal notation: strtod alone would also take "nan", "inf" or hex
+    size_t count = end - start;
+    if (count == 0 || count >= NUMBER_BUFFER_SIZE)
+        return NO;
+    char number[NUMBER_BUFFER_SIZE];
+    BOOL digits = NO;
+    for (size_t i = 0; i < count; ++i) {
+        char c = start[i];
+        if (c == decimalSeparator)
+            c = '.';
+        if (c >= '0' && c <= '9')
+            digits = YES;
+        else if (c != '.' && c != '-' && c != '+' && c != 'e' && c != 'E')
+            return NO;
+        number[i] = c;
+    }
+    number[count] = 0;
+    if (!digits)
+        return NO;
+    
+    char* parsed = NULL;
+    double result = strtod_l(number, &parsed, numericLocale());
+    if (parsed != number + count)
+        return NO;
+    *value = result;
+    return YES;
 }
 
 + (NSDictionary*)cast:(NSDictionary*)inputData fields:(NSDictionary*)fields {
     
-    NSMutableDictionary* output = [NSMutableDictionary dictionaryWithCapacity:inputData.allKeys.count];
-    for (id fieldId in inputData.allKeys) {
+    NSMutableDictionary* output = [NSMutableDictionary dictionaryWithCapacity:inputData.count];
+    for (id fieldId in inputData) {
         id value = inputData[fieldId];
         NSDictionary* field = fields[fieldId];
-        NSString* opType = field[@"optype"];
         
-        if ([opType isEqualToString:@"numeric"] && [value isKindOfClass:[NSString class]]) {
-            value = [self stripAffixesFromValue:value field:field];
+        if ([value isKindOfClass:[NSString class]] && [field[@"optype"] isEqualToString:@"numeric"]) {
+            double number = 0;
+            if ([self parseNumber:value
+                           prefix:[field[@"prefix"] dataUsingEncoding:NSUTF8StringEncoding]
+                           suffix:[field[@"suffix"] dataUsingEncoding:NSUTF8StringEncoding]
+                 decimalSeparator:'.'
+                            value:&number])
+                value = @(number);
+            else
+                value = [self stripAffixesFromValue:value field:field];
         }
         output[fieldId] = value;
     }
     return output;
 }
 
++ (NSArray*)rowsFromCSVFile:(NSString*)path error:(NSError**)error {
+    
+    NSMutableArray* rows = [NSMutableArray array];
+    BOOL read = [self enumerateRowsOfCSVFile:path
+                                   batchSize:CSV_BATCH_SIZE
+                                       error:error
+                                  usingBlock:^(NSArray* batch, BOOL* stop) {
+                                      [rows addObjectsFromArray:batch];
+                                  }];
+    return read ? rows : nil;
+}
+
+/**
+ * The state of the CSV parser, carried over from one read buffer to the next.
+ */
+typedef struct CSVParser {
+    
+    BOOL quoted;        //-- inside a quoted value
+    BOOL afterQuote;    //-- a double quote was just seen inside a quoted value
+    BOOL afterCR;       //-- the last line ended with a carriage return
+    
+} CSVParser;
+
+static inline BOOL isCSVDelimiter(uint8_t c) {
+    
+    return c == '"' || c == ',' || c == '\n' || c == '\r';
+}
+
++ (BOOL)enumerateRowsOfCSVFile:(NSString*)path
+                     batchSize:(NSUInteger)batchSize
+                         error:(NSError**)error
+                    usingBlock:(void(^)(NSArray* rows, BOOL* stop))block {
+    
+    NSAssert(batchSize > 0, @"enumerateRowsOfCSVFile:batchSize:error:usingBlock: contract unfulfilled");
+    FILE* file = fopen(path.fileSystemRepresentation, "rb");
+    if (!file) {
+        if (error)
+            *error = [NSError errorWithInfo:@"Could not read CSV file" code:-10400];
+        return NO;
+    }
+    
+    __block NSArray* header = nil;
+    __block NSMutableArray* rows = [NSMutableArray arrayWithCapacity:batchSize];
+    __block BOOL stop = NO;
+    __block BOOL invalid = NO;
+    NSMutableData* value = [NSMutableData data];
+    NSMutableArray* line = [NSMutableArray array];
+    
+    void(^endValue)(void) = ^{
+        NSString* string = [[NSString alloc] initWithBytes:value.bytes
+                                                    length:value.length
+                                                  encoding:NSUTF8StringEncoding];
+        invalid = invalid || !string;
+        [line addObject:string ?: @""];
+        value.length = 0;
+    };
+    void(^endLine)(void) = ^{
+        if (!header) {
+            header = [line copy];
+        } else if (line.count > 1 || [line.firstObject length] > 0) {
+            NSMutableDictionary* row = [NSMutableDictionary dictionaryWithCapacity:header.count];
+            for (NSUInteger j = 0; j < MIN(header.count, line.count); ++j) {
+                if ([line[j] length] > 0)
+                    row[header[j]] = line[j];
+            }
+            [rows addObject:row];
+            if (rows.count == batchSize) {
+                block(rows, &stop);
+                rows = [NSMutableArray arrayWithCapacity:batchSize];
+            }
+        }
+        [line removeAllObjects];
+    };
+    
+    CSVParser parser = { NO, NO, NO };
+    uint8_t buffer[CSV_READ_BUFFER];
+    size_t count;
+    BOOL firstBuffer = YES;
+    while (!stop && !invalid && (count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        
+        //-- a UTF-8 byte order mark is not part of the first column name
+        size_t i = 0;
+        if (firstBuffer && count >= 3 && memcmp(buffer, "\xEF\xBB\xBF", 3) == 0)
+            i = 3;
+        firstBuffer = NO;
+        while (i < count && !stop) {
+            
+            uint8_t c = buffer[i];
+            if (parser.afterQuote) {
+                parser.afterQuote = NO;
+                if (c == '"') {
+                    [value appendBytes:&c length:1];
+                    ++i;
+                    continue;
+                }
+                parser.quoted = NO;
+            }
+            if (parser.quoted) {
+                
+                //-- quoted values are copied a run at a time, up to the next quote
+                const uint8_t* quote = memchr(buffer + i, '"', count - i);
+                size_t end = quote ? (size_t)(quote - buffer) : count;
+                [value appendBytes:buffer + i length:end - i];
+                parser.afterQuote = quote != NULL;
+                i = quote ? end + 1 : count;
+                continue;
+            }
+            
+            BOOL afterCR = parser.afterCR;
+            parser.afterCR = NO;
+            if (c == '"') {
+                parser.quoted = YES;
+            } else if (c == ',') {
+                endValue();
+            } else if (c == '\n' || c == '\r') {
+                if (!(c == '\n' && afterCR)) {
+                    parser.afterCR = c == '\r';
+                    endValue();
+                    endLine();
+                }
+            } else {
+                size_t end = i + 1;
+                while (end < count && !isCSVDelimiter(buffer[end])) {
+                    ++end;
+                }
+                [value appendBytes:buffer + i length:end - i];
+                i = end;
+                continue;
+            }
+            ++i;
+        }
+    }
+    BOOL failed = ferror(file) != 0 || invalid;
+    fclose(file);
+    if (failed) {
+        if (error)
+            *error = [NSError errorWithInfo:@"Could not read CSV file" code:-10400];
+        return NO;
+    }
+    
+    if (!stop) {
+        if (value.length > 0 || line.count > 0) {
+            endValue();
+            endLine();
+        }
+        if (rows.count > 0)
+            block(rows, &stop);
+    }
+    return YES;
+}
+
++ (NSTimeInterval)monotonicTime {
+    
+    static double secondsPerTick = 0;
+    if (secondsPerTick == 0) {
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        secondsPerTick = (double)timebase.numer / timebase.denom / NSEC_PER_SEC;
+    }
+    return mach_absolute_time() * secondsPerTick;
+}
+
++ (NSTimeInterval)raiseMaximum:(NSTimeInterval*)maximum toDuration:(NSTimeInterval)duration {
+    
+    NSTimeInterval current;
+    __atomic_load(maximum, &current, __ATOMIC_RELAXED);
+    while (duration > current &&
+           !__atomic_compare_exchange(maximum, &current, &duration, YES, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return MAX(current, duration);
+}
+
 @end
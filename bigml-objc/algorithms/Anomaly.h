@@ -15,6 +15,8 @@
 #import <Foundation/Foundation.h>
 #import "FieldResource.h"
 
+@class PredictionCache;
+
 @interface Anomaly : FieldResource
 
 @property (nonatomic) BOOL stopped;
@@ -27,6 +29,66 @@
 @property (nonatomic, strong) NSArray* topAnomalies;
 
 - (instancetype)initWithJSONAnomaly:(NSDictionary*)anomalyDictionary;
+
+/**
+ * Same as initWithJSONAnomaly:, decoding the detector from JSON data first,
+ * as PredictiveModel initWithJSONData:error: does.
+ */
+- (instancetype)initWithJSONData:(NSData*)data error:(NSError**)error;
+
+/**
+ * The anomaly score of the input data, between 0 and 1.
+ *
+ * @param input   The input data
+ * @param options byName, to key input data by field name, and decodedInput,
+ *                when it was already decoded with FieldResource
+ *                decodedInputData:byName:
+ */
 - (double)score:(NSDictionary*)input options:(NSDictionary*)options;
 
+/**
+ * An optional cache of the results of score:options:, nil by default, see
+ * PredictiveModel predictionCache. It is bypassed while recordsBranchHits
+ * is YES, and scores cut short by `stopped` are not cached.
+ */
+@property (nonatomic, strong) PredictionCache* predictionCache;
+
+/**
+ * Branches are tested in decreasing order of their training population.
+ * When recordsBranchHits is YES, scoring counts how often each branch is
+ * taken, and optimizeBranchOrder then tests the busiest branches first.
+ * branchOrder returns the current order, one JSON-compatible dictionary per
+ * tree as described in PredictionTree childOrder, which applyBranchOrder:
+ * restores. Scores are not affected by the order.
+ *
+ * optimizeBranchOrder and applyBranchOrder: compile the trees again into a
+ * second copy in the detector's arena, allocated by the first reorder and
+ * then reused, and wait for the scores still walking the previous copy to
+ * finish, so that periodic reordering does not grow the detector.
+ */
+@property (nonatomic) BOOL recordsBranchHits;
+
+- (void)optimizeBranchOrder;
+- (NSArray*)branchOrder;
+- (void)applyBranchOrder:(NSArray*)branchOrder;
+
+/**
+ * Anytime version of score:options:, for callers with a deadline. Trees
+ * are evaluated in forest order until either budget is exhausted, and the
+ * score is computed from the mean depth of the trees evaluated so far. The
+ * time budget includes decoding the input, and a tree is only started when
+ * the slowest tree this anomaly has evaluated so far would still fit in the
+ * time left. When not even one tree fits, no score is computed.
+ *
+ * @param input   The input data
+ * @param options Options as in score:options:, plus:
+ *                - timeBudget: seconds available for scoring, 0 for no limit
+ *                - treeBudget: maximum number of trees to evaluate, 0 for no limit
+ * @return A dictionary with keys "score", "evaluatedTrees" and "scoreError",
+ *         the estimated standard error of the score with respect to the one
+ *         computed with the whole forest (0 when all trees were evaluated).
+ *         Only "evaluatedTrees", 0, is present when no tree was evaluated.
+ */
+- (NSDictionary*)scoreWithBudget:(NSDictionary*)input options:(NSDictionary*)options;
+
 @end
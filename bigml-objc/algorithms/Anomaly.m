@@ -12,8 +12,14 @@
 // License for the specific language governing permissions and limitations
 // under the License.
 
+#import <malloc/malloc.h>
 #import "Anomaly.h"
 #import "Predicates.h"
+#import "ModelArena.h"
+#import "NSError+BMLError.h"
+#import "BMLUtils.h"
+#import "BMLInstrumentation.h"
+#import "PredictionCache.h"
 
 #define DEPTH_FACTOR 0.5772156649
 
@@ -26,16 +32,28 @@
  */
 @interface AnomalyTreeNode : NSObject
 
-@property (nonatomic, strong) Anomaly* anomaly;
+@property (nonatomic, weak) Anomaly* anomaly;
 @property (nonatomic, strong) Predicates* predicates;
 @property (nonatomic, strong) NSString* identifier;
 @property (nonatomic, strong) NSMutableArray* children;
+@property (atomic, copy) NSArray* evaluationOrder;
+@property (nonatomic) BOOL recordsHits;
 
 @end
 
+static NSString* anomalyChildPath(NSString* path, NSUInteger index) {
+    
+    return path.length > 0 ?
+    [NSString stringWithFormat:@"%@.%lu", path, (unsigned long)index] :
+    [NSString stringWithFormat:@"%lu", (unsigned long)index];
+}
+
 @implementation AnomalyTreeNode {
     
     NSDictionary* _fields;
+    NSUInteger _population;
+    NSUInteger _index;
+    long _hits;
 }
 
 - (instancetype)initWithTree:(NSDictionary*)tree anomaly:(Anomaly*)anomaly {
@@ -44,16 +62,47 @@
         _anomaly = anomaly;
         _fields = anomaly.fields;
         _predicates = [[Predicates alloc] initWithPredicates:tree[@"predicates"]?:@[@(YES)]];
+        [_predicates prepareWithFields:_fields];
         _identifier = tree[@"id"];
+        _population = [tree[@"population"] unsignedIntegerValue];
         
-        _children = [NSMutableArray arrayWithCapacity:[tree[@"children"] count]];
-        for (id child in tree[@"children"]) {
-            [_children addObject:[[AnomalyTreeNode alloc] initWithTree:child anomaly:anomaly]];
+        //-- leaves, about half of the nodes, share the empty list
+        NSArray* childTrees = tree[@"children"];
+        _children = childTrees.count > 0 ? [NSMutableArray arrayWithCapacity:childTrees.count] : nil;
+        for (id child in childTrees) {
+            AnomalyTreeNode* node = [[AnomalyTreeNode alloc] initWithTree:child anomaly:anomaly];
+            node->_index = _children.count;
+            [_children addObject:node];
         }
+        
+        //-- the most populated branches are tested first
+        _evaluationOrder = !_children ? @[] :
+        [_children sortedArrayWithOptions:NSSortStable
+                          usingComparator:^NSComparisonResult(AnomalyTreeNode* a, AnomalyTreeNode* b) {
+                              return a->_population > b->_population ? NSOrderedAscending :
+                              a->_population < b->_population ? NSOrderedDescending : NSOrderedSame;
+                          }];
     }
     return self;
 }
 
+/**
+ * See PredictionTree nodeCountWithBytes:.
+ */
+- (NSUInteger)nodeCountWithBytes:(size_t*)bytes {
+    
+    *bytes += malloc_size((__bridge const void*)self) + [_predicates byteSize];
+    if (_children) {
+        *bytes += malloc_size((__bridge const void*)_children) +
+        malloc_size((__bridge const void*)self.evaluationOrder);
+    }
+    NSUInteger count = 1;
+    for (AnomalyTreeNode* child in _children) {
+        count += [child nodeCountWithBytes:bytes];
+    }
+    return count;
+}
+
 /**
  *
  * Returns the depth of the tree that the input data "verifies"
@@ -72,16 +121,19 @@
 
     if (!path)
         path = [NSMutableArray new];
+    Anomaly* anomaly = _anomaly;
     if (depth == 0) {
         if (![self.predicates apply:tree fields:_fields]) {
             return depth;
         }
         ++depth;
     }
-    for (AnomalyTreeNode* child in _children) {
-        if (_anomaly.stopped)
+    for (AnomalyTreeNode* child in self.evaluationOrder) {
+        if (anomaly.stopped)
             return 0;
         if ([child.predicates apply:tree fields:_fields]) {
+            if (_recordsHits)
+                __atomic_fetch_add(&child->_hits, 1, __ATOMIC_RELAXED);
             [path addObject:[child.predicates ruleWithFields:_fields label:nil]];
             return [child verifiedDepthForTree:tree path:path depth:++depth];
         }
@@ -89,19 +141,150 @@
     return depth;
 }
 
+- (void)setRecordsHits:(BOOL)recordsHits {
+    
+    _recordsHits = recordsHits;
+    for (AnomalyTreeNode* child in _children) {
+        child.recordsHits = recordsHits;
+    }
+}
+
+- (void)orderChildrenByHits {
+    
+    self.evaluationOrder = [_children sortedArrayWithOptions:NSSortStable
+                                         usingComparator:^NSComparisonResult(AnomalyTreeNode* a, AnomalyTreeNode* b) {
+                                             if (a->_hits != b->_hits)
+                                                 return [@(b->_hits) compare:@(a->_hits)];
+                                             return [@(b->_population) compare:@(a->_population)];
+                                         }];
+    for (AnomalyTreeNode* child in _children) {
+        [child orderChildrenByHits];
+    }
+}
+
+/**
+ * Same format as PredictionTree childOrder: nodes are identified by their
+ * path of child indexes from the root.
+ */
+- (void)addChildOrder:(NSMutableDictionary*)order path:(NSString*)path {
+    
+    if (_children.count < 2)
+        return;
+    NSMutableArray* indexes = [NSMutableArray arrayWithCapacity:_children.count];
+    for (AnomalyTreeNode* child in self.evaluationOrder) {
+        [indexes addObject:@(child->_index)];
+    }
+    order[path] = indexes;
+    for (AnomalyTreeNode* child in _children) {
+        [child addChildOrder:order path:anomalyChildPath(path, child->_index)];
+    }
+}
+
+- (void)applyChildOrder:(NSDictionary*)order path:(NSString*)path {
+    
+    NSArray* indexes = order[path];
+    if (indexes.count == _children.count) {
+        NSMutableArray* evaluationOrder = [NSMutableArray arrayWithCapacity:_children.count];
+        for (NSNumber* index in indexes) {
+            if (index.unsignedIntegerValue >= _children.count)
+                return;
+            [evaluationOrder addObject:_children[index.unsignedIntegerValue]];
+        }
+        if ([[NSSet setWithArray:evaluationOrder] count] == _children.count)
+            self.evaluationOrder = evaluationOrder;
+    }
+    for (AnomalyTreeNode* child in _children) {
+        [child applyChildOrder:order path:anomalyChildPath(path, child->_index)];
+    }
+}
+
 @end
 
+/**
+ * A tree node compiled into the detector's arena: the range of its
+ * predicates, all of which must apply, and that of its children, stored
+ * contiguously in their evaluation order.
+ */
+typedef struct CompiledAnomalyNode {
+    
+    uint32_t firstPredicate;
+    uint32_t predicateCount;
+    uint32_t firstChild;
+    uint32_t childCount;
+    
+} CompiledAnomalyNode;
+
+/**
+ * The compiled trees of a forest, whose roots are its first nodes.
+ */
+typedef struct CompiledForest {
+    
+    CompiledAnomalyNode* nodes;
+    CompiledPredicate* predicates;
+    
+} CompiledForest;
+
+static void countCompiledNodes(AnomalyTreeNode* tree, uint32_t* nodes, uint32_t* predicates) {
+    
+    *nodes += 1;
+    *predicates += (uint32_t)tree.predicates.predicates.count;
+    for (AnomalyTreeNode* child in tree.evaluationOrder) {
+        countCompiledNodes(child, nodes, predicates);
+    }
+}
+
+static void compileAnomalyNode(CompiledForest* forest,
+                               uint32_t index,
+                               AnomalyTreeNode* tree,
+                               uint32_t* nextNode,
+                               uint32_t* nextPredicate) {
+    
+    CompiledAnomalyNode* node = forest->nodes + index;
+    NSArray* predicates = tree.predicates.predicates;
+    node->firstPredicate = *nextPredicate;
+    node->predicateCount = (uint32_t)predicates.count;
+    *nextPredicate += node->predicateCount;
+    for (uint32_t i = 0; i < node->predicateCount; ++i) {
+        [predicates[i] compileInto:forest->predicates + node->firstPredicate + i];
+    }
+    
+    NSArray* children = tree.evaluationOrder;
+    node->childCount = (uint32_t)children.count;
+    node->firstChild = *nextNode;
+    *nextNode += node->childCount;
+    for (uint32_t i = 0; i < node->childCount; ++i) {
+        compileAnomalyNode(forest, node->firstChild + i, children[i], nextNode, nextPredicate);
+    }
+}
+
+static BOOL compiledAnomalyNodeApplies(const CompiledForest* forest,
+                                       const CompiledAnomalyNode* node,
+                                       NSDictionary* input,
+                                       NSDictionary* fields) {
+    
+    for (uint32_t i = node->firstPredicate; i < node->firstPredicate + node->predicateCount; ++i) {
+        if (!BMLCompiledPredicateApplies(forest->predicates + i, input, fields))
+            return NO;
+    }
+    return YES;
+}
 
 @implementation Anomaly {
     
     NSMutableArray* _iForest;
+    BMLModelStats* _stats;
+    NSTimeInterval _slowestTree;
+    ModelArena* _arena;
+    CompiledForest* _compiledForest;
+    CompiledForest _compiledBuffers[2];
+    ArenaReaders _compiledReaders;
 }
 
 @synthesize iForest = _iForest;
 
 - (instancetype)initWithJSONAnomaly:(NSDictionary*)anomalyDictionary {
     
-    
+    BML_STAGE_START(buildStart);
     NSDictionary* model = anomalyDictionary[@"model"];
     NSAssert(model && [model[@"fields"] count] > 0,
              @"Anomaly constructor's contract unfulfilled: no fields");
@@ -120,10 +303,44 @@
                                    ((_sampleSize - 1) / _sampleSize));
         _expectedMeanDepth = fmin(_meanDepth, defaultDepth);
         _iForest = [NSMutableArray arrayWithCapacity:[model[@"trees"] count]];
-        for (NSDictionary* tree in model[@"trees"]) {
-            [_iForest addObject:[[AnomalyTreeNode alloc] initWithTree:tree[@"root"] anomaly:self]];
+        @autoreleasepool {
+            for (NSDictionary* tree in model[@"trees"]) {
+                [_iForest addObject:[[AnomalyTreeNode alloc] initWithTree:tree[@"root"] anomaly:self]];
+            }
         }
         _topAnomalies = model[@"top_anomalies"];
+        _arena = [ModelArena new];
+        [self compileForest];
+        _stats = [BMLInstrumentation registerModelWithLabel:
+                  anomalyDictionary[@"resource"] ?: [NSString stringWithFormat:@"anomaly %p", self]];
+        BML_LOAD_TICKS(_stats, buildTicks, buildStart, mach_absolute_time());
+#if BML_INSTRUMENTATION
+        if (buildStart && _stats) {
+            size_t bytes = malloc_size((__bridge const void*)self) + malloc_size((__bridge const void*)_iForest) +
+            _arena.bytesReserved;
+            for (AnomalyTreeNode* tree in _iForest) {
+                _stats.load->nodes += [tree nodeCountWithBytes:&bytes];
+            }
+            _stats.load->bytes = bytes;
+            _stats.load->compiledBytes = _arena.bytesReserved;
+        }
+#endif
+    }
+    return self;
+}
+
+- (instancetype)initWithJSONData:(NSData*)data error:(NSError**)error {
+    
+    BML_STAGE_START(parseStart);
+    NSDictionary* jsonAnomaly = [NSJSONSerialization JSONObjectWithData:data options:0 error:error];
+    BML_STAGE_MARK(parseEnd, parseStart);
+    if (![jsonAnomaly isKindOfClass:[NSDictionary class]]) {
+        if (error && !*error)
+            *error = [NSError errorWithInfo:@"Bad anomaly format" code:-10401];
+        return nil;
+    }
+    if (self = [self initWithJSONAnomaly:jsonAnomaly]) {
+        BML_LOAD_TICKS(_stats, parseTicks, parseStart, parseEnd);
     }
     return self;
 }
@@ -134,15 +351,203 @@
     _stopped = false;
     NSAssert(_iForest, @"Could not find forest info. The anomaly was possibly not completely created");
 
-    NSDictionary* filteredInput = [self filteredInputData:input byName:byName];
+    NSDictionary* filteredInput = [options[@"decodedInput"] ?: @NO boolValue] ?
+    input : [self decodedInputData:input byName:byName];
+    if (_predictionCache && !_recordsBranchHits) {
+        __block double score = 0;
+        NSNumber* cached = [_predictionCache resultForInput:filteredInput options:options compute:^id{
+            score = [self scoreWithDecodedInput:filteredInput];
+            //-- a stopped traversal gives an incomplete score: return it, but do not cache it
+            return self.stopped ? nil : @(score);
+        }];
+        return cached ? cached.doubleValue : score;
+    }
+    return [self scoreWithDecodedInput:filteredInput];
+}
+
+- (double)scoreWithDecodedInput:(NSDictionary*)filteredInput {
+    
+    BML_COUNT(_stats, rows, 1);
+    BML_STAGE_START(traversalStart);
     double depthSum = 0.0;
-    for (AnomalyTreeNode* tree in _iForest) {
-        depthSum += _stopped ? 0 : [tree verifiedDepthForTree:filteredInput path:nil depth:0];
+    unsigned int parity = ArenaReadersEnter(&_compiledReaders);
+    const CompiledForest* forest = __atomic_load_n(&_compiledForest, __ATOMIC_SEQ_CST);
+    for (NSUInteger i = 0; i < _iForest.count; ++i) {
+        depthSum += _stopped ? 0 : [self depthOfTree:i input:filteredInput forest:forest];
     }
+    ArenaReadersLeave(&_compiledReaders, parity);
+    BML_STAGE_END(traversalStart, BMLStageTraversal);
     double observedMeanDepth = depthSum / _iForest.count;
     return pow(2.0, -observedMeanDepth / _expectedMeanDepth);
 }
 
+- (void)setRecordsBranchHits:(BOOL)recordsBranchHits {
+    
+    _recordsBranchHits = recordsBranchHits;
+    for (AnomalyTreeNode* tree in _iForest) {
+        tree.recordsHits = recordsBranchHits;
+    }
+}
+
+- (void)optimizeBranchOrder {
+    
+    for (AnomalyTreeNode* tree in _iForest) {
+        [tree orderChildrenByHits];
+    }
+    [self compileForest];
+}
+
+- (NSArray*)branchOrder {
+    
+    NSMutableArray* branchOrder = [NSMutableArray arrayWithCapacity:_iForest.count];
+    for (AnomalyTreeNode* tree in _iForest) {
+        NSMutableDictionary* order = [NSMutableDictionary new];
+        [tree addChildOrder:order path:@""];
+        [branchOrder addObject:order];
+    }
+    return branchOrder;
+}
+
+- (void)applyBranchOrder:(NSArray*)branchOrder {
+    
+    if (branchOrder.count != _iForest.count)
+        return;
+    [_iForest enumerateObjectsUsingBlock:^(AnomalyTreeNode* tree, NSUInteger i, BOOL* stop) {
+        [tree applyChildOrder:branchOrder[i] path:@""];
+    }];
+    [self compileForest];
+}
+
+/**
+ * Lays the trees out in the arena, in the current branch order. As with
+ * PredictiveModel, a new order is compiled into the other of two buffers,
+ * allocated once, and replaces the old nodes at once; this then waits for
+ * the scores still walking the old nodes, which the next order reuses.
+ */
+- (void)compileForest {
+    
+    @synchronized (self) {
+        uint32_t nodeCount = 0, predicateCount = 0;
+        for (AnomalyTreeNode* tree in _iForest) {
+            countCompiledNodes(tree, &nodeCount, &predicateCount);
+        }
+        CompiledForest* forest = &_compiledBuffers[_compiledForest == &_compiledBuffers[1] ? 0 : 1];
+        if (!forest->nodes) {
+            forest->nodes = [_arena allocate:nodeCount * sizeof(CompiledAnomalyNode)];
+            forest->predicates = [_arena allocate:predicateCount * sizeof(CompiledPredicate)];
+        }
+        NSAssert(forest->nodes && forest->predicates, @"Could not allocate the compiled forest");
+        memset(forest->nodes, 0, nodeCount * sizeof(CompiledAnomalyNode));
+        memset(forest->predicates, 0, predicateCount * sizeof(CompiledPredicate));
+        
+        uint32_t nextNode = (uint32_t)_iForest.count, nextPredicate = 0;
+        for (uint32_t i = 0; i < _iForest.count; ++i) {
+            compileAnomalyNode(forest, i, _iForest[i], &nextNode, &nextPredicate);
+        }
+        __atomic_store_n(&_compiledForest, forest, __ATOMIC_SEQ_CST);
+        ArenaReadersWait(&_compiledReaders);
+    }
+}
+
+/**
+ * The depth the input reaches in a tree of the forest, as AnomalyTreeNode
+ * verifiedDepthForTree:path:depth: computes it; through the compiled trees
+ * unless branch hits are being recorded. The forest must have been loaded
+ * by a reader registered with _compiledReaders.
+ */
+- (NSUInteger)depthOfTree:(NSUInteger)index
+                    input:(NSDictionary*)input
+                   forest:(const CompiledForest*)forest {
+    
+    if (_recordsBranchHits)
+        return [_iForest[index] verifiedDepthForTree:input path:nil depth:0];
+    
+    NSDictionary* fields = self.fields;
+    const CompiledAnomalyNode* node = forest->nodes + index;
+    if (!compiledAnomalyNodeApplies(forest, node, input, fields))
+        return 0;
+    NSUInteger depth = 1;
+    BOOL descending = YES;
+    while (descending) {
+        
+        descending = NO;
+        for (uint32_t i = node->firstChild; i < node->firstChild + node->childCount; ++i) {
+            if (_stopped)
+                return 0;
+            if (compiledAnomalyNodeApplies(forest, forest->nodes + i, input, fields)) {
+                node = forest->nodes + i;
+                ++depth;
+                descending = YES;
+                break;
+            }
+        }
+    }
+    return depth;
+}
+
+- (NSDictionary*)scoreWithBudget:(NSDictionary*)input options:(NSDictionary*)options {
+    
+    BOOL byName = [options[@"byName"] ?: @(NO) boolValue];
+    NSTimeInterval timeBudget = [options[@"timeBudget"] doubleValue];
+    NSUInteger treeBudget = [options[@"treeBudget"] unsignedIntegerValue];
+    _stopped = false;
+    NSAssert(_iForest, @"Could not find forest info. The anomaly was possibly not completely created");
+    
+    NSTimeInterval start = [BMLUtils monotonicTime];
+    NSDictionary* filteredInput = [options[@"decodedInput"] ?: @NO boolValue] ?
+    input : [self decodedInputData:input byName:byName];
+    NSUInteger treeCount = _iForest.count;
+    if (treeBudget > 0)
+        treeCount = MIN(treeCount, treeBudget);
+    
+    //-- trees are evaluated in forest order. A tree is only started when the
+    //-- slowest tree this forest has scored so far would still fit in what is
+    //-- left of the time budget, which may leave no tree at all.
+    BML_COUNT(_stats, rows, 1);
+    BML_STAGE_START(traversalStart);
+    double depthSum = 0.0;
+    double depthSquareSum = 0.0;
+    NSTimeInterval slowestTree = [BMLUtils raiseMaximum:&_slowestTree toDuration:0];
+    NSUInteger evaluated = 0;
+    unsigned int parity = ArenaReadersEnter(&_compiledReaders);
+    const CompiledForest* forest = __atomic_load_n(&_compiledForest, __ATOMIC_SEQ_CST);
+    while (evaluated < treeCount && !_stopped) {
+        
+        NSTimeInterval treeStart = [BMLUtils monotonicTime];
+        if (timeBudget > 0 && treeStart - start + slowestTree > timeBudget)
+            break;
+        double depth = [self depthOfTree:evaluated input:filteredInput forest:forest];
+        depthSum += depth;
+        depthSquareSum += depth * depth;
+        slowestTree = [BMLUtils raiseMaximum:&_slowestTree
+                                  toDuration:[BMLUtils monotonicTime] - treeStart];
+        ++evaluated;
+    }
+    ArenaReadersLeave(&_compiledReaders, parity);
+    
+    BML_STAGE_END(traversalStart, BMLStageTraversal);
+    if (evaluated < _iForest.count)
+        BML_COUNT(_stats, earlyStops, 1);
+    if (evaluated == 0)
+        return @{ @"evaluatedTrees" : @0 };
+    
+    double observedMeanDepth = depthSum / evaluated;
+    double score = pow(2.0, -observedMeanDepth / _expectedMeanDepth);
+    
+    //-- the standard error of the partial mean depth, with the finite
+    //-- population correction for the trees left out, propagated to the score
+    double scoreError = 0;
+    if (evaluated > 1 && evaluated < _iForest.count) {
+        double variance = (depthSquareSum - depthSum * observedMeanDepth) / (evaluated - 1);
+        double correction = (double)(_iForest.count - evaluated) / (_iForest.count - 1);
+        double depthError = sqrt(fmax(variance, 0) / evaluated * correction);
+        scoreError = score * M_LN2 / _expectedMeanDepth * depthError;
+    }
+    return @{ @"score" : @(score),
+              @"evaluatedTrees" : @(evaluated),
+              @"scoreError" : @(scoreError) };
+}
+
 @end
 
 
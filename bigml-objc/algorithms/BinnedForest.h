@@ -0,0 +1,69 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+
+@class MultiVote;
+
+/**
+ * The trees of an ensemble compiled for fast evaluation.
+ *
+ * The thresholds of all the numeric splits in all the trees are collected
+ * per field and sorted, so that an input row can be encoded once into a bin
+ * code per field: 2k + 1 for a value equal to the k-th threshold, 2k for a
+ * value between the (k-1)-th and the k-th one. Numeric splits then become
+ * comparisons between two integers, and each tree is walked along a flat
+ * array of nodes. Other predicates (categories, text, null values) are
+ * evaluated as usual.
+ *
+ * Predictions are those of the LastPrediction missing strategy, and are the
+ * same as the members' own.
+ */
+@interface BinnedForest : NSObject
+
+/**
+ * @param models The PredictiveModel members, sharing their fields. Their
+ *        current branch order is compiled in, so tune it before.
+ */
+- (instancetype)initWithModels:(NSArray*)models;
+
+@property (nonatomic, readonly) NSUInteger memberCount;
+
+/// the number of fields tested by numeric splits
+@property (nonatomic, readonly) NSUInteger binnedFieldCount;
+
+/// the number of distinct numeric thresholds across all fields
+@property (nonatomic, readonly) NSUInteger thresholdCount;
+
+/**
+ * Encodes a row into bin codes, once for all the members.
+ * @param inputData The input, decoded with FieldResource decodedInputData:byName:
+ */
+- (NSData*)encodedInputData:(NSDictionary*)inputData;
+
+/**
+ * The vote of a member, as MultiModel predictWithModelAtIndex:... returns it.
+ * @param encoded The bin codes returned by encodedInputData: for inputData
+ */
+- (NSDictionary*)predictWithMember:(NSUInteger)index
+                      encodedInput:(NSData*)encoded
+                         inputData:(NSDictionary*)inputData;
+
+/**
+ * The votes of all the members, in member order.
+ */
+- (MultiVote*)generateVotes:(NSDictionary*)inputData;
+
+@end
@@ -0,0 +1,307 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "BinnedForest.h"
+#import "PredictiveModel.h"
+#import "PredictionTree.h"
+#import "Predicates.h"
+#import "MultiVote.h"
+#import "BMLInstrumentation.h"
+
+//-- bin codes of missing values and of values that cannot be binned
+#define BF_MISSING UINT32_MAX
+#define BF_UNBINNED (UINT32_MAX - 1)
+
+typedef enum BFOperator {
+    
+    BFOperatorTrue = 0,
+    BFOperatorPredicate,
+    BFOperatorLess,
+    BFOperatorLessOrEqual,
+    BFOperatorGreater,
+    BFOperatorGreaterOrEqual,
+    BFOperatorEqual,
+    BFOperatorNotEqual
+    
+} BFOperator;
+
+/**
+ * A tree node, holding the predicate that leads to it. The children of a
+ * node are stored contiguously, in their evaluation order.
+ */
+typedef struct BFNode {
+    
+    uint32_t firstChild;
+    uint32_t childCount;
+    uint32_t field;         //-- index of the binned field
+    uint32_t code;          //-- bin code of the threshold
+    uint8_t op;
+    uint8_t missing;        //-- the predicate holds when the field is missing
+    
+} BFNode;
+
+@implementation BinnedForest {
+    
+    NSArray* _models;
+    NSDictionary* _fields;
+    NSMutableData* _nodes;
+    NSMutableArray* _treeNodes;
+    NSMutableArray* _roots;
+    
+    NSMutableArray* _fieldIds;
+    NSMutableData* _thresholds;
+    NSMutableData* _thresholdOffsets;
+}
+
+- (instancetype)initWithModels:(NSArray*)models {
+    
+    if (self = [super init]) {
+        
+        _models = models;
+        _fields = [models.firstObject fields];
+        _nodes = [NSMutableData data];
+        _treeNodes = [NSMutableArray array];
+        _roots = [NSMutableArray arrayWithCapacity:models.count];
+        
+        NSDictionary* thresholds = [self collectThresholds];
+        _fieldIds = [[thresholds.allKeys sortedArrayUsingSelector:@selector(compare:)] mutableCopy];
+        _thresholds = [NSMutableData data];
+        _thresholdOffsets = [NSMutableData data];
+        for (NSString* fieldId in _fieldIds) {
+            uint32_t offset = (uint32_t)(_thresholds.length / sizeof(double));
+            [_thresholdOffsets appendBytes:&offset length:sizeof(offset)];
+            for (NSNumber* threshold in [[thresholds[fieldId] allObjects] sortedArrayUsingSelector:@selector(compare:)]) {
+                double value = threshold.doubleValue;
+                [_thresholds appendBytes:&value length:sizeof(value)];
+            }
+        }
+        uint32_t end = (uint32_t)(_thresholds.length / sizeof(double));
+        [_thresholdOffsets appendBytes:&end length:sizeof(end)];
+        
+        for (PredictiveModel* model in models) {
+            uint32_t root = (uint32_t)(_nodes.length / sizeof(BFNode));
+            [_roots addObject:@(root)];
+            [_nodes increaseLengthBy:sizeof(BFNode)];
+            [_treeNodes addObject:model.tree];
+            [self fillNode:root withTree:model.tree];
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)memberCount {
+    
+    return _models.count;
+}
+
+- (NSUInteger)binnedFieldCount {
+    
+    return _fieldIds.count;
+}
+
+- (NSUInteger)thresholdCount {
+    
+    return _thresholds.length / sizeof(double);
+}
+
+#pragma mark Compiling
+
+/**
+ * The operator of a predicate comparing a number, or BFOperatorPredicate
+ * when it has to be evaluated by the predicate itself.
+ */
++ (BFOperator)binnedOperatorOfPredicate:(Predicate*)predicate {
+    
+    id value = predicate.value;
+    if (predicate.term || ![value isKindOfClass:[NSNumber class]] || isnan([value doubleValue]))
+        return BFOperatorPredicate;
+    
+    NSDictionary* operators = @{ @"<" : @(BFOperatorLess),
+                                 @"<=" : @(BFOperatorLessOrEqual),
+                                 @">" : @(BFOperatorGreater),
+                                 @">=" : @(BFOperatorGreaterOrEqual),
+                                 @"=" : @(BFOperatorEqual),
+                                 @"!=" : @(BFOperatorNotEqual) };
+    return [operators[predicate.op] ?: @(BFOperatorPredicate) intValue];
+}
+
+- (void)addThresholdsOfTree:(PredictionTree*)tree to:(NSMutableDictionary*)thresholds {
+    
+    for (PredictionTree* child in tree.evaluationOrder) {
+        Predicate* predicate = child.predicate;
+        if (!child.isPredicate &&
+            [BinnedForest binnedOperatorOfPredicate:predicate] != BFOperatorPredicate) {
+            NSMutableSet* values = thresholds[predicate.field];
+            if (!values) {
+                values = [NSMutableSet set];
+                thresholds[predicate.field] = values;
+            }
+            [values addObject:@([(id)predicate.value doubleValue])];
+        }
+        [self addThresholdsOfTree:child to:thresholds];
+    }
+}
+
+- (NSDictionary*)collectThresholds {
+    
+    NSMutableDictionary* thresholds = [NSMutableDictionary dictionary];
+    for (PredictiveModel* model in _models) {
+        [self addThresholdsOfTree:model.tree to:thresholds];
+    }
+    return thresholds;
+}
+
+- (uint32_t)codeOfValue:(double)value field:(uint32_t)field {
+    
+    const double* thresholds = _thresholds.bytes;
+    const uint32_t* offsets = _thresholdOffsets.bytes;
+    uint32_t low = offsets[field], high = offsets[field + 1], first = low;
+    
+    //-- the number of thresholds below the value
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (thresholds[middle] < value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    uint32_t code = 2 * (low - first);
+    if (low < offsets[field + 1] && thresholds[low] == value)
+        ++code;
+    return code;
+}
+
+- (void)fillNode:(uint32_t)index withTree:(PredictionTree*)tree {
+    
+    BFNode node = { 0 };
+    if (tree.isPredicate) {
+        node.op = BFOperatorTrue;
+    } else {
+        node.op = [BinnedForest binnedOperatorOfPredicate:tree.predicate];
+        node.missing = tree.predicate.missing;
+        if (node.op != BFOperatorPredicate) {
+            node.field = (uint32_t)[_fieldIds indexOfObject:tree.predicate.field];
+            node.code = [self codeOfValue:[(id)tree.predicate.value doubleValue] field:node.field];
+        }
+    }
+    
+    NSArray* children = tree.evaluationOrder;
+    node.childCount = (uint32_t)children.count;
+    node.firstChild = (uint32_t)(_nodes.length / sizeof(BFNode));
+    [_nodes increaseLengthBy:children.count * sizeof(BFNode)];
+    [_treeNodes addObjectsFromArray:children];
+    ((BFNode*)_nodes.mutableBytes)[index] = node;
+    
+    for (NSUInteger i = 0; i < children.count; ++i) {
+        [self fillNode:(uint32_t)(node.firstChild + i) withTree:children[i]];
+    }
+}
+
+#pragma mark Predicting
+
+- (NSData*)encodedInputData:(NSDictionary*)inputData {
+    
+    NSMutableData* encoded = [NSMutableData dataWithLength:_fieldIds.count * sizeof(uint32_t)];
+    uint32_t* codes = encoded.mutableBytes;
+    for (uint32_t i = 0; i < _fieldIds.count; ++i) {
+        
+        id value = inputData[_fieldIds[i]];
+        if (!value) {
+            codes[i] = BF_MISSING;
+        } else if (![value isKindOfClass:[NSNumber class]] || isnan([value doubleValue])) {
+            codes[i] = BF_UNBINNED;
+        } else {
+            codes[i] = [self codeOfValue:[value doubleValue] field:i];
+        }
+    }
+    return encoded;
+}
+
+- (BOOL)node:(const BFNode*)node
+        index:(uint32_t)index
+ matchesCodes:(const uint32_t*)codes
+    inputData:(NSDictionary*)inputData {
+    
+    if (node->op == BFOperatorTrue)
+        return YES;
+    
+    uint32_t code = node->op == BFOperatorPredicate ? BF_UNBINNED : codes[node->field];
+    if (code == BF_MISSING)
+        return node->missing;
+    if (code == BF_UNBINNED)
+        return [[_treeNodes[index] predicate] apply:inputData fields:_fields];
+    
+    switch (node->op) {
+        case BFOperatorLess:
+            return code < node->code;
+        case BFOperatorLessOrEqual:
+            return code <= node->code;
+        case BFOperatorGreater:
+            return code > node->code;
+        case BFOperatorGreaterOrEqual:
+            return code >= node->code;
+        case BFOperatorEqual:
+            return code == node->code;
+        case BFOperatorNotEqual:
+            return code != node->code;
+    }
+    return NO;
+}
+
+- (NSDictionary*)predictWithMember:(NSUInteger)member
+                      encodedInput:(NSData*)encoded
+                         inputData:(NSDictionary*)inputData {
+    
+    if (inputData.allKeys.count == 0)
+        return nil;
+    
+    const BFNode* nodes = _nodes.bytes;
+    const uint32_t* codes = encoded.bytes;
+    uint32_t index = [_roots[member] unsignedIntValue];
+    NSUInteger depth = 0;
+    BOOL descending = YES;
+    BML_STAGE_START(traversalStart);
+    while (descending && nodes[index].childCount > 0) {
+        
+        descending = NO;
+        const BFNode* node = nodes + index;
+        for (uint32_t i = node->firstChild; i < node->firstChild + node->childCount; ++i) {
+            if ([self node:nodes + i index:i matchesCodes:codes inputData:inputData]) {
+                index = i;
+                ++depth;
+                descending = YES;
+                break;
+            }
+        }
+    }
+    
+    BML_STAGE_END(traversalStart, BMLStageTraversal);
+    [_models[member] countPredictionWithDepth:depth missingBranch:nodes[index].childCount > 0];
+    
+    TreePrediction* prediction = [_treeNodes[index] predictionWithPath:nil];
+    return [[_models[member] outputWithTreePrediction:prediction multiple:NSUIntegerMax] firstObject];
+}
+
+- (MultiVote*)generateVotes:(NSDictionary*)inputData {
+    
+    NSData* encoded = [self encodedInputData:inputData];
+    MultiVote* votes = [MultiVote new];
+    for (NSUInteger i = 0; i < _models.count; ++i) {
+        [votes append:[self predictWithMember:i encodedInput:encoded inputData:inputData]];
+    }
+    return votes;
+}
+
+@end
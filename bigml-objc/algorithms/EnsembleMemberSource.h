@@ -0,0 +1,45 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Provides the JSON definitions of the members of an ensemble on request,
+ * so that PredictiveEnsemble can load them on first use instead of keeping
+ * all of them in memory.
+ */
+@protocol EnsembleMemberSource <NSObject>
+
+/// the number of members
+- (NSUInteger)memberCount;
+
+/**
+ * The JSON model of a member, as accepted by PredictiveModel
+ * initWithJSONModel:, or nil if it cannot be read. May be called from
+ * several threads at once.
+ */
+- (NSDictionary*)memberAtIndex:(NSUInteger)index;
+
+@end
+
+/**
+ * An EnsembleMemberSource reading members from a directory containing one
+ * JSON model per file, e.g. as saved from BMLAPIConnector downloads.
+ * Members are the files with the given extension, sorted by name.
+ */
+@interface DirectoryMemberSource : NSObject <EnsembleMemberSource>
+
+- (instancetype)initWithDirectory:(NSString*)path extension:(NSString*)extension;
+
+@end
@@ -0,0 +1,53 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "EnsembleMemberSource.h"
+
+@implementation DirectoryMemberSource {
+    
+    NSArray* _paths;
+}
+
+- (instancetype)initWithDirectory:(NSString*)path extension:(NSString*)extension {
+    
+    if (self = [super init]) {
+        
+        NSMutableArray* paths = [NSMutableArray array];
+        NSArray* files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:path error:nil];
+        for (NSString* file in [files sortedArrayUsingSelector:@selector(compare:)]) {
+            if ([file.pathExtension isEqualToString:extension]) {
+                [paths addObject:[path stringByAppendingPathComponent:file]];
+            }
+        }
+        _paths = paths;
+    }
+    return self;
+}
+
+- (NSUInteger)memberCount {
+    return _paths.count;
+}
+
+- (NSDictionary*)memberAtIndex:(NSUInteger)index {
+    
+    NSData* data = [NSData dataWithContentsOfFile:_paths[index]
+                                          options:NSDataReadingMappedIfSafe
+                                            error:nil];
+    if (!data)
+        return nil;
+    id member = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    return [member isKindOfClass:[NSDictionary class]] ? member : nil;
+}
+
+@end
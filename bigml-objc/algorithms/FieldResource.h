@@ -19,6 +19,7 @@
 @property (nonatomic, strong) NSDictionary* fields;
 @property (nonatomic, readonly) NSDictionary* fieldIdByName;
 @property (nonatomic, readonly) NSDictionary* fieldNameById;
+@property (nonatomic, readonly) NSString* objectiveFieldId;
 
 - (instancetype)initWithFields:(NSDictionary*)fields;
 
@@ -27,6 +28,35 @@
                         locale:(NSString*)locale
                  missingTokens:(NSArray*)missingTokens;
 
+/**
+ * Initializes a resource sharing the field definitions and name maps of
+ * another one, e.g. the members of an ensemble trained on the same dataset.
+ * Nothing is copied: the shared fields must not be modified afterwards.
+ */
+- (instancetype)initWithFieldResource:(FieldResource*)fieldResource;
+
 - (NSDictionary*)filteredInputData:(NSDictionary*)inputData byName:(BOOL)byName;
 
+/**
+ * Replaces the values of text fields in the input data with TermFrequencies
+ * objects, so that each text is tokenized once per row and not once per text
+ * predicate. Values already tokenized with the same term analysis settings,
+ * e.g. by another model in the same ensemble, are kept as they are.
+ */
+- (NSDictionary*)tokenizedInputData:(NSDictionary*)inputData byName:(BOOL)byName;
+
+/**
+ * Decodes an input row the way local predictors expect it: keyed by field
+ * id, without missing values, with numeric strings cast to numbers and with
+ * text tokenized. Predictors given the `decodedInput` option skip this step,
+ * so that a row decoded once can be scored by several of them.
+ */
+- (NSDictionary*)decodedInputData:(NSDictionary*)inputData byName:(BOOL)byName;
+
+/**
+ * YES when decodedInputData:byName: gives the same rows as with the other
+ * resource: same fields, locale decimal separator and missing tokens.
+ */
+- (BOOL)decodesInputLike:(FieldResource*)fieldResource;
+
 @end
@@ -13,6 +13,9 @@
 // under the License.
 
 #import "FieldResource.h"
+#import "Predicates.h"
+#import "BMLUtils.h"
+#import "BMLInstrumentation.h"
 
 #define DEFAULT_MISSING_TOKENS @[ \
 @"", @"N/A", @"n/a", @"NULL", @"null", @"-", @"#DIV/0", \
@@ -34,10 +37,26 @@
 
 @end
 
+/**
+ * What the cast stage needs to parse the values of a numeric field.
+ */
+@interface NumericFieldFormat : NSObject
+
+@property (nonatomic, strong) NSData* prefix;
+@property (nonatomic, strong) NSData* suffix;
+
+@end
+
+@implementation NumericFieldFormat
+@end
+
 @implementation FieldResource {
     
     NSMutableDictionary* _fieldIdByName;
     NSMutableDictionary* _fieldNameById;
+    NSSet* _missingTokenSet;
+    NSDictionary* _numericFormats;
+    char _decimalSeparator;
 }
 
 @synthesize fieldIdByName = _fieldIdByName;
@@ -64,8 +83,10 @@
         if (_objectiveFieldId)
             _objectiveFieldName = _fields[_objectiveFieldId][@"name"];
         [self makeFieldNamesUnique:_fields];
-        if (!_missingTokens)
-            _missingTokens = DEFAULT_MISSING_TOKENS;
+        _missingTokens = missingTokens ?: DEFAULT_MISSING_TOKENS;
+        _missingTokenSet = [NSSet setWithArray:_missingTokens];
+        _decimalSeparator = [FieldResource decimalSeparatorOfLocale:_locale];
+        _numericFormats = [FieldResource numericFormatsOfFields:_fields];
     }
     return self;
 }
@@ -74,8 +95,103 @@
     return [self initWithFields:fields objectiveFieldId:nil locale:nil missingTokens:nil];
 }
 
+- (instancetype)initWithFieldResource:(FieldResource*)fieldResource {
+    
+    if (self = [super init]) {
+        
+        _fields = fieldResource.fields;
+        _objectiveFieldId = fieldResource.objectiveFieldId;
+        _objectiveFieldName = fieldResource.objectiveFieldName;
+        _locale = fieldResource.locale;
+        _missingTokens = fieldResource.missingTokens;
+        _missingTokenSet = fieldResource->_missingTokenSet;
+        _decimalSeparator = fieldResource->_decimalSeparator;
+        _numericFormats = fieldResource->_numericFormats;
+        _fieldNames = fieldResource.fieldNames;
+        _fieldIds = fieldResource.fieldIds;
+        _fieldIdByName = (NSMutableDictionary*)fieldResource.fieldIdByName;
+        _fieldNameById = (NSMutableDictionary*)fieldResource.fieldNameById;
+    }
+    return self;
+}
+
+/**
+ * Models store their locale as e.g. "en-US" or "en_US.UTF-8"; values given
+ * as strings use its decimal separator. Only single byte separators are
+ * supported, '.' being used otherwise.
+ */
++ (char)decimalSeparatorOfLocale:(NSString*)locale {
+    
+    if (locale.length == 0)
+        return '.';
+    NSString* identifier = [[locale componentsSeparatedByString:@"."].firstObject
+                            stringByReplacingOccurrencesOfString:@"-" withString:@"_"];
+    NSString* separator = [[NSLocale localeWithLocaleIdentifier:identifier] objectForKey:NSLocaleDecimalSeparator];
+    if (separator.length == 1 && [separator characterAtIndex:0] < 128)
+        return (char)[separator characterAtIndex:0];
+    return '.';
+}
+
++ (NSDictionary*)numericFormatsOfFields:(NSDictionary*)fields {
+    
+    NSMutableDictionary* formats = [NSMutableDictionary new];
+    for (NSString* fieldId in fields) {
+        NSDictionary* field = fields[fieldId];
+        if (![field[@"optype"] isEqualToString:@"numeric"])
+            continue;
+        NumericFieldFormat* format = [NumericFieldFormat new];
+        format.prefix = [field[@"prefix"] dataUsingEncoding:NSUTF8StringEncoding];
+        format.suffix = [field[@"suffix"] dataUsingEncoding:NSUTF8StringEncoding];
+        formats[fieldId] = format;
+    }
+    return formats;
+}
+
+- (void)setFields:(NSDictionary*)fields {
+    
+    _fields = fields;
+    _numericFormats = [FieldResource numericFormatsOfFields:fields];
+}
+
 - (id)normalizedValue:(id)value {
-    return ([_missingTokens indexOfObject:value] != NSNotFound) ? nil : value;
+    return [_missingTokenSet containsObject:value] ? nil : value;
+}
+
+- (NSDictionary*)castInputData:(NSDictionary*)inputData {
+    
+    //-- only numeric strings change, usually few: the row is copied on the first one
+    NSMutableDictionary* castInputData = nil;
+    for (NSString* fieldId in inputData) {
+        
+        id value = inputData[fieldId];
+        if (![value isKindOfClass:[NSString class]])
+            continue;
+        NumericFieldFormat* format = _numericFormats[fieldId];
+        if (!format)
+            continue;
+        
+        double number = 0;
+        if ([BMLUtils parseNumber:value
+                           prefix:format.prefix
+                           suffix:format.suffix
+                 decimalSeparator:_decimalSeparator
+                            value:&number]) {
+            value = @(number);
+        } else {
+            value = [BMLUtils stripAffixesFromValue:value field:_fields[fieldId]];
+            if ([self normalizedValue:value] == nil)
+                value = [NSNull null];
+        }
+        castInputData = castInputData ?: [NSMutableDictionary dictionaryWithCapacity:inputData.count];
+        castInputData[fieldId] = value;
+    }
+    if (!castInputData)
+        return inputData;
+    
+    NSMutableDictionary* output = [inputData mutableCopy];
+    [output addEntriesFromDictionary:castInputData];
+    [output removeObjectsForKeys:[castInputData allKeysForObject:[NSNull null]]];
+    return output;
 }
 
 - (NSDictionary*)filteredInputData:(NSDictionary*)inputData byName:(BOOL)byName {
@@ -95,6 +211,57 @@
     return filteredInputData;
 }
 
+- (NSDictionary*)tokenizedInputData:(NSDictionary*)inputData byName:(BOOL)byName {
+    
+    NSMutableDictionary* tokenizedInputData = nil;
+    for (NSString* key in inputData.allKeys) {
+        
+        NSDictionary* field = _fields[byName ? _fieldIdByName[key] : key];
+        if (![field[@"optype"] isEqualToString:@"text"])
+            continue;
+        
+        id value = inputData[key];
+        if (![self normalizedValue:value])
+            continue;
+        NSDictionary* termAnalysis = field[@"term_analysis"];
+        if ([value isKindOfClass:[TermFrequencies class]]) {
+            TermFrequencies* terms = value;
+            if (terms.termAnalysis == termAnalysis || [terms.termAnalysis isEqualToDictionary:termAnalysis])
+                continue;
+            value = terms.text;
+        }
+        if ([value isKindOfClass:[NSString class]]) {
+            tokenizedInputData = tokenizedInputData ?: [inputData mutableCopy];
+            tokenizedInputData[key] = [[TermFrequencies alloc] initWithText:value termAnalysis:termAnalysis];
+        }
+    }
+    return tokenizedInputData ?: inputData;
+}
+
+- (NSDictionary*)decodedInputData:(NSDictionary*)inputData byName:(BOOL)byName {
+    
+    BML_STAGE_START(filterStart);
+    inputData = [self filteredInputData:inputData byName:byName];
+    BML_STAGE_END(filterStart, BMLStageFilter);
+    
+    BML_STAGE_START(castStart);
+    inputData = [self castInputData:inputData];
+    BML_STAGE_END(castStart, BMLStageCast);
+    
+    BML_STAGE_START(tokenizeStart);
+    inputData = [self tokenizedInputData:inputData byName:NO];
+    BML_STAGE_END(tokenizeStart, BMLStageTokenize);
+    return inputData;
+}
+
+- (BOOL)decodesInputLike:(FieldResource*)fieldResource {
+    
+    return fieldResource == self ||
+    (_decimalSeparator == fieldResource->_decimalSeparator &&
+     [_missingTokenSet isEqualToSet:fieldResource->_missingTokenSet] &&
+     [_fields isEqualToDictionary:fieldResource.fields]);
+}
+
 - (BOOL)checkModelStructure:(NSDictionary*)model {
 
     return (model[@"resource"] &&
@@ -135,7 +302,9 @@
                 }
             }
             [self addFieldId:fieldId name:name];
-            [fields[fieldId] setObject:name forKey:@"name"];
+            //-- only write when needed, so that normalized fields can be shared
+            if (![fields[fieldId][@"name"] isEqualToString:name])
+                [fields[fieldId] setObject:name forKey:@"name"];
         }
     }
 }
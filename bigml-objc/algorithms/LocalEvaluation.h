@@ -0,0 +1,65 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Evaluates a loaded PredictiveModel or PredictiveEnsemble against labeled
+ * data, without creating a remote evaluation.
+ *
+ * Rows are scored in parallel slices, each slice keeping its own partial
+ * counts, which are merged once the slice is done. CSV files are streamed a
+ * batch at a time, the next batch being read while the previous one is
+ * scored, so holdout sets need not fit in memory.
+ *
+ * Reports are dictionaries. They always include "rows", the rows read, and
+ * "evaluated", those with a label. For classifications they also hold:
+ *
+ *   - accuracy
+ *   - confusionMatrix: actual class -> predicted class -> count
+ *   - perClass: class -> { precision, recall, f1, support }
+ *   - averagePrecision, averageRecall, averageF1: macro averages over the
+ *     classes that appear as label or prediction
+ *
+ * and for regressions meanAbsoluteError, meanSquaredError and r2. Regression
+ * rows the predictor gives no value for are not evaluated but counted in
+ * "unpredicted".
+ */
+@interface LocalEvaluation : NSObject
+
+- (instancetype)initWithPredictor:(id)predictor;
+
+@property (nonatomic, readonly) id predictor;
+
+/// YES when the objective field is numeric
+@property (nonatomic, readonly) BOOL isRegression;
+
+/**
+ * @param rows Input rows, labeled with the value of the objective field
+ * @param options The predictor's prediction options (e.g. byName, method),
+ *        plus sliceSize, the number of rows scored by each parallel task
+ *        (default 256)
+ */
+- (NSDictionary*)evaluateRows:(NSArray*)rows options:(NSDictionary*)options;
+
+/**
+ * Same as evaluateRows:options:, over the rows of a CSV file whose header
+ * holds field names. byName defaults to YES, and options also accept
+ * batchSize, the number of rows read at a time (default 65536).
+ */
+- (NSDictionary*)evaluateCSVFile:(NSString*)path
+                         options:(NSDictionary*)options
+                           error:(NSError**)error;
+
+@end
@@ -0,0 +1,287 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "LocalEvaluation.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "BMLUtils.h"
+
+#define EVALUATION_SLICE_SIZE 256
+#define EVALUATION_BATCH_SIZE 65536
+#define EVALUATION_BATCHES_IN_FLIGHT 2
+
+/**
+ * Counts over a set of rows, which can be merged with those of other rows.
+ */
+@interface EvaluationCounts : NSObject
+
+- (void)addPrediction:(id)prediction label:(id)label regression:(BOOL)regression;
+- (void)addRowCount:(NSUInteger)rows;
+- (void)mergeCounts:(EvaluationCounts*)counts;
+- (NSDictionary*)reportWithRegression:(BOOL)regression;
+
+@end
+
+@implementation EvaluationCounts {
+    
+    NSUInteger _rows;
+    NSUInteger _evaluated;
+    NSUInteger _unpredicted;
+    
+    //-- classification: actual -> predicted -> count
+    NSMutableDictionary* _confusion;
+    
+    //-- regression: errors, and label mean and sum of squared deviations
+    double _absoluteErrors;
+    double _squaredErrors;
+    double _labelMean;
+    double _labelDeviations;
+}
+
+- (instancetype)init {
+    
+    if (self = [super init]) {
+        _confusion = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)addRowCount:(NSUInteger)rows {
+    
+    _rows += rows;
+}
+
+- (void)addPrediction:(id)prediction label:(id)label regression:(BOOL)regression {
+    
+    //-- a missing prediction has no error to measure
+    if (regression && !prediction) {
+        ++_unpredicted;
+        return;
+    }
+    
+    ++_evaluated;
+    if (regression) {
+        double value = [label doubleValue];
+        double error = [prediction doubleValue] - value;
+        _absoluteErrors += fabs(error);
+        _squaredErrors += error * error;
+        double delta = value - _labelMean;
+        _labelMean += delta / _evaluated;
+        _labelDeviations += delta * (value - _labelMean);
+    } else {
+        NSString* actual = [label description];
+        NSString* predicted = [prediction description] ?: @"";
+        NSMutableDictionary* row = _confusion[actual];
+        if (!row) {
+            row = [NSMutableDictionary new];
+            _confusion[actual] = row;
+        }
+        row[predicted] = @([row[predicted] unsignedIntegerValue] + 1);
+    }
+}
+
+- (void)mergeCounts:(EvaluationCounts*)counts {
+    
+    //-- label statistics are combined as in Chan et al.'s parallel variance
+    NSUInteger evaluated = _evaluated + counts->_evaluated;
+    if (counts->_evaluated > 0) {
+        double delta = counts->_labelMean - _labelMean;
+        _labelDeviations += counts->_labelDeviations +
+        delta * delta * _evaluated * counts->_evaluated / evaluated;
+        _labelMean += delta * counts->_evaluated / evaluated;
+    }
+    _rows += counts->_rows;
+    _evaluated = evaluated;
+    _unpredicted += counts->_unpredicted;
+    _absoluteErrors += counts->_absoluteErrors;
+    _squaredErrors += counts->_squaredErrors;
+    
+    [counts->_confusion enumerateKeysAndObjectsUsingBlock:^(NSString* actual,
+                                                             NSDictionary* predictions,
+                                                             BOOL* stop) {
+        NSMutableDictionary* row = _confusion[actual];
+        if (!row) {
+            row = [NSMutableDictionary new];
+            _confusion[actual] = row;
+        }
+        for (NSString* predicted in predictions) {
+            row[predicted] = @([row[predicted] unsignedIntegerValue] + [predictions[predicted] unsignedIntegerValue]);
+        }
+    }];
+}
+
+- (NSDictionary*)reportWithRegression:(BOOL)regression {
+    
+    NSMutableDictionary* report = [@{ @"rows" : @(_rows), @"evaluated" : @(_evaluated) } mutableCopy];
+    if (regression)
+        report[@"unpredicted"] = @(_unpredicted);
+    if (_evaluated == 0)
+        return report;
+    
+    if (regression) {
+        report[@"meanAbsoluteError"] = @(_absoluteErrors / _evaluated);
+        report[@"meanSquaredError"] = @(_squaredErrors / _evaluated);
+        report[@"r2"] = @(_labelDeviations > 0 ? 1 - _squaredErrors / _labelDeviations : 0);
+        return report;
+    }
+    
+    NSMutableSet* classes = [NSMutableSet setWithArray:_confusion.allKeys];
+    NSMutableDictionary* predictedCounts = [NSMutableDictionary new];
+    NSUInteger hits = 0;
+    for (NSString* actual in _confusion) {
+        NSDictionary* row = _confusion[actual];
+        hits += [row[actual] unsignedIntegerValue];
+        for (NSString* predicted in row) {
+            [classes addObject:predicted];
+            predictedCounts[predicted] = @([predictedCounts[predicted] unsignedIntegerValue] +
+            [row[predicted] unsignedIntegerValue]);
+        }
+    }
+    
+    NSMutableDictionary* perClass = [NSMutableDictionary dictionaryWithCapacity:classes.count];
+    double precisionSum = 0, recallSum = 0, f1Sum = 0;
+    for (NSString* category in classes) {
+        
+        double truePositives = [_confusion[category][category] unsignedIntegerValue];
+        NSUInteger support = 0;
+        for (NSNumber* count in [_confusion[category] allValues]) {
+            support += count.unsignedIntegerValue;
+        }
+        NSUInteger predicted = [predictedCounts[category] unsignedIntegerValue];
+        double precision = predicted > 0 ? truePositives / predicted : 0;
+        double recall = support > 0 ? truePositives / support : 0;
+        double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0;
+        perClass[category] = @{ @"precision" : @(precision),
+                                @"recall" : @(recall),
+                                @"f1" : @(f1),
+                                @"support" : @(support) };
+        precisionSum += precision;
+        recallSum += recall;
+        f1Sum += f1;
+    }
+    
+    report[@"accuracy"] = @((double)hits / _evaluated);
+    report[@"confusionMatrix"] = _confusion;
+    report[@"perClass"] = perClass;
+    report[@"averagePrecision"] = @(precisionSum / classes.count);
+    report[@"averageRecall"] = @(recallSum / classes.count);
+    report[@"averageF1"] = @(f1Sum / classes.count);
+    return report;
+}
+
+@end
+
+@implementation LocalEvaluation {
+    
+    NSString* _objectiveFieldId;
+    NSString* _objectiveFieldName;
+}
+
+- (instancetype)initWithPredictor:(id)predictor {
+    
+    NSAssert([predictor isKindOfClass:[PredictiveModel class]] ||
+             [predictor isKindOfClass:[PredictiveEnsemble class]],
+             @"initWithPredictor: contract unfulfilled");
+    
+    if (self = [super init]) {
+        _predictor = predictor;
+        _objectiveFieldId = [predictor objectiveFieldId];
+        NSDictionary* objectiveField = [predictor fields][_objectiveFieldId];
+        _objectiveFieldName = objectiveField[@"name"] ?: _objectiveFieldId;
+        _isRegression = [objectiveField[@"optype"] isEqualToString:@"numeric"];
+    }
+    return self;
+}
+
+- (NSArray*)predictionsForRows:(NSArray*)rows options:(NSDictionary*)options {
+    
+    if ([_predictor isKindOfClass:[PredictiveEnsemble class]])
+        return [[(PredictiveEnsemble*)_predictor predictWithRows:rows options:options] valueForKey:@"prediction"];
+    
+    NSMutableArray* predictions = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        id prediction = [[(PredictiveModel*)_predictor predictWithArguments:row options:options] firstObject][@"prediction"];
+        [predictions addObject:prediction ?: [NSNull null]];
+    }
+    return predictions;
+}
+
+- (EvaluationCounts*)countsForRows:(NSArray*)rows options:(NSDictionary*)options {
+    
+    BOOL byName = [options[@"byName"] ?: @NO boolValue];
+    NSString* labelKey = byName ? _objectiveFieldName : _objectiveFieldId;
+    NSUInteger sliceSize = [options[@"sliceSize"] unsignedIntegerValue] ?: EVALUATION_SLICE_SIZE;
+    NSUInteger sliceCount = (rows.count + sliceSize - 1) / sliceSize;
+    
+    EvaluationCounts* total = [EvaluationCounts new];
+    [total addRowCount:rows.count];
+    dispatch_apply(sliceCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t slice) {
+        
+        NSRange range = NSMakeRange(slice * sliceSize, MIN(sliceSize, rows.count - slice * sliceSize));
+        NSArray* sliceRows = [rows subarrayWithRange:range];
+        NSArray* predictions = [self predictionsForRows:sliceRows options:options];
+        
+        EvaluationCounts* counts = [EvaluationCounts new];
+        [sliceRows enumerateObjectsUsingBlock:^(NSDictionary* row, NSUInteger i, BOOL* stop) {
+            id label = row[labelKey];
+            if (!label || label == [NSNull null] || [[label description] length] == 0)
+                return;
+            [counts addPrediction:predictions[i] == [NSNull null] ? nil : predictions[i]
+                            label:label
+                       regression:_isRegression];
+        }];
+        @synchronized (total) {
+            [total mergeCounts:counts];
+        }
+    });
+    return total;
+}
+
+- (NSDictionary*)evaluateRows:(NSArray*)rows options:(NSDictionary*)options {
+    
+    return [[self countsForRows:rows options:options] reportWithRegression:_isRegression];
+}
+
+- (NSDictionary*)evaluateCSVFile:(NSString*)path
+                         options:(NSDictionary*)options
+                           error:(NSError**)error {
+    
+    NSMutableDictionary* fileOptions = [options ?: @{} mutableCopy];
+    if (!fileOptions[@"byName"])
+        fileOptions[@"byName"] = @YES;
+    NSUInteger batchSize = [options[@"batchSize"] unsignedIntegerValue] ?: EVALUATION_BATCH_SIZE;
+    
+    //-- batches are scored while the next one is read, with a bounded number in memory
+    EvaluationCounts* total = [EvaluationCounts new];
+    dispatch_group_t scoring = dispatch_group_create();
+    dispatch_semaphore_t inFlight = dispatch_semaphore_create(EVALUATION_BATCHES_IN_FLIGHT);
+    BOOL read = [BMLUtils enumerateRowsOfCSVFile:path
+                                       batchSize:batchSize
+                                           error:error
+                                      usingBlock:^(NSArray* rows, BOOL* stop) {
+        
+        dispatch_semaphore_wait(inFlight, DISPATCH_TIME_FOREVER);
+        dispatch_group_async(scoring, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            EvaluationCounts* counts = [self countsForRows:rows options:fileOptions];
+            @synchronized (total) {
+                [total mergeCounts:counts];
+            }
+            dispatch_semaphore_signal(inFlight);
+        });
+    }];
+    dispatch_group_wait(scoring, DISPATCH_TIME_FOREVER);
+    return read ? [total reportWithRegression:_isRegression] : nil;
+}
+
+@end
@@ -0,0 +1,87 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+#import <stdatomic.h>
+
+/**
+ * A region of memory for the plain C data of a model's nodes, so that
+ * building a model does not make one heap allocation per node for them and
+ * releasing the model frees them all at once.
+ *
+ * Memory is taken from chunks, allocated as needed, in zeroed blocks
+ * aligned to 16 bytes; blocks are never freed individually, but models
+ * reuse the blocks of data they compile again (see ArenaReaders). Not thread
+ * safe: models allocate while holding their own lock, and blocks already
+ * handed out stay valid while others are allocated.
+ */
+@interface ModelArena : NSObject
+
+/**
+ * @param chunkSize The size of the chunks memory is taken from; larger
+ *        blocks get a chunk of their own
+ */
+- (instancetype)initWithChunkSize:(size_t)chunkSize;
+
+/**
+ * A zeroed block of memory, valid as long as the arena, or NULL if memory
+ * is exhausted.
+ */
+- (void*)allocate:(size_t)size;
+
+/// the bytes handed out by allocate:
+@property (nonatomic, readonly) size_t bytesUsed;
+
+/// the bytes taken from the system, chunk headers included
+@property (nonatomic, readonly) size_t bytesReserved;
+
+@end
+
+/**
+ * The readers of data a model compiles again while it is in use, e.g. its
+ * tree in a new branch order, so that the memory of the previous version can
+ * be reused instead of taking more from the arena. As in BMLModelHandle,
+ * readers take no lock: they register with the parity of the epoch they
+ * started in for as long as they use the data.
+ */
+typedef struct ArenaReaders {
+    
+    atomic_uint epoch;
+    atomic_uint readers[2];
+    
+} ArenaReaders;
+
+/**
+ * Registers a reader, to be called before loading the published data.
+ * @return The parity to pass to ArenaReadersLeave
+ */
+static inline unsigned int ArenaReadersEnter(ArenaReaders* readers) {
+    
+    unsigned int parity = atomic_load(&readers->epoch) & 1;
+    atomic_fetch_add(&readers->readers[parity], 1);
+    return parity;
+}
+
+static inline void ArenaReadersLeave(ArenaReaders* readers, unsigned int parity) {
+    
+    atomic_fetch_sub(&readers->readers[parity], 1);
+}
+
+/**
+ * Waits for the readers registered so far to leave. Called by the writer
+ * right after publishing new data, it makes the previous version free to
+ * overwrite. Writers must be serialized with each other.
+ */
+void ArenaReadersWait(ArenaReaders* readers);
@@ -0,0 +1,95 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "ModelArena.h"
+#import <sched.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_DEFAULT_CHUNK_SIZE 16384
+
+/**
+ * Chunks are linked from the most recent one, which blocks are taken from.
+ */
+typedef struct ArenaChunk {
+    
+    struct ArenaChunk* previous;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGNMENT) unsigned char bytes[];
+    
+} ArenaChunk;
+
+@implementation ModelArena {
+    
+    ArenaChunk* _chunk;
+    size_t _chunkSize;
+}
+
+- (instancetype)init {
+    
+    return [self initWithChunkSize:ARENA_DEFAULT_CHUNK_SIZE];
+}
+
+- (instancetype)initWithChunkSize:(size_t)chunkSize {
+    
+    if (self = [super init]) {
+        _chunkSize = MAX(chunkSize, ARENA_ALIGNMENT);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    while (_chunk) {
+        ArenaChunk* previous = _chunk->previous;
+        free(_chunk);
+        _chunk = previous;
+    }
+}
+
+- (void*)allocate:(size_t)size {
+    
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (!_chunk || _chunk->size - _chunk->used < size) {
+        
+        //-- the rest of the current chunk is left unused
+        size_t chunkSize = MAX(size, _chunkSize);
+        ArenaChunk* chunk = calloc(1, sizeof(ArenaChunk) + chunkSize);
+        if (!chunk)
+            return NULL;
+        chunk->size = chunkSize;
+        chunk->previous = _chunk;
+        _chunk = chunk;
+        _bytesReserved += sizeof(ArenaChunk) + chunkSize;
+    }
+    void* block = _chunk->bytes + _chunk->used;
+    _chunk->used += size;
+    _bytesUsed += size;
+    return block;
+}
+
+@end
+
+void ArenaReadersWait(ArenaReaders* readers) {
+    
+    //-- two epochs, as a reader may have read the epoch before the last flip
+    //-- but registered after it
+    for (NSUInteger round = 0; round < 2; ++round) {
+        unsigned int parity = atomic_fetch_add(&readers->epoch, 1) & 1;
+        while (atomic_load(&readers->readers[parity]) > 0) {
+            sched_yield();
+        }
+    }
+}
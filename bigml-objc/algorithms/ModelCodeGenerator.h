@@ -0,0 +1,104 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+#import "FieldResource.h"
+
+/**
+ * Exports a decision tree model, an ensemble or an anomaly detector as a
+ * standalone C function, with no dependency besides the C standard library.
+ * Each tree becomes a function whose split thresholds and categories are
+ * inlined as constants and whose branches are plain jumps, so that nothing
+ * is left to interpret when predicting.
+ *
+ * The generated function takes the input row as two arrays indexed as
+ * inputFields: `numbers`, holding the values of numeric fields (NAN when
+ * missing), and `strings`, holding the UTF-8 values of categorical fields
+ * (NULL when missing). It returns:
+ *
+ *        - for classification models, the index of the predicted class in
+ *          the generated `<name>_classes` array, also storing the
+ *          confidence of the prediction if `confidence` is not NULL;
+ *        - for regression models, the predicted value, also storing its
+ *          confidence (the expected error) if `confidence` is not NULL;
+ *        - for ensembles, the plurality vote of the members (the index of
+ *          the class or the mean of the predicted values);
+ *        - for anomaly detectors, the anomaly score.
+ *
+ * Predictions follow the LastPrediction missing strategy and the default
+ * order of branches, that of PredictiveModel, PredictiveEnsemble and Anomaly.
+ * Splits on text or items fields are not supported.
+ */
+@interface ModelCodeGenerator : FieldResource
+
+/**
+ * @param jsonModel The model, either as a full resource or its `object` element
+ * @param functionName The name of the generated function, a C identifier
+ * @return The generator, or nil if the model is not finished or cannot be
+ *         exported
+ */
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel
+                     functionName:(NSString*)functionName;
+
+/**
+ * @param jsonModels The members of an ensemble, as given to PredictiveEnsemble
+ */
+- (instancetype)initWithJSONModels:(NSArray*)jsonModels
+                      functionName:(NSString*)functionName;
+
+/**
+ * @param jsonAnomaly The anomaly detector, as given to Anomaly
+ */
+- (instancetype)initWithJSONAnomaly:(NSDictionary*)jsonAnomaly
+                       functionName:(NSString*)functionName;
+
+@property (nonatomic, readonly) NSString* functionName;
+
+/// the ids of the input fields, in the order of the generated arrays
+@property (nonatomic, readonly) NSArray* inputFields;
+
+/// the classes the function returns the index of, nil for regressions
+@property (nonatomic, readonly) NSArray* classes;
+
+/// the C source of the generated function and its tables
+@property (nonatomic, readonly) NSString* source;
+
+/**
+ * A C program made of the generated source and a main function checking it
+ * against the given predictor: the rows are embedded in the program along
+ * with the predictions of the predictor for them. Once compiled (e.g.
+ * `cc -O2 harness.c -lm`), the program prints the rows whose generated
+ * prediction differs and exits with a non-zero status if there is any.
+ * Regression predictions and scores are compared with a relative tolerance
+ * of 1e-9.
+ *
+ * @param predictor The PredictiveModel, PredictiveEnsemble or Anomaly built
+ *        from the JSON this generator was built from
+ * @param rows The input rows
+ * @param byName YES when the rows are keyed by field name
+ */
+- (NSString*)harnessSourceWithPredictor:(id)predictor
+                                   rows:(NSArray*)rows
+                                 byName:(BOOL)byName;
+
+/**
+ * Same as harnessSourceWithPredictor:rows:byName:, over the rows of a CSV
+ * file whose header holds the field names.
+ */
+- (NSString*)harnessSourceWithPredictor:(id)predictor
+                                CSVFile:(NSString*)path
+                                  error:(NSError**)error;
+
+@end
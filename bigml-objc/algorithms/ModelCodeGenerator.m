@@ -0,0 +1,590 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "ModelCodeGenerator.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "Anomaly.h"
+#import "Predicates.h"
+#import "BMLUtils.h"
+
+typedef enum CodeGeneratorKind {
+    
+    CodeGeneratorKindModel,
+    CodeGeneratorKindEnsemble,
+    CodeGeneratorKindAnomaly,
+    
+} CodeGeneratorKind;
+
+#pragma mark C literals
+
+static NSString* doubleLiteral(double value) {
+    
+    if (isnan(value))
+        return @"NAN";
+    if (isinf(value))
+        return value > 0 ? @"INFINITY" : @"-INFINITY";
+    
+    //-- 17 significant digits read back as the same double
+    NSString* literal = [NSString stringWithFormat:@"%.17g", value];
+    if ([literal rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@".eE"]].location == NSNotFound)
+        literal = [literal stringByAppendingString:@".0"];
+    return literal;
+}
+
+/**
+ * Non-printable and non-ASCII bytes are written as octal escapes, which
+ * never take more than three digits, and '?' is escaped to avoid trigraphs.
+ */
+static NSString* stringLiteral(NSString* value) {
+    
+    if (!value)
+        return @"NULL";
+    const char* bytes = value.UTF8String;
+    NSMutableString* literal = [NSMutableString stringWithString:@"\""];
+    for (const unsigned char* c = (const unsigned char*)bytes; *c; ++c) {
+        if (*c == '"' || *c == '\\' || *c == '?')
+            [literal appendFormat:@"\\%c", *c];
+        else if (*c < 0x20 || *c >= 0x7f)
+            [literal appendFormat:@"\\%03o", *c];
+        else
+            [literal appendFormat:@"%c", *c];
+    }
+    [literal appendString:@"\""];
+    return literal;
+}
+
+static BOOL isIdentifier(NSString* name) {
+    
+    return [RegExHelper isRegex:@"^[A-Za-z_][A-Za-z0-9_]*$" matching:name ?: @""];
+}
+
+#pragma mark ModelCodeGenerator
+
+@implementation ModelCodeGenerator {
+    
+    CodeGeneratorKind _kind;
+    BOOL _regression;
+    NSUInteger _treeCount;
+    double _expectedMeanDepth;
+    NSMutableString* _trees;
+    NSMutableArray* _inputFields;
+    NSMutableDictionary* _fieldIndexes;
+    NSMutableArray* _classes;
+    NSMutableDictionary* _classIndexes;
+}
+
+- (instancetype)initWithFieldResource:(FieldResource*)fieldResource
+                         functionName:(NSString*)functionName
+                                 kind:(CodeGeneratorKind)kind {
+    
+    if (!isIdentifier(functionName))
+        return nil;
+    if (self = [super initWithFieldResource:fieldResource]) {
+        
+        _functionName = functionName;
+        _kind = kind;
+        _trees = [NSMutableString string];
+        _inputFields = [NSMutableArray array];
+        _fieldIndexes = [NSMutableDictionary dictionary];
+        _classes = [NSMutableArray array];
+        _classIndexes = [NSMutableDictionary dictionary];
+        _regression = kind != CodeGeneratorKindAnomaly &&
+        [self.fields[self.objectiveFieldId][@"optype"] isEqualToString:@"numeric"];
+    }
+    return self;
+}
+
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel
+                     functionName:(NSString*)functionName {
+    
+    NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+    if ([model[@"status"][@"code"] intValue] != 5)
+        return nil;
+    
+    if (self = [self initWithFieldResource:[PredictiveModel sharedFieldsWithJSONModel:jsonModel]
+                              functionName:functionName
+                                      kind:CodeGeneratorKindModel]) {
+        
+        if (![self appendModelTree:model[@"model"][@"root"]])
+            return nil;
+        _source = [self modelSource];
+    }
+    return self;
+}
+
+- (instancetype)initWithJSONModels:(NSArray*)jsonModels
+                      functionName:(NSString*)functionName {
+    
+    if (jsonModels.count == 0)
+        return nil;
+    for (NSDictionary* jsonModel in jsonModels) {
+        NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+        if ([model[@"status"][@"code"] intValue] != 5)
+            return nil;
+    }
+    
+    if (self = [self initWithFieldResource:[PredictiveModel sharedFieldsWithJSONModels:jsonModels]
+                              functionName:functionName
+                                      kind:CodeGeneratorKindEnsemble]) {
+        
+        for (NSDictionary* jsonModel in jsonModels) {
+            NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+            if (![self appendModelTree:model[@"model"][@"root"]])
+                return nil;
+        }
+        _source = [self ensembleSource];
+    }
+    return self;
+}
+
+- (instancetype)initWithJSONAnomaly:(NSDictionary*)jsonAnomaly
+                       functionName:(NSString*)functionName {
+    
+    NSDictionary* model = jsonAnomaly[@"model"];
+    if ([jsonAnomaly[@"status"][@"code"] intValue] != 5 || [model[@"trees"] count] == 0)
+        return nil;
+    
+    if (self = [self initWithFieldResource:[[FieldResource alloc] initWithFields:model[@"fields"]]
+                              functionName:functionName
+                                      kind:CodeGeneratorKindAnomaly]) {
+        
+        //-- the depth normalization is the one of the interpreted detector
+        _expectedMeanDepth = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly].expectedMeanDepth;
+        for (NSDictionary* tree in model[@"trees"]) {
+            if (![self appendAnomalyTree:tree[@"root"]])
+                return nil;
+        }
+        _source = [self anomalySource];
+    }
+    return self;
+}
+
+- (NSArray*)classes {
+    
+    return _regression || _kind == CodeGeneratorKindAnomaly ? nil : _classes;
+}
+
+#pragma mark Predicates
+
+- (NSUInteger)indexOfField:(NSString*)fieldId {
+    
+    NSNumber* index = _fieldIndexes[fieldId];
+    if (!index) {
+        index = @(_inputFields.count);
+        _fieldIndexes[fieldId] = index;
+        [_inputFields addObject:fieldId];
+    }
+    return index.unsignedIntegerValue;
+}
+
+- (NSUInteger)indexOfClass:(id)category {
+    
+    NSString* name = [category description];
+    NSNumber* index = _classIndexes[name];
+    if (!index) {
+        index = @(_classes.count);
+        _classIndexes[name] = index;
+        [_classes addObject:name];
+    }
+    return index.unsignedIntegerValue;
+}
+
+/**
+ * The C expression of a predicate, as evaluated by Predicate apply:fields:,
+ * or nil if it cannot be exported. Model predicates name their operator
+ * `operator`, anomaly ones `op`.
+ */
+- (NSString*)conditionOfPredicate:(id)predicate {
+    
+    if ([predicate isKindOfClass:[NSNumber class]] && [predicate boolValue])
+        return @"1";
+    if (![predicate isKindOfClass:[NSDictionary class]] || predicate[@"term"])
+        return nil;
+    
+    NSString* op = predicate[@"operator"] ?: predicate[@"op"];
+    NSString* fieldId = predicate[@"field"];
+    id value = predicate[@"value"];
+    if (![op isKindOfClass:[NSString class]] || ![fieldId isKindOfClass:[NSString class]])
+        return nil;
+    BOOL missing = [op hasSuffix:@"*"];
+    if (missing)
+        op = [op substringToIndex:op.length - 1];
+    
+    NSString* optype = self.fields[fieldId][@"optype"];
+    BOOL numeric = [optype isEqualToString:@"numeric"];
+    if (!numeric && ![optype isEqualToString:@"categorical"])
+        return nil;
+    NSUInteger index = [self indexOfField:fieldId];
+    NSString* input = [NSString stringWithFormat:numeric ? @"numbers[%lu]" : @"strings[%lu]",
+                       (unsigned long)index];
+    NSString* isMissing = numeric ? [NSString stringWithFormat:@"isnan(%@)", input] : [@"!" stringByAppendingString:input];
+    NSString* isPresent = numeric ? [@"!" stringByAppendingString:isMissing] : input;
+    
+    NSString* test = nil;
+    if (!value || value == [NSNull null]) {
+        
+        if ([op isEqualToString:@"="])
+            return isMissing;
+        if ([op isEqualToString:@"!="])
+            return isPresent;
+        return nil;
+    } else if (numeric && [value isKindOfClass:[NSNumber class]]) {
+        
+        NSDictionary* operators = @{ @"<" : @"<", @"<=" : @"<=", @">" : @">", @">=" : @">=",
+                                     @"=" : @"==", @"!=" : @"!=" };
+        if (!operators[op])
+            return nil;
+        test = [NSString stringWithFormat:@"%@ %@ %@", input, operators[op], doubleLiteral([value doubleValue])];
+    } else if (!numeric && [value isKindOfClass:[NSString class]] &&
+               ([op isEqualToString:@"="] || [op isEqualToString:@"!="])) {
+        
+        test = [NSString stringWithFormat:@"strcmp(%@, %@) %@ 0",
+                input, stringLiteral(value), [op isEqualToString:@"="] ? @"==" : @"!="];
+    } else if (!numeric && [op isEqualToString:@"in"] && [value isKindOfClass:[NSArray class]]) {
+        
+        NSMutableArray* tests = [NSMutableArray arrayWithCapacity:[value count]];
+        for (id category in value) {
+            if (![category isKindOfClass:[NSString class]])
+                return nil;
+            [tests addObject:[NSString stringWithFormat:@"strcmp(%@, %@) == 0", input, stringLiteral(category)]];
+        }
+        test = tests.count > 0 ? [NSString stringWithFormat:@"(%@)", [tests componentsJoinedByString:@" || "]] : @"0";
+    } else {
+        return nil;
+    }
+    return missing ?
+    [NSString stringWithFormat:@"(%@ || %@)", isMissing, test] :
+    [NSString stringWithFormat:@"(%@ && %@)", isPresent, test];
+}
+
+#pragma mark Trees
+
+/**
+ * Children in the order the interpreted trees test them: most populated
+ * first, ties keeping the order of the JSON.
+ */
+static NSArray* orderedChildren(NSDictionary* node, NSString* populationKey) {
+    
+    return [node[@"children"] sortedArrayWithOptions:NSSortStable
+                                     usingComparator:^NSComparisonResult(NSDictionary* a, NSDictionary* b) {
+                                         return [@([b[populationKey] integerValue])
+                                                 compare:@([a[populationKey] integerValue])];
+                                     }];
+}
+
+/**
+ * Appends a function returning the index of the node a row reaches, along
+ * with the tables of outputs (and confidences) of the nodes. Nodes are
+ * numbered breadth first and each one is a label: a split is a sequence of
+ * conditional jumps to the children, tested in order, falling back on
+ * returning the node itself.
+ */
+- (BOOL)appendModelTree:(NSDictionary*)root {
+    
+    if (![root isKindOfClass:[NSDictionary class]])
+        return NO;
+    
+    NSString* tree = [NSString stringWithFormat:@"%@_tree%lu", _functionName, (unsigned long)_treeCount++];
+    NSMutableString* code = [NSMutableString string];
+    NSMutableArray* outputs = [NSMutableArray array];
+    NSMutableArray* confidences = [NSMutableArray array];
+    NSMutableArray* queue = [NSMutableArray arrayWithObject:root];
+    
+    for (NSUInteger index = 0; index < queue.count; ++index) {
+        
+        NSDictionary* node = queue[index];
+        if (_regression) {
+            if (![node[@"output"] isKindOfClass:[NSNumber class]])
+                return NO;
+            [outputs addObject:doubleLiteral([node[@"output"] doubleValue])];
+        } else {
+            if (!node[@"output"])
+                return NO;
+            [outputs addObject:[@([self indexOfClass:node[@"output"]]) stringValue]];
+        }
+        [confidences addObject:doubleLiteral([node[@"confidence"] doubleValue])];
+        
+        if (index > 0)
+            [code appendFormat:@"n%lu:\n", (unsigned long)index];
+        for (NSDictionary* child in orderedChildren(node, @"count")) {
+            NSString* condition = [self conditionOfPredicate:child[@"predicate"]];
+            if (!condition)
+                return NO;
+            [code appendFormat:@"    if (%@) goto n%lu;\n", condition, (unsigned long)queue.count];
+            [queue addObject:child];
+        }
+        [code appendFormat:@"    return %lu;\n", (unsigned long)index];
+    }
+    
+    [_trees appendFormat:@"static const %@ %@_output[%lu] = {\n    %@\n};\n\n",
+     _regression ? @"double" : @"int", tree, (unsigned long)outputs.count,
+     [outputs componentsJoinedByString:@",\n    "]];
+    if (_kind == CodeGeneratorKindModel) {
+        [_trees appendFormat:@"static const double %@_confidence[%lu] = {\n    %@\n};\n\n",
+         tree, (unsigned long)confidences.count, [confidences componentsJoinedByString:@",\n    "]];
+    }
+    [_trees appendFormat:@"static int %@(const double* numbers, const char* const* strings) {\n\n"
+     @"    (void)numbers;\n    (void)strings;\n%@}\n\n", tree, code];
+    return YES;
+}
+
+/**
+ * Anomaly trees return the depth the row reaches, as AnomalyTreeNode
+ * verifiedDepthForTree:path:depth: does: 0 when the root predicates do not
+ * hold, and one more per level otherwise.
+ */
+- (NSString*)conditionOfPredicates:(NSArray*)predicates {
+    
+    NSMutableArray* conditions = [NSMutableArray arrayWithCapacity:predicates.count];
+    for (id predicate in predicates ?: @[ @YES ]) {
+        NSString* condition = [self conditionOfPredicate:predicate];
+        if (!condition)
+            return nil;
+        if (![condition isEqualToString:@"1"])
+            [conditions addObject:condition];
+    }
+    return conditions.count > 0 ? [conditions componentsJoinedByString:@" && "] : @"1";
+}
+
+- (BOOL)appendAnomalyTree:(NSDictionary*)root {
+    
+    if (![root isKindOfClass:[NSDictionary class]])
+        return NO;
+    
+    NSString* tree = [NSString stringWithFormat:@"%@_tree%lu", _functionName, (unsigned long)_treeCount++];
+    NSMutableString* code = [NSMutableString string];
+    NSMutableArray* queue = [NSMutableArray arrayWithObject:root];
+    NSMutableArray* depths = [NSMutableArray arrayWithObject:@1];
+    
+    NSString* rootCondition = [self conditionOfPredicates:root[@"predicates"]];
+    if (!rootCondition)
+        return NO;
+    if (![rootCondition isEqualToString:@"1"])
+        [code appendFormat:@"    if (!(%@)) return 0;\n", rootCondition];
+    
+    for (NSUInteger index = 0; index < queue.count; ++index) {
+        
+        NSDictionary* node = queue[index];
+        NSUInteger depth = [depths[index] unsignedIntegerValue];
+        if (index > 0)
+            [code appendFormat:@"n%lu:\n", (unsigned long)index];
+        for (NSDictionary* child in orderedChildren(node, @"population")) {
+            NSString* condition = [self conditionOfPredicates:child[@"predicates"]];
+            if (!condition)
+                return NO;
+            [code appendFormat:@"    if (%@) goto n%lu;\n", condition, (unsigned long)queue.count];
+            [queue addObject:child];
+            [depths addObject:@(depth + 1)];
+        }
+        [code appendFormat:@"    return %lu;\n", (unsigned long)depth];
+    }
+    
+    [_trees appendFormat:@"static int %@(const double* numbers, const char* const* strings) {\n\n"
+     @"    (void)numbers;\n    (void)strings;\n%@}\n\n", tree, code];
+    return YES;
+}
+
+#pragma mark Source
+
+- (NSString*)prologue {
+    
+    NSMutableString* source = [NSMutableString string];
+    [source appendFormat:@"/* %@: generated by bigml-objc, do not edit. */\n\n", _functionName];
+    [source appendString:@"#include <math.h>\n#include <stddef.h>\n#include <string.h>\n\n"];
+    
+    NSMutableArray* fieldIds = [NSMutableArray arrayWithCapacity:_inputFields.count];
+    for (NSString* fieldId in _inputFields) {
+        [fieldIds addObject:stringLiteral(fieldId)];
+    }
+    [source appendFormat:@"#define %@_FIELD_COUNT %lu\n\n", _functionName.uppercaseString, (unsigned long)_inputFields.count];
+    [source appendFormat:@"/* the ids of the fields in numbers (numeric) and strings (categorical) */\n"
+     @"const char* const %@_fields[] = { %@ };\n\n",
+     _functionName, fieldIds.count > 0 ? [fieldIds componentsJoinedByString:@", "] : @"NULL"];
+    
+    if (self.classes) {
+        NSMutableArray* classes = [NSMutableArray arrayWithCapacity:_classes.count];
+        for (NSString* category in _classes) {
+            [classes addObject:stringLiteral(category)];
+        }
+        [source appendFormat:@"#define %@_CLASS_COUNT %lu\n\n", _functionName.uppercaseString, (unsigned long)_classes.count];
+        [source appendFormat:@"const char* const %@_classes[] = {\n    %@\n};\n\n",
+         _functionName, [classes componentsJoinedByString:@",\n    "]];
+    }
+    [source appendString:_trees];
+    return source;
+}
+
+- (NSString*)modelSource {
+    
+    NSMutableString* source = [NSMutableString stringWithString:[self prologue]];
+    [source appendFormat:@"%@ %@(const double* numbers, const char* const* strings, double* confidence) {\n\n"
+     @"    int node = %@_tree0(numbers, strings);\n"
+     @"    if (confidence)\n"
+     @"        *confidence = %@_tree0_confidence[node];\n"
+     @"    return %@_tree0_output[node];\n}\n",
+     _regression ? @"double" : @"int", _functionName, _functionName, _functionName, _functionName];
+    return source;
+}
+
+- (NSString*)ensembleSource {
+    
+    NSMutableString* source = [NSMutableString stringWithString:[self prologue]];
+    if (_regression) {
+        
+        [source appendFormat:@"double %@(const double* numbers, const char* const* strings) {\n\n"
+         @"    double sum = 0;\n", _functionName];
+        for (NSUInteger i = 0; i < _treeCount; ++i) {
+            [source appendFormat:@"    sum += %@_tree%lu_output[%@_tree%lu(numbers, strings)];\n",
+             _functionName, (unsigned long)i, _functionName, (unsigned long)i];
+        }
+        [source appendFormat:@"    return sum / %lu;\n}\n", (unsigned long)_treeCount];
+        return source;
+    }
+    
+    //-- as MultiVote combineCategorical:confidence:, ties go to the class voted first
+    NSString* classCount = [_functionName.uppercaseString stringByAppendingString:@"_CLASS_COUNT"];
+    [source appendFormat:@"int %@(const double* numbers, const char* const* strings) {\n\n"
+     @"    int votes[%@] = { 0 };\n"
+     @"    int first[%@] = { 0 };\n"
+     @"    int vote, best = 0;\n",
+     _functionName, classCount, classCount];
+    for (NSUInteger i = 0; i < _treeCount; ++i) {
+        [source appendFormat:@"    vote = %@_tree%lu_output[%@_tree%lu(numbers, strings)];\n"
+         @"    if (votes[vote]++ == 0)\n        first[vote] = %lu;\n",
+         _functionName, (unsigned long)i, _functionName, (unsigned long)i, (unsigned long)i];
+    }
+    [source appendFormat:@"    for (vote = 1; vote < %@; ++vote) {\n"
+     @"        if (votes[vote] > votes[best] ||\n"
+     @"            (votes[vote] == votes[best] && votes[vote] > 0 && first[vote] < first[best]))\n"
+     @"            best = vote;\n"
+     @"    }\n"
+     @"    return best;\n}\n", classCount];
+    return source;
+}
+
+- (NSString*)anomalySource {
+    
+    NSMutableString* source = [NSMutableString stringWithString:[self prologue]];
+    [source appendFormat:@"double %@(const double* numbers, const char* const* strings) {\n\n"
+     @"    double depthSum = 0;\n", _functionName];
+    for (NSUInteger i = 0; i < _treeCount; ++i) {
+        [source appendFormat:@"    depthSum += %@_tree%lu(numbers, strings);\n", _functionName, (unsigned long)i];
+    }
+    [source appendFormat:@"    return pow(2.0, -(depthSum / %lu) / %@);\n}\n",
+     (unsigned long)_treeCount, doubleLiteral(_expectedMeanDepth)];
+    return source;
+}
+
+#pragma mark Harness
+
+/**
+ * The prediction of the interpreted predictor for a decoded row, as a C
+ * literal comparable to the generated function's result. Unknown classes
+ * become -1, which the generated function never returns.
+ */
+- (NSString*)expectedLiteralWithPredictor:(id)predictor input:(NSDictionary*)input {
+    
+    NSDictionary* options = @{ @"decodedInput" : @YES };
+    id prediction = nil;
+    if (_kind == CodeGeneratorKindAnomaly) {
+        return doubleLiteral([(Anomaly*)predictor score:input options:options]);
+    } else if (_kind == CodeGeneratorKindEnsemble) {
+        prediction = [(PredictiveEnsemble*)predictor predictWithArguments:input options:options][@"prediction"];
+    } else {
+        prediction = [[(PredictiveModel*)predictor predictWithArguments:input options:options] firstObject][@"prediction"];
+    }
+    if (_regression)
+        return doubleLiteral([prediction doubleValue]);
+    NSNumber* index = prediction ? _classIndexes[[prediction description]] : nil;
+    return index ? index.stringValue : @"-1";
+}
+
+- (NSString*)harnessSourceWithPredictor:(id)predictor
+                                   rows:(NSArray*)rows
+                                 byName:(BOOL)byName {
+    
+    NSUInteger width = MAX(_inputFields.count, 1);
+    NSMutableArray* numberRows = [NSMutableArray arrayWithCapacity:rows.count];
+    NSMutableArray* stringRows = [NSMutableArray arrayWithCapacity:rows.count];
+    NSMutableArray* expected = [NSMutableArray arrayWithCapacity:rows.count];
+    
+    for (NSDictionary* row in rows) {
+        
+        NSDictionary* input = [self decodedInputData:row byName:byName];
+        NSMutableArray* numbers = [NSMutableArray arrayWithCapacity:width];
+        NSMutableArray* strings = [NSMutableArray arrayWithCapacity:width];
+        for (NSUInteger i = 0; i < width; ++i) {
+            
+            NSString* fieldId = i < _inputFields.count ? _inputFields[i] : nil;
+            id value = fieldId ? input[fieldId] : nil;
+            BOOL numeric = fieldId && [self.fields[fieldId][@"optype"] isEqualToString:@"numeric"];
+            [numbers addObject:numeric && [value isKindOfClass:[NSNumber class]] ?
+             doubleLiteral([value doubleValue]) : @"NAN"];
+            [strings addObject:!numeric && value ? stringLiteral([value description]) : @"NULL"];
+        }
+        [numberRows addObject:[NSString stringWithFormat:@"{ %@ }", [numbers componentsJoinedByString:@", "]]];
+        [stringRows addObject:[NSString stringWithFormat:@"{ %@ }", [strings componentsJoinedByString:@", "]]];
+        [expected addObject:[self expectedLiteralWithPredictor:predictor input:input]];
+    }
+    
+    BOOL exact = !_regression && _kind != CodeGeneratorKindAnomaly;
+    NSString* arguments = _kind == CodeGeneratorKindModel ?
+    @"harness_numbers[row], harness_strings[row], NULL" : @"harness_numbers[row], harness_strings[row]";
+    NSMutableString* source = [NSMutableString stringWithString:_source];
+    [source appendString:@"\n/* harness: the predictions of bigml-objc for the rows below */\n\n"
+     @"#include <stdio.h>\n\n"];
+    [source appendFormat:@"#define HARNESS_ROWS %lu\n\n", (unsigned long)rows.count];
+    if (rows.count > 0) {
+        [source appendFormat:@"static const double harness_numbers[][%lu] = {\n    %@\n};\n\n",
+         (unsigned long)width, [numberRows componentsJoinedByString:@",\n    "]];
+        [source appendFormat:@"static const char* const harness_strings[][%lu] = {\n    %@\n};\n\n",
+         (unsigned long)width, [stringRows componentsJoinedByString:@",\n    "]];
+        [source appendFormat:@"static const %@ harness_expected[] = {\n    %@\n};\n\n",
+         exact ? @"int" : @"double", [expected componentsJoinedByString:@",\n    "]];
+    }
+    [source appendString:@"int main(void) {\n\n    int mismatches = 0;\n"];
+    if (rows.count > 0) {
+        [source appendString:@"    int row;\n    for (row = 0; row < HARNESS_ROWS; ++row) {\n"];
+        if (exact) {
+            [source appendFormat:@"        int result = %@(%@);\n"
+             @"        if (result != harness_expected[row]) {\n"
+             @"            printf(\"row %%d: %%d, expected %%d\\n\", row, result, harness_expected[row]);\n",
+             _functionName, arguments];
+        } else {
+            [source appendFormat:@"        double result = %@(%@);\n"
+             @"        double expected = harness_expected[row];\n"
+             @"        if (!(fabs(result - expected) <= 1e-9 * fmax(1.0, fabs(expected)))) {\n"
+             @"            printf(\"row %%d: %%.17g, expected %%.17g\\n\", row, result, expected);\n",
+             _functionName, arguments];
+        }
+        [source appendString:@"            ++mismatches;\n        }\n    }\n"];
+    }
+    [source appendString:@"    printf(\"%d rows, %d mismatches\\n\", HARNESS_ROWS, mismatches);\n"
+     @"    return mismatches > 0;\n}\n"];
+    return source;
+}
+
+- (NSString*)harnessSourceWithPredictor:(id)predictor
+                                CSVFile:(NSString*)path
+                                  error:(NSError**)error {
+    
+    NSArray* rows = [BMLUtils rowsFromCSVFile:path error:error];
+    if (!rows)
+        return nil;
+    return [self harnessSourceWithPredictor:predictor rows:rows byName:YES];
+}
+
+@end
@@ -13,8 +13,11 @@
 // under the License.
 
 #import <Foundation/Foundation.h>
+#import "EnsembleMemberSource.h"
 
 @class MultiVote;
+@class FieldResource;
+@class PredictiveModel;
 
 @interface MultiModel : NSObject
 
@@ -22,8 +25,52 @@
 
 + (MultiModel*)multiModelWithModels:(NSArray*)ids;
 
+/**
+ * @param sharedFields Field definitions to be shared by all the models, see
+ *        PredictiveModel initWithJSONModel:sharedFields:
+ */
++ (MultiModel*)multiModelWithModels:(NSArray*)ids sharedFields:(FieldResource*)sharedFields;
+
+/**
+ * A MultiModel whose models are read from a member source when first used,
+ * and kept in a cache of at most `workingSet` models (0 for no limit) that
+ * is also trimmed under memory pressure.
+ */
+- (instancetype)initWithMemberSource:(id<EnsembleMemberSource>)source
+                          workingSet:(NSUInteger)workingSet
+                        sharedFields:(FieldResource*)sharedFields;
+
+/**
+ * The number of models in this MultiModel.
+ */
+- (NSUInteger)count;
+
+/**
+ * The number of times a model could not be read from the member source or
+ * built from what it returned. Failed members are tried again when next used.
+ */
+@property (nonatomic, readonly) NSUInteger unavailableCount;
+
+/**
+ * The local model at the given index, built on first use and then reused
+ * (or kept in the working set, for models read from a member source). nil
+ * if the member source could not provide it.
+ */
+- (PredictiveModel*)predictiveModelAtIndex:(NSUInteger)index;
+
+/**
+ * Makes a prediction with a single model, as a vote to be appended to a
+ * MultiVote. The local model is built on first use and then reused.
+ * Input data must be decoded, see FieldResource decodedInputData:byName:.
+ * nil, and no vote to append, if the input is empty or the model could not
+ * be loaded.
+ */
+- (NSDictionary*)predictWithModelAtIndex:(NSUInteger)index
+                               inputData:(NSDictionary*)inputData
+                         missingStrategy:(NSInteger)missingStrategy
+                                  median:(BOOL)median;
+
 - (MultiVote*)generateVotes:(NSDictionary*)inputData
-                     byName:(BOOL)byName
             missingStrategy:(NSInteger)missingStrategy
                      median:(BOOL)median;
 
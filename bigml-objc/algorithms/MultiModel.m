@@ -15,43 +15,136 @@
 #import "MultiModel.h"
 #import "MultiVote.h"
 #import "PredictiveModel.h"
+#import <stdatomic.h>
 
 @implementation MultiModel {
     
     NSArray* _models;
+    
+    //-- the models built so far, retained, or 0; each slot is set only once
+    _Atomic(uintptr_t)* _predictiveModels;
+    FieldResource* _sharedFields;
+    id<EnsembleMemberSource> _source;
+    NSCache* _cache;
+    NSUInteger _unavailableCount;
 }
 
 - (instancetype)initWithModels:(NSArray*)models {
     
     if (self = [super init]) {
         _models = models;
+        _predictiveModels = calloc(MAX(models.count, 1), sizeof(_Atomic(uintptr_t)));
     }
     return self;
 }
 
+- (void)dealloc {
+    
+    for (NSUInteger i = 0; _predictiveModels && i < _models.count; ++i) {
+        uintptr_t model = atomic_load(&_predictiveModels[i]);
+        if (model)
+            CFRelease((CFTypeRef)model);
+    }
+    free(_predictiveModels);
+}
+
 + (MultiModel*)multiModelWithModels:(NSArray*)models {
     return [[self alloc] initWithModels:models];
 }
 
++ (MultiModel*)multiModelWithModels:(NSArray*)models sharedFields:(FieldResource*)sharedFields {
+    
+    MultiModel* multiModel = [[self alloc] initWithModels:models];
+    multiModel->_sharedFields = sharedFields;
+    return multiModel;
+}
+
+- (instancetype)initWithMemberSource:(id<EnsembleMemberSource>)source
+                          workingSet:(NSUInteger)workingSet
+                        sharedFields:(FieldResource*)sharedFields {
+    
+    if (self = [super init]) {
+        _source = source;
+        _sharedFields = sharedFields;
+        _cache = [NSCache new];
+        _cache.countLimit = workingSet;
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    return _source ? [_source memberCount] : _models.count;
+}
+
+- (NSUInteger)unavailableCount {
+    return __atomic_load_n(&_unavailableCount, __ATOMIC_RELAXED);
+}
+
+- (PredictiveModel*)predictiveModelAtIndex:(NSUInteger)index {
+    
+    if (_source) {
+        PredictiveModel* model = [_cache objectForKey:@(index)];
+        if (!model) {
+            NSDictionary* member = [_source memberAtIndex:index];
+            model = member ? [[PredictiveModel alloc] initWithJSONModel:member sharedFields:_sharedFields] : nil;
+            if (model)
+                [_cache setObject:model forKey:@(index)];
+            else
+                __atomic_fetch_add(&_unavailableCount, 1, __ATOMIC_RELAXED);
+        }
+        return model;
+    }
+    
+    //-- without a lock: threads building the same model at once race to
+    //-- publish it, and the losers drop theirs for the winner's
+    uintptr_t built = atomic_load_explicit(&_predictiveModels[index], memory_order_acquire);
+    if (built)
+        return (__bridge PredictiveModel*)(void*)built;
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:_models[index] sharedFields:_sharedFields];
+    if (!model)
+        return nil;
+    uintptr_t retained = (uintptr_t)CFBridgingRetain(model);
+    if (!atomic_compare_exchange_strong_explicit(&_predictiveModels[index], &built, retained,
+                                                 memory_order_acq_rel, memory_order_acquire)) {
+        CFRelease((CFTypeRef)retained);
+        return (__bridge PredictiveModel*)(void*)built;
+    }
+    return model;
+}
+
+- (NSDictionary*)predictWithModelAtIndex:(NSUInteger)index
+                               inputData:(NSDictionary*)inputData
+                         missingStrategy:(NSInteger)missingStrategy
+                                  median:(BOOL)median {
+    
+    if (inputData.allKeys.count == 0)
+        return nil;
+    
+    return [[self predictiveModelAtIndex:index]
+            predictWithArguments:inputData
+            options:@{ @"decodedInput" : @YES,
+                       @"strategy" : @(missingStrategy),
+                       @"median" : @(median),
+                       @"confidence" : @(YES),
+                       @"count" : @(YES),
+                       @"distribution" : @(YES),
+                       @"multiple" : @NSUIntegerMax}].firstObject;
+}
+
 - (MultiVote*)generateVotes:(NSDictionary*)inputData
-                     byName:(BOOL)byName
             missingStrategy:(NSInteger)missingStrategy
                      median:(BOOL)median {
     
     MultiVote* votes = [MultiVote new];
-    for (NSDictionary* model in _models) {
-        [votes append:[PredictiveModel predictWithJSONModel:model
-                                                  arguments:inputData
-                                                    options:@{ @"byName" : @(byName),
-                                                               @"strategy" : @(missingStrategy),
-                                                               @"median" : @(median),
-                                                               @"confidence" : @(YES),
-                                                               @"count" : @(YES),
-                                                               @"distribution" : @(YES),
-                                                               @"multiple" : @NSUIntegerMax}]];
+    for (NSUInteger i = 0; i < self.count; ++i) {
+        NSDictionary* vote = [self predictWithModelAtIndex:i
+                                                 inputData:inputData
+                                           missingStrategy:missingStrategy
+                                                    median:median];
+        if (vote)
+            [votes append:vote];
     }
     return votes;
 }
 
 @end
-
@@ -17,8 +17,24 @@
 
 @interface MultiVote : NSObject
 
+/**
+ * The number of votes that have not been cast yet, when combining the votes
+ * of only part of an ensemble. Defaults to 0.
+ */
+@property (nonatomic) NSUInteger pendingVotes;
+
+/**
+ * The lowest order any of the pendingVotes may be appended with, used to tell
+ * whether a possible tie is already decided. Defaults to 0, which makes such
+ * ties undecided.
+ */
+@property (nonatomic) NSInteger pendingVotesOrder;
+
 - (MultiVote*)extendWithMultiVote:(MultiVote*)votes;
 
+/// the number of votes cast so far
+- (NSUInteger)count;
+
 - (NSDictionary*)combineWithMethod:(BMLPredictionMethod)method
                         confidence:(BOOL)confidence
                       distribution:(BOOL)distribution
@@ -30,6 +46,32 @@
 
 - (void)append:(NSDictionary*)predictionInfo;
 
+/**
+ * Appends a prediction with an explicit order, used to break ties, instead of
+ * the arrival order.
+ */
+- (void)append:(NSDictionary*)predictionInfo order:(NSInteger)order;
+
+/**
+ * Returns YES if combining the votes with the given method would give the
+ * same prediction whatever the pendingVotes turn out to be. Only plurality
+ * and threshold classifications can be decided early: for other methods and
+ * for regressions this returns NO until no votes are pending.
+ */
+- (BOOL)isDecidedWithMethod:(BMLPredictionMethod)method options:(NSDictionary*)options;
+
+/**
+ * For classifications, the estimated probability that the current plurality
+ * leader keeps the lead once the pendingVotes are cast. 1 if none is pending.
+ */
+- (double)estimatedDecisionConfidence;
+
+/**
+ * For regressions, the estimated standard error of the mean of the current
+ * votes with respect to the mean of all of them. 0 if none is pending.
+ */
+- (double)estimatedStandardError;
+
 - (void)addMedian;
 
 @end
@@ -389,7 +389,8 @@ static NSString* const kNullCategory = @"kNullCategory";
 - (MultiVote*)singleOutCategory:(NSString*)category threshold:(NSInteger)threshold {
     
     NSAssert(threshold > 0 && category.length > 0, @"MultiVote singleOutCategory contract unfulfilled");
-    NSAssert(threshold <= _predictions.count, @"MultiVote singleOutCategory: threshold higher than prediction count");
+    NSAssert(threshold <= _predictions.count + _pendingVotes,
+             @"MultiVote singleOutCategory: threshold higher than prediction count");
     NSMutableArray* categoryPredictions = [NSMutableArray new];
     NSMutableArray* restOfPredictions = [NSMutableArray new];
     for (NSDictionary* prediction in _predictions) {
@@ -501,10 +502,13 @@ static NSString* const kNullCategory = @"kNullCategory";
         }
         category = prediction[@"prediction"];
         
+        //-- ties go to the category with the lowest order, whatever the order votes were appended in
         NSMutableDictionary* categoryHash = [NSMutableDictionary new];
         if (mode[category]) {
             [categoryHash setObject:@([mode[category][@"count"] doubleValue] + weight) forKey:@"count"];
-            [categoryHash setObject:mode[category][@"order"] forKey:@"order"];
+            [categoryHash setObject:@(MIN([mode[category][@"order"] integerValue],
+                                          [prediction[@"order"] integerValue]))
+                             forKey:@"order"];
         } else {
             [categoryHash setObject:@(weight) forKey:@"count"];
             [categoryHash setObject:prediction[@"order"] forKey:@"order"];
@@ -525,8 +529,8 @@ static NSString* const kNullCategory = @"kNullCategory";
         NSDictionary* d2 = obj2[1];
         double w1 = [d1[@"count"] doubleValue];
         double w2 = [d2[@"count"] doubleValue];
-        int order1 = [d1[@"order"] intValue];
-        int order2 = [d2[@"order"] intValue];
+        NSInteger order1 = [d1[@"order"] integerValue];
+        NSInteger order2 = [d2[@"order"] integerValue];
         return w1 > w2 ? -1 : (w1 < w2 ? 1 : order1 < order2 ? -1 : 1);
     }].firstObject;
     id predictionName = tuple.firstObject;
@@ -657,16 +661,166 @@ static NSString* const kNullCategory = @"kNullCategory";
  */
 - (void)append:(NSDictionary*)predictionInfo {
     
+    [self append:predictionInfo order:[self nextOrder]];
+}
+
+- (void)append:(NSDictionary*)predictionInfo order:(NSInteger)order {
+    
     NSAssert(predictionInfo.allKeys.count > 0 && predictionInfo[@"prediction"],
              @"Failed to append prediction");
 
     NSMutableDictionary* dict = [predictionInfo mutableCopy];
- 
-    NSInteger order = [self nextOrder];
     [dict setObject:@(order) forKey:@"order"];
     [_predictions addObject:dict];
 }
 
+/**
+ * Checks whether the plurality winner among the current votes, leaving out
+ * those for an excluded category, is bound to win whatever the pending votes.
+ *
+ * Ties are broken as in combineCategorical:confidence:, by the lowest order
+ * among the votes of each category. A tie the pending votes could still
+ * produce is only decided when the leader holds a lower order than both the
+ * rival and pendingVotesOrder.
+ */
+- (BOOL)isPluralityDecidedExcludingCategory:(id)excludedCategory {
+    
+    NSMutableDictionary* counts = [NSMutableDictionary new];
+    NSMutableDictionary* orders = [NSMutableDictionary new];
+    for (NSDictionary* prediction in _predictions) {
+        id category = prediction[@"prediction"];
+        if (excludedCategory && [excludedCategory isEqual:category])
+            continue;
+        counts[category] = @([counts[category] unsignedIntegerValue] + 1);
+        NSInteger order = [prediction[@"order"] integerValue];
+        if (!orders[category] || order < [orders[category] integerValue])
+            orders[category] = @(order);
+    }
+    
+    id leader = nil;
+    NSUInteger first = 0;
+    NSInteger leaderOrder = NSIntegerMax;
+    for (id category in counts) {
+        NSUInteger c = [counts[category] unsignedIntegerValue];
+        NSInteger order = [orders[category] integerValue];
+        if (c > first || (c == first && order < leaderOrder)) {
+            leader = category;
+            first = c;
+            leaderOrder = order;
+        }
+    }
+    
+    //-- a category without votes yet competes with 0 votes and may get all the pending ones
+    if (_pendingVotes > first ||
+        (_pendingVotes == first && leaderOrder >= _pendingVotesOrder))
+        return NO;
+    for (id category in counts) {
+        if (category == leader)
+            continue;
+        NSUInteger c = [counts[category] unsignedIntegerValue] + _pendingVotes;
+        if (c > first)
+            return NO;
+        if (c == first && (leaderOrder >= _pendingVotesOrder ||
+                           leaderOrder >= [orders[category] integerValue]))
+            return NO;
+    }
+    return leader != nil;
+}
+
+- (BOOL)isDecidedWithMethod:(BMLPredictionMethod)method options:(NSDictionary*)options {
+    
+    if (_pendingVotes == 0)
+        return YES;
+    if (_predictions.count == 0 || [self isRegression])
+        return NO;
+    
+    id excludedCategory = nil;
+    if (method == BMLPredictionMethodThreshold) {
+        
+        NSUInteger threshold = [options[@"threshold-k"] intValue];
+        NSString* category = options[@"threshold-category"];
+        NSUInteger categoryVotes = 0;
+        for (NSDictionary* prediction in _predictions) {
+            if ([category isEqual:prediction[@"prediction"]])
+                ++categoryVotes;
+        }
+        if (categoryVotes >= threshold)
+            return YES;
+        if (categoryVotes + _pendingVotes >= threshold)
+            return NO;
+        //-- the category cannot reach the threshold: the rest of the votes decide
+        excludedCategory = category;
+        
+    } else if (method != BMLPredictionMethodPlurality) {
+        return NO;
+    }
+    return [self isPluralityDecidedExcludingCategory:excludedCategory];
+}
+
+/**
+ * Estimates the probability that the plurality leader among the current
+ * votes is still the leader once the pending votes are cast, taking the
+ * current vote shares as the probability of each pending vote going to the
+ * leader or to the runner-up (normal approximation of the vote margin).
+ */
+- (double)estimatedDecisionConfidence {
+    
+    if (_pendingVotes == 0)
+        return 1.0;
+    if (_predictions.count == 0)
+        return 0.0;
+    
+    NSMutableDictionary* counts = [NSMutableDictionary new];
+    for (NSDictionary* prediction in _predictions) {
+        id category = prediction[@"prediction"];
+        counts[category] = @([counts[category] unsignedIntegerValue] + 1);
+    }
+    double first = 0, second = 0;
+    for (NSNumber* count in counts.allValues) {
+        double c = count.doubleValue;
+        if (c > first) {
+            second = first;
+            first = c;
+        } else if (c > second) {
+            second = c;
+        }
+    }
+    
+    double p1 = first / _predictions.count, p2 = second / _predictions.count;
+    double mean = (first - second) + _pendingVotes * (p1 - p2);
+    double variance = _pendingVotes * (p1 + p2 - (p1 - p2) * (p1 - p2));
+    if (variance <= 0)
+        return mean > 0 ? 1.0 : 0.5;
+    return 0.5 * erfc(-mean / sqrt(2 * variance));
+}
+
+/**
+ * Estimates the standard error of the mean of the current numeric votes as
+ * an estimate of the mean of all votes, pending ones included, applying the
+ * finite population correction.
+ */
+- (double)estimatedStandardError {
+    
+    NSUInteger n = _predictions.count;
+    if (_pendingVotes == 0 || n < 2)
+        return 0.0;
+    
+    double sum = 0, squareSum = 0;
+    for (NSDictionary* prediction in _predictions) {
+        double value = [prediction[@"prediction"] doubleValue];
+        sum += value;
+        squareSum += value * value;
+    }
+    double variance = fmax(squareSum - sum * sum / n, 0) / (n - 1);
+    double correction = (double)_pendingVotes / (n + _pendingVotes - 1);
+    return sqrt(variance / n * correction);
+}
+
+- (NSUInteger)count {
+    
+    return _predictions.count;
+}
+
 - (void)addMedian {
     
     for (NSMutableDictionary* prediction in _predictions) {
@@ -28,6 +28,60 @@ typedef enum PredicateLanguage {
 @end
 
 
+/**
+ * The terms found in the value of a text field, according to the field's
+ * term_analysis settings (case_sensitive, token_mode). The text is scanned
+ * once, when the object is created, so that a row can be tokenized once and
+ * then shared by all the text predicates of a model or an ensemble.
+ */
+@interface TermFrequencies : NSObject <NSCopying>
+
+@property (nonatomic, readonly) NSString* text;
+@property (nonatomic, readonly) NSDictionary* termAnalysis;
+
+/**
+ * Term frequencies are equal when built from the same text with the same
+ * term analysis settings, so that tokenized rows can be compared, e.g. as
+ * PredictionCache keys.
+ */
+- (instancetype)initWithText:(NSString*)text termAnalysis:(NSDictionary*)termAnalysis;
+
+/**
+ * The number of occurrences of a term, given as the list of its forms (the
+ * term itself first). Full terms, as defined by the token mode, count 1
+ * when they match the whole text and 0 otherwise. Forms of more than one
+ * token, like "new york", are searched for in the text itself.
+ */
+- (NSUInteger)countForTerms:(NSArray*)forms;
+
+@end
+
+@class Predicate;
+
+/**
+ * A predicate laid out as plain C data, e.g. in a model's arena, so that
+ * numbers and categories are compared without messaging the predicate; what
+ * cannot be compiled is left to it. Zeroed memory holds the TRUE predicate.
+ * Object pointers are not retained: the predicate must outlive its compiled
+ * form.
+ */
+typedef struct CompiledPredicate {
+    
+    __unsafe_unretained Predicate* predicate;
+    __unsafe_unretained NSString* field;
+    __unsafe_unretained NSString* category;
+    double threshold;
+    uint8_t kind;           //-- the rest is private to Predicates.m
+    uint8_t op;
+    uint8_t missing;
+    
+} CompiledPredicate;
+
+/**
+ * Same as Predicate apply:fields:, for a compiled predicate.
+ */
+BOOL BMLCompiledPredicateApplies(const CompiledPredicate* compiled, NSDictionary* input, NSDictionary* fields);
+
 /**
  * A predicate to be evaluated in a tree's node.
  */
@@ -37,22 +91,41 @@ typedef enum PredicateLanguage {
 @property (nonatomic, strong) NSString* field;
 @property (nonatomic, strong) NSString* value;
 @property (nonatomic) BOOL missing;
+@property (nonatomic, readonly) NSString* term;
 
 - (instancetype)initWithOperator:(NSString*)op
                            field:(NSString*)field
                            value:(id)value
                             term:(NSString*)term;
 
+/**
+ * Precomputes what the predicate needs from the model fields, once the
+ * model is loaded. Optional: apply:fields: works without it.
+ */
+- (void)prepareWithFields:(NSDictionary*)fields;
+
 - (BOOL)apply:(NSDictionary*)input fields:(NSDictionary*)fields;
 - (NSString*)ruleWithFields:(NSDictionary*)fields label:(NSString*)label;
 
+/**
+ * Fills `compiled`, see CompiledPredicate.
+ */
+- (void)compileInto:(CompiledPredicate*)compiled;
+
 @end
 
 
 @interface Predicates : NSObject
 
 - (instancetype)initWithPredicates:(NSArray*)predicates;
+- (void)prepareWithFields:(NSDictionary*)fields;
 - (BOOL)apply:(NSDictionary*)input fields:(NSDictionary*)fields;
 - (NSString*)ruleWithFields:(NSDictionary*)fields label:(NSString*)label;
 
+/// the Predicate objects, all of which must apply
+- (NSArray*)predicates;
+
+/// the heap bytes taken by this object, its list and its predicates
+- (size_t)byteSize;
+
 @end
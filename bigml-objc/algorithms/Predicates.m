@@ -12,6 +12,7 @@
 // License for the specific language governing permissions and limitations
 // under the License.
 
+#import <malloc/malloc.h>
 #import "Predicates.h"
 
 NSString* plural(NSString* string, int multiplicity) {
@@ -59,6 +60,232 @@ NSString* plural(NSString* string, int multiplicity) {
 #define TM_FULL_TERMS @"full_terms_only"
 #define TM_ALL @"all"
 #define FULL_TERM_PATTERN @"^.+\\b.+$"
+#define TOKEN_PATTERN @"[^\\W_]+"
+
+@implementation TermFrequencies {
+    
+    NSString* _tokenMode;
+    BOOL _caseSensitive;
+    NSString* _normalizedText;
+    NSMutableDictionary* _counts;
+}
+
+- (instancetype)initWithText:(NSString*)text termAnalysis:(NSDictionary*)termAnalysis {
+    
+    if (self = [super init]) {
+        
+        _text = text;
+        _termAnalysis = termAnalysis;
+        _tokenMode = TM_TOKENS;
+        _caseSensitive = YES;
+        if ([termAnalysis[@"token_mode"] isKindOfClass:[NSString class]]) {
+            _tokenMode = termAnalysis[@"token_mode"];
+        }
+        if ([termAnalysis[@"case_sensitive"] respondsToSelector:@selector(boolValue)]) {
+            _caseSensitive = [termAnalysis[@"case_sensitive"] boolValue];
+        }
+        _normalizedText = _caseSensitive ? text : [text lowercaseString];
+        
+        //-- tokens are the runs of word characters, underscores excluded
+        _counts = [NSMutableDictionary new];
+        if (![_tokenMode isEqualToString:TM_FULL_TERMS]) {
+            
+            static NSRegularExpression* tokenRegex = nil;
+            static dispatch_once_t onceToken;
+            dispatch_once(&onceToken, ^{
+                tokenRegex = [NSRegularExpression regularExpressionWithPattern:TOKEN_PATTERN
+                                                                       options:0
+                                                                         error:nil];
+            });
+            [tokenRegex enumerateMatchesInString:_normalizedText
+                                         options:0
+                                           range:NSMakeRange(0, _normalizedText.length)
+                                      usingBlock:^(NSTextCheckingResult* match,
+                                                   NSMatchingFlags flags,
+                                                   BOOL* stop) {
+                                          
+                                          NSString* token = [_normalizedText substringWithRange:match.range];
+                                          _counts[token] = @([_counts[token] unsignedIntegerValue] + 1);
+                                      }];
+        }
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone*)zone {
+    return self;
+}
+
+- (NSUInteger)hash {
+    return _text.hash;
+}
+
+- (BOOL)isEqual:(TermFrequencies*)other {
+    
+    return self == other ||
+    ([other isKindOfClass:[TermFrequencies class]] &&
+     [_text isEqualToString:other.text] &&
+     (_termAnalysis == other.termAnalysis || [_termAnalysis isEqualToDictionary:other.termAnalysis]));
+}
+
+- (NSString*)normalizedTerm:(NSString*)term {
+    return _caseSensitive ? term : [term lowercaseString];
+}
+
+/**
+ * Forms that span several tokens, such as "new york" or "e-mail", cannot be
+ * found among the token counts: their occurrences are counted as the
+ * reference implementation does, by matching all the forms in the text
+ * between word boundaries or underscores. Compiled patterns are kept, since
+ * the same predicates are applied to every row.
+ */
+- (NSUInteger)phraseCountForTerms:(NSArray*)forms {
+    
+    static NSCache* phraseRegexes = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        phraseRegexes = [NSCache new];
+    });
+    NSMutableArray* patterns = [NSMutableArray arrayWithCapacity:forms.count];
+    for (NSString* form in forms) {
+        [patterns addObject:[NSRegularExpression escapedPatternForString:[self normalizedTerm:form]]];
+    }
+    NSString* pattern = [NSString stringWithFormat:@"(\\b|_)%@(\\b|_)",
+                         [patterns componentsJoinedByString:@"(\\b|_)|(\\b|_)"]];
+    NSRegularExpression* regex = [phraseRegexes objectForKey:pattern];
+    if (!regex) {
+        regex = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:nil];
+        if (!regex)
+            return 0;
+        [phraseRegexes setObject:regex forKey:pattern];
+    }
+    return [regex numberOfMatchesInString:_normalizedText
+                                  options:0
+                                    range:NSMakeRange(0, _normalizedText.length)];
+}
+
+- (NSUInteger)countForTerms:(NSArray*)forms {
+    
+    static NSCharacterSet* nonTokenCharacters = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        nonTokenCharacters = [[NSCharacterSet alphanumericCharacterSet] invertedSet];
+    });
+    
+    NSString* firstTerm = forms.firstObject;
+    if ([_tokenMode isEqualToString:TM_FULL_TERMS] ||
+        ([_tokenMode isEqualToString:TM_ALL] &&
+         forms.count == 1 &&
+         [RegExHelper isRegex:FULL_TERM_PATTERN matching:firstTerm])) {
+        
+        return [_normalizedText isEqualToString:[self normalizedTerm:firstTerm]] ? 1 : 0;
+    }
+    
+    for (NSString* form in forms) {
+        if ([form rangeOfCharacterFromSet:nonTokenCharacters].location != NSNotFound)
+            return [self phraseCountForTerms:forms];
+    }
+    
+    NSUInteger count = 0;
+    NSMutableSet* seen = [NSMutableSet setWithCapacity:forms.count];
+    for (NSString* form in forms) {
+        NSString* term = [self normalizedTerm:form];
+        if (![seen containsObject:term]) {
+            [seen addObject:term];
+            count += [_counts[term] unsignedIntegerValue];
+        }
+    }
+    return count;
+}
+
+@end
+
+
+/**
+ * The operators found in model predicates, parsed once so that applying a
+ * predicate does not go through NSPredicate.
+ */
+typedef enum PredicateOperator {
+    
+    PredicateOperatorUnknown,
+    PredicateOperatorTrue,
+    PredicateOperatorLess,
+    PredicateOperatorLessOrEqual,
+    PredicateOperatorGreater,
+    PredicateOperatorGreaterOrEqual,
+    PredicateOperatorEqual,
+    PredicateOperatorNotEqual,
+    PredicateOperatorIn,
+    
+} PredicateOperator;
+
+static PredicateOperator predicateOperator(NSString* op) {
+    
+    static NSDictionary* operators = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        operators = @{ @"TRUE" : @(PredicateOperatorTrue),
+                       @"<" : @(PredicateOperatorLess),
+                       @"<=" : @(PredicateOperatorLessOrEqual),
+                       @">" : @(PredicateOperatorGreater),
+                       @">=" : @(PredicateOperatorGreaterOrEqual),
+                       @"=" : @(PredicateOperatorEqual),
+                       @"==" : @(PredicateOperatorEqual),
+                       @"!=" : @(PredicateOperatorNotEqual),
+                       @"<>" : @(PredicateOperatorNotEqual),
+                       @"in" : @(PredicateOperatorIn) };
+    });
+    return op ? (PredicateOperator)[operators[op] intValue] : PredicateOperatorUnknown;
+}
+
+typedef enum CompiledPredicateKind {
+    
+    CompiledPredicateKindTrue = 0,
+    CompiledPredicateKindPredicate,
+    CompiledPredicateKindNumber,
+    CompiledPredicateKindCategory
+    
+} CompiledPredicateKind;
+
+static BOOL compareResultMatches(PredicateOperator op, NSComparisonResult result) {
+    
+    switch (op) {
+        case PredicateOperatorLess:
+            return result == NSOrderedAscending;
+        case PredicateOperatorLessOrEqual:
+            return result != NSOrderedDescending;
+        case PredicateOperatorGreater:
+            return result == NSOrderedDescending;
+        case PredicateOperatorGreaterOrEqual:
+            return result != NSOrderedAscending;
+        case PredicateOperatorEqual:
+            return result == NSOrderedSame;
+        case PredicateOperatorNotEqual:
+            return result != NSOrderedSame;
+        default:
+            return NO;
+    }
+}
+
+static BOOL numberMatches(PredicateOperator op, double lhs, double rhs) {
+    
+    switch (op) {
+        case PredicateOperatorLess:
+            return lhs < rhs;
+        case PredicateOperatorLessOrEqual:
+            return lhs <= rhs;
+        case PredicateOperatorGreater:
+            return lhs > rhs;
+        case PredicateOperatorGreaterOrEqual:
+            return lhs >= rhs;
+        case PredicateOperatorEqual:
+            return lhs == rhs;
+        case PredicateOperatorNotEqual:
+            return lhs != rhs;
+        default:
+            return NO;
+    }
+}
 
 @implementation Predicate {
 
@@ -66,6 +293,11 @@ NSString* plural(NSString* string, int multiplicity) {
     NSString* _field;
     id _value;
     NSString* _term;
+    NSArray* _termForms;
+    NSSet* _valueSet;
+    PredicateOperator _operator;
+    BOOL _numeric;
+    double _numericValue;
 }
 
 - (instancetype)initWithOperator:(NSString*)op
@@ -79,12 +311,22 @@ NSString* plural(NSString* string, int multiplicity) {
         _value = value;
         _term = term;
         _missing = NO;
-        if ([RegExHelper isRegex:@"\\*$" matching:_op]) {
+        if ([_op hasSuffix:@"*"]) {
             _missing = YES;
             _op = [_op substringToIndex:_op.length - 1];
         }
         if ([_op length] == 0)
             NSLog(@"CONY");
+        
+        //-- set membership is checked by hashing, not by scanning the list
+        if ([_op isEqualToString:@"in"] && [_value isKindOfClass:[NSArray class]]) {
+            _valueSet = [NSSet setWithArray:_value];
+        }
+        _operator = predicateOperator(_op);
+        if ([_value isKindOfClass:[NSNumber class]]) {
+            _numeric = YES;
+            _numericValue = [_value doubleValue];
+        }
 
     }
     return self;
@@ -161,43 +403,26 @@ NSString* plural(NSString* string, int multiplicity) {
     return  _op;
 }
 
-- (NSInteger)fullTermCount:(NSString*)text
-                  fullTerm:(NSString*)fullTerm
-             caseSensitive:(BOOL)caseSensitive {
+/**
+ * The term and its forms, as listed in the field summary.
+ */
+- (NSArray*)termFormsWithFields:(NSDictionary*)fields {
     
-    return (caseSensitive ?
-            ((text == fullTerm) ? 1 : 0) :
-            ([RegExHelper isRegex:@"/^\(fullTerm)$/i" matching:text] ? 1 : 0));
-}
-
-- (NSInteger)tokenTermCount:(NSString*)text
-                   forms:(NSArray*)forms
-              caseSensitive:(BOOL)caseSensitive {
-
-    NSString* fre = [forms componentsJoinedByString:@"(\\b|_)"];
-    NSString* re = [NSString stringWithFormat:@"(\\b|_)%@(\\b|_)", fre];
-    return [RegExHelper countOfMatches:re in:text];
+    NSArray* termForms = @[];
+    NSDictionary* summary = fields[_field][@"summary"];
+    if ([summary isKindOfClass:[NSDictionary class]] &&
+        [summary[@"term_forms"] isKindOfClass:[NSDictionary class]] &&
+        [summary[@"term_forms"][_term] isKindOfClass:[NSArray class]]) {
+        
+        termForms = summary[@"term_forms"][_term];
+    }
+    return [@[_term] arrayByAddingObjectsFromArray:termForms];
 }
 
-- (NSInteger)termCount:(NSString*)text forms:(NSArray*)forms options:(NSDictionary*)options {
+- (void)prepareWithFields:(NSDictionary*)fields {
     
-    NSString* tokenMode = TM_TOKENS;
-    BOOL caseSensitive = YES;
-    if (options && [options[@"token_mode"] isKindOfClass:[NSString class]]) {
-        tokenMode = options[@"token_mode"];
-    }
-    if (options && [options[@"case_sensitive"] respondsToSelector:@selector(boolValue)]) {
-        caseSensitive = [options[@"case_sensitive"] boolValue];
-    }
-    NSString* firstTerm = forms.firstObject;
-    if ([tokenMode isEqualToString:TM_FULL_TERMS] ||
-        ([tokenMode isEqualToString:TM_ALL] &&
-         forms.count == 1 &&
-         [RegExHelper isRegex:FULL_TERM_PATTERN matching:firstTerm])) {
-            
-        return [self fullTermCount:text fullTerm:firstTerm caseSensitive:caseSensitive];
-    }
-    return [self tokenTermCount:text forms:forms caseSensitive:caseSensitive];
+    if (_term)
+        _termForms = [self termFormsWithFields:fields];
 }
 
 - (BOOL)evalPredicate:(NSString*)predicate args:(NSDictionary*)args {
@@ -208,49 +433,110 @@ NSString* plural(NSString* string, int multiplicity) {
     return [p evaluateWithObject:args];
 }
 
+/**
+ * Compares numbers as doubles and strings as strings; any other combination
+ * is left to NSPredicate, as the values would need coercing.
+ */
+- (BOOL)compareValue:(id)value {
+    
+    if (_operator != PredicateOperatorUnknown && _operator != PredicateOperatorIn) {
+        if (_numeric && [value isKindOfClass:[NSNumber class]])
+            return numberMatches(_operator, [value doubleValue], _numericValue);
+        if ([_value isKindOfClass:[NSString class]] && [value isKindOfClass:[NSString class]]) {
+            if (_operator == PredicateOperatorEqual)
+                return [value isEqualToString:_value];
+            if (_operator == PredicateOperatorNotEqual)
+                return ![value isEqualToString:_value];
+            return compareResultMatches(_operator, [value compare:_value]);
+        }
+    }
+    return [self evalPredicate:[NSString stringWithFormat:@"ls %@ rs", _op]
+                          args:@{ @"ls" : value, @"rs" : _value ?: [NSNull null]}];
+}
+
 - (BOOL)apply:(NSDictionary*)input fields:(NSDictionary*)fields {
     
-    if ([_op isEqualToString:@"TRUE"])
+    if (_operator == PredicateOperatorTrue)
         return YES;
     
     if (!input[_field]) {
-        return _missing || ([_op isEqualToString:@"="] && !_value);
-    } else if ([_op isEqualToString:@"!="] && !_value) {
+        return _missing || (_operator == PredicateOperatorEqual && !_value);
+    } else if (_operator == PredicateOperatorNotEqual && !_value) {
         return YES;
     }
     
-    if ([_op isEqualToString:@"in"]) {
+    if (_operator == PredicateOperatorIn) {
+        if (_valueSet)
+            return [_valueSet containsObject:input[_field]];
         return [self evalPredicate:[NSString stringWithFormat:@"ls %@ rs", _op]
                               args:@{ @"ls" : input[_field], @"rs" : _value ?: [NSNull null]}];
     }
-    if (_term &&
-        [input[_field] isKindOfClass:[NSString class]] &&
-        [fields[_field] isKindOfClass:[NSString class]]) {
+    id value = input[_field];
+    if (_term && ([value isKindOfClass:[TermFrequencies class]] || [value isKindOfClass:[NSString class]])) {
         
-        NSArray* termForms = [NSArray new];
-        if ([fields[@"summary"] isKindOfClass:[NSDictionary class]] &&
-            [fields[@"summary"][@"term_forms"] isKindOfClass:[NSDictionary class]] &&
-            [fields[@"summary"][@"term_forms"][_term] isKindOfClass:[NSArray class]]) {
-            
-            termForms = fields[@"summary"][@"term_forms"][_term];
+        //-- rows tokenized by FieldResource tokenizedInputData:byName: are
+        //-- scanned once for all predicates; plain strings are scanned here
+        TermFrequencies* terms = value;
+        if ([value isKindOfClass:[NSString class]]) {
+            terms = [[TermFrequencies alloc] initWithText:value
+                                             termAnalysis:fields[_field][@"term_analysis"]];
         }
-        NSArray* terms = [@[_term] arrayByAddingObjectsFromArray:termForms];
-        NSDictionary* options = fields[_field][@"term_analysis"];
-        
-        return [self evalPredicate:[NSString stringWithFormat:@"ls %@ rs", _op]
-                              args:@{@"ls" : @([self termCount:input[_field] forms:terms options:options]),
-                                     @"rs" : _value ?: [NSNull null]}];
+        NSUInteger count = [terms countForTerms:_termForms ?: [self termFormsWithFields:fields]];
+        return [self compareValue:@(count)];
     }
-    if (input[_field]) {
-        return [self evalPredicate:[NSString stringWithFormat:@"ls %@ rs", _op]
-                              args:@{ @"ls" : input[_field], @"rs" : _value ?: [NSNull null]}];
+    if ([value isKindOfClass:[TermFrequencies class]]) {
+        value = [value text];
+    }
+    if (value) {
+        return [self compareValue:value];
     }
     NSAssert(NO, @"Predicate apply: Should not be here!");
     return NO;
 }
 
+- (void)compileInto:(CompiledPredicate*)compiled {
+    
+    memset(compiled, 0, sizeof(*compiled));
+    if (_operator == PredicateOperatorTrue)
+        return;
+    
+    compiled->predicate = self;
+    compiled->field = _field;
+    compiled->op = _operator;
+    compiled->missing = _missing;
+    compiled->kind = CompiledPredicateKindPredicate;
+    if (_term || _operator == PredicateOperatorUnknown || _operator == PredicateOperatorIn)
+        return;
+    if (_numeric) {
+        compiled->kind = CompiledPredicateKindNumber;
+        compiled->threshold = _numericValue;
+    } else if ([_value isKindOfClass:[NSString class]] &&
+               (_operator == PredicateOperatorEqual || _operator == PredicateOperatorNotEqual)) {
+        compiled->kind = CompiledPredicateKindCategory;
+        compiled->category = _value;
+    }
+}
+
 @end
 
+BOOL BMLCompiledPredicateApplies(const CompiledPredicate* compiled, NSDictionary* input, NSDictionary* fields) {
+    
+    if (compiled->kind == CompiledPredicateKindTrue)
+        return YES;
+    if (compiled->kind == CompiledPredicateKindPredicate)
+        return [compiled->predicate apply:input fields:fields];
+    
+    //-- the same checks as apply: and compareValue:, for the values compiled
+    id value = input[compiled->field];
+    if (!value)
+        return compiled->missing;
+    if (compiled->kind == CompiledPredicateKindNumber && [value isKindOfClass:[NSNumber class]])
+        return numberMatches(compiled->op, [value doubleValue], compiled->threshold);
+    if (compiled->kind == CompiledPredicateKindCategory && [value isKindOfClass:[NSString class]])
+        return [value isEqualToString:compiled->category] == (compiled->op == PredicateOperatorEqual);
+    return [compiled->predicate apply:input fields:fields];
+}
+
 @implementation Predicates {
     
     NSMutableArray* _predicates;
@@ -284,6 +570,13 @@ NSString* plural(NSString* string, int multiplicity) {
     return self;
 }
 
+- (void)prepareWithFields:(NSDictionary*)fields {
+    
+    for (Predicate* p in _predicates) {
+        [p prepareWithFields:fields];
+    }
+}
+
 - (NSString*)ruleWithFields:(NSDictionary*)fields label:(NSString*)label {
 
     NSMutableArray* rules = [@[] mutableCopy];
@@ -295,6 +588,20 @@ NSString* plural(NSString* string, int multiplicity) {
     return [rules componentsJoinedByString:@" and "];
 }
 
+- (NSArray*)predicates {
+    
+    return _predicates;
+}
+
+- (size_t)byteSize {
+    
+    size_t bytes = malloc_size((__bridge const void*)self) + malloc_size((__bridge const void*)_predicates);
+    for (Predicate* p in _predicates) {
+        bytes += malloc_size((__bridge const void*)p);
+    }
+    return bytes;
+}
+
 - (BOOL)apply:(NSDictionary*)input fields:(NSDictionary*)fields {
 
     BOOL result = YES;
@@ -0,0 +1,70 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A bounded cache of prediction results, keyed by decoded input data (see
+ * FieldResource decodedInputData:byName:) and prediction options. When full,
+ * the least recently used result is evicted. A cache can be assigned to a
+ * PredictiveModel or Anomaly, so that repeated inputs skip tree traversal;
+ * it is safe to use from several threads at once.
+ *
+ * Options that only affect how input is decoded ("byName" and
+ * "decodedInput") are left out of the key. Results are cached, and
+ * returned, as immutable copies at every level.
+ */
+@interface PredictionCache : NSObject
+
+/// the maximum number of results kept
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/// the number of results currently kept
+@property (nonatomic, readonly) NSUInteger count;
+
+/// lookups answered from the cache
+@property (nonatomic, readonly) NSUInteger hits;
+
+/// lookups that had to compute their result
+@property (nonatomic, readonly) NSUInteger misses;
+
+/// results dropped to make room for new ones
+@property (nonatomic, readonly) NSUInteger evictions;
+
+/**
+ * @param capacity The maximum number of results kept; must be positive
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/**
+ * The result cached for the given input and options, if any; otherwise the
+ * result of `compute`, which is then cached. `compute` runs without holding
+ * the cache lock, so two threads missing on the same input at once may both
+ * compute it.
+ */
+- (id)resultForInput:(NSDictionary*)input
+             options:(NSDictionary*)options
+             compute:(id(^)(void))compute;
+
+/**
+ * The hit rate so far, between 0 and 1.
+ */
+- (double)hitRate;
+
+/**
+ * Drops every cached result and zeroes the counters.
+ */
+- (void)removeAllResults;
+
+@end
@@ -0,0 +1,277 @@
+// Copyright 2014-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "PredictionCache.h"
+
+static inline NSUInteger mixedHash(NSUInteger h) {
+    
+    //-- 64-bit finalizer from MurmurHash3, spreading NSNumber and NSString hashes
+    uint64_t x = h;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (NSUInteger)x;
+}
+
+static NSUInteger dictionaryHash(NSDictionary* dictionary) {
+    
+    //-- order independent, since dictionaries do not enumerate in a fixed order
+    __block NSUInteger hash = dictionary.count;
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL* stop) {
+        hash += mixedHash([key hash] * 31 + [value hash]);
+    }];
+    return hash;
+}
+
+/**
+ * An immutable copy of a result or input, at every level, so that callers
+ * cannot change what is cached through the objects they are given.
+ */
+static id immutableCopy(id object) {
+    
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSMutableDictionary* copy = [NSMutableDictionary dictionaryWithCapacity:[object count]];
+        [object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL* stop) {
+            copy[key] = immutableCopy(value);
+        }];
+        return [copy copy];
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSMutableArray* copy = [NSMutableArray arrayWithCapacity:[object count]];
+        for (id value in object) {
+            [copy addObject:immutableCopy(value)];
+        }
+        return [copy copy];
+    }
+    return [object conformsToProtocol:@protocol(NSCopying)] ? [object copy] : object;
+}
+
+/**
+ * NSDictionary hashes only by count, so cache keys carry their own hash.
+ */
+@interface PredictionCacheKey : NSObject <NSCopying>
+
+@property (nonatomic, readonly) NSDictionary* input;
+@property (nonatomic, readonly) NSDictionary* options;
+
+@end
+
+@implementation PredictionCacheKey {
+    
+    NSUInteger _hash;
+}
+
+- (instancetype)initWithInput:(NSDictionary*)input options:(NSDictionary*)options {
+    
+    if (self = [super init]) {
+        _input = immutableCopy(input);
+        if (options[@"byName"] || options[@"decodedInput"]) {
+            NSMutableDictionary* resultOptions = [options mutableCopy];
+            [resultOptions removeObjectsForKeys:@[ @"byName", @"decodedInput" ]];
+            options = resultOptions;
+        }
+        _options = [options copy] ?: @{};
+        _hash = dictionaryHash(_input) ^ mixedHash(dictionaryHash(_options));
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone*)zone {
+    return self;
+}
+
+- (NSUInteger)hash {
+    return _hash;
+}
+
+- (BOOL)isEqual:(PredictionCacheKey*)other {
+    
+    return self == other ||
+    ([other isKindOfClass:[PredictionCacheKey class]] &&
+     _hash == other->_hash &&
+     [_input isEqualToDictionary:other.input] &&
+     [_options isEqualToDictionary:other.options]);
+}
+
+@end
+
+/**
+ * An entry of the recency list, most recently used first.
+ */
+@interface PredictionCacheEntry : NSObject {
+    
+    @public
+    PredictionCacheKey* key;
+    id result;
+    PredictionCacheEntry* next;
+    __unsafe_unretained PredictionCacheEntry* previous;
+}
+@end
+
+@implementation PredictionCacheEntry
+@end
+
+@implementation PredictionCache {
+    
+    NSMutableDictionary* _entries;
+    PredictionCacheEntry* _head;
+    __unsafe_unretained PredictionCacheEntry* _tail;
+    NSUInteger _hits;
+    NSUInteger _misses;
+    NSUInteger _evictions;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    
+    NSAssert(capacity > 0, @"initWithCapacity: contract unfulfilled");
+    if (self = [super init]) {
+        _capacity = capacity;
+        _entries = [NSMutableDictionary dictionaryWithCapacity:capacity];
+    }
+    return self;
+}
+
+- (void)unlinkEntry:(PredictionCacheEntry*)entry {
+    
+    if (entry->previous)
+        entry->previous->next = entry->next;
+    else
+        _head = entry->next;
+    if (entry->next)
+        entry->next->previous = entry->previous;
+    else
+        _tail = entry->previous;
+    entry->next = nil;
+    entry->previous = nil;
+}
+
+- (void)unlinkAllEntries {
+    
+    //-- one entry at a time, a long chain would be released recursively
+    while (_head) {
+        PredictionCacheEntry* entry = _head;
+        _head = entry->next;
+        entry->next = nil;
+    }
+}
+
+- (void)dealloc {
+    [self unlinkAllEntries];
+}
+
+- (void)pushEntry:(PredictionCacheEntry*)entry {
+    
+    entry->next = _head;
+    if (_head)
+        _head->previous = entry;
+    _head = entry;
+    if (!_tail)
+        _tail = entry;
+}
+
+- (id)resultForInput:(NSDictionary*)input
+             options:(NSDictionary*)options
+             compute:(id(^)(void))compute {
+    
+    PredictionCacheKey* key = [[PredictionCacheKey alloc] initWithInput:input options:options];
+    @synchronized (self) {
+        PredictionCacheEntry* entry = _entries[key];
+        if (entry) {
+            ++_hits;
+            if (entry != _head) {
+                [self unlinkEntry:entry];
+                [self pushEntry:entry];
+            }
+            return entry->result;
+        }
+        ++_misses;
+    }
+    
+    id result = immutableCopy(compute());
+    if (!result)
+        return nil;
+    
+    @synchronized (self) {
+        PredictionCacheEntry* entry = _entries[key];
+        if (entry) {
+            //-- computed concurrently by another thread
+            entry->result = result;
+            return result;
+        }
+        entry = [PredictionCacheEntry new];
+        entry->key = key;
+        entry->result = result;
+        _entries[key] = entry;
+        [self pushEntry:entry];
+        if (_entries.count > _capacity) {
+            PredictionCacheEntry* evicted = _tail;
+            [self unlinkEntry:evicted];
+            [_entries removeObjectForKey:evicted->key];
+            ++_evictions;
+        }
+    }
+    return result;
+}
+
+- (NSUInteger)count {
+    
+    @synchronized (self) {
+        return _entries.count;
+    }
+}
+
+- (NSUInteger)hits {
+    
+    @synchronized (self) {
+        return _hits;
+    }
+}
+
+- (NSUInteger)misses {
+    
+    @synchronized (self) {
+        return _misses;
+    }
+}
+
+- (NSUInteger)evictions {
+    
+    @synchronized (self) {
+        return _evictions;
+    }
+}
+
+- (double)hitRate {
+    
+    @synchronized (self) {
+        NSUInteger lookups = _hits + _misses;
+        return lookups > 0 ? (double)_hits / lookups : 0;
+    }
+}
+
+- (void)removeAllResults {
+    
+    @synchronized (self) {
+        [self unlinkAllEntries];
+        _tail = nil;
+        [_entries removeAllObjects];
+        _hits = 0;
+        _misses = 0;
+        _evictions = 0;
+    }
+}
+
+@end
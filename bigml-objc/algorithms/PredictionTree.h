@@ -17,6 +17,7 @@
 
 @class Predicate;
 @class TreePrediction;
+@class ModelArena;
 
 /**
  * A tree that represents a node in the predictive model
@@ -28,18 +29,25 @@
 @property (nonatomic) NSInteger maxBins;
 @property (nonatomic, readonly) NSArray* objectiveFields;
 
+/// the children of this node, in the order they are tested. Reordering
+/// replaces the whole immutable array, so that predictions running at the
+/// same time keep going through either the old or the new order
+@property (atomic, readonly) NSArray* evaluationOrder;
+
 /**
  * Initializes a PredictionTree object
  * @param aRoot A json object that acts as root of this tree
  * @param aFields The fields of the predictive model
  * @param aObjectiveField The objective field id (ej: 0000001, 0000002, etc)
+ * @param arena Where the plain C data of the nodes is allocated; every node
+ *        retains it, so that the tree stays usable after its model is gone
  */
 - (PredictionTree*)initWithRoot:(NSDictionary*)aRoot
                              fields:(NSDictionary*)aFields
                      objectiveField:(NSString*)aObjectiveField
                    rootDistribution:(NSDictionary*)rootDistribution
                            parentId:(NSNumber*)parentId
-                             idsMap:(NSMutableDictionary*)idsMap
+                              arena:(ModelArena*)arena
                             subtree:(BOOL)subtree
                             maxBins:(NSInteger)maxBins;
 
@@ -62,6 +70,51 @@
                       path:(NSMutableArray*)path
                   strategy:(BMLMissingStrategy)strategy;
 
+/**
+ * The prediction of this node, as returned by predict:path:strategy: with
+ * the LastPrediction strategy when the input stops here.
+ */
+- (TreePrediction*)predictionWithPath:(NSMutableArray*)path;
+
+/**
+ * Computes, for every node of the tree, the value explained by
+ * explain:fieldIndexes:outputs:contributions:: the probability of each of
+ * the given classes, or the node output for regressions (classes nil).
+ * The values are allocated from the arena the tree was built with, which
+ * every node retains. Not to be called while other threads use the tree.
+ */
+- (void)prepareExplanationsWithClasses:(NSArray*)classes;
+
+/**
+ * The values of this node computed by prepareExplanationsWithClasses:, one
+ * per class, or the output of a regression.
+ */
+- (const double*)explanationValues;
+
+/**
+ * Follows the input down the tree as predict:path:strategy: does with the
+ * LastPrediction strategy, without building the rules of the path. At each
+ * split, the change from the parent's values to the child's is added to the
+ * contributions of the split field, so that the root values plus all the
+ * contributions give the values of the node reached.
+ *
+ * @param fieldIndexes The row of each field in `contributions`, by field id
+ * @param outputs The number of values per node (classes, or 1)
+ * @param contributions A row-major matrix of fields by outputs, added to
+ * @return The node reached, see predictionWithPath:
+ */
+- (PredictionTree*)explain:(NSDictionary*)inputData
+              fieldIndexes:(NSDictionary*)fieldIndexes
+                   outputs:(NSUInteger)outputs
+             contributions:(double*)contributions;
+
+/**
+ * The number of nodes of the tree, adding to `bytes` the heap memory taken
+ * by the nodes, their predicates and their lists of children. Values shared
+ * with the JSON model are not counted.
+ */
+- (NSUInteger)nodeCountWithBytes:(size_t*)bytes;
+
 /**
  * Checks if the subtree structure can be a regression
  *
@@ -69,4 +122,41 @@
  */
 - (BOOL)isRegression;
 
+/**
+ * Sibling nodes are tested in decreasing order of their training instance
+ * count, so that the branch most rows follow is usually found first. The
+ * following methods let that order be tuned to the traffic actually seen.
+ */
+
+/**
+ * When YES, every node of the tree counts how many times predictions went
+ * through it. Intended for profiling runs; NO by default.
+ */
+@property (nonatomic) BOOL recordsHits;
+
+/**
+ * Resets the hit counters of the whole tree.
+ */
+- (void)resetHits;
+
+/**
+ * Reorders the children of every node by the hits recorded so far, falling
+ * back on the training instance count for equal hits.
+ */
+- (void)orderChildrenByHits;
+
+/**
+ * The order in which children are tested, in a form suitable for JSON, to be
+ * stored and restored with applyChildOrder:. Keys identify nodes by their
+ * path of child indexes from the root ("" for the root, "0.1" for the second
+ * child of its first child) and values are arrays of child indexes.
+ */
+- (NSDictionary*)childOrder;
+
+/**
+ * Restores an order obtained from childOrder. Entries not matching the tree
+ * are ignored.
+ */
+- (void)applyChildOrder:(NSDictionary*)order;
+
 @end
@@ -12,8 +12,10 @@
 // License for the specific language governing permissions and limitations
 // under the License.
 
+#import <malloc/malloc.h>
 #import "PredictionTree.h"
 #import "TreePrediction.h"
+#import "ModelArena.h"
 #import "Predicates.h"
 #import "BMLEnums.h"
 #import "BMLUtils.h"
@@ -31,6 +33,7 @@ typedef PredictionTree TreeHolder;
 @property (nonatomic, strong) NSArray* distribution;
 @property (nonatomic, strong) NSString* distributionUnit;
 @property (nonatomic, strong) NSArray* children;
+@property (atomic, copy) NSArray* evaluationOrder;
 
 @end
 
@@ -44,6 +47,10 @@ typedef PredictionTree TreeHolder;
     long _count;
     double _impurity;
     NSDictionary* _rootDistribution;
+    NSUInteger _index;
+    long _hits;
+    ModelArena* _arena;
+    double* _explanationValues;
 }
 
 @synthesize predicate = _predicate;
@@ -54,13 +61,14 @@ typedef PredictionTree TreeHolder;
                       objectiveFields:(NSArray*)objectiveFields
                     rootDistribution:(NSDictionary*)rootDistribution
                             parentId:(NSNumber*)parentId
-                              idsMap:(NSMutableDictionary*)idsMap
+                               arena:(ModelArena*)arena
                              subtree:(BOOL)subtree
                              maxBins:(NSInteger)maxBins {
 
     if (self = [super init]) {
         
         _fields = fields;
+        _arena = arena;
         _objectiveFields = objectiveFields;
         
         _output = root[@"output"];
@@ -79,17 +87,19 @@ typedef PredictionTree TreeHolder;
                                                          field:predicateDict[@"field"]
                                                          value:predicateDict[@"value"]
                                                           term:predicateDict[@"term"]];
+            [self.predicate prepareWithFields:fields];
         }
         
         if (root[@"id"]) {
             _nodeId = root[@"id"];
             _parentId = parentId;
-            [idsMap setObject:self forKey:_nodeId];
         }
         
-        //-- Generate children array
-        NSMutableArray* children = [[NSMutableArray alloc] init];
-        for (NSDictionary* child in root[@"children"]) {
+        //-- Generate children array; leaves, about half of the nodes, share the empty one
+        NSArray* childNodes = root[@"children"];
+        NSMutableArray* children = childNodes.count > 0 ?
+        [[NSMutableArray alloc] initWithCapacity:childNodes.count] : nil;
+        for (NSDictionary* child in childNodes) {
             
             PredictionTree* childTree =
             [[PredictionTree alloc] initWithRoot:child
@@ -97,12 +107,22 @@ typedef PredictionTree TreeHolder;
                                       objectiveFields:_objectiveFields
                                      rootDistribution:nil
                                              parentId:_nodeId
-                                               idsMap:idsMap
+                                                arena:arena
                                               subtree:subtree
                                               maxBins:maxBins];
+            childTree->_index = children.count;
             [children addObject:childTree];
         }
-        _children = children;
+        _children = children ?: @[];
+        
+        //-- siblings are exclusive, so they can be tested in any order:
+        //-- the most populated ones, hence the likeliest to match, go first
+        _evaluationOrder = !children ? _children :
+        [_children sortedArrayWithOptions:NSSortStable
+                          usingComparator:^NSComparisonResult(PredictionTree* a, PredictionTree* b) {
+                              return a->_count > b->_count ? NSOrderedAscending :
+                              a->_count < b->_count ? NSOrderedDescending : NSOrderedSame;
+                          }];
         
         _count = [root[@"count"] integerValue];
         _confidence = [root[@"confidence"] doubleValue];
@@ -247,7 +267,7 @@ typedef PredictionTree TreeHolder;
                       objectiveField:(NSString*)objectiveField
                     rootDistribution:(NSDictionary*)rootDistribution
                             parentId:(NSNumber*)parentId
-                              idsMap:(NSMutableDictionary*)idsMap
+                               arena:(ModelArena*)arena
                              subtree:(BOOL)subtree
                              maxBins:(NSInteger)maxBins {
     
@@ -256,7 +276,7 @@ typedef PredictionTree TreeHolder;
               objectiveFields:@[objectiveField]
              rootDistribution:rootDistribution
                      parentId:parentId
-                       idsMap:idsMap
+                        arena:arena
                       subtree:subtree
                       maxBins:maxBins];
 }
@@ -333,8 +353,10 @@ typedef PredictionTree TreeHolder;
         return [BMLUtils dictionaryFromDistributionArray:_distribution];
     }
     if ([self isOneBranch:_children inputData:inputData]) {
-        for (PredictionTree* child in _children) {
+        for (PredictionTree* child in self.evaluationOrder) {
             if ([child.predicate apply:inputData fields:_fields]) {
+                if (_recordsHits)
+                    __atomic_fetch_add(&child->_hits, 1, __ATOMIC_RELAXED);
                 NSString* newRule = [child.predicate ruleWithFields:_fields label:nil];
                 if (![path containsObject:newRule] && !missingFound) {
                     [path addObject:newRule];
@@ -393,21 +415,16 @@ typedef PredictionTree TreeHolder;
     
     if (strategy == BMLMissingStrategyLastPrediction) {
         if (_children.count > 0) {
-            for (PredictionTree* child in _children) {
+            for (PredictionTree* child in self.evaluationOrder) {
                 if ([child.predicate apply:inputData fields:_fields]) {
+                    if (_recordsHits)
+                        __atomic_fetch_add(&child->_hits, 1, __ATOMIC_RELAXED);
                     [path addObject:[child.predicate ruleWithFields:_fields label:nil]];
                     return [child predict:inputData path:path strategy:strategy];
                 }
             }
         }
-        return [TreePrediction treePrediction:_output
-                                   confidence:_confidence
-                                        count:_count
-                                       median:([self isRegression]?_median:NAN)
-                                         path:path
-                                 distribution:_distribution
-                             distributionUnit:_distributionUnit
-                                     children:_children];
+        return [self predictionWithPath:path];
         
     } else if (strategy == BMLMissingStrategyProportional) {
 
@@ -477,6 +494,18 @@ typedef PredictionTree TreeHolder;
     return nil;
 }
 
+- (TreePrediction*)predictionWithPath:(NSMutableArray*)path {
+    
+    return [TreePrediction treePrediction:_output
+                               confidence:_confidence
+                                    count:_count
+                                   median:([self isRegression]?_median:NAN)
+                                     path:path
+                             distribution:_distribution
+                         distributionUnit:_distributionUnit
+                                 children:_children];
+}
+
 - (TreePrediction*)predict:(NSDictionary*)inputData
                       path:(NSMutableArray*)path {
     
@@ -488,4 +517,170 @@ typedef PredictionTree TreeHolder;
     return [self predict:inputData path:nil strategy:BMLMissingStrategyLastPrediction];
 }
 
+#pragma mark Explanations
+
+- (void)prepareExplanationsWithClasses:(NSArray*)classes {
+    
+    NSUInteger outputs = classes ? classes.count : 1;
+    _explanationValues = [_arena allocate:outputs * sizeof(double)];
+    NSAssert(_explanationValues, @"Could not allocate explanation values");
+    if (classes) {
+        double total = 0;
+        for (NSArray* bin in _distribution) {
+            total += [bin.lastObject doubleValue];
+        }
+        for (NSArray* bin in _distribution) {
+            NSUInteger index = [classes indexOfObject:bin.firstObject];
+            if (index != NSNotFound && total > 0)
+                _explanationValues[index] = [bin.lastObject doubleValue] / total;
+        }
+    } else {
+        _explanationValues[0] = [_output doubleValue];
+    }
+    for (PredictionTree* child in _children) {
+        [child prepareExplanationsWithClasses:classes];
+    }
+}
+
+- (const double*)explanationValues {
+    
+    return _explanationValues;
+}
+
+#pragma mark Profiling
+
+- (NSUInteger)nodeCountWithBytes:(size_t*)bytes {
+    
+    *bytes += malloc_size((__bridge const void*)self) + malloc_size((__bridge const void*)_predicate);
+    if (_children.count > 0) {
+        *bytes += malloc_size((__bridge const void*)_children);
+        NSArray* evaluationOrder = self.evaluationOrder;
+        if (evaluationOrder != _children)
+            *bytes += malloc_size((__bridge const void*)evaluationOrder);
+    }
+    NSUInteger count = 1;
+    for (PredictionTree* child in _children) {
+        count += [child nodeCountWithBytes:bytes];
+    }
+    return count;
+}
+
+- (PredictionTree*)explain:(NSDictionary*)inputData
+              fieldIndexes:(NSDictionary*)fieldIndexes
+                   outputs:(NSUInteger)outputs
+             contributions:(double*)contributions {
+    
+    PredictionTree* node = self;
+    while (node->_children.count > 0) {
+        
+        PredictionTree* next = nil;
+        for (PredictionTree* child in node.evaluationOrder) {
+            if ([child->_predicate apply:inputData fields:_fields]) {
+                next = child;
+                break;
+            }
+        }
+        if (!next)
+            break;
+        NSNumber* index = fieldIndexes[next->_predicate.field];
+        if (index) {
+            double* fieldContributions = contributions + index.unsignedIntegerValue * outputs;
+            for (NSUInteger k = 0; k < outputs; ++k) {
+                fieldContributions[k] += next->_explanationValues[k] - node->_explanationValues[k];
+            }
+        }
+        node = next;
+    }
+    return node;
+}
+
+#pragma mark Branch ordering
+
+- (void)setRecordsHits:(BOOL)recordsHits {
+    
+    _recordsHits = recordsHits;
+    for (PredictionTree* child in _children) {
+        child.recordsHits = recordsHits;
+    }
+}
+
+- (void)resetHits {
+    
+    for (PredictionTree* child in _children) {
+        child->_hits = 0;
+        [child resetHits];
+    }
+}
+
+- (void)orderChildrenByHits {
+    
+    self.evaluationOrder = [_children sortedArrayWithOptions:NSSortStable
+                                         usingComparator:^NSComparisonResult(PredictionTree* a, PredictionTree* b) {
+                                             if (a->_hits != b->_hits)
+                                                 return [@(b->_hits) compare:@(a->_hits)];
+                                             return [@(b->_count) compare:@(a->_count)];
+                                         }];
+    for (PredictionTree* child in _children) {
+        [child orderChildrenByHits];
+    }
+}
+
+static NSString* childPath(NSString* path, NSUInteger index) {
+    
+    return path.length > 0 ?
+    [NSString stringWithFormat:@"%@.%lu", path, (unsigned long)index] :
+    [NSString stringWithFormat:@"%lu", (unsigned long)index];
+}
+
+/**
+ * Nodes are identified by the path of child indexes that leads to them from
+ * the root, as in the JSON model, e.g. "0.1" for the second child of the
+ * first child of the root, and "" for the root itself.
+ */
+- (void)addChildOrder:(NSMutableDictionary*)order path:(NSString*)path {
+    
+    if (_children.count < 2)
+        return;
+    NSMutableArray* indexes = [NSMutableArray arrayWithCapacity:_children.count];
+    for (PredictionTree* child in self.evaluationOrder) {
+        [indexes addObject:@(child->_index)];
+    }
+    order[path] = indexes;
+    for (PredictionTree* child in _children) {
+        [child addChildOrder:order
+                        path:childPath(path, child->_index)];
+    }
+}
+
+- (NSDictionary*)childOrder {
+    
+    NSMutableDictionary* order = [NSMutableDictionary new];
+    [self addChildOrder:order path:@""];
+    return order;
+}
+
+- (void)applyChildOrder:(NSDictionary*)order path:(NSString*)path {
+    
+    NSArray* indexes = order[path];
+    if (indexes.count == _children.count) {
+        NSMutableArray* evaluationOrder = [NSMutableArray arrayWithCapacity:_children.count];
+        for (NSNumber* index in indexes) {
+            if (index.unsignedIntegerValue >= _children.count)
+                return;
+            [evaluationOrder addObject:_children[index.unsignedIntegerValue]];
+        }
+        if ([[NSSet setWithArray:evaluationOrder] count] == _children.count)
+            self.evaluationOrder = evaluationOrder;
+    }
+    for (PredictionTree* child in _children) {
+        [child applyChildOrder:order
+                          path:childPath(path, child->_index)];
+    }
+}
+
+- (void)applyChildOrder:(NSDictionary*)order {
+    
+    [self applyChildOrder:order path:@""];
+}
+
 @end
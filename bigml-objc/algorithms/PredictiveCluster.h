@@ -28,6 +28,21 @@
 
 @interface PredictiveCluster : NSObject
 
+/**
+ * Builds a local cluster from its JSON representation, as returned by BigML.io.
+ * The resulting object can be reused to compute any number of centroids.
+ */
+- (instancetype)initWithCluster:(NSDictionary*)jsonCluster;
+
+/**
+ * Computes the nearest centroid to the given input data.
+ * @param args The input data, which should provide values for all fields
+ * @param options A dictionary of options. See predictWithJSONCluster:arguments:options:
+ * @return A dictionary containing the centroidId, centroidName and distance
+ */
+- (NSDictionary*)predictWithArguments:(NSDictionary*)args
+                              options:(NSDictionary*)options;
+
 + (NSDictionary*)predictWithJSONCluster:(NSDictionary*)jsonCluster
                               arguments:(NSDictionary*)args
                                 options:(NSDictionary*)options;
@@ -14,6 +14,8 @@
 
 #import "PredictiveCluster.h"
 #import "PredictionCentroid.h"
+#import "Predicates.h"
+#import "BMLInstrumentation.h"
 
 #define TM_TOKENS @"tokens_only"
 #define TM_FULL_TERM @"full_terms_only"
@@ -46,19 +48,29 @@ to generate centroid predictions locally.
                               arguments:(NSDictionary*)args
                                 options:(NSDictionary*)options {
     
+    return [[[self alloc] initWithCluster:jsonCluster] predictWithArguments:args options:options];
+}
+
+- (NSDictionary*)predictWithArguments:(NSDictionary*)args
+                              options:(NSDictionary*)options {
+    
     BOOL byName = [options[@"byName"] ?: @(NO) boolValue];
-    NSDictionary* fields = jsonCluster[@"clusters"][@"fields"];
+    NSDictionary* fields = self.fields;
     NSMutableDictionary* inputData = [NSMutableDictionary dictionaryWithCapacity:[fields allKeys].count];
     for (NSString* key in [fields allKeys]) {
         NSString* fieldId = byName ? fields[key][@"name"] : key;
-        if (args[fieldId]) {
-            [inputData setObject:args[fieldId] forKey:fieldId];
+        id value = args[fieldId];
+        //-- input decoded for tree models carries tokenized text
+        if ([value isKindOfClass:[TermFrequencies class]])
+            value = [value text];
+        if (value) {
+            [inputData setObject:value forKey:fieldId];
         } else {
             NSAssert(NO, @"All input fields should be provided to calculate a centroid");
         }
     }
     
-    return [[[self alloc] initWithCluster:jsonCluster] computeNearest:inputData];
+    return [self computeNearest:inputData];
 }
 
 - (void)fillStructureForResource:(NSDictionary*)resourceDict {
@@ -167,6 +179,7 @@ to generate centroid predictions locally.
                                @"centroidName":@"",
                                @"distance":@(INFINITY) };
     
+    BML_STAGE_START(distanceStart);
     for (PredictionCentroid* centroid in self.centroids) {
         
         float distance2 = [centroid distance2WithInputData:inputData
@@ -182,6 +195,8 @@ to generate centroid predictions locally.
         }
     }
     
+    BML_STAGE_END(distanceStart, BMLStageDistance);
+    
     return @{ @"centroidId":nearest[@"centroidId"],
               @"centroidName":nearest[@"centroidName"],
               @"distance":@(sqrt([nearest[@"distance"] floatValue])) };
@@ -13,6 +13,9 @@
 // under the License.
 
 #import <Foundation/Foundation.h>
+#import "EnsembleMemberSource.h"
+
+@class FieldResource;
 
 @interface PredictiveEnsemble : NSObject
 
@@ -22,9 +25,137 @@
                      maxModels:(NSUInteger)maxModels
                  distributions:(NSArray*)distributions;
 
+/**
+ * Builds an ensemble whose members are loaded from a source when they are
+ * first needed, instead of all being held in memory. At most `workingSet`
+ * loaded members are kept (0 for no limit), fewer under memory pressure;
+ * evicted members are loaded again on their next use.
+ *
+ * Members the source cannot provide do not vote, and are counted by
+ * unavailableMemberCount; a row no member could vote on gets a result
+ * without prediction.
+ *
+ * Every member is read once here to collect the fields of all of them, so
+ * that inputs can be decoded once for the whole ensemble.
+ *
+ * Each prediction goes through all the members in turn, so with a working
+ * set smaller than the ensemble a single-row prediction reloads nearly every
+ * member. Score such ensembles in batches with predictWithRows:options:,
+ * which loads each member once per batch. Options asking for incremental
+ * evaluation apply row by row, and reload members likewise.
+ */
+- (instancetype)initWithMemberSource:(id<EnsembleMemberSource>)source
+                          workingSet:(NSUInteger)workingSet
+                       distributions:(NSArray*)distributions;
+
+/**
+ * Compiles the members into a BinnedForest, so that each input row is
+ * encoded once against the numeric thresholds of all the trees and their
+ * numeric splits are tested as integer comparisons. Predictions are
+ * unchanged; those using the Proportional missing strategy do not use the
+ * compiled form.
+ *
+ * All members are loaded, and kept, when compiling an ensemble built from a
+ * member source; if one cannot be loaded, nothing is compiled and isBinned
+ * stays NO. Members' branch order is compiled in, so call
+ * optimizeBranchOrder on them first if needed. Not to be called while other
+ * threads are predicting.
+ */
+- (void)compileBinnedForest;
+
+/// YES once compileBinnedForest has been called
+@property (nonatomic, readonly) BOOL isBinned;
+
+/**
+ * The fields of the ensemble members, keyed by field id.
+ */
+- (NSDictionary*)fields;
+
+/**
+ * The fields shared by the members, which decode the ensemble's input.
+ */
+- (FieldResource*)sharedFields;
+
+/**
+ * The number of times a member could not be loaded from the member source
+ * and was left out of a prediction.
+ */
+- (NSUInteger)unavailableMemberCount;
+
+/**
+ * The id of the field the ensemble members predict.
+ */
+- (NSString*)objectiveFieldId;
+
+/**
+ * Combines the predictions of the ensemble members for the given input.
+ * Besides the options of PredictiveModel predictWithArguments:options:, it
+ * accepts:
+ *
+ *        - method: a BMLPredictionMethod (default plurality)
+ *
+ *        - threshold-k, threshold-category: used by the threshold method
+ *
+ *        - earlyTermination: when YES, members are evaluated one at a time and
+ *          evaluation stops as soon as the remaining members cannot change the
+ *          prediction. This applies to plurality and threshold classifications;
+ *          with other methods all members are evaluated. The result includes
+ *          `evaluatedMembers`, and its confidence and distribution only account
+ *          for the evaluated members.
+ *
+ *        - memberOrder: with earlyTermination, the order in which members are
+ *          evaluated, as an array of member indexes. Putting first the members
+ *          most likely to agree with the majority makes decisions earlier.
+ *          Ties still go to the category voted by the lowest member index.
+ *          Also the priority order under a budget. Members left out are
+ *          evaluated after the listed ones, by index; each index may only be
+ *          listed once.
+ *
+ *        - timeBudget: seconds available for the prediction, decoding the
+ *          input and combining the votes included (0, the default, for no
+ *          limit). Members are evaluated one at a time and no new one is
+ *          started unless the slowest member and vote combination seen so far
+ *          still fit in the time left. When not even one member fits, the
+ *          result has no `prediction` and `evaluatedMembers` is 0.
+ *
+ *        - treeBudget: maximum number of members to evaluate (0 for all).
+ *
+ *          When a budget stops evaluation before the prediction is decided, the
+ *          result includes `decisionConfidence`, the estimated probability that
+ *          the full ensemble would predict the same category, or for
+ *          regressions `standardError`, the estimated standard error of the
+ *          partial mean. The threshold method is not accounted for by the
+ *          estimate, which refers to the plurality leader.
+ */
 - (NSDictionary*)predictWithArguments:(NSDictionary*)inputData
                                    options:(NSDictionary*)options;
 
+/**
+ * The prediction of predictWithArguments:options:, explained by the mean
+ * of the members' explanations (see PredictiveModel
+ * explainWithArguments:options:) for the predicted category, or the
+ * predicted value of regressions. Each member is traversed once, both to
+ * cast its vote and to explain it; the votes are combined with the method
+ * and strategy options, while budgets and early termination do not apply.
+ * The bias plus all the contributions give the mean over the members of the
+ * probability they assign to the predicted category (or of their
+ * predictions). An empty dictionary is returned when no member votes.
+ *
+ * @return The prediction, plus fields (input field ids), contributions
+ *         (one number per field) and bias
+ */
+- (NSDictionary*)explainWithArguments:(NSDictionary*)inputData
+                              options:(NSDictionary*)options;
+
+/**
+ * Same as predictWithArguments:options: for several rows at once, returning
+ * the predictions in the order of the rows. Each member is evaluated over
+ * all the rows before moving to the next one, which keeps its tree in cache;
+ * options asking for incremental evaluation (earlyTermination or a budget)
+ * are applied row by row instead.
+ */
+- (NSArray*)predictWithRows:(NSArray*)rows options:(NSDictionary*)options;
+
 + (NSDictionary*)predictWithJSONModels:(NSArray*)models
                                   args:(NSDictionary*)inputData
                                options:(NSDictionary*)options
@@ -15,12 +15,23 @@
 #import "PredictiveEnsemble.h"
 #import "MultiModel.h"
 #import "MultiVote.h"
+#import "PredictiveModel.h"
 #import "BMLEnums.h"
+#import "BMLUtils.h"
+#import "BinnedForest.h"
+#import "BMLInstrumentation.h"
 
 @implementation PredictiveEnsemble {
     
     NSArray* _distributions;
     NSArray* _multiModels;
+    FieldResource* _sharedFields;
+    BinnedForest* _binnedForest;
+    BMLModelStats* _stats;
+    NSArray* _explanationFields;
+    NSDictionary* _explanationFieldIndexes;
+    NSTimeInterval _slowestMember;
+    NSTimeInterval _slowestCombine;
 }
 
 - (instancetype)initWithModels:(NSArray*)models
@@ -33,7 +44,36 @@
 
     if (self = [super init]) {
         
+        //-- members are trained on the same dataset: one copy of the fields will do,
+        //-- as long as it covers the fields of every member
+        _sharedFields = [PredictiveModel sharedFieldsWithJSONModels:models];
         _multiModels = [self multiModelsFromModels:models maxModels:maxModels];
+        [self prepareExplanationFields];
+        _stats = [BMLInstrumentation registerModelWithLabel:[NSString stringWithFormat:@"ensemble %p", self]];
+        _isReadyToPredict = YES;
+        _distributions = distributions;
+    }
+    return self;
+}
+
+- (instancetype)initWithMemberSource:(id<EnsembleMemberSource>)source
+                          workingSet:(NSUInteger)workingSet
+                       distributions:(NSArray*)distributions {
+    
+    NSAssert([source memberCount] > 0,
+             @"initWithMemberSource:workingSet:distributions: contract unfulfilled");
+    
+    if (self = [super init]) {
+        
+        _sharedFields = [PredictiveModel sharedFieldsWithModelCount:[source memberCount]
+                                                   jsonModelAtIndex:^NSDictionary*(NSUInteger index) {
+                                                       return [source memberAtIndex:index];
+                                                   }];
+        _multiModels = @[ [[MultiModel alloc] initWithMemberSource:source
+                                                        workingSet:workingSet
+                                                      sharedFields:_sharedFields] ];
+        [self prepareExplanationFields];
+        _stats = [BMLInstrumentation registerModelWithLabel:[NSString stringWithFormat:@"ensemble %p", self]];
         _isReadyToPredict = YES;
         _distributions = distributions;
     }
@@ -46,12 +86,60 @@
     return [self initWithModels:models maxModels:maxModels distributions:nil];
 }
 
+static BOOL predictsIncrementally(NSDictionary* options) {
+    
+    return [options[@"earlyTermination"] ?: @(NO) boolValue] ||
+    [options[@"timeBudget"] doubleValue] > 0 ||
+    [options[@"treeBudget"] unsignedIntegerValue] > 0;
+}
+
 - (NSDictionary*)predictWithArguments:(NSDictionary*)inputData
                               options:(NSDictionary*)options {
     
     NSAssert(_isReadyToPredict,
              @"You should wait for .isReadyToPredict to be YES before calling this method");
 
+    //-- the time budget also covers decoding the input
+    NSTimeInterval start = [BMLUtils monotonicTime];
+    if (!predictsIncrementally(options))
+        return [self predictWithRows:@[ inputData ] options:options].firstObject;
+    
+    BMLPredictionMethod method = [options[@"method"] ?: @(BMLPredictionMethodPlurality) intValue];
+    BMLMissingStrategy missingStrategy = [options[@"strategy"] ?: @(BMLMissingStrategyLastPrediction) intValue];
+    BOOL byName = [options[@"byName"] ?: @(NO) boolValue];
+    
+    BML_COUNT(_stats, rows, 1);
+    
+    //-- members share their fields: decode the input only once for all of them
+    if (![options[@"decodedInput"] ?: @NO boolValue])
+        inputData = [_sharedFields decodedInputData:inputData byName:byName];
+    
+    return [self predictIncrementally:inputData
+                               method:method
+                      missingStrategy:missingStrategy
+                           confidence:[options[@"confidence"] ?: @(YES) boolValue]
+                         distribution:[options[@"distribution"] ?: @(NO) boolValue]
+                                count:[options[@"count"] ?: @(NO) boolValue]
+                               median:[options[@"median"] ?: @(NO) boolValue]
+                                  min:[options[@"min"] ?: @(NO) boolValue]
+                                  max:[options[@"max"] ?: @(NO) boolValue]
+                            startTime:start
+                              options:options];
+}
+
+- (NSArray*)predictWithRows:(NSArray*)rows options:(NSDictionary*)options {
+    
+    NSAssert(_isReadyToPredict,
+             @"You should wait for .isReadyToPredict to be YES before calling this method");
+    
+    if (predictsIncrementally(options)) {
+        NSMutableArray* results = [NSMutableArray arrayWithCapacity:rows.count];
+        for (NSDictionary* row in rows) {
+            [results addObject:[self predictWithArguments:row options:options]];
+        }
+        return results;
+    }
+    
     BMLPredictionMethod method = [options[@"method"] ?: @(BMLPredictionMethodPlurality) intValue];
     BMLMissingStrategy missingStrategy = [options[@"strategy"] ?: @(BMLMissingStrategyLastPrediction) intValue];
     BOOL byName = [options[@"byName"] ?: @(NO) boolValue];
@@ -62,26 +150,453 @@
     BOOL min = [options[@"min"] ?: @(NO) boolValue];
     BOOL max = [options[@"max"] ?: @(NO) boolValue];
     
+    BML_COUNT(_stats, rows, rows.count);
+    
+    //-- members share their fields: decode the input only once for all of them
+    NSArray* inputs = rows;
+    if (![options[@"decodedInput"] ?: @NO boolValue]) {
+        NSMutableArray* decoded = [NSMutableArray arrayWithCapacity:rows.count];
+        for (NSDictionary* row in rows) {
+            [decoded addObject:[_sharedFields decodedInputData:row byName:byName]];
+        }
+        inputs = decoded;
+    }
+    
+    NSArray* votes = (_binnedForest && missingStrategy == BMLMissingStrategyLastPrediction) ?
+    [self binnedVotesForInputs:inputs median:median] :
+    [self votesForInputs:inputs missingStrategy:missingStrategy median:median];
+    
+    NSMutableArray* results = [NSMutableArray arrayWithCapacity:votes.count];
+    for (MultiVote* rowVotes in votes) {
+        if (rowVotes.count == 0) {
+            [results addObject:@{}];
+            continue;
+        }
+        [results addObject:[self combineVotes:rowVotes
+                                       method:method
+                                   confidence:confidence
+                                 distribution:distribution
+                                        count:count
+                                       median:median
+                                          min:min
+                                          max:max
+                                      options:options]];
+    }
+    return results;
+}
+
+/**
+ * The votes of all members for each of the inputs. Members are evaluated one
+ * at a time over all the inputs, so that each tree is walked while it is
+ * still in cache; votes are appended in member order, as for a single row.
+ */
+- (NSArray*)votesForInputs:(NSArray*)inputs
+           missingStrategy:(BMLMissingStrategy)missingStrategy
+                    median:(BOOL)median {
+    
+    NSMutableArray* votes = [NSMutableArray arrayWithCapacity:inputs.count];
+    for (NSUInteger row = 0; row < inputs.count; ++row) {
+        [votes addObject:[MultiVote new]];
+    }
+    for (MultiModel* multiModel in _multiModels) {
+        
+        NSMutableArray* partialVotes = [NSMutableArray arrayWithCapacity:inputs.count];
+        for (NSUInteger row = 0; row < inputs.count; ++row) {
+            [partialVotes addObject:[MultiVote new]];
+        }
+        for (NSUInteger i = 0; i < multiModel.count; ++i) {
+            for (NSUInteger row = 0; row < inputs.count; ++row) {
+                NSDictionary* vote = [multiModel predictWithModelAtIndex:i
+                                                               inputData:inputs[row]
+                                                         missingStrategy:missingStrategy
+                                                                  median:median];
+                if (vote)
+                    [partialVotes[row] append:vote];
+            }
+        }
+        for (NSUInteger row = 0; row < inputs.count; ++row) {
+            if (median) {
+                [partialVotes[row] addMedian];
+            }
+            [votes[row] extendWithMultiVote:partialVotes[row]];
+        }
+    }
+    return votes;
+}
+
+/**
+ * Same as votesForInputs:missingStrategy:median:, with the binned forest.
+ */
+- (NSArray*)binnedVotesForInputs:(NSArray*)inputs median:(BOOL)median {
+    
+    NSMutableArray* encodedInputs = [NSMutableArray arrayWithCapacity:inputs.count];
+    NSMutableArray* votes = [NSMutableArray arrayWithCapacity:inputs.count];
+    for (NSDictionary* input in inputs) {
+        [encodedInputs addObject:[_binnedForest encodedInputData:input]];
+        [votes addObject:[MultiVote new]];
+    }
+    NSUInteger memberCount = [self memberCount];
+    for (NSUInteger i = 0; i < memberCount; ++i) {
+        for (NSUInteger row = 0; row < inputs.count; ++row) {
+            [votes[row] append:[_binnedForest predictWithMember:i
+                                                   encodedInput:encodedInputs[row]
+                                                      inputData:inputs[row]]];
+        }
+    }
+    if (median) {
+        for (MultiVote* rowVotes in votes) {
+            [rowVotes addMedian];
+        }
+    }
+    return votes;
+}
+
+- (NSDictionary*)combineVotes:(MultiVote*)votes
+                       method:(BMLPredictionMethod)method
+                   confidence:(BOOL)confidence
+                 distribution:(BOOL)distribution
+                        count:(BOOL)count
+                       median:(BOOL)median
+                          min:(BOOL)min
+                          max:(BOOL)max
+                      options:(NSDictionary*)options {
+    
+    BML_STAGE_START(combineStart);
+    NSDictionary* result = [votes combineWithMethod:method
+                                         confidence:confidence
+                                       distribution:distribution
+                                              count:count
+                                             median:median
+                                                min:min
+                                                max:max
+                                            options:options];
+    BML_STAGE_END(combineStart, BMLStageCombine);
+    return result;
+}
+
+- (void)compileBinnedForest {
+    
+    //-- the forest needs every member: it is not compiled if one is unavailable
+    NSMutableArray* models = [NSMutableArray arrayWithCapacity:[self memberCount]];
+    for (MultiModel* multiModel in _multiModels) {
+        for (NSUInteger i = 0; i < multiModel.count; ++i) {
+            PredictiveModel* model = [multiModel predictiveModelAtIndex:i];
+            if (!model)
+                return;
+            [models addObject:model];
+        }
+    }
+    _binnedForest = [[BinnedForest alloc] initWithModels:models];
+}
+
+- (BOOL)isBinned {
+    
+    return _binnedForest != nil;
+}
+
+- (NSDictionary*)fields {
+    
+    return _sharedFields.fields;
+}
+
+- (FieldResource*)sharedFields {
+    
+    return _sharedFields;
+}
+
+- (NSUInteger)unavailableMemberCount {
+    
+    NSUInteger count = 0;
+    for (MultiModel* multiModel in _multiModels) {
+        count += multiModel.unavailableCount;
+    }
+    return count;
+}
+
+- (NSDictionary*)explainWithArguments:(NSDictionary*)inputData
+                              options:(NSDictionary*)options {
+    
+    NSAssert(_isReadyToPredict,
+             @"You should wait for .isReadyToPredict to be YES before calling this method");
+    
+    BMLPredictionMethod method = [options[@"method"] ?: @(BMLPredictionMethodPlurality) intValue];
+    BMLMissingStrategy missingStrategy = [options[@"strategy"] ?: @(BMLMissingStrategyLastPrediction) intValue];
+    BOOL median = [options[@"median"] ?: @(NO) boolValue];
+    NSDictionary* input = inputData;
+    if (![options[@"decodedInput"] ?: @NO boolValue])
+        input = [_sharedFields decodedInputData:inputData byName:[options[@"byName"] ?: @NO boolValue]];
+    
+    //-- as for predictions, an empty input gets no votes
+    if (input.count == 0)
+        return @{};
+    
+    //-- each member votes with the traversal that explains it, keeping the
+    //-- contributions of all its classes until the predicted one is known
+    NSMutableArray* explained = [NSMutableArray new];
     MultiVote* votes = [MultiVote new];
     for (MultiModel* multiModel in _multiModels) {
-        MultiVote* partialVote = [multiModel generateVotes:inputData
-                                                    byName:byName
-                                           missingStrategy:missingStrategy
-                                                 median:median];
-        if (median) {
-            [partialVote addMedian];
+        
+        MultiVote* partialVotes = [MultiVote new];
+        for (NSUInteger i = 0; i < multiModel.count; ++i) {
+            
+            PredictiveModel* model = [multiModel predictiveModelAtIndex:i];
+            if (!model)
+                continue;
+            NSUInteger outputs = model.explanationClasses ? model.explanationClasses.count : 1;
+            NSMutableData* contributions = [NSMutableData dataWithLength:
+                                            model.explanationFields.count * outputs * sizeof(double)];
+            const double* memberBias = NULL;
+            TreePrediction* prediction = [model explainDecodedInput:input
+                                                           strategy:missingStrategy
+                                                      contributions:contributions.mutableBytes
+                                                               bias:&memberBias];
+            [partialVotes append:[[model outputWithTreePrediction:prediction multiple:NSUIntegerMax] firstObject]];
+            [explained addObject:@[ model,
+                                    contributions,
+                                    [NSData dataWithBytes:memberBias length:outputs * sizeof(double)] ]];
         }
-        [votes extendWithMultiVote:partialVote];
+        if (median)
+            [partialVotes addMedian];
+        [votes extendWithMultiVote:partialVotes];
     }
+    if (votes.count == 0)
+        return @{};
+    
+    NSMutableDictionary* explanation = [[self combineVotes:votes
+                                                    method:method
+                                                confidence:[options[@"confidence"] ?: @(YES) boolValue]
+                                              distribution:[options[@"distribution"] ?: @(NO) boolValue]
+                                                     count:[options[@"count"] ?: @(NO) boolValue]
+                                                    median:median
+                                                       min:[options[@"min"] ?: @(NO) boolValue]
+                                                       max:[options[@"max"] ?: @(NO) boolValue]
+                                                   options:options] mutableCopy];
+    id predicted = explanation[@"prediction"];
+    
+    NSUInteger fieldCount = _explanationFields.count;
+    double* total = calloc(fieldCount, sizeof(double));
+    double bias = 0;
+    for (NSArray* member in explained) {
+        
+        PredictiveModel* model = member[0];
+        const double* contributions = [member[1] bytes];
+        const double* memberBias = [member[2] bytes];
+        NSArray* classes = model.explanationClasses;
+        NSArray* fields = model.explanationFields;
+        NSUInteger outputs = classes ? classes.count : 1;
+        
+        //-- members that never saw the predicted category count as 0
+        NSUInteger output = classes ? [classes indexOfObject:predicted] : 0;
+        if (output == NSNotFound)
+            continue;
+        bias += memberBias[output];
+        for (NSUInteger j = 0; j < fields.count; ++j) {
+            NSNumber* index = _explanationFieldIndexes[fields[j]];
+            if (index)
+                total[index.unsignedIntegerValue] += contributions[j * outputs + output];
+        }
+    }
+    
+    NSUInteger members = explained.count;
+    NSMutableArray* contributions = [NSMutableArray arrayWithCapacity:fieldCount];
+    for (NSUInteger i = 0; i < fieldCount; ++i) {
+        [contributions addObject:@(total[i] / members)];
+    }
+    free(total);
+    explanation[@"fields"] = _explanationFields;
+    explanation[@"contributions"] = contributions;
+    explanation[@"bias"] = @(bias / members);
+    return explanation;
+}
 
-    return [votes combineWithMethod:method
-                         confidence:confidence
-                    distribution:distribution
-                           count:count
-                          median:median
-                             min:min
-                             max:max
-                            options:options];
+- (void)prepareExplanationFields {
+    
+    NSMutableArray* fieldIds = [_sharedFields.fields.allKeys mutableCopy];
+    [fieldIds removeObject:_sharedFields.objectiveFieldId];
+    [fieldIds sortUsingSelector:@selector(compare:)];
+    NSMutableDictionary* indexes = [NSMutableDictionary dictionaryWithCapacity:fieldIds.count];
+    [fieldIds enumerateObjectsUsingBlock:^(NSString* fieldId, NSUInteger i, BOOL* stop) {
+        indexes[fieldId] = @(i);
+    }];
+    _explanationFieldIndexes = indexes;
+    _explanationFields = fieldIds;
+}
+
+- (NSString*)objectiveFieldId {
+    
+    return _sharedFields.objectiveFieldId;
+}
+
+- (NSUInteger)memberCount {
+    
+    NSUInteger count = 0;
+    for (MultiModel* multiModel in _multiModels) {
+        count += multiModel.count;
+    }
+    return count;
+}
+
+- (NSDictionary*)predictWithMember:(NSUInteger)index
+                         inputData:(NSDictionary*)inputData
+                      encodedInput:(NSData*)encodedInput
+                   missingStrategy:(BMLMissingStrategy)missingStrategy
+                            median:(BOOL)median {
+    
+    if (encodedInput)
+        return [_binnedForest predictWithMember:index encodedInput:encodedInput inputData:inputData];
+    for (MultiModel* multiModel in _multiModels) {
+        if (index < multiModel.count) {
+            return [multiModel predictWithModelAtIndex:index
+                                             inputData:inputData
+                                       missingStrategy:missingStrategy
+                                                median:median];
+        }
+        index -= multiModel.count;
+    }
+    NSAssert(NO, @"Ensemble member index out of range");
+    return nil;
+}
+
+/**
+ * The order in which members are evaluated incrementally: the members listed
+ * in `order`, followed by those it leaves out, by index. Every member votes
+ * exactly once, so indexes out of range or listed twice are skipped. Returns
+ * nil, for the default order, when `order` is nil.
+ */
+- (NSData*)memberEvaluationOrder:(NSArray*)order {
+    
+    if (!order)
+        return nil;
+    NSUInteger members = [self memberCount];
+    NSMutableData* data = [NSMutableData dataWithLength:members * sizeof(NSUInteger)];
+    NSUInteger* indexes = data.mutableBytes;
+    NSUInteger count = 0;
+    NSMutableIndexSet* listed = [NSMutableIndexSet indexSet];
+    for (NSNumber* index in order) {
+        BOOL valid = [index isKindOfClass:[NSNumber class]] &&
+        index.longLongValue >= 0 && index.unsignedIntegerValue < members &&
+        ![listed containsIndex:index.unsignedIntegerValue];
+        NSAssert(valid, @"Invalid ensemble member order: %@", order);
+        if (valid) {
+            [listed addIndex:index.unsignedIntegerValue];
+            indexes[count++] = index.unsignedIntegerValue;
+        }
+    }
+    for (NSUInteger member = 0; count < members; ++member) {
+        if (![listed containsIndex:member])
+            indexes[count++] = member;
+    }
+    return data;
+}
+
+/**
+ * Evaluates members one at a time, in the order given by the `memberOrder`
+ * option (see memberEvaluationOrder:, by default 0..n-1). Votes keep their member index
+ * as order, and ties go to the category voted by the lowest index, so they
+ * are broken as if all members had voted in index order.
+ *
+ * With `earlyTermination`, evaluation stops as soon as the remaining members
+ * cannot change the combined prediction, which is then the same as with a
+ * full evaluation. With `timeBudget` or `treeBudget`, it also stops when the
+ * budget is exhausted: a member is only started when the slowest member and
+ * the slowest vote combination seen so far by this ensemble still fit in the
+ * time left since `start`. If not even the first member fits, no prediction is
+ * made. Confidence, distribution and count are computed from the evaluated
+ * members only, whose number is returned as `evaluatedMembers`.
+ * When the budget cut evaluation short, the result also carries an estimate
+ * of how reliable the partial prediction is.
+ */
+- (NSDictionary*)predictIncrementally:(NSDictionary*)inputData
+                               method:(BMLPredictionMethod)method
+                      missingStrategy:(BMLMissingStrategy)missingStrategy
+                           confidence:(BOOL)confidence
+                         distribution:(BOOL)distribution
+                                count:(BOOL)count
+                               median:(BOOL)median
+                                  min:(BOOL)min
+                                  max:(BOOL)max
+                            startTime:(NSTimeInterval)start
+                              options:(NSDictionary*)options {
+    
+    BOOL earlyTermination = [options[@"earlyTermination"] ?: @(NO) boolValue];
+    NSTimeInterval timeBudget = [options[@"timeBudget"] doubleValue];
+    NSUInteger treeBudget = [options[@"treeBudget"] unsignedIntegerValue];
+    NSData* orderData = [self memberEvaluationOrder:options[@"memberOrder"]];
+    const NSUInteger* order = orderData.bytes;
+    NSUInteger members = [self memberCount];
+    NSUInteger budget = treeBudget > 0 ? MIN(treeBudget, members) : members;
+    
+    NSData* encodedInput = nil;
+    if (_binnedForest && missingStrategy == BMLMissingStrategyLastPrediction)
+        encodedInput = [_binnedForest encodedInputData:inputData];
+    
+    MultiVote* votes = [MultiVote new];
+    NSUInteger evaluated = 0;
+    //-- the lowest member index still to be evaluated, which tells whether a tie is decided
+    NSMutableData* doneData = order ? [NSMutableData dataWithLength:members] : nil;
+    BOOL* done = doneData.mutableBytes;
+    NSUInteger lowestPending = 0;
+    NSTimeInterval slowestMember = [BMLUtils raiseMaximum:&_slowestMember toDuration:0];
+    NSTimeInterval slowestCombine = [BMLUtils raiseMaximum:&_slowestCombine toDuration:0];
+    BOOL decided = NO;
+    while (evaluated < budget) {
+        
+        NSTimeInterval memberStart = [BMLUtils monotonicTime];
+        if (timeBudget > 0 && memberStart - start + slowestMember + slowestCombine > timeBudget)
+            break;
+        NSUInteger member = order ? order[evaluated] : evaluated;
+        NSMutableDictionary* vote = [[self predictWithMember:member
+                                                   inputData:inputData
+                                                encodedInput:encodedInput
+                                             missingStrategy:missingStrategy
+                                                      median:median] mutableCopy];
+        if (median)
+            vote[@"prediction"] = vote[@"median"];
+        if (vote)
+            [votes append:vote order:member];
+        slowestMember = [BMLUtils raiseMaximum:&_slowestMember
+                                    toDuration:[BMLUtils monotonicTime] - memberStart];
+        votes.pendingVotes = members - ++evaluated;
+        if (done) {
+            done[member] = YES;
+            while (lowestPending < members && done[lowestPending])
+                ++lowestPending;
+        } else {
+            lowestPending = evaluated;
+        }
+        votes.pendingVotesOrder = lowestPending;
+        if (earlyTermination && [votes isDecidedWithMethod:method options:options]) {
+            decided = YES;
+            break;
+        }
+    }
+    
+    BOOL truncated = !decided && evaluated < members;
+    if (evaluated < members)
+        BML_COUNT(_stats, earlyStops, 1);
+    if (votes.count == 0)
+        return @{ @"evaluatedMembers" : @(evaluated) };
+    
+    NSTimeInterval combineStart = [BMLUtils monotonicTime];
+    NSMutableDictionary* result = [[self combineVotes:votes
+                                               method:method
+                                           confidence:confidence
+                                         distribution:distribution
+                                                count:count
+                                               median:median
+                                                  min:min
+                                                  max:max
+                                              options:options] mutableCopy];
+    result[@"evaluatedMembers"] = @(evaluated);
+    if (truncated) {
+        id prediction = result[@"prediction"];
+        if ([prediction isKindOfClass:[NSNumber class]])
+            result[@"standardError"] = @([votes estimatedStandardError]);
+        else
+            result[@"decisionConfidence"] = @([votes estimatedDecisionConfidence]);
+    }
+    [BMLUtils raiseMaximum:&_slowestCombine toDuration:[BMLUtils monotonicTime] - combineStart];
+    return result;
 }
 
 + (NSDictionary*)predictWithJSONModels:(NSArray*)models
@@ -108,7 +623,8 @@
           [models subarrayWithRange:(NSRange){
              i * maxModels,
              MIN(multiModelSize, models.count - i*multiModelSize)
-         }]]];
+         }]
+                              sharedFields:_sharedFields]];
     }
     return multiModels;
 }
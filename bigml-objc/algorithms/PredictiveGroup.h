@@ -0,0 +1,50 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A group of local predictors scoring the same rows, e.g. the model versions
+ * of an A/B test or a shadow deployment.
+ *
+ * Each row is decoded (field names mapped to ids, missing values removed,
+ * numbers cast and text tokenized) once for all the predictors that decode
+ * it the same way, i.e. with the same fields, locale and missing tokens, and
+ * the decoded row is then handed to every one of them, instead of each
+ * predictor decoding it again. Clusters are given the row as it is.
+ */
+@interface PredictiveGroup : NSObject
+
+/**
+ * @param predictors Loaded PredictiveModel, PredictiveEnsemble, Anomaly and
+ *        PredictiveCluster instances
+ */
+- (instancetype)initWithPredictors:(NSArray*)predictors;
+
+@property (nonatomic, readonly) NSArray* predictors;
+
+/**
+ * Scores a row with all the predictors.
+ *
+ * @param arguments The input data
+ * @param options Options passed to every predictor (e.g. byName, strategy);
+ *        see the predictors' own prediction methods
+ * @return The results, in the order of the predictors: the prediction
+ *         dictionary for models and ensembles, the nearest centroid for
+ *         clusters and a dictionary with a "score" for anomaly detectors.
+ */
+- (NSArray*)predictWithArguments:(NSDictionary*)arguments
+                         options:(NSDictionary*)options;
+
+@end
@@ -0,0 +1,106 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "PredictiveGroup.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "PredictiveCluster.h"
+#import "Anomaly.h"
+
+@implementation PredictiveGroup {
+    
+    NSArray* _decoders;
+    NSArray* _decoderIndexes;
+}
+
+/**
+ * The fields that decode the predictor's input, nil for predictors that
+ * take the input as given.
+ */
++ (FieldResource*)decoderOfPredictor:(id)predictor {
+    
+    if ([predictor isKindOfClass:[FieldResource class]])
+        return predictor;
+    if ([predictor isKindOfClass:[PredictiveEnsemble class]])
+        return [predictor sharedFields];
+    NSAssert([predictor isKindOfClass:[PredictiveCluster class]],
+             @"PredictiveGroup: unsupported predictor %@", predictor);
+    return nil;
+}
+
+- (instancetype)initWithPredictors:(NSArray*)predictors {
+    
+    if (self = [super init]) {
+        
+        _predictors = predictors;
+        
+        //-- predictors decoding rows the same way share one decoded row
+        NSMutableArray* decoders = [NSMutableArray new];
+        NSMutableArray* decoderIndexes = [NSMutableArray arrayWithCapacity:predictors.count];
+        for (id predictor in predictors) {
+            
+            FieldResource* decoder = [PredictiveGroup decoderOfPredictor:predictor];
+            NSUInteger index = NSNotFound;
+            if (decoder) {
+                index = [decoders indexOfObjectPassingTest:^BOOL(FieldResource* other, NSUInteger i, BOOL* stop) {
+                    return [other decodesInputLike:decoder];
+                }];
+                if (index == NSNotFound) {
+                    index = decoders.count;
+                    [decoders addObject:decoder];
+                }
+            }
+            [decoderIndexes addObject:@(index)];
+        }
+        _decoders = decoders;
+        _decoderIndexes = decoderIndexes;
+    }
+    return self;
+}
+
+- (NSArray*)predictWithArguments:(NSDictionary*)arguments
+                         options:(NSDictionary*)options {
+    
+    BOOL byName = [options[@"byName"] ?: @NO boolValue];
+    NSMutableArray* inputs = [NSMutableArray arrayWithCapacity:_decoders.count];
+    for (FieldResource* decoder in _decoders) {
+        [inputs addObject:[decoder decodedInputData:arguments byName:byName]];
+    }
+    
+    NSMutableDictionary* decodedOptions = [options ?: @{} mutableCopy];
+    decodedOptions[@"byName"] = @NO;
+    decodedOptions[@"decodedInput"] = @YES;
+    
+    NSMutableArray* results = [NSMutableArray arrayWithCapacity:_predictors.count];
+    for (NSUInteger i = 0; i < _predictors.count; ++i) {
+        
+        id predictor = _predictors[i];
+        NSUInteger decoder = [_decoderIndexes[i] unsignedIntegerValue];
+        NSDictionary* input = decoder != NSNotFound ? inputs[decoder] : arguments;
+        id result = nil;
+        if ([predictor isKindOfClass:[PredictiveModel class]]) {
+            result = [[predictor predictWithArguments:input options:decodedOptions] firstObject];
+        } else if ([predictor isKindOfClass:[PredictiveEnsemble class]]) {
+            result = [predictor predictWithArguments:input options:decodedOptions];
+        } else if ([predictor isKindOfClass:[Anomaly class]]) {
+            result = @{ @"score" : @([predictor score:input options:decodedOptions]) };
+        } else if ([predictor isKindOfClass:[PredictiveCluster class]]) {
+            result = [predictor predictWithArguments:input options:options];
+        }
+        [results addObject:result ?: [NSNull null]];
+    }
+    return results;
+}
+
+@end
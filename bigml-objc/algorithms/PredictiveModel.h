@@ -16,6 +16,8 @@
 #import "FieldResource.h"
 #import "PredictionTree.h"
 
+@class PredictionCache;
+
 /*
  * A local Predictive Model.
  
@@ -37,6 +39,51 @@
  */
 @interface PredictiveModel : FieldResource
 
+/**
+ * Builds a local model from its JSON representation, as returned by BigML.io.
+ * The resulting object can be reused to make any number of predictions.
+ * @param jsonModel The model, either as a full resource or its `object` element
+ * @return The model, or nil if the model has not finished processing
+ */
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel;
+
+/**
+ * Same as initWithJSONModel:, but reusing field definitions shared with
+ * other models instead of copying the model's own, when they include all
+ * of them. Ensembles use it to keep a single copy of their fields.
+ * @param sharedFields As returned by sharedFieldsWithJSONModel:, or nil
+ */
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel sharedFields:(FieldResource*)sharedFields;
+
+/**
+ * Same as initWithJSONModel:, decoding the model from JSON data first. The
+ * decoding time is part of the load figures of BMLInstrumentation.
+ * @return The model, or nil with an error if the data is not a JSON model
+ */
+- (instancetype)initWithJSONData:(NSData*)data error:(NSError**)error;
+
+/**
+ * Builds the field definitions of a model, to be shared with
+ * initWithJSONModel:sharedFields: by models trained on the same dataset.
+ */
++ (FieldResource*)sharedFieldsWithJSONModel:(NSDictionary*)jsonModel;
+
+/**
+ * Builds the union of the field definitions of several models, so that
+ * members using fields the others do not can still share them. The
+ * objective field and locale are those of the first model; models with
+ * another objective field are left out.
+ */
++ (FieldResource*)sharedFieldsWithJSONModels:(NSArray*)jsonModels;
+
+/**
+ * Same as sharedFieldsWithJSONModels:, getting the models one at a time, so
+ * that each can be released before the next is read. Models the block
+ * returns nil for are skipped.
+ */
++ (FieldResource*)sharedFieldsWithModelCount:(NSUInteger)count
+                            jsonModelAtIndex:(NSDictionary*(^)(NSUInteger index))jsonModelAtIndex;
+
 /**
  * Makes a prediction based on a number of field values.
  *
@@ -68,11 +115,115 @@
  *  the maximum number of categories to be returned. If NSUIntegerMax,
  *  the entire distribution in the node will be returned.
  *
+ *        - decodedInput: YES when arguments were already decoded with
+ *                        FieldResource decodedInputData:byName:
+ *
  * This method will return an NSArray of TreePrediction objects.
+ * When predictionCache is set, results for repeated inputs are reused.
  */
 - (NSArray*)predictWithArguments:(NSDictionary*)arguments
                          options:(NSDictionary*)options;
 
+/**
+ * Formats a prediction of the model's tree as predictWithArguments:options:
+ * does, given the value of its `multiple` option.
+ */
+- (NSArray*)outputWithTreePrediction:(TreePrediction*)prediction multiple:(NSUInteger)multiple;
+
+/**
+ * Explains a prediction as contributions of the input fields, computed in
+ * the same traversal as the prediction itself. The explained value is the
+ * prediction for regressions and the probability of the predicted class for
+ * classifications: starting from its value at the root of the tree, each
+ * split on the path moves it to the value of the child taken, and the move
+ * is credited to the split field. The value at the root plus all the
+ * contributions therefore give the value at the node reached.
+ *
+ * @param arguments The input data, as in predictWithArguments:options:
+ * @param options byName, decodedInput and strategy, as in
+ *        predictWithArguments:options:
+ * @return The first result of predictWithArguments:options:, plus:
+ *         - fields: explanationFields
+ *         - contributions: one number per field, in the same order
+ *         - bias: the explained value at the root of the tree
+ */
+- (NSDictionary*)explainWithArguments:(NSDictionary*)arguments
+                              options:(NSDictionary*)options;
+
+/// the input field ids, in the order of explanation contributions
+@property (nonatomic, readonly) NSArray* explanationFields;
+
+/// the classes whose probabilities are explained, nil for regressions
+@property (nonatomic, readonly) NSArray* explanationClasses;
+
+/**
+ * The traversal of explainWithArguments:options:, for callers combining
+ * explanations, e.g. ensembles. For each of explanationFields, the changes
+ * of every explained value (each class, or the single regression output)
+ * are added to a row of `contributions`. With the Proportional strategy the
+ * path explained ends at the first split on a missing field, from which the
+ * prediction is completed as predictWithArguments:options: does.
+ *
+ * @param input Decoded input data, see FieldResource decodedInputData:byName:
+ * @param strategy How missing values are handled
+ * @param contributions explanationFields.count rows of as many values as
+ *        explanationClasses (1 for regressions)
+ * @param bias Set to the explained values at the root, or NULL
+ */
+- (TreePrediction*)explainDecodedInput:(NSDictionary*)input
+                              strategy:(BMLMissingStrategy)strategy
+                         contributions:(double*)contributions
+                                  bias:(const double**)bias;
+
+/**
+ * Updates the instrumentation counters of the model for a prediction that
+ * reached a node at the given depth, see BMLInstrumentation.
+ * @param missingBranch YES when a missing value stopped it above a leaf
+ */
+- (void)countPredictionWithDepth:(NSUInteger)depth missingBranch:(BOOL)missingBranch;
+
+/**
+ * An optional cache of prediction results, nil by default. Caches may be
+ * shared by models only when they are also shared by the same inputs and
+ * options would give the same results, so usually there is one per model.
+ * It is bypassed while recordsBranchHits is YES.
+ */
+@property (nonatomic, strong) PredictionCache* predictionCache;
+
+/// the model's decision tree. Predictions with the LastPrediction strategy
+/// walk a copy of it compiled into the model's arena, except while branch
+/// hits are recorded
+@property (nonatomic, readonly) PredictionTree* tree;
+
+/**
+ * When YES, predictions count how many times each branch of the tree is
+ * taken, so that optimizeBranchOrder can test the busiest branches first.
+ * Meant for a profiling run over representative inputs; NO by default.
+ */
+@property (nonatomic) BOOL recordsBranchHits;
+
+/**
+ * Reorders the branches of every split by the hits recorded so far (see
+ * recordsBranchHits) instead of by training instance count. Predictions are
+ * unchanged; only the number of predicates checked per row is affected.
+ * Safe to call, as is applyBranchOrder:, while other threads are predicting:
+ * each split switches to its new order at once.
+ *
+ * Both compile the tree again into a second copy in the model's arena,
+ * allocated by the first reorder and then reused, and wait for the
+ * predictions still walking the previous copy to finish. Reordering
+ * periodically therefore does not grow the model.
+ */
+- (void)optimizeBranchOrder;
+
+/**
+ * The current branch order, as a JSON-compatible dictionary that can be
+ * stored along with the model and restored with applyBranchOrder:.
+ */
+- (NSDictionary*)branchOrder;
+
+- (void)applyBranchOrder:(NSDictionary*)branchOrder;
+
 /**
  * Creates a local prediction using the model and args passed as parameters
  * @param jsonModel The model to use to create the prediction
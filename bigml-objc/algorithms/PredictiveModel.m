@@ -12,27 +12,176 @@
 // License for the specific language governing permissions and limitations
 // under the License.
 
+#import <malloc/malloc.h>
 #import "PredictiveModel.h"
 #import "TreePrediction.h"
+#import "ModelArena.h"
+#import "NSError+BMLError.h"
 #import "Predicates.h"
 #import "BMLUtils.h"
+#import "BMLInstrumentation.h"
+#import "PredictionCache.h"
 
 #define BML_DEFAULT_LOCALE @"en.US"
 
+/**
+ * A tree node compiled into the model's arena, holding the predicate that
+ * leads to it. The children of a node are stored contiguously, in their
+ * evaluation order. The node it stands for is not retained: the model keeps
+ * its tree along with the arena.
+ */
+typedef struct CompiledNode {
+    
+    CompiledPredicate predicate;
+    __unsafe_unretained PredictionTree* tree;
+    uint32_t firstChild;
+    uint32_t childCount;
+    
+} CompiledNode;
+
+static uint32_t compiledNodeCount(PredictionTree* tree) {
+    
+    uint32_t count = 1;
+    for (PredictionTree* child in tree.evaluationOrder) {
+        count += compiledNodeCount(child);
+    }
+    return count;
+}
+
+static void compileNode(CompiledNode* nodes, uint32_t index, PredictionTree* tree, uint32_t* next) {
+    
+    CompiledNode* node = nodes + index;
+    node->tree = tree;
+    if (!tree.isPredicate)
+        [tree.predicate compileInto:&node->predicate];
+    
+    NSArray* children = tree.evaluationOrder;
+    node->childCount = (uint32_t)children.count;
+    node->firstChild = *next;
+    *next += node->childCount;
+    for (uint32_t i = 0; i < node->childCount; ++i) {
+        compileNode(nodes, node->firstChild + i, children[i], next);
+    }
+}
+
 @implementation PredictiveModel {
     
     NSDictionary* fields;
     NSString* _description;
     NSMutableArray* _fieldImportance;
     PredictionTree* _tree;
-    NSMutableDictionary* _idsMap;
+    ModelArena* _arena;
+    CompiledNode* _compiledNodes;
+    CompiledNode* _compiledBuffers[2];
+    ArenaReaders _compiledReaders;
     NSInteger _maxBins;
     
     NSDictionary* _model;
+    BMLModelStats* _stats;
+    NSArray* _explanationFields;
+    NSArray* _explanationClasses;
+    NSDictionary* _explanationFieldIndexes;
+    BOOL _explanationsPrepared;
+}
+
+/**
+ * Adds the model fields missing from `fields`, completed with the summaries
+ * and names found in the dataset fields.
+ */
++ (void)addFieldsOfModel:(NSDictionary*)model toFields:(NSMutableDictionary*)fields {
+    
+    NSDictionary* modelFields = model[@"model"][@"fields"];
+    NSDictionary* inputFields = model[@"model"][@"model_fields"];
+    for (NSString* fieldName in inputFields) {
+        if (fields[fieldName])
+            continue;
+        NSMutableDictionary* field = CFBridgingRelease(CFPropertyListCreateDeepCopy(kCFAllocatorDefault,
+                                                                                    (CFDictionaryRef)inputFields[fieldName],
+                                                                                    kCFPropertyListMutableContainers));
+        NSAssert(field, @"Missing field %@", fieldName);
+        NSDictionary* modelField = modelFields[fieldName];
+        //-- older resources may come without summaries
+        if (modelField[@"summary"])
+            [field setObject:modelField[@"summary"] forKey:@"summary"];
+        if (modelField[@"name"])
+            [field setObject:modelField[@"name"] forKey:@"name"];
+        fields[fieldName] = field;
+    }
+}
+
+/**
+ * The model fields, completed with the summaries and names found in the
+ * dataset fields.
+ */
++ (NSDictionary*)fieldsOfModel:(NSDictionary*)model {
+    
+    NSMutableDictionary* fields = [NSMutableDictionary new];
+    [self addFieldsOfModel:model toFields:fields];
+    return fields;
+}
+
++ (NSString*)objectiveFieldOfModel:(NSDictionary*)model {
+    
+    id objectiveFields = model[@"objective_fields"] ?: model[@"objective_field"];
+    if ([objectiveFields isKindOfClass:[NSArray class]])
+        return [objectiveFields firstObject];
+    return objectiveFields;
+}
+
++ (FieldResource*)sharedFieldsWithJSONModel:(NSDictionary*)jsonModel {
+    
+    NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+    return [[FieldResource alloc] initWithFields:[self fieldsOfModel:model]
+                                objectiveFieldId:[self objectiveFieldOfModel:model]
+                                          locale:jsonModel[@"locale"] ?: BML_DEFAULT_LOCALE
+                                   missingTokens:nil];
+}
+
++ (FieldResource*)sharedFieldsWithJSONModels:(NSArray*)jsonModels {
+    
+    return [self sharedFieldsWithModelCount:jsonModels.count
+                           jsonModelAtIndex:^NSDictionary*(NSUInteger index) {
+                               return jsonModels[index];
+                           }];
+}
+
++ (FieldResource*)sharedFieldsWithModelCount:(NSUInteger)count
+                            jsonModelAtIndex:(NSDictionary*(^)(NSUInteger index))jsonModelAtIndex {
+    
+    NSMutableDictionary* fields = [NSMutableDictionary new];
+    NSString* objectiveField = nil;
+    NSString* locale = nil;
+    for (NSUInteger i = 0; i < count; ++i) {
+        
+        //-- members may be loaded just for this: drop each one right away
+        @autoreleasepool {
+            NSDictionary* jsonModel = jsonModelAtIndex(i);
+            if (!jsonModel)
+                continue;
+            NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+            if (!objectiveField) {
+                objectiveField = [self objectiveFieldOfModel:model];
+                locale = jsonModel[@"locale"] ?: BML_DEFAULT_LOCALE;
+            }
+            //-- a model predicting another field cannot share the fields anyway
+            if ([[self objectiveFieldOfModel:model] isEqualToString:objectiveField])
+                [self addFieldsOfModel:model toFields:fields];
+        }
+    }
+    return [[FieldResource alloc] initWithFields:fields
+                                objectiveFieldId:objectiveField
+                                          locale:locale ?: BML_DEFAULT_LOCALE
+                                   missingTokens:nil];
 }
 
 - (instancetype)initWithJSONModel:(NSDictionary*)jsonModel {
     
+    return [self initWithJSONModel:jsonModel sharedFields:nil];
+}
+
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel sharedFields:(FieldResource*)sharedFields {
+    
+    BML_STAGE_START(buildStart);
     NSString* locale;
     NSString* objectiveField;
     NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
@@ -42,32 +191,30 @@
     NSAssert([status[@"code"] intValue] == 5, @"The model is not ready");
     if ([status[@"code"] intValue] != 5)
         return nil;
-
-    fields = CFBridgingRelease(CFPropertyListCreateDeepCopy(kCFAllocatorDefault,
-                                                            (CFDictionaryRef)model[@"model"][@"model_fields"],
-                                                            kCFPropertyListMutableContainers));
-
-    NSDictionary* modelFields = model[@"model"][@"fields"];
-    for (NSString* fieldName in fields.allKeys) {
-        NSMutableDictionary* field = fields[fieldName];
-        NSAssert(field, @"Missing field %@", fieldName);
-        NSDictionary* modelField = modelFields[fieldName];
-        [field setObject:modelField[@"summary"] forKey:@"summary"];
-        [field setObject:modelField[@"name"] forKey:@"name"];
-    }
-    
-    id objectiveFields = model[@"objective_fields"];
-    if ([objectiveFields isKindOfClass:[NSArray class]])
-        objectiveField = [objectiveFields firstObject];
-    else
-        objectiveField = objectiveFields;
     
+    objectiveField = [PredictiveModel objectiveFieldOfModel:model];
     locale = jsonModel[@"locale"] ?: BML_DEFAULT_LOCALE;
     
-    if (self = [super initWithFields:fields
+    //-- the shared fields can only stand in for ours if they include them all
+    BOOL sharing = [sharedFields.objectiveFieldId isEqualToString:objectiveField];
+    for (NSString* fieldId in model[@"model"][@"model_fields"]) {
+        if (!sharing)
+            break;
+        sharing = sharedFields.fields[fieldId] != nil;
+    }
+    
+    if (sharing) {
+        fields = sharedFields.fields;
+        self = [super initWithFieldResource:sharedFields];
+    } else {
+        fields = [PredictiveModel fieldsOfModel:model];
+        self = [super initWithFields:fields
                     objectiveFieldId:objectiveField
                               locale:locale
-                       missingTokens:nil]) {
+                       missingTokens:nil];
+    }
+    
+    if (self) {
         
         _maxBins = 0;
         _model = model;
@@ -83,23 +230,135 @@
             }
         }
         
-        _idsMap = [NSMutableDictionary new];
-        _tree = [[PredictionTree alloc] initWithRoot:_model[@"model"][@"root"]
-                                              fields:self.fields
-                                      objectiveField:objectiveField
-                                    rootDistribution:jsonModel[@"model"][@"distribution"][@"training"]
-                                            parentId:nil
-                                              idsMap:_idsMap
-                                             subtree:YES
-                                             maxBins:_maxBins];
+        _stats = [BMLInstrumentation registerModelWithLabel:
+                  _model[@"resource"] ?: [NSString stringWithFormat:@"model %p", self]];
+        _arena = [ModelArena new];
+        
+        //-- the temporaries of large trees are released as soon as they are built
+        @autoreleasepool {
+            _tree = [[PredictionTree alloc] initWithRoot:_model[@"model"][@"root"]
+                                                  fields:self.fields
+                                          objectiveField:objectiveField
+                                        rootDistribution:jsonModel[@"model"][@"distribution"][@"training"]
+                                                parentId:nil
+                                                   arena:_arena
+                                                 subtree:YES
+                                                 maxBins:_maxBins];
+        }
         
         if (_tree.isRegression) {
             _maxBins = _tree.maxBins;
         }
+        [self compileTree];
+        BML_LOAD_TICKS(_stats, buildTicks, buildStart, mach_absolute_time());
+#if BML_INSTRUMENTATION
+        if (buildStart && _stats) {
+            size_t bytes = malloc_size((__bridge const void*)self) + _arena.bytesReserved;
+            _stats.load->nodes = [_tree nodeCountWithBytes:&bytes];
+            _stats.load->bytes = bytes;
+            _stats.load->compiledBytes = _arena.bytesReserved;
+        }
+#endif
     }
     return self;
 }
 
+- (instancetype)initWithJSONData:(NSData*)data error:(NSError**)error {
+    
+    BML_STAGE_START(parseStart);
+    NSDictionary* jsonModel = [NSJSONSerialization JSONObjectWithData:data options:0 error:error];
+    BML_STAGE_MARK(parseEnd, parseStart);
+    if (![jsonModel isKindOfClass:[NSDictionary class]]) {
+        if (error && !*error)
+            *error = [NSError errorWithInfo:@"Bad model format" code:-10401];
+        return nil;
+    }
+    if (self = [self initWithJSONModel:jsonModel]) {
+        BML_LOAD_TICKS(_stats, parseTicks, parseStart, parseEnd);
+    }
+    return self;
+}
+
+- (BOOL)recordsBranchHits {
+    
+    return _tree.recordsHits;
+}
+
+- (void)setRecordsBranchHits:(BOOL)recordsBranchHits {
+    
+    _tree.recordsHits = recordsBranchHits;
+}
+
+- (void)optimizeBranchOrder {
+    
+    [_tree orderChildrenByHits];
+    [self compileTree];
+}
+
+- (NSDictionary*)branchOrder {
+    
+    return [_tree childOrder];
+}
+
+- (void)applyBranchOrder:(NSDictionary*)branchOrder {
+    
+    [_tree applyChildOrder:branchOrder];
+    [self compileTree];
+}
+
+/**
+ * Lays the tree out in the arena as compiled nodes, in the current branch
+ * order. When the order changes, the tree is compiled again into the other
+ * of two buffers, and the new nodes replace the old ones at once. The node
+ * count never changes, so each buffer is allocated once; before returning,
+ * this waits for the predictions still walking the old nodes, so that the
+ * next order can be compiled over them.
+ */
+- (void)compileTree {
+    
+    @synchronized (self) {
+        uint32_t count = compiledNodeCount(_tree);
+        NSUInteger spare = _compiledNodes == _compiledBuffers[1] ? 0 : 1;
+        if (!_compiledBuffers[spare])
+            _compiledBuffers[spare] = [_arena allocate:count * sizeof(CompiledNode)];
+        CompiledNode* nodes = _compiledBuffers[spare];
+        NSAssert(nodes, @"Could not allocate the compiled tree");
+        memset(nodes, 0, count * sizeof(CompiledNode));
+        uint32_t next = 1;
+        compileNode(nodes, 0, _tree, &next);
+        __atomic_store_n(&_compiledNodes, nodes, __ATOMIC_SEQ_CST);
+        ArenaReadersWait(&_compiledReaders);
+    }
+}
+
+/**
+ * The compiled node an input reaches with the LastPrediction strategy, and
+ * its depth. The node is only valid until the caller, registered with
+ * _compiledReaders, leaves.
+ */
+- (const CompiledNode*)compiledNodeForDecodedInput:(NSDictionary*)input depth:(NSUInteger*)depth {
+    
+    const CompiledNode* nodes = __atomic_load_n(&_compiledNodes, __ATOMIC_SEQ_CST);
+    NSDictionary* modelFields = self.fields;
+    uint32_t index = 0;
+    *depth = 0;
+    BOOL descending = YES;
+    while (descending && nodes[index].childCount > 0) {
+        
+        descending = NO;
+        const CompiledNode* node = nodes + index;
+        for (uint32_t i = node->firstChild; i < node->firstChild + node->childCount; ++i) {
+            if (BMLCompiledPredicateApplies(&nodes[i].predicate, input, modelFields)) {
+                index = i;
+                ++*depth;
+                descending = YES;
+                break;
+            }
+        }
+    }
+    return nodes + index;
+}
+
 - (double)roundedConfidence:(double)confidence {
     return floor(confidence * 10000.0) / 10000.0;
 }
@@ -112,14 +371,156 @@
     NSUInteger multiple = [options[@"multiple"]?:@0 intValue];
     
     NSAssert(arguments, @"Prediction arguments missing.");
-    NSMutableArray* output = [NSMutableArray new];
     
-    arguments = [BMLUtils cast:[self filteredInputData:arguments byName:byName]
-                           fields:self.fields];
+    if (![options[@"decodedInput"] ?: @NO boolValue])
+        arguments = [self decodedInputData:arguments byName:byName];
     
-    TreePrediction* prediction = [_tree predict:arguments
-                                           path:nil
-                                       strategy:strategy];
+    if (_predictionCache && !self.recordsBranchHits) {
+        return [_predictionCache resultForInput:arguments options:options compute:^id{
+            return [self predictionWithDecodedInput:arguments strategy:strategy multiple:multiple];
+        }];
+    }
+    return [self predictionWithDecodedInput:arguments strategy:strategy multiple:multiple];
+}
+
+- (NSArray*)predictionWithDecodedInput:(NSDictionary*)arguments
+                              strategy:(BMLMissingStrategy)strategy
+                              multiple:(NSUInteger)multiple {
+    
+    BML_STAGE_START(traversalStart);
+    TreePrediction* prediction = nil;
+    NSUInteger depth = 0;
+    BOOL missingBranch = NO;
+    if (strategy == BMLMissingStrategyLastPrediction && !_tree.recordsHits) {
+        
+        //-- the compiled nodes do not build the rules of the path, which is not returned
+        unsigned int parity = ArenaReadersEnter(&_compiledReaders);
+        const CompiledNode* node = [self compiledNodeForDecodedInput:arguments depth:&depth];
+        PredictionTree* tree = node->tree;
+        missingBranch = node->childCount > 0;
+        ArenaReadersLeave(&_compiledReaders, parity);
+        prediction = [tree predictionWithPath:nil];
+    } else {
+        prediction = [_tree predict:arguments path:nil strategy:strategy];
+        depth = prediction.path.count;
+        missingBranch = strategy == BMLMissingStrategyLastPrediction && prediction.children.count > 0;
+    }
+    BML_STAGE_END(traversalStart, BMLStageTraversal);
+    [self countPredictionWithDepth:depth missingBranch:missingBranch];
+    return [self outputWithTreePrediction:prediction multiple:multiple];
+}
+
+- (void)prepareExplanations {
+    
+    if (__atomic_load_n(&_explanationsPrepared, __ATOMIC_ACQUIRE))
+        return;
+    @synchronized (self) {
+        if (_explanationsPrepared)
+            return;
+        
+        NSMutableArray* fieldIds = [self.fields.allKeys mutableCopy];
+        [fieldIds removeObject:self.objectiveFieldId];
+        [fieldIds sortUsingSelector:@selector(compare:)];
+        NSMutableDictionary* indexes = [NSMutableDictionary dictionaryWithCapacity:fieldIds.count];
+        [fieldIds enumerateObjectsUsingBlock:^(NSString* fieldId, NSUInteger i, BOOL* stop) {
+            indexes[fieldId] = @(i);
+        }];
+        _explanationFields = fieldIds;
+        _explanationFieldIndexes = indexes;
+        
+        //-- the root distribution holds every class the tree can predict
+        if (![_tree isRegression]) {
+            NSMutableArray* classes = [NSMutableArray new];
+            for (NSArray* bin in [_tree predictionWithPath:nil].distribution) {
+                [classes addObject:bin.firstObject];
+            }
+            _explanationClasses = classes;
+        }
+        [_tree prepareExplanationsWithClasses:_explanationClasses];
+        __atomic_store_n(&_explanationsPrepared, YES, __ATOMIC_RELEASE);
+    }
+}
+
+- (NSArray*)explanationFields {
+    
+    [self prepareExplanations];
+    return _explanationFields;
+}
+
+- (NSArray*)explanationClasses {
+    
+    [self prepareExplanations];
+    return _explanationClasses;
+}
+
+- (TreePrediction*)explainDecodedInput:(NSDictionary*)input
+                              strategy:(BMLMissingStrategy)strategy
+                         contributions:(double*)contributions
+                                  bias:(const double**)bias {
+    
+    [self prepareExplanations];
+    BML_STAGE_START(traversalStart);
+    PredictionTree* node = [_tree explain:input
+                             fieldIndexes:_explanationFieldIndexes
+                                  outputs:_explanationClasses ? _explanationClasses.count : 1
+                            contributions:contributions];
+    BML_STAGE_END(traversalStart, BMLStageTraversal);
+    if (bias)
+        *bias = [_tree explanationValues];
+    if (strategy == BMLMissingStrategyLastPrediction)
+        return [node predictionWithPath:nil];
+    return [node predict:input path:nil strategy:strategy];
+}
+
+- (NSDictionary*)explainWithArguments:(NSDictionary*)arguments
+                              options:(NSDictionary*)options {
+    
+    NSAssert(arguments, @"Prediction arguments missing.");
+    if (![options[@"decodedInput"] ?: @NO boolValue])
+        arguments = [self decodedInputData:arguments byName:[options[@"byName"] ?: @NO boolValue]];
+    
+    [self prepareExplanations];
+    NSUInteger fieldCount = _explanationFields.count;
+    NSUInteger outputs = _explanationClasses ? _explanationClasses.count : 1;
+    double* contributions = calloc(fieldCount * outputs, sizeof(double));
+    const double* bias = NULL;
+    BMLMissingStrategy strategy = [options[@"strategy"] ?: @(BMLMissingStrategyLastPrediction) intValue];
+    TreePrediction* prediction = [self explainDecodedInput:arguments
+                                                  strategy:strategy
+                                             contributions:contributions
+                                                      bias:&bias];
+    
+    //-- only the values of the predicted class are returned
+    NSUInteger output = 0;
+    if (_explanationClasses) {
+        output = [_explanationClasses indexOfObject:prediction.prediction];
+        NSAssert(output != NSNotFound, @"Predicted class missing from the root distribution");
+    }
+    NSMutableArray* fieldContributions = [NSMutableArray arrayWithCapacity:fieldCount];
+    for (NSUInteger i = 0; i < fieldCount; ++i) {
+        [fieldContributions addObject:@(contributions[i * outputs + output])];
+    }
+    free(contributions);
+    
+    NSMutableDictionary* explanation = [[[self outputWithTreePrediction:prediction multiple:0] firstObject] mutableCopy];
+    explanation[@"fields"] = _explanationFields;
+    explanation[@"contributions"] = fieldContributions;
+    explanation[@"bias"] = @(bias[output]);
+    return explanation;
+}
+
+- (void)countPredictionWithDepth:(NSUInteger)depth missingBranch:(BOOL)missingBranch {
+    
+    BML_COUNT(_stats, rows, 1);
+    BML_COUNT(_stats, nodesVisited, depth + 1);
+    BML_COUNT(_stats, depth, depth);
+    if (missingBranch)
+        BML_COUNT(_stats, missingBranchHits, 1);
+}
+
+- (NSArray*)outputWithTreePrediction:(TreePrediction*)prediction multiple:(NSUInteger)multiple {
+    
+    NSMutableArray* output = [NSMutableArray new];
     NSArray* distribution = [prediction distribution];
     NSDictionary* distributionDictionary = [BMLUtils dictionaryFromDistributionArray:distribution];
     long instances = prediction.count;
@@ -0,0 +1,96 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <Foundation/Foundation.h>
+#import "FieldResource.h"
+#import "BMLEnums.h"
+
+@class PredictiveModel;
+
+/**
+ * A compact, read-only form of a decision tree model for devices short on
+ * memory.
+ *
+ * The tree is flattened into an array of fixed-size nodes whose children are
+ * stored next to each other. Split thresholds are kept in single or half
+ * precision, categories are replaced by 16-bit ids and the instance counts
+ * of each node are packed as varints. Predictions follow the
+ * LastPrediction missing strategy.
+ *
+ * Since lowering the precision of the thresholds may send rows lying close
+ * to them down a different branch, accuracyAgainstModel:rows:byName: and
+ * accuracyAgainstModel:validationFile:error: report how much the
+ * predictions move away from those of the full model.
+ */
+@interface QuantizedModel : FieldResource
+
+/**
+ * @param jsonModel The model, either as a full resource or its `object` element
+ * @param precision The precision of the split thresholds. Models with
+ *        thresholds beyond the float16 range (±65504) are kept in Float32
+ *        whatever the precision asked for, see the precision property.
+ * @return The quantized model, or nil if the model is not finished, splits
+ *         on text or items fields, or has more than 65535 categories in a field
+ */
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel
+                        precision:(BMLThresholdPrecision)precision;
+
+/// the precision the thresholds are actually stored with
+@property (nonatomic, readonly) BMLThresholdPrecision precision;
+
+/// the number of tree nodes
+@property (nonatomic, readonly) NSUInteger nodeCount;
+
+/// the bytes taken by the tree, not counting the field definitions
+@property (nonatomic, readonly) NSUInteger byteSize;
+
+/**
+ * Makes a prediction based on a number of field values.
+ *
+ * @param arguments Input data to be predicted
+ * @param options Supports byName and decodedInput, as in PredictiveModel
+ * @return A dictionary with the prediction, its confidence, the instance
+ *         count and the distribution of the predicted node
+ */
+- (NSDictionary*)predictWithArguments:(NSDictionary*)arguments
+                              options:(NSDictionary*)options;
+
+/**
+ * Compares the predictions of this model with those of the full precision
+ * model it was built from.
+ *
+ * @param model The full precision model
+ * @param rows The validation rows. When they include the objective field,
+ *        the accuracy (or the mean absolute error, for regressions) of both
+ *        models is reported as well.
+ * @param byName YES when the rows are keyed by field name
+ * @return A dictionary with the number of rows, the fraction of them
+ *         where both models agree and, if known, fullAccuracy,
+ *         quantizedAccuracy and accuracyDelta, or fullMAE, quantizedMAE and
+ *         maeDelta
+ */
+- (NSDictionary*)accuracyAgainstModel:(PredictiveModel*)model
+                                 rows:(NSArray*)rows
+                               byName:(BOOL)byName;
+
+/**
+ * Same as accuracyAgainstModel:rows:byName:, over the rows of a CSV file
+ * whose header holds the field names.
+ */
+- (NSDictionary*)accuracyAgainstModel:(PredictiveModel*)model
+                       validationFile:(NSString*)path
+                                error:(NSError**)error;
+
+@end
@@ -0,0 +1,596 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import "QuantizedModel.h"
+#import "PredictiveModel.h"
+#import "BMLUtils.h"
+
+#define QM_NO_CATEGORY UINT16_MAX
+#define QM_HALF_MAX 65504.0
+
+typedef enum QMOperator {
+    
+    QMOperatorTrue = 0,
+    QMOperatorLess,
+    QMOperatorLessOrEqual,
+    QMOperatorGreater,
+    QMOperatorGreaterOrEqual,
+    QMOperatorEqual,
+    QMOperatorNotEqual,
+    QMOperatorCategoryEqual,
+    QMOperatorCategoryNotEqual,
+    QMOperatorIn,
+    QMOperatorIsNull,
+    QMOperatorIsNotNull
+    
+} QMOperator;
+
+//-- the predicate also holds when the field is missing
+#define QM_FLAG_MISSING 0x01
+
+/**
+ * A tree node, holding the predicate that leads to it. The children of a
+ * node are stored contiguously, most populated first.
+ */
+typedef struct QMNode {
+    
+    uint32_t firstChild;
+    uint32_t argument;      //-- threshold index, category id, or offset of an "in" set
+    uint32_t leaf;          //-- offset of the count and distribution in _leaves
+    uint32_t output;        //-- objective category id, or the bits of a float
+    uint16_t childCount;
+    uint16_t field;
+    uint16_t confidence;    //-- scaled to [0, UINT16_MAX]
+    uint8_t op;
+    uint8_t flags;
+    
+} QMNode;
+
+#pragma mark Half precision
+
+static uint16_t halfFromFloat(float value) {
+    
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xff;
+    int32_t exponent = (int32_t)floatExponent - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    
+    if (floatExponent == 0xff)
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 0x1f)
+        return sign | 0x7c00;
+    if (exponent <= 0) {
+        
+        //-- subnormal halves, rounding to nearest even
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            ++half;
+        return sign | half;
+    }
+    
+    //-- a carry out of the mantissa correctly bumps the exponent
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return half;
+}
+
+static float floatFromHalf(uint16_t half) {
+    
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        float value = ldexpf((float)mantissa, -24);
+        return sign ? -value : value;
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * The largest magnitude of the numeric split thresholds of a tree, to check
+ * whether they all fit in half precision.
+ */
+static double largestThresholdOfTree(NSDictionary* root) {
+    
+    double largest = 0;
+    id predicate = root[@"predicate"];
+    if ([predicate isKindOfClass:[NSDictionary class]] &&
+        [predicate[@"value"] isKindOfClass:[NSNumber class]] &&
+        ![predicate[@"operator"] hasPrefix:@"in"]) {
+        
+        largest = fabs([predicate[@"value"] doubleValue]);
+    }
+    for (NSDictionary* child in root[@"children"]) {
+        largest = MAX(largest, largestThresholdOfTree(child));
+    }
+    return largest;
+}
+
+#pragma mark Varints
+
+static void appendVarint(NSMutableData* data, uint64_t value) {
+    
+    uint8_t bytes[10];
+    NSUInteger length = 0;
+    do {
+        bytes[length] = (value & 0x7f) | (value > 0x7f ? 0x80 : 0);
+        value >>= 7;
+        ++length;
+    } while (value);
+    [data appendBytes:bytes length:length];
+}
+
+static uint64_t readVarint(const uint8_t** cursor) {
+    
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *(*cursor)++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+static uint32_t bitsOfFloat(float value) {
+    
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float floatOfBits(uint32_t bits) {
+    
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#pragma mark QuantizedModel
+
+@implementation QuantizedModel {
+    
+    BOOL _regression;
+    NSMutableData* _nodes;
+    NSMutableData* _thresholds;
+    NSMutableData* _sets;
+    NSMutableData* _leaves;
+    
+    NSMutableArray* _fieldIds;
+    NSMutableDictionary* _fieldIndexes;
+    NSMutableArray* _categoryIds;
+    NSMutableArray* _objectiveCategories;
+    NSMutableDictionary* _objectiveCategoryIds;
+}
+
+- (instancetype)initWithJSONModel:(NSDictionary*)jsonModel
+                        precision:(BMLThresholdPrecision)precision {
+    
+    NSDictionary* model = jsonModel[@"object"] ?: jsonModel;
+    if ([model[@"status"][@"code"] intValue] != 5)
+        return nil;
+    
+    if (self = [super initWithFieldResource:[PredictiveModel sharedFieldsWithJSONModel:jsonModel]]) {
+        
+        //-- thresholds beyond the half precision range would become infinite
+        NSDictionary* root = model[@"model"][@"root"];
+        if (precision == BMLThresholdPrecisionFloat16 && !(largestThresholdOfTree(root) <= QM_HALF_MAX))
+            precision = BMLThresholdPrecisionFloat32;
+        _precision = precision;
+        _regression = [self.fields[self.objectiveFieldId][@"optype"] isEqualToString:@"numeric"];
+        _nodes = [NSMutableData data];
+        _thresholds = [NSMutableData data];
+        _sets = [NSMutableData data];
+        _leaves = [NSMutableData data];
+        _fieldIds = [NSMutableArray array];
+        _fieldIndexes = [NSMutableDictionary dictionary];
+        _categoryIds = [NSMutableArray array];
+        _objectiveCategories = [NSMutableArray array];
+        _objectiveCategoryIds = [NSMutableDictionary dictionary];
+        
+        [_nodes increaseLengthBy:sizeof(QMNode)];
+        if (![self fillNode:0 withRoot:root])
+            return nil;
+    }
+    return self;
+}
+
+- (NSUInteger)nodeCount {
+    
+    return _nodes.length / sizeof(QMNode);
+}
+
+- (NSUInteger)byteSize {
+    
+    return _nodes.length + _thresholds.length + _sets.length + _leaves.length;
+}
+
+#pragma mark Building
+
+- (uint16_t)indexOfField:(NSString*)fieldId {
+    
+    NSNumber* index = _fieldIndexes[fieldId];
+    if (!index) {
+        index = @(_fieldIds.count);
+        _fieldIndexes[fieldId] = index;
+        [_fieldIds addObject:fieldId];
+        [_categoryIds addObject:[NSMutableDictionary dictionary]];
+    }
+    return index.unsignedShortValue;
+}
+
+/**
+ * The id of a category of an input field, or QM_NO_CATEGORY once all the
+ * 16-bit ids are taken.
+ */
+- (uint16_t)idOfCategory:(NSString*)category field:(uint16_t)field {
+    
+    NSMutableDictionary* ids = _categoryIds[field];
+    NSNumber* categoryId = ids[category];
+    if (!categoryId) {
+        if (ids.count >= QM_NO_CATEGORY)
+            return QM_NO_CATEGORY;
+        categoryId = @(ids.count);
+        ids[category] = categoryId;
+    }
+    return categoryId.unsignedShortValue;
+}
+
+- (uint32_t)idOfObjectiveCategory:(id)category {
+    
+    NSNumber* categoryId = _objectiveCategoryIds[category];
+    if (!categoryId) {
+        categoryId = @(_objectiveCategories.count);
+        _objectiveCategoryIds[category] = categoryId;
+        [_objectiveCategories addObject:category];
+    }
+    return categoryId.unsignedIntValue;
+}
+
+- (uint32_t)addThreshold:(double)threshold {
+    
+    if (_precision == BMLThresholdPrecisionFloat16) {
+        uint16_t half = halfFromFloat((float)threshold);
+        [_thresholds appendBytes:&half length:sizeof(half)];
+        return (uint32_t)(_thresholds.length / sizeof(half) - 1);
+    }
+    float single = (float)threshold;
+    [_thresholds appendBytes:&single length:sizeof(single)];
+    return (uint32_t)(_thresholds.length / sizeof(single) - 1);
+}
+
+- (BOOL)setPredicate:(id)predicate ofNode:(QMNode*)node {
+    
+    if ([predicate isKindOfClass:[NSNumber class]] && [predicate boolValue]) {
+        node->op = QMOperatorTrue;
+        return YES;
+    }
+    if (![predicate isKindOfClass:[NSDictionary class]] || predicate[@"term"])
+        return NO;
+    
+    NSString* op = predicate[@"operator"];
+    id value = predicate[@"value"];
+    if ([op hasSuffix:@"*"]) {
+        node->flags |= QM_FLAG_MISSING;
+        op = [op substringToIndex:op.length - 1];
+    }
+    node->field = [self indexOfField:predicate[@"field"]];
+    
+    if ([op isEqualToString:@"in"] && [value isKindOfClass:[NSArray class]]) {
+        
+        if ([value count] >= QM_NO_CATEGORY)
+            return NO;
+        node->op = QMOperatorIn;
+        node->argument = (uint32_t)(_sets.length / sizeof(uint16_t));
+        uint16_t count = (uint16_t)[value count];
+        [_sets appendBytes:&count length:sizeof(count)];
+        for (id category in value) {
+            uint16_t categoryId = [self idOfCategory:[category description] field:node->field];
+            if (categoryId == QM_NO_CATEGORY)
+                return NO;
+            [_sets appendBytes:&categoryId length:sizeof(categoryId)];
+        }
+    } else if (!value || value == [NSNull null]) {
+        
+        if ([op isEqualToString:@"="])
+            node->op = QMOperatorIsNull;
+        else if ([op isEqualToString:@"!="])
+            node->op = QMOperatorIsNotNull;
+        else
+            return NO;
+    } else if ([value isKindOfClass:[NSNumber class]]) {
+        
+        NSDictionary* operators = @{ @"<" : @(QMOperatorLess),
+                                     @"<=" : @(QMOperatorLessOrEqual),
+                                     @">" : @(QMOperatorGreater),
+                                     @">=" : @(QMOperatorGreaterOrEqual),
+                                     @"=" : @(QMOperatorEqual),
+                                     @"!=" : @(QMOperatorNotEqual) };
+        if (!operators[op])
+            return NO;
+        node->op = [operators[op] unsignedCharValue];
+        node->argument = [self addThreshold:[value doubleValue]];
+    } else if ([value isKindOfClass:[NSString class]] &&
+               ([op isEqualToString:@"="] || [op isEqualToString:@"!="])) {
+        
+        node->op = [op isEqualToString:@"="] ? QMOperatorCategoryEqual : QMOperatorCategoryNotEqual;
+        node->argument = [self idOfCategory:value field:node->field];
+        if (node->argument == QM_NO_CATEGORY)
+            return NO;
+    } else {
+        return NO;
+    }
+    return YES;
+}
+
+- (void)setLeafOfNode:(QMNode*)node withRoot:(NSDictionary*)root {
+    
+    node->leaf = (uint32_t)_leaves.length;
+    appendVarint(_leaves, [root[@"count"] unsignedLongLongValue]);
+    NSArray* distribution = root[@"distribution"];
+    appendVarint(_leaves, distribution.count);
+    for (NSArray* bin in distribution) {
+        if (_regression) {
+            uint32_t bits = bitsOfFloat([bin.firstObject floatValue]);
+            [_leaves appendBytes:&bits length:sizeof(bits)];
+        } else {
+            appendVarint(_leaves, [self idOfObjectiveCategory:bin.firstObject]);
+        }
+        appendVarint(_leaves, [bin.lastObject unsignedLongLongValue]);
+    }
+}
+
+- (BOOL)fillNode:(uint32_t)index withRoot:(NSDictionary*)root {
+    
+    QMNode node = { 0 };
+    if (![self setPredicate:root[@"predicate"] ofNode:&node])
+        return NO;
+    
+    node.output = _regression ?
+    bitsOfFloat([root[@"output"] floatValue]) : [self idOfObjectiveCategory:root[@"output"]];
+    node.confidence = (uint16_t)lround(MAX(0, MIN(1, [root[@"confidence"] doubleValue])) * UINT16_MAX);
+    [self setLeafOfNode:&node withRoot:root];
+    
+    //-- as in PredictionTree, the most populated siblings are tested first
+    NSArray* children = [root[@"children"] sortedArrayWithOptions:NSSortStable
+                                                  usingComparator:^NSComparisonResult(NSDictionary* a, NSDictionary* b) {
+                                                      return [@([b[@"count"] integerValue])
+                                                              compare:@([a[@"count"] integerValue])];
+                                                  }];
+    if (children.count > UINT16_MAX)
+        return NO;
+    node.childCount = (uint16_t)children.count;
+    node.firstChild = (uint32_t)self.nodeCount;
+    [_nodes increaseLengthBy:children.count * sizeof(QMNode)];
+    ((QMNode*)_nodes.mutableBytes)[index] = node;
+    
+    for (NSUInteger i = 0; i < children.count; ++i) {
+        if (![self fillNode:(uint32_t)(node.firstChild + i) withRoot:children[i]])
+            return NO;
+    }
+    return YES;
+}
+
+#pragma mark Predicting
+
+- (double)thresholdAtIndex:(uint32_t)index {
+    
+    if (_precision == BMLThresholdPrecisionFloat16)
+        return floatFromHalf(((const uint16_t*)_thresholds.bytes)[index]);
+    return ((const float*)_thresholds.bytes)[index];
+}
+
+- (BOOL)node:(const QMNode*)node
+matchesNumbers:(const double*)numbers
+  categories:(const uint16_t*)categories
+     present:(const BOOL*)present {
+    
+    if (node->op == QMOperatorTrue)
+        return YES;
+    
+    uint16_t field = node->field;
+    if (!present[field])
+        return (node->flags & QM_FLAG_MISSING) || node->op == QMOperatorIsNull;
+    
+    switch (node->op) {
+        case QMOperatorLess:
+            return numbers[field] < [self thresholdAtIndex:node->argument];
+        case QMOperatorLessOrEqual:
+            return numbers[field] <= [self thresholdAtIndex:node->argument];
+        case QMOperatorGreater:
+            return numbers[field] > [self thresholdAtIndex:node->argument];
+        case QMOperatorGreaterOrEqual:
+            return numbers[field] >= [self thresholdAtIndex:node->argument];
+        case QMOperatorEqual:
+            return numbers[field] == [self thresholdAtIndex:node->argument];
+        case QMOperatorNotEqual:
+            return numbers[field] != [self thresholdAtIndex:node->argument];
+        case QMOperatorCategoryEqual:
+            return categories[field] == node->argument;
+        case QMOperatorCategoryNotEqual:
+            return categories[field] != node->argument;
+        case QMOperatorIn: {
+            const uint16_t* set = (const uint16_t*)_sets.bytes + node->argument;
+            for (uint16_t i = 1; i <= set[0]; ++i) {
+                if (set[i] == categories[field])
+                    return YES;
+            }
+            return NO;
+        }
+        case QMOperatorIsNull:
+            return NO;
+        case QMOperatorIsNotNull:
+            return YES;
+    }
+    return NO;
+}
+
+- (NSDictionary*)predictWithArguments:(NSDictionary*)arguments
+                              options:(NSDictionary*)options {
+    
+    NSAssert(arguments, @"Prediction arguments missing.");
+    if (![options[@"decodedInput"] ?: @NO boolValue])
+        arguments = [self decodedInputData:arguments byName:[options[@"byName"] ?: @NO boolValue]];
+    
+    //-- encode the fields used by the tree as numbers and category ids
+    NSUInteger fieldCount = MAX(_fieldIds.count, 1);
+    double* numbers = malloc(fieldCount * sizeof(double));
+    uint16_t* categories = malloc(fieldCount * sizeof(uint16_t));
+    BOOL* present = calloc(fieldCount, sizeof(BOOL));
+    for (NSUInteger i = 0; i < _fieldIds.count; ++i) {
+        
+        id value = arguments[_fieldIds[i]];
+        numbers[i] = NAN;
+        categories[i] = QM_NO_CATEGORY;
+        if (!value)
+            continue;
+        present[i] = YES;
+        if ([value isKindOfClass:[NSNumber class]]) {
+            numbers[i] = [value doubleValue];
+        }
+        NSNumber* categoryId = _categoryIds[i][[value description]];
+        if (categoryId)
+            categories[i] = categoryId.unsignedShortValue;
+    }
+    
+    const QMNode* nodes = _nodes.bytes;
+    const QMNode* node = nodes;
+    BOOL descending = YES;
+    while (descending && node->childCount > 0) {
+        
+        descending = NO;
+        for (uint32_t i = 0; i < node->childCount; ++i) {
+            const QMNode* child = nodes + node->firstChild + i;
+            if ([self node:child matchesNumbers:numbers categories:categories present:present]) {
+                node = child;
+                descending = YES;
+                break;
+            }
+        }
+    }
+    free(numbers);
+    free(categories);
+    free(present);
+    
+    const uint8_t* cursor = (const uint8_t*)_leaves.bytes + node->leaf;
+    uint64_t count = readVarint(&cursor);
+    uint64_t bins = readVarint(&cursor);
+    NSMutableArray* distribution = [NSMutableArray arrayWithCapacity:(NSUInteger)bins];
+    for (uint64_t i = 0; i < bins; ++i) {
+        id value;
+        if (_regression) {
+            uint32_t bits;
+            memcpy(&bits, cursor, sizeof(bits));
+            cursor += sizeof(bits);
+            value = @(floatOfBits(bits));
+        } else {
+            value = _objectiveCategories[(NSUInteger)readVarint(&cursor)];
+        }
+        [distribution addObject:@[ value, @(readVarint(&cursor)) ]];
+    }
+    
+    id prediction = _regression ? @(floatOfBits(node->output)) : _objectiveCategories[node->output];
+    double confidence = (double)node->confidence / UINT16_MAX;
+    return @{ @"prediction" : prediction,
+              @"confidence" : @(floor(confidence * 10000.0) / 10000.0),
+              @"distribution" : [BMLUtils dictionaryFromDistributionArray:distribution],
+              @"count" : @(count) };
+}
+
+#pragma mark Accuracy
+
+- (NSDictionary*)accuracyAgainstModel:(PredictiveModel*)model
+                                 rows:(NSArray*)rows
+                               byName:(BOOL)byName {
+    
+    NSString* objectiveKey = byName ? self.fieldNameById[self.objectiveFieldId] : self.objectiveFieldId;
+    NSUInteger agreements = 0, labeled = 0;
+    double fullHits = 0, quantizedHits = 0;
+    
+    for (NSDictionary* row in rows) {
+        
+        NSDictionary* input = [self decodedInputData:row byName:byName];
+        id full = [[model predictWithArguments:input options:@{ @"decodedInput" : @YES }] firstObject][@"prediction"];
+        id quantized = [self predictWithArguments:input options:@{ @"decodedInput" : @YES }][@"prediction"];
+        
+        if (_regression) {
+            //-- outputs are stored in single precision
+            double expected = [full doubleValue];
+            if (fabs([quantized doubleValue] - expected) <= 1e-6 * MAX(1, fabs(expected)))
+                ++agreements;
+        } else if ([[full description] isEqualToString:[quantized description]]) {
+            ++agreements;
+        }
+        
+        id label = row[objectiveKey];
+        if (!label || label == [NSNull null] || [[label description] length] == 0)
+            continue;
+        ++labeled;
+        if (_regression) {
+            fullHits += fabs([full doubleValue] - [label doubleValue]);
+            quantizedHits += fabs([quantized doubleValue] - [label doubleValue]);
+        } else {
+            fullHits += [[full description] isEqualToString:[label description]];
+            quantizedHits += [[quantized description] isEqualToString:[label description]];
+        }
+    }
+    
+    NSMutableDictionary* report = [@{ @"rows" : @(rows.count),
+                                      @"agreement" : @(rows.count ? (double)agreements / rows.count : 1),
+                                      @"byteSize" : @(self.byteSize) } mutableCopy];
+    if (labeled > 0) {
+        if (_regression) {
+            report[@"fullMAE"] = @(fullHits / labeled);
+            report[@"quantizedMAE"] = @(quantizedHits / labeled);
+            report[@"maeDelta"] = @((quantizedHits - fullHits) / labeled);
+        } else {
+            report[@"fullAccuracy"] = @(fullHits / labeled);
+            report[@"quantizedAccuracy"] = @(quantizedHits / labeled);
+            report[@"accuracyDelta"] = @((quantizedHits - fullHits) / labeled);
+        }
+    }
+    return report;
+}
+
+- (NSDictionary*)accuracyAgainstModel:(PredictiveModel*)model
+                       validationFile:(NSString*)path
+                                error:(NSError**)error {
+    
+    NSArray* rows = [BMLUtils rowsFromCSVFile:path error:error];
+    if (!rows)
+        return nil;
+    return [self accuracyAgainstModel:model rows:rows byName:YES];
+}
+
+@end
@@ -22,4 +22,8 @@ FOUNDATION_EXPORT const unsigned char bigml_objcVersionString[];
 #import <BMLResourceTypeIdentifier.h>
 #import <BMLResourceProtocol.h>
 #import <BMLAPIConnector.h>
-#import <BMLLocalPredictions.h>
\ No newline at end of file
+#import <BMLLocalPredictions.h>
+#import <BMLInstrumentation.h>
+#import <BMLRequestMetrics.h>
+#import <BMLScoringService.h>
+#import <BMLModelHandle.h>
\ No newline at end of file
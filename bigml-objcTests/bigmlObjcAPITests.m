@@ -103,4 +103,80 @@
 }
 
 
+- (void)testEnumerateDatasets {
+    
+    NSString* name = @"testEnumerateDatasets";
+    [self runTest:name test:^(XCTestExpectation* exp) {
+        
+        NSUInteger __block pages = 0;
+        [self.connector enumerateResources:BMLResourceTypeDataset
+                                   filters:nil
+                                    fields:@[@"name", @"created"]
+                                  pageSize:1
+                                usingBlock:^(NSArray* resources, BOOL* stop) {
+                                    
+                                    XCTAssert(resources.count == 1);
+                                    id<BMLResource> resource = resources.firstObject;
+                                    XCTAssert(resource.jsonDefinition.count <= 2);
+                                    *stop = (++pages == 2);
+                                }
+                                completion:^(NSUInteger count, NSError* error) {
+                                    
+                                    XCTAssert(error == nil && count == 2 && pages == 2);
+                                    [exp fulfill];
+                                }];
+    }];
+}
+
+- (void)testDownloadDataset {
+    
+    NSString* name = @"testDownloadDataset";
+    [self runTest:name test:^(XCTestExpectation* exp) {
+        
+        NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"dataset.json"];
+        id<BMLResource> dataset = self.aDataset;
+        [self.connector downloadResource:BMLResourceTypeDataset
+                                    uuid:dataset.uuid
+                                  toFile:path
+                              completion:^(NSError* error) {
+                                  
+                                  XCTAssert(error == nil);
+                                  NSDictionary* dict =
+                                  [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:path]
+                                                                  options:0
+                                                                    error:&error];
+                                  XCTAssert([dict[@"resource"] isEqualToString:dataset.fullUuid]);
+                                  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+                                  [exp fulfill];
+                              }];
+    }];
+}
+
+- (void)testBulkCreateAndDeleteDatasets {
+    
+    NSString* name = @"testBulkCreateAndDeleteDatasets";
+    [self runTest:name test:^(XCTestExpectation* exp) {
+        
+        NSArray* requests = @[ @{ @"name" : name, @"from" : self.aSource },
+                               @{ @"name" : name, @"from" : self.aSource },
+                               @{ @"name" : name, @"from" : self.aSource } ];
+        [self.connector createResources:BMLResourceTypeDataset
+                               requests:requests
+                            parallelism:2
+                             maxRetries:3
+                             completion:^(NSArray* resources, NSDictionary* errors) {
+                                 
+                                 XCTAssert(resources.count == 3 && errors.count == 0);
+                                 [self.connector deleteResources:resources
+                                                     parallelism:2
+                                                      maxRetries:3
+                                                      completion:^(NSDictionary* errors) {
+                                                          
+                                                          XCTAssert(errors.count == 0);
+                                                          [exp fulfill];
+                                                      }];
+                             }];
+    }];
+}
+
 @end
@@ -0,0 +1,338 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "PredictiveCluster.h"
+#import "Anomaly.h"
+
+//-- Offline benchmarks of local predictions against synthetic resources.
+//--
+//-- Each scenario reports, for single-row scoring, the mean, median and 99th
+//-- percentile latency per row, and for batch scoring the mean time and the
+//-- number of heap allocations per row. The report is written as JSON to the
+//-- file named by the BML_BENCHMARK_OUTPUT environment variable, or to
+//-- bigml-benchmarks.json in the temporary directory. BML_BENCHMARK_ROWS sets
+//-- the number of rows scored by each scenario (default 1000); setting
+//-- BML_BENCHMARK_VERBOSE also logs each result as it is measured.
+
+#define BENCHMARK_DEFAULT_ROWS 1000
+#define BENCHMARK_WARMUP_ROWS 50
+
+typedef id(^BenchmarkScorer)(NSDictionary* row);
+
+#pragma mark Allocation counting
+
+static int64_t allocationCount = 0;
+static BOOL allocationCountingInstalled = NO;
+static void* (*defaultMalloc)(struct _malloc_zone_t*, size_t);
+static void* (*defaultCalloc)(struct _malloc_zone_t*, size_t, size_t);
+static void* (*defaultRealloc)(struct _malloc_zone_t*, void*, size_t);
+
+static void* countingMalloc(struct _malloc_zone_t* zone, size_t size) {
+    __sync_fetch_and_add(&allocationCount, 1);
+    return defaultMalloc(zone, size);
+}
+
+static void* countingCalloc(struct _malloc_zone_t* zone, size_t count, size_t size) {
+    __sync_fetch_and_add(&allocationCount, 1);
+    return defaultCalloc(zone, count, size);
+}
+
+static void* countingRealloc(struct _malloc_zone_t* zone, void* ptr, size_t size) {
+    __sync_fetch_and_add(&allocationCount, 1);
+    return defaultRealloc(zone, ptr, size);
+}
+
+/**
+ * Wraps the allocation functions of the default malloc zone, which Objective-C
+ * objects are allocated from, with counting versions. The zone structure is
+ * read-only on recent systems, so its protection is lifted for the update; if
+ * that fails, allocations are reported as -1.
+ */
+static BOOL updateDefaultZone(void* (*mallocFunction)(struct _malloc_zone_t*, size_t),
+                              void* (*callocFunction)(struct _malloc_zone_t*, size_t, size_t),
+                              void* (*reallocFunction)(struct _malloc_zone_t*, void*, size_t)) {
+
+    malloc_zone_t* zone = malloc_default_zone();
+    vm_address_t page = trunc_page((vm_address_t)zone);
+    vm_size_t size = round_page((vm_address_t)zone + sizeof(malloc_zone_t)) - page;
+    if (vm_protect(mach_task_self(), page, size, 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS)
+        return NO;
+
+    if (!defaultMalloc) {
+        defaultMalloc = zone->malloc;
+        defaultCalloc = zone->calloc;
+        defaultRealloc = zone->realloc;
+    }
+    zone->malloc = mallocFunction;
+    zone->calloc = callocFunction;
+    zone->realloc = reallocFunction;
+    vm_protect(mach_task_self(), page, size, 0, VM_PROT_READ);
+    return YES;
+}
+
+static void installAllocationCounting() {
+
+    if (!allocationCountingInstalled)
+        allocationCountingInstalled = updateDefaultZone(countingMalloc, countingCalloc, countingRealloc);
+}
+
+/**
+ * Puts the original allocation functions back, so that no other test runs on
+ * the counting allocator.
+ */
+static void uninstallAllocationCounting() {
+
+    if (allocationCountingInstalled &&
+        updateDefaultZone(defaultMalloc, defaultCalloc, defaultRealloc))
+        allocationCountingInstalled = NO;
+}
+
+#pragma mark Timing
+
+static double nanosecondsFromTicks(uint64_t ticks) {
+
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double)ticks * timebase.numer / timebase.denom;
+}
+
+static int compareTicks(const void* a, const void* b) {
+
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+@interface bigmlObjcBenchmarkTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcBenchmarkTests
+
+static NSMutableArray* benchmarkResults = nil;
+
++ (void)setUp {
+
+    [super setUp];
+    benchmarkResults = [NSMutableArray array];
+    installAllocationCounting();
+}
+
++ (void)tearDown {
+
+    uninstallAllocationCounting();
+    NSString* path = [[NSProcessInfo processInfo] environment][@"BML_BENCHMARK_OUTPUT"] ?:
+    [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-benchmarks.json"];
+
+    NSProcessInfo* process = [NSProcessInfo processInfo];
+    NSDictionary* report = @{ @"date" : [[NSDate date] description],
+                              @"os" : process.operatingSystemVersionString,
+                              @"processors" : @(process.activeProcessorCount),
+                              @"seed" : @(BML_TEST_SEED),
+                              @"results" : benchmarkResults };
+    NSData* data = [NSJSONSerialization dataWithJSONObject:report
+                                                   options:NSJSONWritingPrettyPrinted
+                                                     error:nil];
+    [data writeToFile:path atomically:YES];
+    if ([self isVerbose])
+        NSLog(@"Benchmark report written to %@", path);
+    [super tearDown];
+}
+
++ (BOOL)isVerbose {
+
+    return [[NSProcessInfo processInfo] environment][@"BML_BENCHMARK_VERBOSE"] != nil;
+}
+
+- (NSUInteger)rowCount {
+
+    NSUInteger rows = [[[NSProcessInfo processInfo] environment][@"BML_BENCHMARK_ROWS"] integerValue];
+    return rows ?: BENCHMARK_DEFAULT_ROWS;
+}
+
+/**
+ * Scores every row once individually, collecting per-row latencies, and once
+ * as a batch, counting allocations. The build block is timed separately.
+ */
+- (void)runBenchmark:(NSString*)name
+          parameters:(NSDictionary*)parameters
+                rows:(NSArray*)rows
+               build:(BenchmarkScorer(^)())build {
+
+    uint64_t start = mach_absolute_time();
+    BenchmarkScorer scorer = build();
+    double buildNs = nanosecondsFromTicks(mach_absolute_time() - start);
+
+    for (NSUInteger i = 0; i < MIN(BENCHMARK_WARMUP_ROWS, rows.count); ++i) {
+        @autoreleasepool {
+            XCTAssert(scorer(rows[i]) != nil);
+        }
+    }
+
+    uint64_t* latencies = malloc(rows.count * sizeof(uint64_t));
+    for (NSUInteger i = 0; i < rows.count; ++i) {
+        @autoreleasepool {
+            uint64_t t0 = mach_absolute_time();
+            scorer(rows[i]);
+            latencies[i] = mach_absolute_time() - t0;
+        }
+    }
+    uint64_t total = 0;
+    for (NSUInteger i = 0; i < rows.count; ++i)
+        total += latencies[i];
+    qsort(latencies, rows.count, sizeof(uint64_t), compareTicks);
+    double p50 = nanosecondsFromTicks(latencies[rows.count / 2]);
+    double p99 = nanosecondsFromTicks(latencies[MIN(rows.count - 1, rows.count * 99 / 100)]);
+    free(latencies);
+
+    int64_t allocations = allocationCount;
+    start = mach_absolute_time();
+    @autoreleasepool {
+        for (NSDictionary* row in rows) {
+            scorer(row);
+        }
+    }
+    double batchNs = nanosecondsFromTicks(mach_absolute_time() - start);
+    allocations = allocationCount - allocations;
+
+    NSDictionary* result =
+    @{ @"name" : name,
+       @"parameters" : parameters,
+       @"rows" : @(rows.count),
+       @"build_ns" : @(buildNs),
+       @"ns_per_row" : @(nanosecondsFromTicks(total) / rows.count),
+       @"p50_ns" : @(p50),
+       @"p99_ns" : @(p99),
+       @"batch_ns_per_row" : @(batchNs / rows.count),
+       @"allocs_per_row" : @(allocationCountingInstalled ? (double)allocations / rows.count : -1) };
+
+    @synchronized (benchmarkResults) {
+        [benchmarkResults addObject:result];
+    }
+    if ([[self class] isVerbose])
+        NSLog(@"%@ %@: %.0f ns/row (p50 %.0f, p99 %.0f), %@ allocs/row",
+              name, parameters, [result[@"ns_per_row"] doubleValue], p50, p99, result[@"allocs_per_row"]);
+}
+
+- (void)testModelBenchmarks {
+
+    for (NSNumber* depth in @[ @4, @8, @12 ]) {
+        for (NSNumber* fieldCount in @[ @8, @64 ]) {
+
+            bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+            NSDictionary* json = [generator modelWithDepth:depth.unsignedIntegerValue
+                                                fieldCount:fieldCount.unsignedIntegerValue
+                                                classCount:4];
+            NSArray* rows = [generator rowsWithCount:self.rowCount fieldCount:fieldCount.unsignedIntegerValue];
+            [self runBenchmark:@"model"
+                    parameters:@{ @"depth" : depth, @"fields" : fieldCount, @"classes" : @4 }
+                          rows:rows
+                         build:^BenchmarkScorer() {
+
+                             PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+                             return ^id(NSDictionary* row) {
+                                 return [model predictWithArguments:row options:nil].firstObject;
+                             };
+                         }];
+        }
+    }
+}
+
+- (void)testEnsembleBenchmarks {
+
+    for (NSNumber* modelCount in @[ @10, @50 ]) {
+        for (NSNumber* earlyTermination in @[ @NO, @YES ]) {
+
+            bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+            NSArray* models = [generator ensembleWithModelCount:modelCount.unsignedIntegerValue
+                                                          depth:8
+                                                     fieldCount:16
+                                                     classCount:4];
+            NSArray* rows = [generator rowsWithCount:self.rowCount fieldCount:16];
+            NSDictionary* options = @{ @"earlyTermination" : earlyTermination };
+            [self runBenchmark:@"ensemble"
+                    parameters:@{ @"models" : modelCount,
+                                  @"depth" : @8,
+                                  @"fields" : @16,
+                                  @"classes" : @4,
+                                  @"earlyTermination" : earlyTermination }
+                          rows:rows
+                         build:^BenchmarkScorer() {
+
+                             PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:models
+                                                                                             maxModels:0
+                                                                                         distributions:nil];
+                             return ^id(NSDictionary* row) {
+                                 return [ensemble predictWithArguments:row options:options];
+                             };
+                         }];
+        }
+    }
+}
+
+- (void)testAnomalyBenchmarks {
+
+    for (NSNumber* treeCount in @[ @32, @128 ]) {
+        for (NSNumber* depth in @[ @6, @10 ]) {
+
+            bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+            NSDictionary* json = [generator anomalyWithTreeCount:treeCount.unsignedIntegerValue
+                                                           depth:depth.unsignedIntegerValue
+                                                      fieldCount:16];
+            NSArray* rows = [generator rowsWithCount:self.rowCount fieldCount:16];
+            [self runBenchmark:@"anomaly"
+                    parameters:@{ @"trees" : treeCount, @"depth" : depth, @"fields" : @16 }
+                          rows:rows
+                         build:^BenchmarkScorer() {
+
+                             Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:json];
+                             return ^id(NSDictionary* row) {
+                                 return @([anomaly score:row options:nil]);
+                             };
+                         }];
+        }
+    }
+}
+
+- (void)testClusterBenchmarks {
+
+    for (NSNumber* centroidCount in @[ @8, @64 ]) {
+        for (NSNumber* fieldCount in @[ @8, @64 ]) {
+
+            bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+            NSDictionary* json = [generator clusterWithCentroidCount:centroidCount.unsignedIntegerValue
+                                                          fieldCount:fieldCount.unsignedIntegerValue];
+            NSArray* rows = [generator rowsWithCount:self.rowCount fieldCount:fieldCount.unsignedIntegerValue];
+            [self runBenchmark:@"cluster"
+                    parameters:@{ @"centroids" : centroidCount, @"fields" : fieldCount }
+                          rows:rows
+                         build:^BenchmarkScorer() {
+
+                             PredictiveCluster* cluster = [[PredictiveCluster alloc] initWithCluster:json];
+                             return ^id(NSDictionary* row) {
+                                 return [cluster predictWithArguments:row options:nil];
+                             };
+                         }];
+        }
+    }
+}
+
+@end
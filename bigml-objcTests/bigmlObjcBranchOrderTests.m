@@ -0,0 +1,115 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "Anomaly.h"
+
+#define BRANCH_TEST_ROWS 300
+
+@interface bigmlObjcBranchOrderTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcBranchOrderTests
+
+- (id)roundTrip:(id)object {
+
+    NSData* data = [NSJSONSerialization dataWithJSONObject:object options:0 error:nil];
+    return [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+}
+
+- (void)testModelBranchOrder {
+
+    NSDictionary* json = [self.generator modelWithDepth:8 fieldCount:6 classCount:4];
+    NSArray* rows = [self.generator rowsWithCount:BRANCH_TEST_ROWS fieldCount:6];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+
+    NSMutableArray* expected = [NSMutableArray array];
+    model.recordsBranchHits = YES;
+    for (NSDictionary* row in rows) {
+        [expected addObject:[[model predictWithArguments:row options:nil] firstObject]];
+    }
+    model.recordsBranchHits = NO;
+    NSDictionary* trainingOrder = [model branchOrder];
+    [model optimizeBranchOrder];
+    NSDictionary* trafficOrder = [self roundTrip:[model branchOrder]];
+    XCTAssert(trafficOrder.count == trainingOrder.count);
+
+    //-- a fresh model restored with the learned order predicts the same
+    PredictiveModel* restored = [[PredictiveModel alloc] initWithJSONModel:json];
+    [restored applyBranchOrder:trafficOrder];
+    XCTAssertEqualObjects([restored branchOrder], trafficOrder);
+    [rows enumerateObjectsUsingBlock:^(NSDictionary* row, NSUInteger i, BOOL* stop) {
+        XCTAssertEqualObjects([[restored predictWithArguments:row options:nil] firstObject],
+                              expected[i]);
+    }];
+}
+
+- (void)testAnomalyBranchOrder {
+
+    NSDictionary* json = [self.generator anomalyWithTreeCount:16 depth:8 fieldCount:6];
+    NSArray* rows = [self.generator rowsWithCount:BRANCH_TEST_ROWS fieldCount:6];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:json];
+
+    NSMutableArray* expected = [NSMutableArray array];
+    anomaly.recordsBranchHits = YES;
+    for (NSDictionary* row in rows) {
+        [expected addObject:@([anomaly score:row options:@{}])];
+    }
+    anomaly.recordsBranchHits = NO;
+    [anomaly optimizeBranchOrder];
+
+    Anomaly* restored = [[Anomaly alloc] initWithJSONAnomaly:json];
+    [restored applyBranchOrder:[self roundTrip:[anomaly branchOrder]]];
+    XCTAssertEqualObjects([restored branchOrder], [anomaly branchOrder]);
+    [rows enumerateObjectsUsingBlock:^(NSDictionary* row, NSUInteger i, BOOL* stop) {
+        XCTAssertEqualWithAccuracy([restored score:row options:@{}], [expected[i] doubleValue], 1e-12);
+    }];
+}
+
+- (void)testStoredBranchOrder {
+
+    NSDictionary* json = [self modelFixtureNamed:@"iris.model"];
+    NSDictionary* jsonAnomaly = [self JSONFixtureNamed:@"testAnomaly.json"];
+    NSArray* rows = [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:nil];
+    NSDictionary* options = @{ @"byName" : @YES };
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+
+    NSMutableArray* predictions = [NSMutableArray array];
+    NSMutableArray* scores = [NSMutableArray array];
+    model.recordsBranchHits = YES;
+    anomaly.recordsBranchHits = YES;
+    for (NSDictionary* row in rows) {
+        [predictions addObject:[[model predictWithArguments:row options:options] firstObject]];
+        [scores addObject:@([anomaly score:row options:options])];
+    }
+    model.recordsBranchHits = NO;
+    anomaly.recordsBranchHits = NO;
+    [model optimizeBranchOrder];
+    [anomaly optimizeBranchOrder];
+
+    PredictiveModel* restored = [[PredictiveModel alloc] initWithJSONModel:json];
+    [restored applyBranchOrder:[self roundTrip:[model branchOrder]]];
+    Anomaly* restoredAnomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+    [restoredAnomaly applyBranchOrder:[self roundTrip:[anomaly branchOrder]]];
+    [rows enumerateObjectsUsingBlock:^(NSDictionary* row, NSUInteger i, BOOL* stop) {
+        XCTAssertEqualObjects([[restored predictWithArguments:row options:options] firstObject], predictions[i]);
+        XCTAssertEqualWithAccuracy([restoredAnomaly score:row options:options], [scores[i] doubleValue], 1e-12);
+    }];
+}
+
+@end
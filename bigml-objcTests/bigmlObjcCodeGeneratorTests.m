@@ -0,0 +1,158 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "bigmlObjcTestCredentials.h"
+#import "ModelCodeGenerator.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "Anomaly.h"
+
+#define CODEGEN_TEST_ROWS 200
+#define CODEGEN_COMPILER @"/usr/bin/cc"
+
+@interface bigmlObjcCodeGeneratorTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+@implementation bigmlObjcCodeGeneratorTests
+
+- (void)setUp {
+
+    [super setUp];
+    self.rows = [self.generator rowsWithCount:CODEGEN_TEST_ROWS fieldCount:8];
+}
+
+/**
+ * Compiles and runs a harness when a C compiler is available, which is
+ * the case for the OS X test host but not on devices.
+ */
+- (void)checkHarness:(NSString*)harness name:(NSString*)name {
+
+    XCTAssert([harness containsString:@"int main(void)"]);
+    if (![[NSFileManager defaultManager] isExecutableFileAtPath:CODEGEN_COMPILER])
+        return;
+
+    NSString* directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-codegen"];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    NSString* sourcePath = [directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"c"]];
+    NSString* programPath = [directory stringByAppendingPathComponent:name];
+    XCTAssert([harness writeToFile:sourcePath atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    NSTask* compiler = [NSTask launchedTaskWithLaunchPath:CODEGEN_COMPILER
+                                                arguments:@[ @"-std=c99", @"-O1", @"-o", programPath,
+                                                             sourcePath, @"-lm" ]];
+    [compiler waitUntilExit];
+    XCTAssertEqual(compiler.terminationStatus, 0);
+
+    NSTask* program = [NSTask launchedTaskWithLaunchPath:programPath arguments:@[]];
+    [program waitUntilExit];
+    XCTAssertEqual(program.terminationStatus, 0);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+}
+
+- (void)testModel {
+
+    NSDictionary* jsonModel = [self.generator modelWithDepth:8 fieldCount:8 classCount:3];
+    ModelCodeGenerator* codeGenerator = [[ModelCodeGenerator alloc] initWithJSONModel:jsonModel
+                                                                         functionName:@"synthetic_model"];
+    XCTAssertNotNil(codeGenerator);
+    XCTAssert(codeGenerator.classes.count == 3);
+    XCTAssert(codeGenerator.inputFields.count > 0 && codeGenerator.inputFields.count <= 8);
+    XCTAssert([codeGenerator.source containsString:
+               @"int synthetic_model(const double* numbers, const char* const* strings, double* confidence)"]);
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+    [self checkHarness:[codeGenerator harnessSourceWithPredictor:model rows:self.rows byName:NO]
+                  name:@"model"];
+}
+
+- (void)testEnsemble {
+
+    NSArray* models = [self.generator ensembleWithModelCount:9 depth:6 fieldCount:8 classCount:3];
+    ModelCodeGenerator* codeGenerator = [[ModelCodeGenerator alloc] initWithJSONModels:models
+                                                                          functionName:@"synthetic_ensemble"];
+    XCTAssertNotNil(codeGenerator);
+    XCTAssert([codeGenerator.source containsString:@"synthetic_ensemble_tree8("]);
+
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    [self checkHarness:[codeGenerator harnessSourceWithPredictor:ensemble rows:self.rows byName:NO]
+                  name:@"ensemble"];
+}
+
+- (void)testAnomaly {
+
+    NSDictionary* jsonAnomaly = [self.generator anomalyWithTreeCount:16 depth:6 fieldCount:8];
+    ModelCodeGenerator* codeGenerator = [[ModelCodeGenerator alloc] initWithJSONAnomaly:jsonAnomaly
+                                                                           functionName:@"synthetic_anomaly"];
+    XCTAssertNotNil(codeGenerator);
+    XCTAssertNil(codeGenerator.classes);
+
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+    [self checkHarness:[codeGenerator harnessSourceWithPredictor:anomaly rows:self.rows byName:NO]
+                  name:@"anomaly"];
+}
+
+- (void)testUnsupported {
+
+    NSDictionary* jsonModel = [self.generator modelWithDepth:2 fieldCount:4 classCount:2];
+    XCTAssertNil([[ModelCodeGenerator alloc] initWithJSONModel:jsonModel functionName:@"not a name"]);
+
+    NSMutableDictionary* unfinished = [jsonModel[@"object"] mutableCopy];
+    unfinished[@"status"] = @{ @"code" : @3 };
+    XCTAssertNil([[ModelCodeGenerator alloc] initWithJSONModel:@{ @"object" : unfinished } functionName:@"model"]);
+}
+
+- (void)testStoredResources {
+
+    NSDictionary* iris = [self modelFixtureNamed:@"iris.model"];
+    ModelCodeGenerator* irisGenerator = [[ModelCodeGenerator alloc] initWithJSONModel:iris functionName:@"iris"];
+    XCTAssert(irisGenerator.classes.count == 3);
+    NSError* error = nil;
+    NSString* harness = [irisGenerator harnessSourceWithPredictor:[[PredictiveModel alloc] initWithJSONModel:iris]
+                                                          CSVFile:pathForResource(@"iris.csv")
+                                                            error:&error];
+    XCTAssert(harness && !error);
+    [self checkHarness:harness name:@"iris"];
+
+    //-- categorical splits compare strings, missing values included
+    NSDictionary* spam = [self modelFixtureNamed:@"spam.model"];
+    ModelCodeGenerator* spamGenerator = [[ModelCodeGenerator alloc] initWithJSONModel:spam functionName:@"spam"];
+    XCTAssertNotNil(spamGenerator);
+    NSArray* messages = @[ @{ @"Message" : spam[@"model"][@"root"][@"children"][0][@"predicate"][@"value"] },
+                           @{ @"Message" : @"Ok lar... Joking wif u oni..." },
+                           @{} ];
+    [self checkHarness:[spamGenerator harnessSourceWithPredictor:[[PredictiveModel alloc] initWithJSONModel:spam]
+                                                            rows:messages
+                                                          byName:YES]
+                  name:@"spam"];
+
+    NSDictionary* jsonAnomaly = [self JSONFixtureNamed:@"testAnomaly.json"];
+    ModelCodeGenerator* anomalyGenerator = [[ModelCodeGenerator alloc] initWithJSONAnomaly:jsonAnomaly
+                                                                              functionName:@"iris_anomaly"];
+    XCTAssertNotNil(anomalyGenerator);
+    [self checkHarness:[anomalyGenerator harnessSourceWithPredictor:[[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly]
+                                                               rows:[self rowsOfCSVFixtureNamed:@"iris.csv"
+                                                                                excludingColumn:nil]
+                                                             byName:YES]
+                  name:@"iris_anomaly"];
+}
+
+@end
@@ -0,0 +1,531 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveEnsemble.h"
+#import "Anomaly.h"
+#import "PredictiveGroup.h"
+#import "PredictiveModel.h"
+#import "BMLEnums.h"
+
+#define ENSEMBLE_TEST_MODELS 51
+#define ENSEMBLE_TEST_ROWS 200
+
+//-- a member source counting how many times members are read
+@interface bigmlObjcCountingMemberSource : NSObject <EnsembleMemberSource>
+
+@property (nonatomic, readonly) NSUInteger loads;
+
+- (instancetype)initWithModels:(NSArray*)models;
+
+@end
+
+@implementation bigmlObjcCountingMemberSource {
+
+    NSArray* _models;
+    NSUInteger _loads;
+}
+
+- (instancetype)initWithModels:(NSArray*)models {
+
+    if (self = [super init]) {
+        _models = models;
+    }
+    return self;
+}
+
+- (NSUInteger)memberCount {
+    return _models.count;
+}
+
+- (NSUInteger)loads {
+    return __atomic_load_n(&_loads, __ATOMIC_RELAXED);
+}
+
+- (NSDictionary*)memberAtIndex:(NSUInteger)index {
+
+    __atomic_fetch_add(&_loads, 1, __ATOMIC_RELAXED);
+    return _models[index];
+}
+
+@end
+
+@interface bigmlObjcEnsemblePredictionTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) NSArray* models;
+@property (nonatomic, strong) PredictiveEnsemble* ensemble;
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+@implementation bigmlObjcEnsemblePredictionTests
+
+- (void)setUp {
+
+    [super setUp];
+    NSArray* models = [self.generator ensembleWithModelCount:ENSEMBLE_TEST_MODELS
+                                                  depth:6
+                                             fieldCount:8
+                                             classCount:3];
+    self.models = models;
+    self.ensemble = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    self.rows = [self.generator rowsWithCount:ENSEMBLE_TEST_ROWS fieldCount:8];
+}
+
+- (void)checkEarlyTerminationWithOptions:(NSDictionary*)options {
+
+    NSMutableDictionary* earlyOptions = [options mutableCopy];
+    earlyOptions[@"earlyTermination"] = @YES;
+    NSMutableArray* order = [NSMutableArray array];
+    for (NSUInteger i = ENSEMBLE_TEST_MODELS; i > 0; --i) {
+        [order addObject:@(i - 1)];
+    }
+
+    NSUInteger evaluated = 0;
+    for (NSDictionary* row in self.rows) {
+
+        NSDictionary* full = [self.ensemble predictWithArguments:row options:options];
+        NSDictionary* early = [self.ensemble predictWithArguments:row options:earlyOptions];
+        XCTAssertEqualObjects(full[@"prediction"], early[@"prediction"]);
+        XCTAssert([early[@"evaluatedMembers"] unsignedIntegerValue] <= ENSEMBLE_TEST_MODELS);
+        evaluated += [early[@"evaluatedMembers"] unsignedIntegerValue];
+
+        //-- the evaluation order must not affect the outcome, ties included
+        earlyOptions[@"memberOrder"] = order;
+        XCTAssertEqualObjects(full[@"prediction"],
+                              [self.ensemble predictWithArguments:row options:earlyOptions][@"prediction"]);
+
+        //-- members left out of a partial order still vote, after the listed ones
+        earlyOptions[@"memberOrder"] = [order subarrayWithRange:NSMakeRange(0, 5)];
+        XCTAssertEqualObjects(full[@"prediction"],
+                              [self.ensemble predictWithArguments:row options:earlyOptions][@"prediction"]);
+        NSMutableDictionary* allOptions = [options mutableCopy];
+        allOptions[@"memberOrder"] = earlyOptions[@"memberOrder"];
+        allOptions[@"treeBudget"] = @(ENSEMBLE_TEST_MODELS);
+        NSDictionary* all = [self.ensemble predictWithArguments:row options:allOptions];
+        XCTAssert([all[@"evaluatedMembers"] unsignedIntegerValue] == ENSEMBLE_TEST_MODELS);
+        XCTAssertEqualObjects(all[@"prediction"], full[@"prediction"]);
+        XCTAssertEqualWithAccuracy([all[@"confidence"] doubleValue], [full[@"confidence"] doubleValue], 1e-12);
+        [earlyOptions removeObjectForKey:@"memberOrder"];
+    }
+    XCTAssert(evaluated < ENSEMBLE_TEST_MODELS * ENSEMBLE_TEST_ROWS);
+}
+
+- (void)testEarlyTerminationPlurality {
+
+    [self checkEarlyTerminationWithOptions:@{ @"method" : @(BMLPredictionMethodPlurality) }];
+}
+
+- (void)testEarlyTerminationThreshold {
+
+    [self checkEarlyTerminationWithOptions:@{ @"method" : @(BMLPredictionMethodThreshold),
+                                              @"threshold-k" : @20,
+                                              @"threshold-category" : @"class 0" }];
+}
+
+- (void)testEarlyTerminationTies {
+
+    //-- two members voting for each of two classes, so that every row ends in a tie
+    NSDictionary* row = self.rows.firstObject;
+    NSMutableDictionary* modelsByClass = [NSMutableDictionary dictionary];
+    for (NSDictionary* model in self.models) {
+        id prediction = [[[[PredictiveModel alloc] initWithJSONModel:model]
+                          predictWithArguments:row options:nil] firstObject][@"prediction"];
+        if (!modelsByClass[prediction])
+            modelsByClass[prediction] = [NSMutableArray array];
+        [modelsByClass[prediction] addObject:model];
+    }
+    NSMutableArray* classes = [NSMutableArray array];
+    for (id category in modelsByClass) {
+        if ([modelsByClass[category] count] >= 2)
+            [classes addObject:category];
+    }
+    XCTAssert(classes.count >= 2);
+    NSArray* x = modelsByClass[classes[0]];
+    NSArray* y = modelsByClass[classes[1]];
+
+    //-- the tie goes to member 0's class even when its first vote is cast last
+    PredictiveEnsemble* tied = [[PredictiveEnsemble alloc] initWithModels:@[ x[0], y[0], y[1], x[1] ]
+                                                                maxModels:0
+                                                            distributions:nil];
+    NSDictionary* full = [tied predictWithArguments:row options:nil];
+    XCTAssertEqualObjects(full[@"prediction"], classes[0]);
+    NSDictionary* early = [tied predictWithArguments:row
+                                             options:@{ @"earlyTermination" : @YES,
+                                                        @"memberOrder" : @[ @3, @1, @2, @0 ] }];
+    XCTAssertEqualObjects(early[@"prediction"], full[@"prediction"]);
+    XCTAssert([early[@"evaluatedMembers"] unsignedIntegerValue] == 4);
+
+    //-- a tie the last member could only force is already won by the lowest index
+    PredictiveEnsemble* decided = [[PredictiveEnsemble alloc] initWithModels:@[ x[0], y[0], x[1], y[1] ]
+                                                                   maxModels:0
+                                                               distributions:nil];
+    early = [decided predictWithArguments:row options:@{ @"earlyTermination" : @YES }];
+    XCTAssertEqualObjects(early[@"prediction"], [decided predictWithArguments:row options:nil][@"prediction"]);
+    XCTAssertEqualObjects(early[@"prediction"], classes[0]);
+    XCTAssert([early[@"evaluatedMembers"] unsignedIntegerValue] == 3);
+}
+
+- (void)testTreeBudget {
+
+    for (NSDictionary* row in self.rows) {
+
+        NSDictionary* partial = [self.ensemble predictWithArguments:row options:@{ @"treeBudget" : @5 }];
+        XCTAssert([partial[@"evaluatedMembers"] unsignedIntegerValue] == 5);
+        double decisionConfidence = [partial[@"decisionConfidence"] doubleValue];
+        XCTAssert(decisionConfidence >= 0 && decisionConfidence <= 1);
+
+        NSDictionary* all = [self.ensemble predictWithArguments:row
+                                                        options:@{ @"treeBudget" : @(ENSEMBLE_TEST_MODELS) }];
+        XCTAssertEqualObjects(all[@"prediction"], [self.ensemble predictWithArguments:row options:@{}][@"prediction"]);
+        XCTAssert(all[@"decisionConfidence"] == nil);
+    }
+}
+
+- (void)testTimeBudget {
+
+    for (NSDictionary* row in self.rows) {
+
+        //-- decoding the input alone exhausts the budget: no member is evaluated
+        NSDictionary* result = [self.ensemble predictWithArguments:row options:@{ @"timeBudget" : @1e-9 }];
+        XCTAssert([result[@"evaluatedMembers"] unsignedIntegerValue] == 0);
+        XCTAssert(result[@"prediction"] == nil);
+
+        NSDictionary* relaxed = [self.ensemble predictWithArguments:row options:@{ @"timeBudget" : @60 }];
+        XCTAssert([relaxed[@"evaluatedMembers"] unsignedIntegerValue] == ENSEMBLE_TEST_MODELS);
+        XCTAssertEqualObjects(relaxed[@"prediction"], [self.ensemble predictWithArguments:row options:@{}][@"prediction"]);
+    }
+}
+
+- (void)testAnomalyBudget {
+
+    bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[generator anomalyWithTreeCount:64
+                                                                                      depth:8
+                                                                                 fieldCount:8]];
+    for (NSDictionary* row in [generator rowsWithCount:ENSEMBLE_TEST_ROWS fieldCount:8]) {
+
+        double score = [anomaly score:row options:@{}];
+        NSDictionary* full = [anomaly scoreWithBudget:row options:@{}];
+        XCTAssertEqualWithAccuracy([full[@"score"] doubleValue], score, 1e-12);
+        XCTAssert([full[@"evaluatedTrees"] unsignedIntegerValue] == 64 && [full[@"scoreError"] doubleValue] == 0);
+
+        NSDictionary* partial = [anomaly scoreWithBudget:row options:@{ @"treeBudget" : @16 }];
+        XCTAssert([partial[@"evaluatedTrees"] unsignedIntegerValue] == 16);
+        XCTAssert([partial[@"scoreError"] doubleValue] >= 0);
+
+        NSDictionary* hurried = [anomaly scoreWithBudget:row options:@{ @"timeBudget" : @1e-9 }];
+        XCTAssert([hurried[@"evaluatedTrees"] unsignedIntegerValue] == 0);
+        XCTAssert(hurried[@"score"] == nil);
+
+        NSDictionary* relaxed = [anomaly scoreWithBudget:row options:@{ @"timeBudget" : @60 }];
+        XCTAssert([relaxed[@"evaluatedTrees"] unsignedIntegerValue] == 64);
+    }
+}
+
+- (void)testPredictiveGroup {
+
+    bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[generator modelWithDepth:6
+                                                                                      fieldCount:8
+                                                                                      classCount:3]];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[generator anomalyWithTreeCount:16
+                                                                                      depth:6
+                                                                                 fieldCount:8]];
+    PredictiveGroup* group = [[PredictiveGroup alloc] initWithPredictors:@[ model, self.ensemble, anomaly ]];
+
+    for (NSDictionary* row in self.rows) {
+
+        NSArray* results = [group predictWithArguments:row options:nil];
+        XCTAssert(results.count == 3);
+        XCTAssertEqualObjects(results[0][@"prediction"],
+                              [[model predictWithArguments:row options:nil] firstObject][@"prediction"]);
+        XCTAssertEqualObjects(results[1][@"prediction"],
+                              [self.ensemble predictWithArguments:row options:nil][@"prediction"]);
+        XCTAssertEqualWithAccuracy([results[2][@"score"] doubleValue], [anomaly score:row options:nil], 1e-12);
+    }
+}
+
+- (void)testConcurrentFirstUse {
+
+    //-- members are built lazily, here by many threads at once
+    PredictiveEnsemble* fresh = [[PredictiveEnsemble alloc] initWithModels:self.models
+                                                                 maxModels:0
+                                                             distributions:nil];
+    NSMutableArray* expected = [NSMutableArray arrayWithCapacity:self.rows.count];
+    for (NSDictionary* row in self.rows) {
+        [expected addObject:[self.ensemble predictWithArguments:row options:nil]];
+    }
+    __block NSUInteger mismatches = 0;
+    dispatch_apply(self.rows.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (![[fresh predictWithArguments:self.rows[i] options:nil] isEqualToDictionary:expected[i]]) {
+            @synchronized (self) {
+                ++mismatches;
+            }
+        }
+    });
+    XCTAssert(mismatches == 0);
+}
+
+- (void)testSharedFields {
+
+    bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+    NSArray* models = [generator ensembleWithModelCount:2 depth:6 fieldCount:8 classCount:3];
+    FieldResource* sharedFields = [PredictiveModel sharedFieldsWithJSONModel:models[0]];
+
+    PredictiveModel* shared = [[PredictiveModel alloc] initWithJSONModel:models[1] sharedFields:sharedFields];
+    PredictiveModel* own = [[PredictiveModel alloc] initWithJSONModel:models[1]];
+    XCTAssert(shared.fields == sharedFields.fields && own.fields != sharedFields.fields);
+    XCTAssertEqualObjects(shared.fieldIdByName, own.fieldIdByName);
+    for (NSDictionary* row in self.rows) {
+        XCTAssertEqualObjects([[shared predictWithArguments:row options:nil] firstObject],
+                              [[own predictWithArguments:row options:nil] firstObject]);
+    }
+}
+
+- (void)testMembersWithDifferentFields {
+
+    //-- a first member only listing the fields it splits on, unlike the rest
+    NSDictionary* first = [[[self class] seededGenerator] modelWithDepth:1 fieldCount:8 classCount:3];
+    NSDictionary* object = first[@"object"];
+    NSDictionary* root = object[@"model"][@"root"];
+    NSString* splitField = [root[@"children"] firstObject][@"predicate"][@"field"];
+    NSString* objectiveField = [object[@"objective_fields"] firstObject];
+    NSMutableDictionary* fields = [NSMutableDictionary dictionary];
+    for (NSString* fieldId in @[ splitField, objectiveField ]) {
+        fields[fieldId] = object[@"model"][@"model_fields"][fieldId];
+    }
+    NSMutableDictionary* restrictedObject = [object mutableCopy];
+    restrictedObject[@"model"] = @{ @"model_fields" : fields, @"fields" : fields, @"root" : root };
+    NSDictionary* restricted = @{ @"resource" : first[@"resource"], @"object" : restrictedObject };
+
+    NSArray* members = [@[ first ] arrayByAddingObjectsFromArray:self.models];
+    NSArray* restrictedMembers = [@[ restricted ] arrayByAddingObjectsFromArray:self.models];
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:members
+                                                                    maxModels:0
+                                                                distributions:nil];
+    PredictiveEnsemble* restrictedEnsemble = [[PredictiveEnsemble alloc] initWithModels:restrictedMembers
+                                                                              maxModels:0
+                                                                          distributions:nil];
+    XCTAssert(restrictedEnsemble.sharedFields.fields.count == ensemble.sharedFields.fields.count);
+    for (NSDictionary* row in self.rows) {
+        XCTAssertEqualObjects([restrictedEnsemble predictWithArguments:row options:@{ @"distribution" : @YES }],
+                              [ensemble predictWithArguments:row options:@{ @"distribution" : @YES }]);
+    }
+}
+
+- (void)testBinnedForest {
+
+    PredictiveEnsemble* binned = [[PredictiveEnsemble alloc] initWithModels:self.models
+                                                                  maxModels:0
+                                                              distributions:nil];
+    [binned compileBinnedForest];
+    XCTAssert(binned.isBinned && !self.ensemble.isBinned);
+
+    NSArray* optionSets = @[ @{},
+                             @{ @"method" : @(BMLPredictionMethodConfidence), @"distribution" : @YES },
+                             @{ @"earlyTermination" : @YES } ];
+    for (NSDictionary* row in self.rows) {
+
+        //-- also with a field missing, which only some branches accept
+        NSMutableDictionary* partial = [row mutableCopy];
+        [partial removeObjectForKey:[bigmlObjcSyntheticModels fieldIdAtIndex:0]];
+        for (NSDictionary* input in @[ row, partial ]) {
+            for (NSDictionary* options in optionSets) {
+                XCTAssertEqualObjects([binned predictWithArguments:input options:options],
+                                      [self.ensemble predictWithArguments:input options:options]);
+            }
+        }
+    }
+}
+
+- (void)testPredictWithRows {
+
+    NSArray* optionSets = @[ @{},
+                             @{ @"method" : @(BMLPredictionMethodProbability), @"distribution" : @YES },
+                             @{ @"strategy" : @(BMLMissingStrategyProportional) },
+                             @{ @"earlyTermination" : @YES } ];
+    PredictiveEnsemble* binned = [[PredictiveEnsemble alloc] initWithModels:self.models
+                                                                  maxModels:0
+                                                              distributions:nil];
+    [binned compileBinnedForest];
+    for (NSDictionary* options in optionSets) {
+
+        NSArray* batch = [self.ensemble predictWithRows:self.rows options:options];
+        NSArray* binnedBatch = [binned predictWithRows:self.rows options:options];
+        XCTAssert(batch.count == self.rows.count);
+        [self.rows enumerateObjectsUsingBlock:^(NSDictionary* row, NSUInteger i, BOOL* stop) {
+            NSDictionary* single = [self.ensemble predictWithArguments:row options:options];
+            XCTAssertEqualObjects(batch[i], single);
+            XCTAssertEqualObjects(binnedBatch[i], single);
+        }];
+    }
+}
+
+- (void)testMemberSource {
+
+    NSString* directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-ensemble-members"];
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    [self.models enumerateObjectsUsingBlock:^(NSDictionary* model, NSUInteger i, BOOL* stop) {
+        NSString* path = [directory stringByAppendingPathComponent:
+                          [NSString stringWithFormat:@"member-%04lu.json", (unsigned long)i]];
+        [[NSJSONSerialization dataWithJSONObject:model options:0 error:nil] writeToFile:path atomically:YES];
+    }];
+
+    DirectoryMemberSource* source = [[DirectoryMemberSource alloc] initWithDirectory:directory extension:@"json"];
+    XCTAssert([source memberCount] == ENSEMBLE_TEST_MODELS);
+
+    //-- a working set much smaller than the ensemble forces members to be reloaded
+    PredictiveEnsemble* lazy = [[PredictiveEnsemble alloc] initWithMemberSource:source
+                                                                     workingSet:4
+                                                                  distributions:nil];
+    for (NSDictionary* row in self.rows) {
+        XCTAssertEqualObjects([lazy predictWithArguments:row options:nil][@"prediction"],
+                              [self.ensemble predictWithArguments:row options:nil][@"prediction"]);
+    }
+    XCTAssert([lazy unavailableMemberCount] == 0);
+
+    //-- an unreadable member is left out of the vote and counted
+    NSString* brokenPath = [directory stringByAppendingPathComponent:@"member-0005.json"];
+    [[@"{ truncated" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:brokenPath atomically:YES];
+    PredictiveEnsemble* broken = [[PredictiveEnsemble alloc] initWithMemberSource:source
+                                                                       workingSet:4
+                                                                    distributions:nil];
+    NSMutableArray* remainingModels = [self.models mutableCopy];
+    [remainingModels removeObjectAtIndex:5];
+    PredictiveEnsemble* remaining = [[PredictiveEnsemble alloc] initWithModels:remainingModels
+                                                                     maxModels:0
+                                                                 distributions:nil];
+    for (NSDictionary* row in self.rows) {
+        XCTAssertEqualObjects([broken predictWithArguments:row options:nil][@"prediction"],
+                              [remaining predictWithArguments:row options:nil][@"prediction"]);
+        XCTAssert([broken predictWithArguments:row options:@{ @"earlyTermination" : @YES }][@"prediction"] != nil);
+    }
+    XCTAssert([broken unavailableMemberCount] >= self.rows.count);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+}
+
+- (void)testMemberSourceLoads {
+
+    bigmlObjcCountingMemberSource* source = [[bigmlObjcCountingMemberSource alloc] initWithModels:self.models];
+    PredictiveEnsemble* lazy = [[PredictiveEnsemble alloc] initWithMemberSource:source
+                                                                     workingSet:4
+                                                                  distributions:nil];
+    //-- every member is read once to collect the fields
+    XCTAssert(source.loads == ENSEMBLE_TEST_MODELS);
+
+    //-- a batch loads each member once
+    NSUInteger loads = source.loads;
+    NSArray* batch = [lazy predictWithRows:self.rows options:nil];
+    XCTAssert(source.loads - loads == ENSEMBLE_TEST_MODELS);
+
+    //-- single rows go through all the members, and miss all but the working set each time
+    NSUInteger singleRows = 10;
+    loads = source.loads;
+    for (NSUInteger row = 0; row < singleRows; ++row) {
+        XCTAssertEqualObjects([lazy predictWithArguments:self.rows[row] options:nil], batch[row]);
+    }
+    XCTAssert(source.loads - loads >= singleRows * (ENSEMBLE_TEST_MODELS - 4));
+    XCTAssert(source.loads - loads <= singleRows * ENSEMBLE_TEST_MODELS);
+}
+
+#pragma mark Stored resources
+
+- (void)testStoredModelEnsemble {
+
+    NSArray* models = [self modelsFromFixtureNamed:@"iris.model" count:5];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:models.firstObject];
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    PredictiveEnsemble* binned = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    [binned compileBinnedForest];
+    NSDictionary* options = @{ @"byName" : @YES };
+    NSDictionary* earlyOptions = @{ @"byName" : @YES, @"earlyTermination" : @YES };
+
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:@"species"]) {
+
+        id expected = [[model predictWithArguments:row options:options] firstObject][@"prediction"];
+        NSDictionary* full = [ensemble predictWithArguments:row options:options];
+        XCTAssertEqualObjects(full[@"prediction"], expected);
+        XCTAssertEqualObjects([binned predictWithArguments:row options:options], full);
+
+        //-- three equal votes out of five cannot be overturned
+        NSDictionary* early = [ensemble predictWithArguments:row options:earlyOptions];
+        XCTAssertEqualObjects(early[@"prediction"], expected);
+        XCTAssert([early[@"evaluatedMembers"] unsignedIntegerValue] == 3);
+    }
+}
+
+- (void)testStoredAnomalyBudget {
+
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[self JSONFixtureNamed:@"testAnomaly.json"]];
+    NSDictionary* options = @{ @"byName" : @YES };
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:nil]) {
+
+        double score = [anomaly score:row options:options];
+        NSDictionary* full = [anomaly scoreWithBudget:row options:options];
+        XCTAssertEqualWithAccuracy([full[@"score"] doubleValue], score, 1e-12);
+
+        NSDictionary* partial = [anomaly scoreWithBudget:row options:@{ @"byName" : @YES, @"treeBudget" : @8 }];
+        XCTAssert([partial[@"evaluatedTrees"] unsignedIntegerValue] == 8);
+        XCTAssert([partial[@"scoreError"] doubleValue] >= 0);
+    }
+}
+
+- (void)testStoredPredictiveGroup {
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self modelFixtureNamed:@"iris.model"]];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[self JSONFixtureNamed:@"testAnomaly.json"]];
+    PredictiveGroup* group = [[PredictiveGroup alloc] initWithPredictors:@[ model, anomaly ]];
+    NSDictionary* options = @{ @"byName" : @YES };
+
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:nil]) {
+
+        NSArray* results = [group predictWithArguments:row options:options];
+        XCTAssertEqualObjects(results[0][@"prediction"],
+                              [[model predictWithArguments:row options:options] firstObject][@"prediction"]);
+        XCTAssertEqualWithAccuracy([results[1][@"score"] doubleValue], [anomaly score:row options:options], 1e-12);
+    }
+}
+
+- (void)testPredictiveGroupLocales {
+
+    NSMutableDictionary* json = [[self modelFixtureNamed:@"iris.model"] mutableCopy];
+    PredictiveModel* english = [[PredictiveModel alloc] initWithJSONModel:json];
+    json[@"locale"] = @"fr_FR";
+    PredictiveModel* french = [[PredictiveModel alloc] initWithJSONModel:json];
+    PredictiveModel* frenchCopy = [[PredictiveModel alloc] initWithJSONModel:json];
+    XCTAssert(![english decodesInputLike:french] && [french decodesInputLike:frenchCopy]);
+
+    //-- rows are decoded with the decimal comma of the French models
+    PredictiveGroup* group = [[PredictiveGroup alloc] initWithPredictors:@[ french, frenchCopy ]];
+    NSDictionary* options = @{ @"byName" : @YES };
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:@"species"]) {
+
+        NSMutableDictionary* frenchRow = [NSMutableDictionary dictionaryWithCapacity:row.count];
+        for (NSString* name in row) {
+            frenchRow[name] = [row[name] stringByReplacingOccurrencesOfString:@"." withString:@","];
+        }
+        NSArray* results = [group predictWithArguments:frenchRow options:options];
+        NSDictionary* expected = [[english predictWithArguments:row options:options] firstObject];
+        XCTAssertEqualObjects(results[0][@"prediction"], expected[@"prediction"]);
+        XCTAssertEqualObjects(results[1][@"prediction"], expected[@"prediction"]);
+    }
+}
+
+@end
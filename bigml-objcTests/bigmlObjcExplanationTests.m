@@ -0,0 +1,153 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+
+#define EXPLANATION_TEST_ROWS 200
+#define EXPLANATION_TEST_MODELS 11
+
+@interface bigmlObjcExplanationTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+@implementation bigmlObjcExplanationTests
+
+- (void)setUp {
+
+    [super setUp];
+    self.rows = [self.generator rowsWithCount:EXPLANATION_TEST_ROWS fieldCount:8];
+}
+
+- (double)probabilityOfCategory:(id)category inPrediction:(NSDictionary*)prediction {
+
+    NSDictionary* distribution = prediction[@"distribution"];
+    double total = 0;
+    for (NSNumber* count in distribution.allValues) {
+        total += count.doubleValue;
+    }
+    return total > 0 ? [distribution[category] doubleValue] / total : 0;
+}
+
+- (double)sumOfExplanation:(NSDictionary*)explanation {
+
+    double sum = [explanation[@"bias"] doubleValue];
+    for (NSNumber* contribution in explanation[@"contributions"]) {
+        sum += contribution.doubleValue;
+    }
+    return sum;
+}
+
+- (void)testModelExplanation {
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:6
+                                                                                            fieldCount:8
+                                                                                            classCount:3]];
+    XCTAssert(model.explanationFields.count == 8 && model.explanationClasses.count == 3);
+    for (NSDictionary* row in self.rows) {
+
+        NSDictionary* prediction = [[model predictWithArguments:row options:nil] firstObject];
+        NSDictionary* explanation = [model explainWithArguments:row options:nil];
+        XCTAssertEqualObjects(explanation[@"prediction"], prediction[@"prediction"]);
+        XCTAssertEqualObjects(explanation[@"confidence"], prediction[@"confidence"]);
+        XCTAssert([explanation[@"contributions"] count] == 8);
+        XCTAssertEqualWithAccuracy([self sumOfExplanation:explanation],
+                                   [self probabilityOfCategory:prediction[@"prediction"] inPrediction:prediction],
+                                   1e-9);
+    }
+
+    //-- without input the prediction stops at the root, and nothing contributes
+    NSDictionary* rootExplanation = [model explainWithArguments:@{} options:nil];
+    for (NSNumber* contribution in rootExplanation[@"contributions"]) {
+        XCTAssert(contribution.doubleValue == 0);
+    }
+}
+
+- (void)testEnsembleExplanation {
+
+    NSArray* models = [self.generator ensembleWithModelCount:EXPLANATION_TEST_MODELS
+                                                       depth:6
+                                                  fieldCount:8
+                                                  classCount:3];
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    NSMutableArray* members = [NSMutableArray arrayWithCapacity:models.count];
+    for (NSDictionary* json in models) {
+        [members addObject:[[PredictiveModel alloc] initWithJSONModel:json]];
+    }
+
+    for (NSDictionary* row in self.rows) {
+
+        NSDictionary* explanation = [ensemble explainWithArguments:row options:nil];
+        id predicted = [ensemble predictWithArguments:row options:nil][@"prediction"];
+        XCTAssertEqualObjects(explanation[@"prediction"], predicted);
+
+        double meanProbability = 0;
+        for (PredictiveModel* member in members) {
+            NSDictionary* vote = [[member predictWithArguments:row options:nil] firstObject];
+            meanProbability += [self probabilityOfCategory:predicted inPrediction:vote] / members.count;
+        }
+        XCTAssertEqualWithAccuracy([self sumOfExplanation:explanation], meanProbability, 1e-9);
+    }
+
+    //-- votes follow the missing strategy, so rows missing half their fields
+    //-- are explained with the prediction made with the same strategy
+    NSDictionary* proportional = @{ @"strategy" : @(BMLMissingStrategyProportional) };
+    for (NSDictionary* row in self.rows) {
+
+        NSMutableDictionary* partial = [row mutableCopy];
+        [partial removeObjectsForKeys:[[row.allKeys sortedArrayUsingSelector:@selector(compare:)]
+                                       subarrayWithRange:NSMakeRange(0, row.count / 2)]];
+        NSDictionary* explanation = [ensemble explainWithArguments:partial options:proportional];
+        NSDictionary* prediction = [ensemble predictWithArguments:partial options:proportional];
+        XCTAssertEqualObjects(explanation[@"prediction"], prediction[@"prediction"]);
+        XCTAssertEqualObjects(explanation[@"confidence"], prediction[@"confidence"]);
+    }
+}
+
+- (void)checkExplanationsOfModel:(PredictiveModel*)model rows:(NSArray*)rows {
+
+    for (NSDictionary* row in rows) {
+
+        NSDictionary* prediction = [[model predictWithArguments:row options:@{ @"byName" : @YES }] firstObject];
+        NSDictionary* explanation = [model explainWithArguments:row options:@{ @"byName" : @YES }];
+        XCTAssertEqualObjects(explanation[@"prediction"], prediction[@"prediction"]);
+        XCTAssertEqualObjects(explanation[@"confidence"], prediction[@"confidence"]);
+        XCTAssert([explanation[@"contributions"] count] == model.explanationFields.count);
+        XCTAssertEqualWithAccuracy([self sumOfExplanation:explanation],
+                                   [self probabilityOfCategory:prediction[@"prediction"] inPrediction:prediction],
+                                   1e-9);
+    }
+}
+
+- (void)testStoredModelExplanation {
+
+    PredictiveModel* iris = [[PredictiveModel alloc] initWithJSONModel:[self modelFixtureNamed:@"iris.model"]];
+    [self checkExplanationsOfModel:iris
+                              rows:[self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:@"species"]];
+
+    //-- categorical splits, and messages stopping at different depths
+    NSDictionary* json = [self modelFixtureNamed:@"spam.model"];
+    PredictiveModel* spam = [[PredictiveModel alloc] initWithJSONModel:json];
+    NSString* spamMessage = json[@"model"][@"root"][@"children"][0][@"predicate"][@"value"];
+    [self checkExplanationsOfModel:spam
+                              rows:@[ @{ @"Message" : spamMessage },
+                                      @{ @"Message" : @"Ok lar... Joking wif u oni..." },
+                                      @{} ]];
+}
+
+@end
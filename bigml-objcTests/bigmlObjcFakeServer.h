@@ -0,0 +1,77 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+@class BMLAPIConnector;
+
+/**
+ * An in-process stand-in for the BigML.io REST endpoints used by
+ * BMLAPIConnector: create (JSON and multipart upload), get, list, update and
+ * delete. Requests are intercepted by an NSURLProtocol registered with the
+ * library's sessions, so the whole client stack except the network itself is
+ * exercised.
+ *
+ * Created resources are queued and move through the processing statuses each
+ * time they are read, reaching BMLResourceStatusEnded after `statusPolls` reads.
+ * Only one server can be started at a time.
+ */
+@interface bigmlObjcFakeServer : NSObject
+
+/// the server URL to pass to BMLAPIConnector
+@property (nonatomic, readonly) NSString* serverUrl;
+
+/// delay applied to every response, in seconds (default 0)
+@property (nonatomic) NSTimeInterval latency;
+
+/// fraction of requests, in [0, 1], answered with errorStatusCode (default 0)
+@property (nonatomic) double errorRate;
+
+/// status code of injected errors (default 500)
+@property (nonatomic) NSInteger errorStatusCode;
+
+/// number of reads after which a resource is finished (default 2)
+@property (nonatomic) NSUInteger statusPolls;
+
+/// number of requests served so far, including injected errors
+@property (nonatomic, readonly) NSUInteger requestCount;
+
+/// number of resources currently stored
+@property (nonatomic, readonly) NSUInteger resourceCount;
+
+/**
+ * @param seed The seed driving error injection, so that runs are reproducible.
+ */
+- (instancetype)initWithSeed:(uint64_t)seed;
+
+- (void)start;
+- (void)stop;
+
+/**
+ * Makes the next `count` requests fail with the given HTTP status code,
+ * regardless of errorRate.
+ */
+- (void)failNextRequests:(NSUInteger)count statusCode:(NSInteger)statusCode;
+
+/**
+ * Requests served so far for each HTTP method.
+ */
+- (NSUInteger)requestCountForMethod:(NSString*)method;
+
+/**
+ * A new connector talking to this server.
+ */
+- (BMLAPIConnector*)connector;
+
+@end
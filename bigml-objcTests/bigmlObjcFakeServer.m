@@ -0,0 +1,406 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "bigmlObjcFakeServer.h"
+#import "BMLAPIConnector.h"
+#import "BMLHTTPMethodHandler.h"
+#import "BMLEnums.h"
+
+#define FAKE_SERVER_HOST @"bigml.fake"
+
+static bigmlObjcFakeServer* currentServer = nil;
+
+@interface bigmlObjcFakeServer ()
+
+- (void)respondToRequest:(NSURLRequest*)request
+                    body:(NSData*)body
+              completion:(void(^)(NSInteger statusCode, NSData* body))completion;
+
+@end
+
+#pragma mark Protocol
+
+/**
+ * Hands intercepted requests over to the current server and delivers its
+ * responses on the thread the loading was started from, as NSURLProtocol
+ * requires.
+ */
+@interface bigmlObjcFakeServerProtocol : NSURLProtocol
+
+@end
+
+@implementation bigmlObjcFakeServerProtocol {
+
+    NSThread* _clientThread;
+    NSArray* _modes;
+    BOOL _stopped;
+}
+
++ (BOOL)canInitWithRequest:(NSURLRequest*)request {
+
+    @synchronized ([bigmlObjcFakeServer class]) {
+        return currentServer && [request.URL.host isEqualToString:FAKE_SERVER_HOST];
+    }
+}
+
++ (NSURLRequest*)canonicalRequestForRequest:(NSURLRequest*)request {
+    return request;
+}
+
+- (NSData*)bodyOfRequest:(NSURLRequest*)request {
+
+    //-- sessions move the body into a stream before handing the request over
+    if (request.HTTPBody || !request.HTTPBodyStream)
+        return request.HTTPBody;
+
+    NSMutableData* body = [NSMutableData data];
+    NSInputStream* stream = request.HTTPBodyStream;
+    uint8_t buffer[4096];
+    [stream open];
+    NSInteger read;
+    while ((read = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+        [body appendBytes:buffer length:read];
+    }
+    [stream close];
+    return body;
+}
+
+- (void)startLoading {
+
+    _clientThread = [NSThread currentThread];
+    NSString* mode = [[NSRunLoop currentRunLoop] currentMode];
+    _modes = mode ? @[ mode, NSDefaultRunLoopMode ] : @[ NSDefaultRunLoopMode ];
+
+    bigmlObjcFakeServer* server = nil;
+    @synchronized ([bigmlObjcFakeServer class]) {
+        server = currentServer;
+    }
+    [server respondToRequest:self.request
+                        body:[self bodyOfRequest:self.request]
+                  completion:^(NSInteger statusCode, NSData* body) {
+
+                      NSHTTPURLResponse* response =
+                      [[NSHTTPURLResponse alloc] initWithURL:self.request.URL
+                                                  statusCode:statusCode
+                                                 HTTPVersion:@"HTTP/1.1"
+                                                headerFields:@{ @"Content-Type" : @"application/json" }];
+                      [self performSelector:@selector(deliverResponse:)
+                                   onThread:_clientThread
+                                 withObject:@[ response, body ?: [NSData data] ]
+                              waitUntilDone:NO
+                                      modes:_modes];
+                  }];
+}
+
+- (void)deliverResponse:(NSArray*)responseAndBody {
+
+    if (_stopped)
+        return;
+    [self.client URLProtocol:self
+          didReceiveResponse:responseAndBody.firstObject
+          cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self didLoadData:responseAndBody.lastObject];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+    _stopped = YES;
+}
+
+@end
+
+#pragma mark Server
+
+@implementation bigmlObjcFakeServer {
+
+    uint64_t _state;
+    NSUInteger _nextId;
+    NSUInteger _failures;
+    NSInteger _failureStatusCode;
+    NSMutableDictionary* _resources;
+    NSMutableDictionary* _reads;
+    NSMutableArray* _order;
+    NSMutableDictionary* _requestCounts;
+    dispatch_queue_t _queue;
+}
+
+- (instancetype)initWithSeed:(uint64_t)seed {
+
+    if (self = [super init]) {
+        _state = seed;
+        _errorStatusCode = 500;
+        _statusPolls = 2;
+        _resources = [NSMutableDictionary new];
+        _reads = [NSMutableDictionary new];
+        _order = [NSMutableArray new];
+        _requestCounts = [NSMutableDictionary new];
+        _queue = dispatch_queue_create("com.bigml.fake-server", DISPATCH_QUEUE_CONCURRENT);
+    }
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithSeed:1];
+}
+
+- (NSString*)serverUrl {
+    return [NSString stringWithFormat:@"https://%@", FAKE_SERVER_HOST];
+}
+
+- (void)start {
+
+    @synchronized ([bigmlObjcFakeServer class]) {
+        NSAssert(!currentServer || currentServer == self, @"Another fake server is running");
+        currentServer = self;
+    }
+    [BMLHTTPMethodHandler registerProtocolClass:[bigmlObjcFakeServerProtocol class]];
+}
+
+- (void)stop {
+
+    [BMLHTTPMethodHandler unregisterProtocolClass:[bigmlObjcFakeServerProtocol class]];
+    @synchronized ([bigmlObjcFakeServer class]) {
+        if (currentServer == self)
+            currentServer = nil;
+    }
+}
+
+- (BMLAPIConnector*)connector {
+
+    return [[BMLAPIConnector alloc] initWithUsername:@"fake"
+                                              apiKey:@"fake"
+                                                mode:BMLModeProduction
+                                              server:self.serverUrl
+                                             version:nil];
+}
+
+- (void)failNextRequests:(NSUInteger)count statusCode:(NSInteger)statusCode {
+
+    @synchronized (self) {
+        _failures = count;
+        _failureStatusCode = statusCode;
+    }
+}
+
+- (NSUInteger)requestCount {
+
+    @synchronized (self) {
+        return [[_requestCounts.allValues valueForKeyPath:@"@sum.self"] unsignedIntegerValue];
+    }
+}
+
+- (NSUInteger)requestCountForMethod:(NSString*)method {
+
+    @synchronized (self) {
+        return [_requestCounts[method] unsignedIntegerValue];
+    }
+}
+
+- (NSUInteger)resourceCount {
+
+    @synchronized (self) {
+        return _resources.count;
+    }
+}
+
+//-- splitmix64, see bigmlObjcSyntheticModels
+- (double)nextDouble {
+
+    uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return ((z ^ (z >> 31)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#pragma mark Routing
+
+- (NSData*)dataWithObject:(id)object {
+    return [NSJSONSerialization dataWithJSONObject:object options:0 error:nil];
+}
+
+- (NSData*)errorBodyWithCode:(NSInteger)code message:(NSString*)message {
+
+    return [self dataWithObject:@{ @"code" : @(code),
+                                   @"status" : @{ @"code" : @(BMLResourceStatusFailed),
+                                                  @"message" : message } }];
+}
+
+/**
+ * Returns the resource path components following the API version, e.g.,
+ * ["dataset"] or ["dataset", "<id>"].
+ */
+- (NSArray*)resourceComponentsFromURL:(NSURL*)url {
+
+    NSMutableArray* components = [[url.path componentsSeparatedByString:@"/"] mutableCopy];
+    [components removeObject:@""];
+    if ([components.firstObject isEqualToString:@"dev"])
+        [components removeObjectAtIndex:0];
+    if (components.count > 0)
+        [components removeObjectAtIndex:0];
+    return components;
+}
+
+- (NSDictionary*)argumentsFromURL:(NSURL*)url {
+
+    NSMutableDictionary* arguments = [NSMutableDictionary dictionary];
+    NSCharacterSet* separators = [NSCharacterSet characterSetWithCharactersInString:@";&"];
+    for (NSString* pair in [url.query componentsSeparatedByCharactersInSet:separators]) {
+        NSArray* keyValue = [pair componentsSeparatedByString:@"="];
+        if (keyValue.count == 2)
+            arguments[keyValue.firstObject] = [keyValue.lastObject stringByRemovingPercentEncoding];
+    }
+    return arguments;
+}
+
+- (NSDictionary*)valuesFromBody:(NSData*)body request:(NSURLRequest*)request {
+
+    NSString* contentType = [request valueForHTTPHeaderField:@"Content-Type"];
+    if ([contentType hasPrefix:@"multipart/form-data"]) {
+
+        NSString* text = [[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding];
+        NSRegularExpression* regex =
+        [NSRegularExpression regularExpressionWithPattern:@"filename=\"([^\"]*)\""
+                                                  options:0
+                                                    error:nil];
+        NSTextCheckingResult* match = text ? [regex firstMatchInString:text
+                                                               options:0
+                                                                 range:NSMakeRange(0, text.length)] : nil;
+        return @{ @"name" : match ? [text substringWithRange:[match rangeAtIndex:1]] : @"upload" };
+    }
+    id values = body.length > 0 ? [NSJSONSerialization JSONObjectWithData:body options:0 error:nil] : nil;
+    return [values isKindOfClass:[NSDictionary class]] ? values : @{};
+}
+
+- (NSDictionary*)resource:(NSDictionary*)resource withCode:(NSInteger)code {
+
+    NSMutableDictionary* result = [resource mutableCopy];
+    result[@"code"] = @(code);
+    return result;
+}
+
+- (NSInteger)statusAfterReads:(NSUInteger)reads {
+
+    if (reads >= _statusPolls)
+        return BMLResourceStatusEnded;
+    return BMLResourceStatusQueued + (reads * (BMLResourceStatusSummarized - BMLResourceStatusQueued)) / _statusPolls;
+}
+
+- (NSInteger)handleRequest:(NSURLRequest*)request body:(NSData*)body response:(NSData**)response {
+
+    NSString* method = request.HTTPMethod ?: @"GET";
+    _requestCounts[method] = @([_requestCounts[method] unsignedIntegerValue] + 1);
+
+    if (_failures > 0 || (_errorRate > 0 && [self nextDouble] < _errorRate)) {
+        NSInteger code = _failures > 0 ? _failureStatusCode : _errorStatusCode;
+        if (_failures > 0)
+            --_failures;
+        *response = [self errorBodyWithCode:code message:@"Injected error"];
+        return code;
+    }
+
+    NSArray* components = [self resourceComponentsFromURL:request.URL];
+    if (components.count == 0 || components.count > 2) {
+        *response = [self errorBodyWithCode:400 message:@"Bad request"];
+        return 400;
+    }
+    NSString* type = components.firstObject;
+    NSString* fullUuid = components.count == 2 ?
+    [NSString stringWithFormat:@"%@/%@", type, components.lastObject] : nil;
+    NSMutableDictionary* resource = fullUuid ? _resources[fullUuid] : nil;
+
+    if ([method isEqualToString:@"POST"] && !fullUuid) {
+
+        fullUuid = [NSString stringWithFormat:@"%@/%024lx", type, (unsigned long)++_nextId];
+        resource = [[self valuesFromBody:body request:request] mutableCopy];
+        resource[@"resource"] = fullUuid;
+        resource[@"name"] = resource[@"name"] ?: fullUuid;
+        resource[@"created"] = [[NSDate date] description];
+        resource[@"status"] = @{ @"code" : @([self statusAfterReads:0]), @"message" : @"Queued" };
+        _resources[fullUuid] = resource;
+        _reads[fullUuid] = @0;
+        [_order addObject:fullUuid];
+        *response = [self dataWithObject:[self resource:resource withCode:201]];
+        return 201;
+
+    } else if ([method isEqualToString:@"GET"] && !fullUuid) {
+
+        NSDictionary* arguments = [self argumentsFromURL:request.URL];
+        NSUInteger offset = [arguments[@"offset"] integerValue];
+        NSUInteger limit = [arguments[@"limit"] integerValue] ?: 20;
+        NSMutableArray* objects = [NSMutableArray array];
+        NSUInteger total = 0;
+        for (NSString* uuid in _order) {
+            if ([uuid hasPrefix:[type stringByAppendingString:@"/"]]) {
+                if (total >= offset && objects.count < limit)
+                    [objects addObject:_resources[uuid]];
+                ++total;
+            }
+        }
+        *response = [self dataWithObject:@{ @"code" : @200,
+                                            @"meta" : @{ @"limit" : @(limit),
+                                                         @"offset" : @(offset),
+                                                         @"total_count" : @(total) },
+                                            @"objects" : objects }];
+        return 200;
+
+    } else if (!resource) {
+
+        *response = [self errorBodyWithCode:404 message:@"Not found"];
+        return 404;
+
+    } else if ([method isEqualToString:@"GET"]) {
+
+        NSUInteger reads = [_reads[fullUuid] unsignedIntegerValue] + 1;
+        _reads[fullUuid] = @(reads);
+        NSInteger status = [self statusAfterReads:reads];
+        resource[@"status"] = @{ @"code" : @(status),
+                                 @"message" : status == BMLResourceStatusEnded ? @"Finished" : @"In progress" };
+        *response = [self dataWithObject:[self resource:resource withCode:200]];
+        return 200;
+
+    } else if ([method isEqualToString:@"PUT"]) {
+
+        [resource addEntriesFromDictionary:[self valuesFromBody:body request:request]];
+        *response = [self dataWithObject:[self resource:resource withCode:202]];
+        return 202;
+
+    } else if ([method isEqualToString:@"DELETE"]) {
+
+        [_resources removeObjectForKey:fullUuid];
+        [_reads removeObjectForKey:fullUuid];
+        [_order removeObject:fullUuid];
+        *response = [NSData data];
+        return 204;
+    }
+    *response = [self errorBodyWithCode:405 message:@"Method not allowed"];
+    return 405;
+}
+
+- (void)respondToRequest:(NSURLRequest*)request
+                    body:(NSData*)body
+              completion:(void(^)(NSInteger statusCode, NSData* body))completion {
+
+    NSData* response = nil;
+    NSInteger statusCode = 0;
+    NSTimeInterval latency = 0;
+    @synchronized (self) {
+        statusCode = [self handleRequest:request body:body response:&response];
+        latency = _latency;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(latency * NSEC_PER_SEC)), _queue, ^{
+        completion(statusCode, response);
+    });
+}
+
+@end
@@ -0,0 +1,188 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "bigmlObjcTestCredentials.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "Anomaly.h"
+#import "BMLInstrumentation.h"
+
+#define INSTRUMENTATION_TEST_ROWS 100
+
+@interface bigmlObjcInstrumentationTests : bigmlObjcLocalTestCase
+
+
+@end
+
+@implementation bigmlObjcInstrumentationTests
+
+- (void)setUp {
+
+    [super setUp];
+    [BMLInstrumentation reset];
+}
+
+- (void)tearDown {
+
+    [BMLInstrumentation setEnabled:NO];
+    [BMLInstrumentation stopExporting];
+    [super tearDown];
+}
+
+- (NSDictionary*)countersOfModel:(NSString*)label {
+
+    for (NSDictionary* counters in [BMLInstrumentation snapshot][@"models"]) {
+        if ([counters[@"model"] isEqualToString:label])
+            return counters;
+    }
+    return nil;
+}
+
+- (void)testModelCounters {
+
+    NSMutableDictionary* json = [[self.generator modelWithDepth:6 fieldCount:6 classCount:3] mutableCopy];
+    json[@"resource"] = @"model/000000000000000000000001";
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    NSArray* rows = [self.generator rowsWithCount:INSTRUMENTATION_TEST_ROWS fieldCount:6];
+
+    //-- nothing is recorded while disabled
+    [model predictWithArguments:rows.firstObject options:nil];
+    XCTAssert([[self countersOfModel:json[@"resource"]][@"rows"] unsignedIntegerValue] == 0);
+
+    [BMLInstrumentation setEnabled:YES];
+    for (NSDictionary* row in rows) {
+        [model predictWithArguments:row options:nil];
+    }
+    NSDictionary* snapshot = [BMLInstrumentation snapshot];
+    NSDictionary* counters = [self countersOfModel:json[@"resource"]];
+    XCTAssert([counters[@"rows"] unsignedIntegerValue] == INSTRUMENTATION_TEST_ROWS);
+    XCTAssertEqualWithAccuracy([counters[@"averageDepth"] doubleValue], 6, 1e-12);
+    XCTAssert([counters[@"nodesVisited"] unsignedIntegerValue] == INSTRUMENTATION_TEST_ROWS * 7);
+    XCTAssert([counters[@"missingBranchHits"] unsignedIntegerValue] == 0);
+    for (NSString* stage in @[ @"filter", @"cast", @"tokenize", @"traversal" ]) {
+        XCTAssert([snapshot[@"stages"][stage][@"calls"] unsignedIntegerValue] == INSTRUMENTATION_TEST_ROWS);
+    }
+
+    //-- without the field tested at the root, predictions stop there
+    NSMutableDictionary* partial = [rows.firstObject mutableCopy];
+    for (NSUInteger i = 0; i < 6; ++i) {
+        [partial removeObjectForKey:[bigmlObjcSyntheticModels fieldIdAtIndex:i]];
+    }
+    [model predictWithArguments:partial options:nil];
+    XCTAssert([[self countersOfModel:json[@"resource"]][@"missingBranchHits"] unsignedIntegerValue] == 1);
+}
+
+- (void)testEnsembleEarlyStops {
+
+    NSArray* models = [self.generator ensembleWithModelCount:21 depth:4 fieldCount:6 classCount:2];
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:models maxModels:0 distributions:nil];
+    [BMLInstrumentation setEnabled:YES];
+    for (NSDictionary* row in [self.generator rowsWithCount:INSTRUMENTATION_TEST_ROWS fieldCount:6]) {
+        [ensemble predictWithArguments:row options:@{ @"treeBudget" : @3 }];
+    }
+    NSDictionary* counters = [self countersOfModel:[NSString stringWithFormat:@"ensemble %p", ensemble]];
+    XCTAssert([counters[@"rows"] unsignedIntegerValue] == INSTRUMENTATION_TEST_ROWS);
+    XCTAssert([counters[@"earlyStops"] unsignedIntegerValue] == INSTRUMENTATION_TEST_ROWS);
+    XCTAssert([[BMLInstrumentation snapshot][@"stages"][@"combine"][@"calls"] unsignedIntegerValue] ==
+              INSTRUMENTATION_TEST_ROWS);
+}
+
+- (void)testLoadFigures {
+
+    NSMutableDictionary* json = [[self.generator modelWithDepth:6 fieldCount:6 classCount:3] mutableCopy];
+    NSMutableDictionary* object = [json[@"object"] mutableCopy];
+    object[@"resource"] = @"model/000000000000000000000002";
+    json[@"object"] = object;
+    NSData* data = [NSJSONSerialization dataWithJSONObject:json options:0 error:nil];
+
+    //-- nothing is recorded for models built while disabled
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONData:data error:nil];
+    XCTAssertNotNil(model);
+    XCTAssert([[self countersOfModel:object[@"resource"]][@"load"][@"nodes"] unsignedIntegerValue] == 0);
+    model = nil;
+
+    [BMLInstrumentation setEnabled:YES];
+    model = [[PredictiveModel alloc] initWithJSONData:data error:nil];
+    NSDictionary* load = [self countersOfModel:object[@"resource"]][@"load"];
+    XCTAssert([load[@"nodes"] unsignedIntegerValue] == 127);
+    XCTAssert([load[@"bytes"] unsignedIntegerValue] > 127 * 16);
+    XCTAssert([load[@"compiledBytes"] unsignedIntegerValue] > 0 &&
+              [load[@"compiledBytes"] unsignedIntegerValue] < [load[@"bytes"] unsignedIntegerValue]);
+    XCTAssert([load[@"parseMs"] doubleValue] > 0 && [load[@"buildMs"] doubleValue] > 0);
+
+    NSDictionary* jsonAnomaly = [self.generator anomalyWithTreeCount:4 depth:3 fieldCount:6];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+    NSDictionary* anomalyLoad = [self countersOfModel:jsonAnomaly[@"resource"]][@"load"];
+    XCTAssert(anomaly && [anomalyLoad[@"nodes"] unsignedIntegerValue] == 4 * 15);
+    XCTAssert([anomalyLoad[@"compiledBytes"] unsignedIntegerValue] > 0 &&
+              [anomalyLoad[@"compiledBytes"] unsignedIntegerValue] < [anomalyLoad[@"bytes"] unsignedIntegerValue]);
+    XCTAssert([anomalyLoad[@"parseMs"] doubleValue] == 0);
+
+    NSError* error = nil;
+    XCTAssertNil([[PredictiveModel alloc] initWithJSONData:[@"[1]" dataUsingEncoding:NSUTF8StringEncoding]
+                                                     error:&error]);
+    XCTAssert(error.code == -10401);
+}
+
+- (NSUInteger)nodeCountOfTree:(NSDictionary*)node {
+
+    NSUInteger count = 1;
+    for (NSDictionary* child in node[@"children"]) {
+        if ([child isKindOfClass:[NSDictionary class]])
+            count += [self nodeCountOfTree:child];
+    }
+    return count;
+}
+
+- (void)testStoredLoadFigures {
+
+    [BMLInstrumentation setEnabled:YES];
+    NSDictionary* json = [self JSONFixtureNamed:@"iris.model"];
+    NSData* data = [NSData dataWithContentsOfFile:pathForResource(@"iris.model")];
+    NSError* error = nil;
+    XCTAssertNotNil([[PredictiveModel alloc] initWithJSONData:data error:&error]);
+    NSDictionary* load = [self countersOfModel:json[@"resource"]][@"load"];
+    XCTAssert([load[@"nodes"] unsignedIntegerValue] == [self nodeCountOfTree:json[@"model"][@"root"]]);
+    XCTAssert([load[@"bytes"] unsignedIntegerValue] > 0 && [load[@"parseMs"] doubleValue] > 0);
+
+    NSDictionary* jsonAnomaly = [self JSONFixtureNamed:@"testAnomaly.json"];
+    NSUInteger nodes = 0;
+    for (NSDictionary* tree in jsonAnomaly[@"model"][@"trees"]) {
+        nodes += [self nodeCountOfTree:tree[@"root"]];
+    }
+    XCTAssertNotNil([[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly]);
+    XCTAssert([[self countersOfModel:jsonAnomaly[@"resource"]][@"load"][@"nodes"] unsignedIntegerValue] == nodes);
+}
+
+- (void)testExport {
+
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-instrumentation.json"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [BMLInstrumentation setEnabled:YES];
+    [BMLInstrumentation startExportingToFile:path interval:0.05];
+
+    XCTestExpectation* exp = [self expectationWithDescription:@"testExport"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        NSData* data = [NSData dataWithContentsOfFile:path];
+        XCTAssert(data && [NSJSONSerialization JSONObjectWithData:data options:0 error:nil][@"stages"]);
+        [exp fulfill];
+    });
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+@end
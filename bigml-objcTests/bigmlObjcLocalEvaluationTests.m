@@ -0,0 +1,196 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "bigmlObjcTestCredentials.h"
+#import "LocalEvaluation.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+#import "BMLUtils.h"
+
+#define EVALUATION_TEST_ROWS 1000
+
+@interface bigmlObjcLocalEvaluationTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) PredictiveModel* model;
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+/**
+ * A synthetic tree node turned into a regression one, predicting the index of
+ * the class it predicted.
+ */
+static NSDictionary* regressionNode(NSDictionary* node) {
+
+    NSMutableArray* children = [NSMutableArray arrayWithCapacity:[node[@"children"] count]];
+    for (NSDictionary* child in node[@"children"]) {
+        [children addObject:regressionNode(child)];
+    }
+    NSNumber* output = @([[[node[@"output"] componentsSeparatedByString:@" "] lastObject] doubleValue]);
+    NSMutableDictionary* regression = [node mutableCopy];
+    regression[@"output"] = output;
+    regression[@"distribution"] = @[ @[ output, node[@"count"] ] ];
+    regression[@"children"] = children;
+    return regression;
+}
+
+@implementation bigmlObjcLocalEvaluationTests
+
+- (void)setUp {
+
+    [super setUp];
+    self.model = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:6
+                                                                           fieldCount:8
+                                                                           classCount:3]];
+
+    //-- every fourth row is labeled "class 0", the others with the model's prediction
+    NSMutableArray* rows = [NSMutableArray arrayWithCapacity:EVALUATION_TEST_ROWS];
+    [[self.generator rowsWithCount:EVALUATION_TEST_ROWS fieldCount:8] enumerateObjectsUsingBlock:^(NSDictionary* row,
+                                                                                            NSUInteger i,
+                                                                                            BOOL* stop) {
+        NSMutableDictionary* labeled = [row mutableCopy];
+        labeled[self.model.objectiveFieldId] = i % 4 == 0 ? @"class 0" :
+        [[self.model predictWithArguments:row options:nil] firstObject][@"prediction"];
+        [rows addObject:labeled];
+    }];
+    self.rows = rows;
+}
+
+- (void)testClassification {
+
+    NSUInteger hits = 0;
+    NSUInteger classZero = 0;
+    for (NSDictionary* row in self.rows) {
+        NSString* prediction = [[self.model predictWithArguments:row options:nil] firstObject][@"prediction"];
+        hits += [prediction isEqualToString:row[self.model.objectiveFieldId]];
+        classZero += [row[self.model.objectiveFieldId] isEqualToString:@"class 0"];
+    }
+
+    LocalEvaluation* evaluation = [[LocalEvaluation alloc] initWithPredictor:self.model];
+    XCTAssert(!evaluation.isRegression);
+    NSDictionary* report = [evaluation evaluateRows:self.rows options:@{ @"sliceSize" : @7 }];
+    XCTAssert([report[@"rows"] unsignedIntegerValue] == EVALUATION_TEST_ROWS);
+    XCTAssert([report[@"evaluated"] unsignedIntegerValue] == EVALUATION_TEST_ROWS);
+    XCTAssertEqualWithAccuracy([report[@"accuracy"] doubleValue], (double)hits / EVALUATION_TEST_ROWS, 1e-12);
+    XCTAssert([report[@"perClass"][@"class 0"][@"support"] unsignedIntegerValue] == classZero);
+
+    NSUInteger total = 0;
+    for (NSDictionary* predictions in [report[@"confusionMatrix"] allValues]) {
+        for (NSNumber* count in predictions.allValues) {
+            total += count.unsignedIntegerValue;
+        }
+    }
+    XCTAssert(total == EVALUATION_TEST_ROWS);
+    for (NSDictionary* metrics in [report[@"perClass"] allValues]) {
+        XCTAssert([metrics[@"precision"] doubleValue] <= 1 && [metrics[@"recall"] doubleValue] <= 1);
+    }
+
+    //-- an ensemble of one model is evaluated alike
+    bigmlObjcSyntheticModels* generator = [[self class] seededGenerator];
+    NSDictionary* json = [generator modelWithDepth:6 fieldCount:8 classCount:3];
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:@[ json ] maxModels:0 distributions:nil];
+    NSDictionary* ensembleReport = [[[LocalEvaluation alloc] initWithPredictor:ensemble] evaluateRows:self.rows
+                                                                                               options:nil];
+    XCTAssertEqualObjects(ensembleReport[@"confusionMatrix"], report[@"confusionMatrix"]);
+}
+
+- (void)testCSVFile {
+
+    NSArray* fieldIds = [[self.rows.firstObject allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    NSArray* names = [self.model.fieldNameById objectsForKeys:fieldIds notFoundMarker:@""];
+    NSMutableString* csv = [NSMutableString stringWithFormat:@"\uFEFF%@\r\n", [names componentsJoinedByString:@","]];
+    for (NSDictionary* row in self.rows) {
+        NSMutableArray* values = [NSMutableArray arrayWithCapacity:fieldIds.count];
+        for (NSString* fieldId in fieldIds) {
+            id value = row[fieldId];
+            [values addObject:[value isKindOfClass:[NSString class]] ?
+             [NSString stringWithFormat:@"\"%@\"", value] :
+             [NSString stringWithFormat:@"%.17g", [value doubleValue]]];
+        }
+        [csv appendFormat:@"%@\r\n", [values componentsJoinedByString:@","]];
+    }
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-evaluation.csv"];
+    [csv writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+
+    LocalEvaluation* evaluation = [[LocalEvaluation alloc] initWithPredictor:self.model];
+    NSError* error = nil;
+    NSDictionary* report = [evaluation evaluateCSVFile:path options:@{ @"batchSize" : @100 } error:&error];
+    XCTAssert(error == nil);
+    XCTAssertEqualObjects(report, [evaluation evaluateRows:self.rows options:nil]);
+
+    //-- the byte order mark the file starts with is not part of the first name
+    NSArray* csvRows = [BMLUtils rowsFromCSVFile:path error:&error];
+    XCTAssert(csvRows.count == EVALUATION_TEST_ROWS);
+    XCTAssert([csvRows.firstObject objectForKey:names.firstObject] != nil);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    XCTAssert([evaluation evaluateCSVFile:path options:nil error:&error] == nil && error != nil);
+}
+
+- (void)testUnpredictedRegression {
+
+    NSDictionary* json = [self.generator modelWithDepth:4 fieldCount:8 classCount:3];
+    NSString* objectiveId = [json[@"object"][@"objective_fields"] firstObject];
+    NSMutableDictionary* fields = [json[@"object"][@"model"][@"fields"] mutableCopy];
+    fields[objectiveId] = @{ @"name" : @"objective", @"optype" : @"numeric", @"column_number" : @8 };
+    NSMutableDictionary* model = [json[@"object"][@"model"] mutableCopy];
+    model[@"fields"] = fields;
+    model[@"model_fields"] = fields;
+    model[@"root"] = regressionNode(model[@"root"]);
+    NSMutableDictionary* object = [json[@"object"] mutableCopy];
+    object[@"model"] = model;
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:@[ @{ @"resource" : json[@"resource"],
+                                                                                     @"object" : object } ]
+                                                                    maxModels:0
+                                                                distributions:nil];
+
+    NSMutableArray* rows = [NSMutableArray arrayWithCapacity:EVALUATION_TEST_ROWS];
+    [[self.generator rowsWithCount:EVALUATION_TEST_ROWS fieldCount:8] enumerateObjectsUsingBlock:^(NSDictionary* row,
+                                                                                            NSUInteger i,
+                                                                                            BOOL* stop) {
+        NSMutableDictionary* labeled = [row mutableCopy];
+        labeled[objectiveId] = @(i % 3);
+        [rows addObject:labeled];
+    }];
+
+    LocalEvaluation* evaluation = [[LocalEvaluation alloc] initWithPredictor:ensemble];
+    XCTAssert(evaluation.isRegression);
+    NSDictionary* report = [evaluation evaluateRows:rows options:nil];
+    XCTAssert([report[@"evaluated"] unsignedIntegerValue] == EVALUATION_TEST_ROWS);
+    XCTAssert([report[@"unpredicted"] unsignedIntegerValue] == 0);
+    XCTAssert(report[@"meanSquaredError"] != nil);
+
+    //-- a budget too short for any member leaves every row without a prediction
+    NSDictionary* unpredicted = [evaluation evaluateRows:rows options:@{ @"timeBudget" : @1e-9 }];
+    XCTAssert([unpredicted[@"rows"] unsignedIntegerValue] == EVALUATION_TEST_ROWS);
+    XCTAssert([unpredicted[@"evaluated"] unsignedIntegerValue] == 0);
+    XCTAssert([unpredicted[@"unpredicted"] unsignedIntegerValue] == EVALUATION_TEST_ROWS);
+    XCTAssert(unpredicted[@"meanSquaredError"] == nil);
+}
+
+- (void)testStoredModel {
+
+    //-- the stored model was trained on iris.csv, so it fits it well
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self modelFixtureNamed:@"iris.model"]];
+    LocalEvaluation* evaluation = [[LocalEvaluation alloc] initWithPredictor:model];
+    NSError* error = nil;
+    NSDictionary* report = [evaluation evaluateCSVFile:pathForResource(@"iris.csv") options:nil error:&error];
+    XCTAssert(report && !error);
+    XCTAssert([report[@"rows"] unsignedIntegerValue] == 150 && [report[@"evaluated"] unsignedIntegerValue] == 150);
+    XCTAssert([report[@"accuracy"] doubleValue] > 0.9);
+    XCTAssert([report[@"perClass"] count] == 3);
+}
+
+@end
@@ -0,0 +1,68 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcSyntheticModels.h"
+
+//-- the seed of all synthetic resources used by the tests
+#define BML_TEST_SEED 20160401
+
+/**
+ * Base class of the local prediction tests. Each test gets a generator of
+ * synthetic resources, seeded with BML_TEST_SEED, and can load the resources
+ * stored in the test bundle, which exercise the categorical, text and missing
+ * value paths that synthetic resources do not.
+ */
+@interface bigmlObjcLocalTestCase : XCTestCase
+
+@property (nonatomic, readonly) bigmlObjcSyntheticModels* generator;
+
+/**
+ * A new generator seeded with BML_TEST_SEED, which produces again the same
+ * sequence of resources and rows.
+ */
++ (bigmlObjcSyntheticModels*)seededGenerator;
+
+/**
+ * The JSON resource stored in the test bundle under the given file name,
+ * e.g. @"iris.model".
+ */
+- (id)JSONFixtureNamed:(NSString*)name;
+
+/**
+ * A model stored in the test bundle. Models stored before the API returned
+ * their status, such as spam.model, are marked as finished.
+ */
+- (NSDictionary*)modelFixtureNamed:(NSString*)name;
+
+/**
+ * A stored model whose tree predicates are replaced by those `map` returns,
+ * e.g. to scale its thresholds or rewrite its splits with other operators.
+ */
+- (NSDictionary*)modelFixtureNamed:(NSString*)name
+                 mappingPredicates:(NSDictionary* (^)(NSDictionary* predicate))map;
+
+/**
+ * An array holding `count` copies of a stored model, to build ensembles from.
+ */
+- (NSArray*)modelsFromFixtureNamed:(NSString*)name count:(NSUInteger)count;
+
+/**
+ * The rows of a CSV file stored in the test bundle, keyed by column name
+ * and holding the values as strings, as read by BMLUtils.
+ * @param column A column left out of the rows, such as the objective, or nil
+ */
+- (NSArray*)rowsOfCSVFixtureNamed:(NSString*)name excludingColumn:(NSString*)column;
+
+@end
@@ -0,0 +1,97 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "bigmlObjcLocalTestCase.h"
+#import "bigmlObjcTestCredentials.h"
+#import "BMLUtils.h"
+
+@implementation bigmlObjcLocalTestCase
+
++ (bigmlObjcSyntheticModels*)seededGenerator {
+
+    return [[bigmlObjcSyntheticModels alloc] initWithSeed:BML_TEST_SEED];
+}
+
+- (void)setUp {
+
+    [super setUp];
+    _generator = [[self class] seededGenerator];
+}
+
+- (id)JSONFixtureNamed:(NSString*)name {
+
+    NSString* path = pathForResource(name);
+    XCTAssertNotNil(path, @"Missing fixture %@", name);
+    NSData* data = path ? [NSData dataWithContentsOfFile:path] : nil;
+    return data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+}
+
+- (NSDictionary*)modelFixtureNamed:(NSString*)name {
+
+    NSMutableDictionary* model = [[self JSONFixtureNamed:name] mutableCopy];
+    if (!model[@"status"] && !model[@"object"])
+        model[@"status"] = @{ @"code" : @5 };
+    return model;
+}
+
+- (NSDictionary*)tree:(NSDictionary*)root mappingPredicates:(NSDictionary* (^)(NSDictionary*))map {
+
+    NSMutableDictionary* node = [root mutableCopy];
+    if ([root[@"predicate"] isKindOfClass:[NSDictionary class]])
+        node[@"predicate"] = map(root[@"predicate"]);
+    NSMutableArray* children = [NSMutableArray array];
+    for (NSDictionary* child in root[@"children"]) {
+        [children addObject:[self tree:child mappingPredicates:map]];
+    }
+    node[@"children"] = children;
+    return node;
+}
+
+- (NSDictionary*)modelFixtureNamed:(NSString*)name
+                 mappingPredicates:(NSDictionary* (^)(NSDictionary* predicate))map {
+
+    NSMutableDictionary* json = [[self modelFixtureNamed:name] mutableCopy];
+    NSMutableDictionary* model = [json[@"model"] mutableCopy];
+    model[@"root"] = [self tree:model[@"root"] mappingPredicates:map];
+    json[@"model"] = model;
+    return json;
+}
+
+- (NSArray*)modelsFromFixtureNamed:(NSString*)name count:(NSUInteger)count {
+
+    NSDictionary* model = [self modelFixtureNamed:name];
+    NSMutableArray* models = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count && model; ++i) {
+        [models addObject:model];
+    }
+    return models;
+}
+
+- (NSArray*)rowsOfCSVFixtureNamed:(NSString*)name excludingColumn:(NSString*)column {
+
+    NSString* path = pathForResource(name);
+    XCTAssertNotNil(path, @"Missing fixture %@", name);
+    NSArray* rows = path ? [BMLUtils rowsFromCSVFile:path error:nil] : nil;
+    if (!column)
+        return rows;
+    NSMutableArray* inputs = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        NSMutableDictionary* input = [row mutableCopy];
+        [input removeObjectForKey:column];
+        [inputs addObject:input];
+    }
+    return inputs;
+}
+
+@end
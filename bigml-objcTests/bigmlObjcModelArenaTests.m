@@ -0,0 +1,212 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "Anomaly.h"
+#import "ModelArena.h"
+
+
+@interface bigmlObjcModelArenaTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcModelArenaTests
+
+- (void)testAllocation {
+
+    ModelArena* arena = [[ModelArena alloc] initWithChunkSize:256];
+    char* previous = NULL;
+    for (NSUInteger i = 1; i <= 100; ++i) {
+        char* block = [arena allocate:i];
+        XCTAssert(block && ((uintptr_t)block % 16) == 0);
+        for (NSUInteger j = 0; j < i; ++j) {
+            XCTAssert(block[j] == 0);
+        }
+        memset(block, 0xff, i);
+        XCTAssert(block != previous);
+        previous = block;
+    }
+
+    //-- blocks larger than a chunk get their own
+    size_t reserved = arena.bytesReserved;
+    XCTAssert([arena allocate:4096] != NULL);
+    XCTAssert(arena.bytesReserved >= reserved + 4096);
+    XCTAssert(arena.bytesUsed <= arena.bytesReserved);
+}
+
+- (void)testReadersWait {
+
+    ArenaReaders* readers = calloc(1, sizeof(ArenaReaders));
+    ArenaReadersWait(readers);
+
+    //-- a writer waits for a reader registered before it publishes
+    unsigned int parity = ArenaReadersEnter(readers);
+    __block BOOL left = NO;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, 50 * NSEC_PER_MSEC),
+                   dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                       __atomic_store_n(&left, YES, __ATOMIC_SEQ_CST);
+                       ArenaReadersLeave(readers, parity);
+                   });
+    ArenaReadersWait(readers);
+    XCTAssert(__atomic_load_n(&left, __ATOMIC_SEQ_CST));
+
+    //-- readers that have left do not hold up the next writer
+    ArenaReadersLeave(readers, ArenaReadersEnter(readers));
+    ArenaReadersWait(readers);
+    free(readers);
+}
+
+/**
+ * Compares the predictions of the compiled tree with those of the tree
+ * itself, which predicts while branch hits are recorded, before and after
+ * the tree is compiled again in the order of those hits.
+ */
+- (void)checkCompiledPredictionsOfModel:(PredictiveModel*)model rows:(NSArray*)rows options:(NSDictionary*)options {
+
+    model.recordsBranchHits = YES;
+    NSMutableArray* expected = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        [expected addObject:[model predictWithArguments:row options:options]];
+    }
+    model.recordsBranchHits = NO;
+    for (NSUInteger i = 0; i < rows.count; ++i) {
+        XCTAssertEqualObjects([model predictWithArguments:rows[i] options:options], expected[i]);
+    }
+    [model optimizeBranchOrder];
+    for (NSUInteger i = 0; i < rows.count; ++i) {
+        XCTAssertEqualObjects([model predictWithArguments:rows[i] options:options], expected[i]);
+    }
+}
+
+- (void)testCompiledTrees {
+
+    //-- numeric splits, with rows missing some of their fields
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:8
+                                                                                            fieldCount:6
+                                                                                            classCount:3]];
+    NSMutableArray* rows = [NSMutableArray array];
+    [[self.generator rowsWithCount:200 fieldCount:6] enumerateObjectsUsingBlock:^(NSDictionary* row,
+                                                                                 NSUInteger i,
+                                                                                 BOOL* stop) {
+        NSMutableDictionary* partial = [row mutableCopy];
+        if (i % 3 == 0)
+            [partial removeObjectForKey:[bigmlObjcSyntheticModels fieldIdAtIndex:i % 6]];
+        [rows addObject:partial];
+    }];
+    [self checkCompiledPredictionsOfModel:model rows:rows options:nil];
+
+    //-- categorical splits
+    NSMutableOrderedSet* messages = [NSMutableOrderedSet orderedSetWithObject:@"Nothing to see here"];
+    NSDictionary* json = [self modelFixtureNamed:@"spam.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        if ([predicate[@"value"] isKindOfClass:[NSString class]])
+            [messages addObject:predicate[@"value"]];
+        return predicate;
+    }];
+    NSMutableArray* messageRows = [NSMutableArray arrayWithCapacity:messages.count];
+    for (NSString* message in messages) {
+        [messageRows addObject:@{ @"Message" : message }];
+    }
+    [self checkCompiledPredictionsOfModel:[[PredictiveModel alloc] initWithJSONModel:json]
+                                     rows:messageRows
+                                  options:@{ @"byName" : @YES }];
+
+    //-- anomaly trees, whose nodes hold lists of predicates
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[self.generator anomalyWithTreeCount:8
+                                                                                           depth:6
+                                                                                      fieldCount:6]];
+    anomaly.recordsBranchHits = YES;
+    NSMutableArray* scores = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        [scores addObject:@([anomaly score:row options:nil])];
+    }
+    anomaly.recordsBranchHits = NO;
+    [anomaly optimizeBranchOrder];
+    for (NSUInteger i = 0; i < rows.count; ++i) {
+        XCTAssertEqualObjects(@([anomaly score:rows[i] options:nil]), scores[i]);
+    }
+}
+
+- (void)testReorderingWhilePredicting {
+
+    //-- the compiled copies are reused by every reorder while predictions walk them
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:8
+                                                                                            fieldCount:6
+                                                                                            classCount:3]];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[self.generator anomalyWithTreeCount:8
+                                                                                           depth:6
+                                                                                      fieldCount:6]];
+    NSArray* rows = [self.generator rowsWithCount:200 fieldCount:6];
+    NSMutableArray* expected = [NSMutableArray arrayWithCapacity:rows.count];
+    NSMutableArray* scores = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        [expected addObject:[model predictWithArguments:row options:nil]];
+        [scores addObject:@([anomaly score:row options:nil])];
+    }
+    NSDictionary* modelOrder = [model branchOrder];
+    NSArray* anomalyOrder = [anomaly branchOrder];
+
+    model.recordsBranchHits = YES;
+    anomaly.recordsBranchHits = YES;
+    for (NSDictionary* row in [rows subarrayWithRange:NSMakeRange(0, 20)]) {
+        [model predictWithArguments:row options:nil];
+        [anomaly score:row options:nil];
+    }
+    model.recordsBranchHits = NO;
+    anomaly.recordsBranchHits = NO;
+
+    __block NSUInteger mismatches = 0;
+    dispatch_apply(4, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        if (thread == 0) {
+            for (NSUInteger round = 0; round < 50; ++round) {
+                [model optimizeBranchOrder];
+                [anomaly optimizeBranchOrder];
+                [model applyBranchOrder:modelOrder];
+                [anomaly applyBranchOrder:anomalyOrder];
+            }
+            return;
+        }
+        for (NSUInteger round = 0; round < 5; ++round) {
+            for (NSUInteger i = 0; i < rows.count; ++i) {
+                if (![[model predictWithArguments:rows[i] options:nil] isEqual:expected[i]] ||
+                    ![@([anomaly score:rows[i] options:nil]) isEqual:scores[i]])
+                    __atomic_fetch_add(&mismatches, 1, __ATOMIC_RELAXED);
+            }
+        }
+    });
+    XCTAssert(mismatches == 0);
+}
+
+- (void)testModelsAreReleased {
+
+    NSDictionary* jsonModel = [self.generator modelWithDepth:8 fieldCount:6 classCount:3];
+    NSDictionary* jsonAnomaly = [self.generator anomalyWithTreeCount:8 depth:6 fieldCount:6];
+    NSDictionary* row = [self.generator rowsWithCount:1 fieldCount:6].firstObject;
+
+    __weak PredictiveModel* weakModel = nil;
+    __weak Anomaly* weakAnomaly = nil;
+    @autoreleasepool {
+        PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+        Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+        XCTAssertNotNil([model explainWithArguments:row options:nil]);
+        XCTAssert([anomaly score:row options:nil] > 0);
+        weakModel = model;
+        weakAnomaly = anomaly;
+    }
+    XCTAssertNil(weakModel);
+    XCTAssertNil(weakAnomaly);
+}
+
+@end
@@ -0,0 +1,118 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "BMLModelHandle.h"
+#import "BMLScoringService.h"
+#import "PredictiveModel.h"
+
+#define HANDLE_TEST_ROWS 50
+#define HANDLE_TEST_VERSIONS 20
+#define HANDLE_TEST_TIMEOUT 30
+
+@interface bigmlObjcModelHandleTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcModelHandleTests
+
+- (void)testVersionsAreReleased {
+
+    __weak PredictiveModel* weakFirst = nil;
+    BMLModelHandle* handle = nil;
+    @autoreleasepool {
+        PredictiveModel* first = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:4
+                                                                                            fieldCount:4
+                                                                                            classCount:2]];
+        weakFirst = first;
+        handle = [[BMLModelHandle alloc] initWithModel:first];
+    }
+    @autoreleasepool {
+        XCTAssert(handle.version == 1 && weakFirst != nil);
+    }
+
+    //-- a reader keeps its version alive after it is replaced
+    PredictiveModel* held = nil;
+    @autoreleasepool {
+        held = [handle currentModel];
+        [handle publishModel:[[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:4
+                                                                                       fieldCount:4
+                                                                                       classCount:2]]];
+        XCTAssert(handle.version == 2 && [handle currentModel] != held);
+        XCTAssert(weakFirst == held);
+    }
+    held = nil;
+    XCTAssert(weakFirst == nil);
+}
+
+- (void)testPublishUnderLoad {
+
+    NSMutableArray* versions = [NSMutableArray arrayWithCapacity:HANDLE_TEST_VERSIONS];
+    for (NSUInteger i = 0; i < HANDLE_TEST_VERSIONS; ++i) {
+        [versions addObject:[self.generator modelWithDepth:6 fieldCount:8 classCount:3]];
+    }
+    NSArray* rows = [self.generator rowsWithCount:HANDLE_TEST_ROWS fieldCount:8];
+    BMLModelHandle* handle =
+    [[BMLModelHandle alloc] initWithModel:[[PredictiveModel alloc] initWithJSONModel:versions[0]]];
+    BMLScoringService* service = [[BMLScoringService alloc] initWithPredictor:handle
+                                                                 maxBatchSize:8
+                                                                     maxDelay:0.001];
+
+    //-- readers check that each model they get is whole while versions are published
+    __block BOOL publishing = YES;
+    __block NSUInteger failures = 0;
+    dispatch_group_t readers = dispatch_group_create();
+    for (NSUInteger reader = 0; reader < 4; ++reader) {
+        dispatch_group_async(readers, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            for (NSUInteger i = 0; publishing || i < HANDLE_TEST_ROWS; ++i) {
+                NSDictionary* row = rows[i % HANDLE_TEST_ROWS];
+                PredictiveModel* model = [handle currentModel];
+                NSArray* first = [model predictWithArguments:row options:nil];
+                NSDictionary* batched = [service scoreArgumentsSync:row options:nil];
+                if (![first isEqualToArray:[model predictWithArguments:row options:nil]] ||
+                    batched[@"prediction"] == nil) {
+                    @synchronized (self) {
+                        ++failures;
+                    }
+                }
+            }
+        });
+    }
+
+    XCTestExpectation* published = [self expectationWithDescription:@"published"];
+    __block NSUInteger next = 1;
+    __block void(^publishNext)(BOOL) = nil;
+    void(^publish)(BOOL) = ^(BOOL done) {
+        if (next == HANDLE_TEST_VERSIONS) {
+            [published fulfill];
+            return;
+        }
+        NSDictionary* version = versions[next++];
+        [handle publishModelFromBuilder:^id{
+            return [[PredictiveModel alloc] initWithJSONModel:version];
+        } completion:publishNext];
+    };
+    publishNext = publish;
+    publish(YES);
+    [self waitForExpectationsWithTimeout:HANDLE_TEST_TIMEOUT handler:nil];
+    publishNext = nil;
+    publishing = NO;
+    dispatch_group_wait(readers, DISPATCH_TIME_FOREVER);
+
+    XCTAssert(failures == 0);
+    XCTAssert(handle.version == HANDLE_TEST_VERSIONS);
+}
+
+@end
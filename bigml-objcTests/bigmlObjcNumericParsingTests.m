@@ -0,0 +1,109 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "FieldResource.h"
+#import "BMLUtils.h"
+
+#define PARSING_TEST_ROWS 200
+
+@interface bigmlObjcNumericParsingTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcNumericParsingTests
+
+- (void)testParseNumber {
+
+    NSData* dollar = [@"$" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData* euro = [@" €" dataUsingEncoding:NSUTF8StringEncoding];
+    double value = 0;
+
+    XCTAssert([BMLUtils parseNumber:@"$12.5" prefix:dollar suffix:nil decimalSeparator:'.' value:&value] &&
+              value == 12.5);
+    XCTAssert([BMLUtils parseNumber:@"12,5 €" prefix:nil suffix:euro decimalSeparator:',' value:&value] &&
+              value == 12.5);
+    XCTAssert([BMLUtils parseNumber:@" -3e2 " prefix:nil suffix:nil decimalSeparator:'.' value:&value] &&
+              value == -300);
+    XCTAssert([BMLUtils parseNumber:@"1.5" prefix:nil suffix:nil decimalSeparator:',' value:&value] &&
+              value == 1.5);
+
+    for (NSString* string in @[ @"", @"-", @"1e", @"abc", @"nan", @"inf", @"1,000.5", @"$" ]) {
+        XCTAssertFalse([BMLUtils parseNumber:string prefix:dollar suffix:nil decimalSeparator:'.' value:&value],
+                       @"%@", string);
+    }
+}
+
+- (void)testStripAffixes {
+
+    NSDictionary* field = @{ @"prefix" : @"<", @"suffix" : @"%" };
+    XCTAssertEqualObjects([BMLUtils stripAffixesFromValue:@"<45%" field:field], @"45");
+    XCTAssertEqualObjects([BMLUtils stripAffixesFromValue:@"4%5%" field:field], @"4%5");
+    XCTAssertEqualObjects([BMLUtils stripAffixesFromValue:@"45" field:field], @"45");
+}
+
+- (void)testDecodedInput {
+
+    NSDictionary* fields = @{ @"000000" : @{ @"name" : @"price", @"optype" : @"numeric",
+                                             @"prefix" : @"$", @"suffix" : @" USD" },
+                              @"000001" : @{ @"name" : @"ratio", @"optype" : @"numeric" },
+                              @"000002" : @{ @"name" : @"color", @"optype" : @"categorical" } };
+    FieldResource* resource = [[FieldResource alloc] initWithFields:fields
+                                                   objectiveFieldId:nil
+                                                             locale:@"de-DE"
+                                                      missingTokens:@[ @"", @"unknown" ]];
+
+    NSDictionary* input = [resource decodedInputData:@{ @"price" : @"$1,25 USD",
+                                                        @"ratio" : @"unknown",
+                                                        @"color" : @"12" }
+                                              byName:YES];
+    XCTAssertEqualObjects(input, (@{ @"000000" : @1.25, @"000002" : @"12" }));
+
+    //-- values reduced to a missing token by stripping are missing too
+    input = [resource decodedInputData:@{ @"price" : @"$", @"ratio" : @"N/A" } byName:YES];
+    XCTAssertEqualObjects(input, (@{ @"000001" : @"N/A" }));
+}
+
+- (void)testStringInputs {
+
+    PredictiveModel* model =
+    [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:8 fieldCount:6 classCount:3]];
+    NSArray* rows = [self.generator rowsWithCount:PARSING_TEST_ROWS fieldCount:6];
+
+    for (NSDictionary* row in rows) {
+        NSMutableDictionary* strings = [NSMutableDictionary dictionaryWithCapacity:row.count];
+        for (NSString* fieldId in row) {
+            strings[fieldId] = [NSString stringWithFormat:@" %.17g", [row[fieldId] doubleValue]];
+        }
+        XCTAssertEqualObjects([model predictWithArguments:strings options:@{ @"byName" : @NO }],
+                              [model predictWithArguments:row options:@{ @"byName" : @NO }]);
+    }
+}
+
+- (void)testStoredModelStringInputs {
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self modelFixtureNamed:@"iris.model"]];
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:@"species"]) {
+        NSMutableDictionary* numbers = [NSMutableDictionary dictionaryWithCapacity:row.count];
+        for (NSString* name in row) {
+            numbers[name] = @([row[name] doubleValue]);
+        }
+        XCTAssertEqualObjects([model predictWithArguments:row options:@{ @"byName" : @YES }],
+                              [model predictWithArguments:numbers options:@{ @"byName" : @YES }]);
+    }
+}
+
+@end
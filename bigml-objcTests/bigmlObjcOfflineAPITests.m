@@ -0,0 +1,356 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import <mach/mach_time.h>
+#import "bigmlObjcFakeServer.h"
+#import "BMLAPIConnector.h"
+#import "BMLResourceTypeIdentifier.h"
+#import "BMLRequestMetrics.h"
+#import "BMLHTTPMethodHandler.h"
+
+//-- API tests running against bigmlObjcFakeServer, which need neither
+//-- credentials nor network access.
+//--
+//-- testLoad measures the throughput and tail latency of the client for a
+//-- number of concurrency levels. Its report is written as JSON to the file
+//-- named by the BML_LOADTEST_OUTPUT environment variable, or to
+//-- bigml-loadtest.json in the temporary directory.
+
+#define OFFLINE_TEST_SEED 20160401
+#define OFFLINE_TEST_TIMEOUT 30
+#define LOAD_TEST_REQUESTS 2000
+#define LOAD_TEST_LATENCY 0.002
+
+@interface bigmlObjcOfflineAPITests : XCTestCase
+
+@property (nonatomic, strong) bigmlObjcFakeServer* server;
+@property (nonatomic, strong) BMLAPIConnector* connector;
+
+@end
+
+@implementation bigmlObjcOfflineAPITests
+
+- (void)setUp {
+
+    [super setUp];
+    self.server = [[bigmlObjcFakeServer alloc] initWithSeed:OFFLINE_TEST_SEED];
+    [self.server start];
+    self.connector = [self.server connector];
+}
+
+- (void)tearDown {
+
+    [self.server stop];
+    [super tearDown];
+}
+
+- (void)runTest:(NSString*)name test:(void(^)(XCTestExpectation*))test {
+
+    XCTestExpectation* exp = [self expectationWithDescription:name];
+    test(exp);
+    [self waitForExpectationsWithTimeout:OFFLINE_TEST_TIMEOUT handler:^(NSError* error) {
+        XCTAssert(error == nil, @"%@ timed out", name);
+    }];
+}
+
+- (void)testCreateTrackUpdateDelete {
+
+    self.server.statusPolls = 1;
+    [self runTest:@"testCreateTrackUpdateDelete" test:^(XCTestExpectation* exp) {
+
+        [self.connector createResource:BMLResourceTypeSource
+                                  name:@"offline"
+                               options:@{ @"remote" : @"s3://bigml-public/csv/iris.csv" }
+                            completion:^(id<BMLResource> resource, NSError* error) {
+
+                                XCTAssert(error == nil && resource.status == BMLResourceStatusEnded);
+                                XCTAssert([resource.jsonDefinition[@"name"] isEqualToString:@"offline"]);
+                                [self.connector updateResource:resource.type
+                                                          uuid:resource.uuid
+                                                        values:@{ @"name" : @"renamed" }
+                                                    completion:^(NSError* error) {
+
+                                    XCTAssert(error == nil);
+                                    [self.connector deleteResource:resource.type
+                                                              uuid:resource.uuid
+                                                        completion:^(NSError* error) {
+
+                                        XCTAssert(error == nil && self.server.resourceCount == 0);
+                                        [exp fulfill];
+                                    }];
+                                }];
+                            }];
+    }];
+}
+
+- (void)testUploadAndList {
+
+    self.server.statusPolls = 0;
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"offline.csv"];
+    [@"a,b\n1,2\n" writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+    [self runTest:@"testUploadAndList" test:^(XCTestExpectation* exp) {
+
+        BMLMinimalResource* file = [[BMLMinimalResource alloc] initWithName:@"offline.csv"
+                                                                       type:BMLResourceTypeFile
+                                                                       uuid:path
+                                                                 definition:@{}];
+        [self.connector createResource:BMLResourceTypeSource
+                                  name:@"offline.csv"
+                               options:nil
+                                  from:file
+                            completion:^(id<BMLResource> resource, NSError* error) {
+
+                                XCTAssert(error == nil);
+                                [self.connector listResources:BMLResourceTypeSource
+                                                      filters:@{ @"limit" : @10 }
+                                                   completion:^(NSArray* resources, NSError* error) {
+
+                                                       XCTAssert(error == nil && resources.count == 1);
+                                                       XCTAssert([[resources.firstObject name] isEqualToString:@"offline.csv"]);
+                                                       [exp fulfill];
+                                                   }];
+                            }];
+    }];
+}
+
+- (void)testStatusTracking {
+
+    self.server.statusPolls = 3;
+    [self runTest:@"testStatusTracking" test:^(XCTestExpectation* exp) {
+
+        [self.connector createResource:BMLResourceTypeSource
+                                  name:@"tracked"
+                               options:@{ @"remote" : @"s3://bigml-public/csv/iris.csv" }
+                            completion:^(id<BMLResource> resource, NSError* error) {
+
+                                XCTAssert(error == nil && resource.status == BMLResourceStatusEnded);
+                                XCTAssert([self.server requestCountForMethod:@"GET"] == 3);
+                                [exp fulfill];
+                            }];
+    }];
+}
+
+- (void)testInjectedErrors {
+
+    [self.server failNextRequests:1 statusCode:500];
+    [self runTest:@"testInjectedErrors" test:^(XCTestExpectation* exp) {
+
+        [self.connector getResource:BMLResourceTypeDataset
+                               uuid:@"000000000000000000000001"
+                         completion:^(id<BMLResource> resource, NSError* error) {
+
+                             XCTAssert(resource == nil && error.code == 500);
+                             [exp fulfill];
+                         }];
+    }];
+}
+
+- (void)testUnexpectedCodeKeepsBody {
+
+    //-- listing answers with code 200, so expecting 201 fails while the body is still decoded
+    NSURL* url = [NSURL URLWithString:[self.server.serverUrl stringByAppendingString:@"/andromeda/dataset"]];
+    BMLHTTPMethodHandler* handler = [[BMLHTTPMethodHandler alloc] initWithMethod:@"GET" expectedCode:201];
+    [self runTest:@"testUnexpectedCodeKeepsBody" test:^(XCTestExpectation* exp) {
+
+        [handler runWithURL:url
+                       data:nil
+                 completion:^(NSDictionary* dict, NSError* error) {
+
+                     XCTAssert(error.code == 200);
+                     XCTAssert([dict[@"code"] integerValue] == 200 && dict[@"meta"] != nil);
+                     [exp fulfill];
+                 }];
+    }];
+}
+
+- (void)testBulkCreateRetriesInjectedErrors {
+
+    self.server.statusPolls = 0;
+    [self.server failNextRequests:3 statusCode:429];
+    [self runTest:@"testBulkCreateRetriesInjectedErrors" test:^(XCTestExpectation* exp) {
+
+        NSArray* requests = @[ @{ @"name" : @"a" }, @{ @"name" : @"b" }, @{ @"name" : @"c" } ];
+        [self.connector createResources:BMLResourceTypeProject
+                               requests:requests
+                            parallelism:3
+                             maxRetries:4
+                             completion:^(NSArray* resources, NSDictionary* errors) {
+
+                                 XCTAssert(resources.count == 3 && errors.count == 0);
+                                 XCTAssert(self.server.resourceCount == 3);
+                                 [exp fulfill];
+                             }];
+    }];
+}
+
+- (void)testBulkCreateDoesNotRepeatAcceptedPosts {
+
+    //-- a 5xx answer to a POST may follow an accepted creation: never send it again
+    self.server.statusPolls = 0;
+    [self.server failNextRequests:1 statusCode:503];
+    [self runTest:@"testBulkCreateDoesNotRepeatAcceptedPosts" test:^(XCTestExpectation* exp) {
+
+        [self.connector createResources:BMLResourceTypeProject
+                               requests:@[ @{ @"name" : @"a" } ]
+                            parallelism:1
+                             maxRetries:4
+                             completion:^(NSArray* resources, NSDictionary* errors) {
+
+                                 XCTAssert([errors[@0] code] == 503);
+                                 XCTAssert([self.server requestCountForMethod:@"POST"] == 1);
+                                 [exp fulfill];
+                             }];
+    }];
+}
+
+- (NSDictionary*)metricsSnapshotWhenCount:(NSUInteger)count
+                               operation:(NSString*)operation
+                                 metrics:(BMLRequestMetrics*)metrics {
+
+    //-- traces may still be waiting for their task metrics
+    NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:OFFLINE_TEST_TIMEOUT];
+    while ([[metrics snapshot][@"operations"][operation][@"count"] unsignedIntegerValue] < count &&
+           [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    return [metrics snapshot];
+}
+
+- (void)testRequestMetrics {
+
+    self.server.statusPolls = 0;
+    [self.server failNextRequests:2 statusCode:429];
+    BMLRequestMetrics* metrics = [BMLRequestMetrics new];
+    self.connector.requestObserver = metrics;
+    [self runTest:@"testRequestMetrics" test:^(XCTestExpectation* exp) {
+
+        NSArray* requests = @[ @{ @"name" : @"a" }, @{ @"name" : @"b" } ];
+        [self.connector createResources:BMLResourceTypeProject
+                               requests:requests
+                            parallelism:1
+                             maxRetries:4
+                             completion:^(NSArray* resources, NSDictionary* errors) {
+
+                                 XCTAssert(resources.count == 2 && errors.count == 0);
+                                 [exp fulfill];
+                             }];
+    }];
+
+    NSDictionary* snapshot = [self metricsSnapshotWhenCount:4 operation:@"project POST" metrics:metrics];
+    NSDictionary* posts = snapshot[@"operations"][@"project POST"];
+    XCTAssert([posts[@"count"] unsignedIntegerValue] == 4);
+    XCTAssert([posts[@"statusCodes"][@"429"] unsignedIntegerValue] == 2);
+    XCTAssert([posts[@"statusCodes"][@"201"] unsignedIntegerValue] == 2);
+    XCTAssert([posts[@"requestBytes"] longLongValue] > 0 && [posts[@"responseBytes"] longLongValue] > 0);
+    XCTAssert([posts[@"p99Ms"] doubleValue] >= [posts[@"p50Ms"] doubleValue]);
+    XCTAssert([snapshot[@"retries"] unsignedIntegerValue] == 2);
+}
+
+#pragma mark Load test
+
+static int compareDoubles(const void* a, const void* b) {
+
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Issues `count` GET requests for the same resource keeping `concurrency`
+ * of them in flight, and reports requests/sec and latency percentiles.
+ */
+- (NSDictionary*)loadWithRequests:(NSUInteger)count
+                      concurrency:(NSUInteger)concurrency
+                         resource:(id<BMLResource>)resource {
+
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+
+    double* latencies = calloc(count, sizeof(double));
+    dispatch_semaphore_t slots = dispatch_semaphore_create(concurrency);
+    dispatch_group_t group = dispatch_group_create();
+    NSUInteger __block errors = 0;
+
+    uint64_t start = mach_absolute_time();
+    for (NSUInteger i = 0; i < count; ++i) {
+
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        dispatch_group_enter(group);
+        uint64_t t0 = mach_absolute_time();
+        [self.connector getResource:resource.type
+                               uuid:resource.uuid
+                         completion:^(id<BMLResource> r, NSError* error) {
+
+                             latencies[i] = (double)(mach_absolute_time() - t0) * timebase.numer / timebase.denom;
+                             if (error) {
+                                 @synchronized (self) {
+                                     ++errors;
+                                 }
+                             }
+                             dispatch_semaphore_signal(slots);
+                             dispatch_group_leave(group);
+                         }];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    double elapsed = (double)(mach_absolute_time() - start) * timebase.numer / timebase.denom;
+
+    qsort(latencies, count, sizeof(double), compareDoubles);
+    NSDictionary* result = @{ @"requests" : @(count),
+                              @"concurrency" : @(concurrency),
+                              @"server_latency_ms" : @(self.server.latency * 1000),
+                              @"errors" : @(errors),
+                              @"requests_per_sec" : @(count / (elapsed / NSEC_PER_SEC)),
+                              @"p50_ms" : @(latencies[count / 2] / NSEC_PER_MSEC),
+                              @"p99_ms" : @(latencies[MIN(count - 1, count * 99 / 100)] / NSEC_PER_MSEC),
+                              @"max_ms" : @(latencies[count - 1] / NSEC_PER_MSEC) };
+    free(latencies);
+    return result;
+}
+
+- (void)testLoad {
+
+    self.server.statusPolls = 0;
+    id<BMLResource> __block resource = nil;
+    [self runTest:@"testLoad" test:^(XCTestExpectation* exp) {
+
+        [self.connector createResource:BMLResourceTypeProject
+                                  name:@"load"
+                               options:nil
+                            completion:^(id<BMLResource> r, NSError* error) {
+                                resource = r;
+                                [exp fulfill];
+                            }];
+    }];
+    XCTAssert(resource != nil);
+
+    self.server.latency = LOAD_TEST_LATENCY;
+    NSMutableArray* results = [NSMutableArray array];
+    for (NSNumber* concurrency in @[ @1, @8, @32, @128 ]) {
+        NSDictionary* result = [self loadWithRequests:LOAD_TEST_REQUESTS
+                                          concurrency:concurrency.unsignedIntegerValue
+                                             resource:resource];
+        XCTAssert([result[@"errors"] unsignedIntegerValue] == 0);
+        [results addObject:result];
+    }
+
+    NSString* path = [[NSProcessInfo processInfo] environment][@"BML_LOADTEST_OUTPUT"] ?:
+    [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-loadtest.json"];
+    NSData* data = [NSJSONSerialization dataWithJSONObject:@{ @"date" : [[NSDate date] description],
+                                                              @"results" : results }
+                                                   options:NSJSONWritingPrettyPrinted
+                                                     error:nil];
+    [data writeToFile:path atomically:YES];
+}
+
+@end
@@ -0,0 +1,148 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "Predicates.h"
+#import "PredictiveModel.h"
+#import "PredictiveEnsemble.h"
+
+@interface bigmlObjcPredicateTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcPredicateTests
+
+- (NSDictionary*)spamModelWithTokenMode:(NSString*)tokenMode {
+
+    NSDictionary* fields = @{ @"000000" : @{ @"name" : @"message",
+                                             @"optype" : @"text",
+                                             @"column_number" : @0,
+                                             @"term_analysis" : @{ @"case_sensitive" : @NO,
+                                                                   @"token_mode" : tokenMode },
+                                             @"summary" : @{ @"term_forms" : @{ @"win" : @[ @"wins", @"winning" ] } } },
+                              @"000001" : @{ @"name" : @"label",
+                                             @"optype" : @"categorical",
+                                             @"column_number" : @1,
+                                             @"summary" : @{ @"categories" : @[] } } };
+    NSDictionary* (^leaf)(NSString*, NSString*, NSUInteger) = ^(NSString* op, NSString* output, NSUInteger count) {
+        return @{ @"predicate" : @{ @"operator" : op, @"field" : @"000000", @"value" : @1, @"term" : @"win" },
+                  @"output" : output,
+                  @"confidence" : @0.9,
+                  @"count" : @(count),
+                  @"distribution" : @[ @[ output, @(count) ] ],
+                  @"children" : @[] };
+    };
+    NSDictionary* root = @{ @"predicate" : @YES,
+                            @"output" : @"ham",
+                            @"confidence" : @0.6,
+                            @"count" : @100,
+                            @"distribution" : @[ @[ @"ham", @60 ], @[ @"spam", @40 ] ],
+                            @"children" : @[ leaf(@">", @"spam", 40), leaf(@"<=", @"ham", 60) ] };
+    return @{ @"object" : @{ @"status" : @{ @"code" : @5 },
+                             @"objective_fields" : @[ @"000001" ],
+                             @"model" : @{ @"model_fields" : fields,
+                                           @"fields" : fields,
+                                           @"root" : root } } };
+}
+
+- (void)testTermFrequencies {
+
+    TermFrequencies* terms = [[TermFrequencies alloc] initWithText:@"Win big, WINNING_streak: wins win"
+                                                      termAnalysis:@{ @"case_sensitive" : @NO,
+                                                                      @"token_mode" : @"tokens_only" }];
+    XCTAssert([terms countForTerms:@[ @"win" ]] == 2);
+    XCTAssert([terms countForTerms:@[ @"win", @"wins", @"winning", @"win" ]] == 4);
+    XCTAssert([terms countForTerms:@[ @"streak" ]] == 1);
+
+    TermFrequencies* full = [[TermFrequencies alloc] initWithText:@"Big Win"
+                                                     termAnalysis:@{ @"case_sensitive" : @NO,
+                                                                     @"token_mode" : @"all" }];
+    XCTAssert([full countForTerms:@[ @"big win" ]] == 1);
+    XCTAssert([full countForTerms:@[ @"win" ]] == 1);
+}
+
+- (void)testPhraseTerms {
+
+    TermFrequencies* terms = [[TermFrequencies alloc] initWithText:@"New York, new-york and NEW YORK_city; an e-mail or two e-mails"
+                                                      termAnalysis:@{ @"case_sensitive" : @NO,
+                                                                      @"token_mode" : @"tokens_only" }];
+    XCTAssert([terms countForTerms:@[ @"new york" ]] == 2);
+    XCTAssert([terms countForTerms:@[ @"new york", @"new-york" ]] == 3);
+    XCTAssert([terms countForTerms:@[ @"e-mail" ]] == 1);
+    XCTAssert([terms countForTerms:@[ @"york" ]] == 3);
+
+    //-- forms listed in the field summary are searched for as well
+    NSDictionary* fields = @{ @"000000" : @{ @"name" : @"city",
+                                             @"optype" : @"text",
+                                             @"term_analysis" : @{ @"case_sensitive" : @NO,
+                                                                   @"token_mode" : @"tokens_only" },
+                                             @"summary" : @{ @"term_forms" : @{ @"new york" : @[ @"new-york" ] } } } };
+    Predicate* predicate = [[Predicate alloc] initWithOperator:@">" field:@"000000" value:@1 term:@"new york"];
+    XCTAssert([predicate apply:@{ @"000000" : @"new York or New-York" } fields:fields]);
+    XCTAssert(![predicate apply:@{ @"000000" : @"New York, not York" } fields:fields]);
+}
+
+- (void)testTextPredictions {
+
+    NSDictionary* json = [self spamModelWithTokenMode:@"tokens_only"];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    NSDictionary* spam = @{ @"message" : @"You WIN, everybody wins" };
+    NSDictionary* ham = @{ @"message" : @"Lunch at noon?" };
+    XCTAssertEqualObjects([[model predictWithArguments:spam options:@{ @"byName" : @YES }] firstObject][@"prediction"], @"spam");
+    XCTAssertEqualObjects([[model predictWithArguments:ham options:@{ @"byName" : @YES }] firstObject][@"prediction"], @"ham");
+
+    //-- rows tokenized once by the ensemble give the same predictions
+    PredictiveEnsemble* ensemble = [[PredictiveEnsemble alloc] initWithModels:@[ json, json, json ]
+                                                                    maxModels:0
+                                                                distributions:nil];
+    XCTAssertEqualObjects([ensemble predictWithArguments:spam options:@{ @"byName" : @YES }][@"prediction"], @"spam");
+    XCTAssertEqualObjects([ensemble predictWithArguments:ham options:@{ @"byName" : @YES }][@"prediction"], @"ham");
+}
+
+- (void)testInPredicate {
+
+    NSMutableArray* zips = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 5000; ++i) {
+        [zips addObject:[NSString stringWithFormat:@"%05lu", (unsigned long)(i * 7)]];
+    }
+    NSDictionary* fields = @{ @"000000" : @{ @"name" : @"zip", @"optype" : @"categorical" } };
+    Predicate* predicate = [[Predicate alloc] initWithOperator:@"in" field:@"000000" value:zips term:nil];
+    XCTAssert([predicate apply:@{ @"000000" : @"00014" } fields:fields]);
+    XCTAssert(![predicate apply:@{ @"000000" : @"00015" } fields:fields]);
+    XCTAssert(![predicate apply:@{} fields:fields]);
+
+    Predicate* orMissing = [[Predicate alloc] initWithOperator:@"in*" field:@"000000" value:zips term:nil];
+    XCTAssert([orMissing apply:@{} fields:fields]);
+}
+
+- (void)testStoredCategoricalModel {
+
+    NSDictionary* json = [self modelFixtureNamed:@"spam.model"];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    NSDictionary* options = @{ @"byName" : @YES };
+    NSString* spamMessage = json[@"model"][@"root"][@"children"][0][@"predicate"][@"value"];
+
+    XCTAssertEqualObjects([[model predictWithArguments:@{ @"Message" : spamMessage } options:options]
+                           firstObject][@"prediction"], @"spam");
+    XCTAssertEqualObjects([[model predictWithArguments:@{ @"Message" : @"Ok lar... Joking wif u oni..." }
+                                               options:options] firstObject][@"prediction"], @"ham");
+
+    //-- a missing message stops at the root
+    NSDictionary* root = [[model predictWithArguments:@{} options:options] firstObject];
+    XCTAssertEqualObjects(root[@"prediction"], @"ham");
+    XCTAssert([root[@"count"] unsignedIntegerValue] == 656);
+}
+
+@end
@@ -0,0 +1,181 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "Anomaly.h"
+#import "PredictionCache.h"
+
+#define CACHE_TEST_ROWS 100
+
+@interface bigmlObjcPredictionCacheTests : bigmlObjcLocalTestCase
+
+@end
+
+@implementation bigmlObjcPredictionCacheTests
+
+- (void)testEviction {
+
+    PredictionCache* cache = [[PredictionCache alloc] initWithCapacity:2];
+    __block NSUInteger computed = 0;
+    id(^compute)(void) = ^id{
+        return @(++computed);
+    };
+    NSDictionary* a = @{ @"000000" : @1 };
+    NSDictionary* b = @{ @"000000" : @2 };
+    NSDictionary* c = @{ @"000000" : @3 };
+
+    XCTAssertEqualObjects([cache resultForInput:a options:nil compute:compute], @1);
+    XCTAssertEqualObjects([cache resultForInput:b options:nil compute:compute], @2);
+    XCTAssertEqualObjects([cache resultForInput:a options:@{ @"byName" : @NO } compute:compute], @1);
+
+    //-- b is now the least recently used result
+    XCTAssertEqualObjects([cache resultForInput:c options:nil compute:compute], @3);
+    XCTAssertEqualObjects([cache resultForInput:a options:nil compute:compute], @1);
+    XCTAssertEqualObjects([cache resultForInput:b options:nil compute:compute], @4);
+    XCTAssertEqualObjects([cache resultForInput:b options:@{ @"multiple" : @2 } compute:compute], @5);
+
+    XCTAssert(cache.count == 2 && cache.hits == 2 && cache.misses == 5 && cache.evictions == 3);
+    [cache removeAllResults];
+    XCTAssert(cache.count == 0 && cache.hits == 0 && [cache hitRate] == 0);
+}
+
+- (void)testImmutableResults {
+
+    PredictionCache* cache = [[PredictionCache alloc] initWithCapacity:2];
+    NSMutableDictionary* prediction = [@{ @"prediction" : @"ham" } mutableCopy];
+    NSArray* result = [cache resultForInput:@{ @"000001" : @"Hello" } options:nil compute:^id{
+        return [NSMutableArray arrayWithObject:prediction];
+    }];
+    prediction[@"prediction"] = @"spam";
+    XCTAssertEqualObjects(result.firstObject[@"prediction"], @"ham");
+    XCTAssertEqualObjects([[cache resultForInput:@{ @"000001" : @"Hello" } options:nil compute:^id{
+        return nil;
+    }] firstObject][@"prediction"], @"ham");
+}
+
+- (void)checkCachedPredictionsOfModel:(NSDictionary*)json rows:(NSArray*)rows {
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    PredictiveModel* cached = [[PredictiveModel alloc] initWithJSONModel:json];
+    cached.predictionCache = [[PredictionCache alloc] initWithCapacity:rows.count];
+    NSDictionary* options = @{ @"byName" : @YES };
+    for (NSUInteger pass = 0; pass < 2; ++pass) {
+        for (NSDictionary* row in rows) {
+            XCTAssertEqualObjects([cached predictWithArguments:row options:options],
+                                  [model predictWithArguments:row options:options]);
+        }
+    }
+    XCTAssert(cached.predictionCache.hits == rows.count);
+    XCTAssert(cached.predictionCache.misses == rows.count);
+}
+
+- (void)testStoredModels {
+
+    //-- the messages spam.model splits on, which reach all its leaves
+    NSMutableOrderedSet* messages = [NSMutableOrderedSet orderedSetWithObject:@"Nothing to see here"];
+    NSDictionary* json = [self modelFixtureNamed:@"spam.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        if ([predicate[@"value"] isKindOfClass:[NSString class]])
+            [messages addObject:predicate[@"value"]];
+        return predicate;
+    }];
+    NSMutableArray* rows = [NSMutableArray arrayWithCapacity:messages.count];
+    for (NSString* message in messages) {
+        [rows addObject:@{ @"Message" : message }];
+    }
+    [self checkCachedPredictionsOfModel:json rows:rows];
+
+    //-- the same splits on a text field: decoded rows carry TermFrequencies
+    NSMutableDictionary* text = [[self modelFixtureNamed:@"spam.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        if (![predicate[@"value"] isKindOfClass:[NSString class]])
+            return predicate;
+        return @{ @"operator" : [predicate[@"operator"] isEqualToString:@"="] ? @">=" : @"<",
+                  @"field" : predicate[@"field"],
+                  @"value" : @1,
+                  @"term" : predicate[@"value"] };
+    }] mutableCopy];
+    NSMutableDictionary* model = [text[@"model"] mutableCopy];
+    NSMutableDictionary* modelFields = [model[@"model_fields"] mutableCopy];
+    NSMutableDictionary* message = [modelFields[@"000001"] mutableCopy];
+    message[@"optype"] = @"text";
+    message[@"term_analysis"] = @{ @"case_sensitive" : @NO, @"token_mode" : @"tokens_only" };
+    modelFields[@"000001"] = message;
+    model[@"model_fields"] = modelFields;
+    text[@"model"] = model;
+    [self checkCachedPredictionsOfModel:text rows:rows];
+}
+
+- (void)testCachedPredictions {
+
+    NSDictionary* jsonModel = [self.generator modelWithDepth:6 fieldCount:8 classCount:3];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+    PredictiveModel* cached = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+    cached.predictionCache = [[PredictionCache alloc] initWithCapacity:CACHE_TEST_ROWS];
+    NSDictionary* jsonAnomaly = [self.generator anomalyWithTreeCount:16 depth:6 fieldCount:8];
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+    Anomaly* cachedAnomaly = [[Anomaly alloc] initWithJSONAnomaly:jsonAnomaly];
+    cachedAnomaly.predictionCache = [[PredictionCache alloc] initWithCapacity:CACHE_TEST_ROWS / 2];
+    NSArray* rows = [self.generator rowsWithCount:CACHE_TEST_ROWS fieldCount:8];
+
+    for (NSUInteger pass = 0; pass < 2; ++pass) {
+        for (NSDictionary* row in rows) {
+            XCTAssertEqualObjects([cached predictWithArguments:row options:nil],
+                                  [model predictWithArguments:row options:nil]);
+            XCTAssertEqualObjects([cached predictWithArguments:row options:@{ @"multiple" : @3 }],
+                                  [model predictWithArguments:row options:@{ @"multiple" : @3 }]);
+        }
+    }
+    XCTAssert(cached.predictionCache.hits == 2 * CACHE_TEST_ROWS);
+    XCTAssert(cached.predictionCache.misses == 2 * CACHE_TEST_ROWS);
+    XCTAssert(cached.predictionCache.count == CACHE_TEST_ROWS);
+
+    //-- under LRU, cyclic scans over more rows than the capacity never hit
+    for (NSUInteger pass = 0; pass < 2; ++pass) {
+        for (NSDictionary* row in rows) {
+            XCTAssert([cachedAnomaly score:row options:nil] == [anomaly score:row options:nil]);
+        }
+    }
+    XCTAssert(cachedAnomaly.predictionCache.hits == 0);
+    XCTAssert(cachedAnomaly.predictionCache.evictions == 3 * CACHE_TEST_ROWS / 2);
+}
+
+- (void)testConcurrentAccess {
+
+    NSDictionary* jsonModel = [self.generator modelWithDepth:6 fieldCount:8 classCount:3];
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+    PredictiveModel* cached = [[PredictiveModel alloc] initWithJSONModel:jsonModel];
+    cached.predictionCache = [[PredictionCache alloc] initWithCapacity:CACHE_TEST_ROWS / 4];
+    NSArray* rows = [self.generator rowsWithCount:CACHE_TEST_ROWS fieldCount:8];
+    NSMutableArray* expected = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSDictionary* row in rows) {
+        [expected addObject:[model predictWithArguments:row options:nil]];
+    }
+
+    __block NSUInteger mismatches = 0;
+    dispatch_apply(16 * CACHE_TEST_ROWS, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        //-- a skewed choice of rows, so that some are hit while others are evicted
+        NSUInteger index = (i * i) % rows.count;
+        if (![[cached predictWithArguments:rows[index] options:nil] isEqualToArray:expected[index]]) {
+            @synchronized (self) {
+                ++mismatches;
+            }
+        }
+    });
+    XCTAssert(mismatches == 0);
+    XCTAssert(cached.predictionCache.hits + cached.predictionCache.misses == 16 * CACHE_TEST_ROWS);
+    XCTAssert(cached.predictionCache.count <= CACHE_TEST_ROWS / 4);
+}
+
+@end
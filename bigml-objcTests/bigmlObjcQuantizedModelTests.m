@@ -0,0 +1,162 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "PredictiveModel.h"
+#import "QuantizedModel.h"
+
+#define QUANTIZED_TEST_ROWS 500
+
+@interface bigmlObjcQuantizedModelTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) NSDictionary* json;
+@property (nonatomic, strong) PredictiveModel* model;
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+@implementation bigmlObjcQuantizedModelTests
+
+- (void)setUp {
+
+    [super setUp];
+    self.json = [self.generator modelWithDepth:8 fieldCount:6 classCount:4];
+    self.model = [[PredictiveModel alloc] initWithJSONModel:self.json];
+    self.rows = [self.generator rowsWithCount:QUANTIZED_TEST_ROWS fieldCount:6];
+}
+
+- (void)testSinglePrecision {
+
+    QuantizedModel* quantized = [[QuantizedModel alloc] initWithJSONModel:self.json
+                                                                precision:BMLThresholdPrecisionFloat32];
+    XCTAssert(quantized.nodeCount == (1 << 9) - 1);
+    for (NSDictionary* row in self.rows) {
+        NSDictionary* expected = [[self.model predictWithArguments:row options:nil] firstObject];
+        NSDictionary* prediction = [quantized predictWithArguments:row options:nil];
+        XCTAssertEqualObjects(prediction[@"prediction"], expected[@"prediction"]);
+        XCTAssertEqualObjects(prediction[@"count"], expected[@"count"]);
+        XCTAssertEqualObjects(prediction[@"distribution"], expected[@"distribution"]);
+        XCTAssertEqualWithAccuracy([prediction[@"confidence"] doubleValue],
+                                   [expected[@"confidence"] doubleValue], 1e-4);
+    }
+    XCTAssert([[quantized accuracyAgainstModel:self.model rows:self.rows byName:NO][@"agreement"] doubleValue] == 1);
+}
+
+- (void)testHalfPrecision {
+
+    QuantizedModel* single = [[QuantizedModel alloc] initWithJSONModel:self.json
+                                                             precision:BMLThresholdPrecisionFloat32];
+    QuantizedModel* half = [[QuantizedModel alloc] initWithJSONModel:self.json
+                                                           precision:BMLThresholdPrecisionFloat16];
+    XCTAssert(half.byteSize < single.byteSize);
+
+    NSDictionary* report = [half accuracyAgainstModel:self.model rows:self.rows byName:NO];
+    XCTAssert([report[@"rows"] unsignedIntegerValue] == QUANTIZED_TEST_ROWS);
+    XCTAssert([report[@"agreement"] doubleValue] > 0.9);
+    XCTAssert(report[@"accuracyDelta"] == nil);
+}
+
+- (void)testLargeThresholds {
+
+    //-- iris measured in hundredths of a micron: thresholds up to ~700000
+    double scale = 1e5;
+    NSDictionary* json = [self modelFixtureNamed:@"iris.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        NSMutableDictionary* scaled = [predicate mutableCopy];
+        scaled[@"value"] = @([predicate[@"value"] doubleValue] * scale);
+        return scaled;
+    }];
+    NSMutableArray* rows = [NSMutableArray array];
+    for (NSDictionary* row in [self rowsOfCSVFixtureNamed:@"iris.csv" excludingColumn:@"species"]) {
+        NSMutableDictionary* scaledRow = [NSMutableDictionary dictionaryWithCapacity:row.count];
+        for (NSString* name in row) {
+            scaledRow[name] = @([row[name] doubleValue] * scale);
+        }
+        [rows addObject:scaledRow];
+    }
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:json];
+    QuantizedModel* half = [[QuantizedModel alloc] initWithJSONModel:json precision:BMLThresholdPrecisionFloat16];
+    XCTAssert(half.precision == BMLThresholdPrecisionFloat32);
+    XCTAssert([[half accuracyAgainstModel:model rows:rows byName:YES][@"agreement"] doubleValue] == 1);
+
+    //-- the original thresholds fit in half precision
+    QuantizedModel* iris = [[QuantizedModel alloc] initWithJSONModel:[self modelFixtureNamed:@"iris.model"]
+                                                            precision:BMLThresholdPrecisionFloat16];
+    XCTAssert(iris.precision == BMLThresholdPrecisionFloat16);
+}
+
+- (void)testStoredCategoricalModel {
+
+    //-- spam.model splits on "=" and "!="; the copy tests the same sets with "in"
+    NSMutableArray* rows = [NSMutableArray arrayWithObject:@{ @"Message" : @"Nothing to see here" }];
+    NSDictionary* json = [self modelFixtureNamed:@"spam.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        if ([predicate[@"value"] isKindOfClass:[NSString class]])
+            [rows addObject:@{ @"Message" : predicate[@"value"] }];
+        return predicate;
+    }];
+    NSDictionary* inJSON = [self modelFixtureNamed:@"spam.model" mappingPredicates:^NSDictionary*(NSDictionary* predicate) {
+        if (![predicate[@"operator"] isEqualToString:@"="] || ![predicate[@"value"] isKindOfClass:[NSString class]])
+            return predicate;
+        return @{ @"operator" : @"in", @"field" : predicate[@"field"], @"value" : @[ predicate[@"value"] ] };
+    }];
+    XCTAssert(rows.count > 1);
+
+    for (NSDictionary* definition in @[ json, inJSON ]) {
+
+        PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:definition];
+        QuantizedModel* quantized = [[QuantizedModel alloc] initWithJSONModel:definition
+                                                                    precision:BMLThresholdPrecisionFloat16];
+        XCTAssert(quantized != nil && quantized.nodeCount == 159);
+        for (NSDictionary* row in rows) {
+            NSDictionary* expected = [[model predictWithArguments:row options:@{ @"byName" : @YES }] firstObject];
+            NSDictionary* prediction = [quantized predictWithArguments:row options:@{ @"byName" : @YES }];
+            XCTAssertEqualObjects(prediction[@"prediction"], expected[@"prediction"]);
+            XCTAssertEqualObjects(prediction[@"count"], expected[@"count"]);
+        }
+    }
+}
+
+- (void)testValidationFile {
+
+    //-- label every row with the full model's prediction, so that its accuracy is 1
+    NSArray* fieldIds = [self.rows.firstObject allKeys];
+    NSArray* names = [self.model.fieldNameById objectsForKeys:fieldIds notFoundMarker:@""];
+    NSMutableString* csv = [NSMutableString stringWithFormat:@"%@,objective\n",
+                            [names componentsJoinedByString:@","]];
+    for (NSDictionary* row in self.rows) {
+        for (NSString* fieldId in fieldIds) {
+            [csv appendFormat:@"%.17g,", [row[fieldId] doubleValue]];
+        }
+        NSString* label = [[self.model predictWithArguments:row options:nil] firstObject][@"prediction"];
+        [csv appendFormat:@"\"%@\"\n", label];
+    }
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bigml-validation.csv"];
+    [csv writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+
+    QuantizedModel* half = [[QuantizedModel alloc] initWithJSONModel:self.json
+                                                           precision:BMLThresholdPrecisionFloat16];
+    NSError* error = nil;
+    NSDictionary* report = [half accuracyAgainstModel:self.model validationFile:path error:&error];
+    XCTAssert(error == nil);
+    XCTAssertEqualWithAccuracy([report[@"fullAccuracy"] doubleValue], 1, 1e-12);
+    XCTAssertEqualWithAccuracy([report[@"accuracyDelta"] doubleValue],
+                               [report[@"quantizedAccuracy"] doubleValue] - 1, 1e-12);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+
+    XCTAssert([half accuracyAgainstModel:self.model validationFile:path error:&error] == nil && error != nil);
+}
+
+@end
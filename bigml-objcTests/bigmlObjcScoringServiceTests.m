@@ -0,0 +1,112 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <XCTest/XCTest.h>
+#import "bigmlObjcLocalTestCase.h"
+#import "BMLScoringService.h"
+#import "PredictiveEnsemble.h"
+#import "PredictiveModel.h"
+#import "Anomaly.h"
+
+#define SERVICE_TEST_ROWS 400
+#define SERVICE_TEST_TIMEOUT 30
+
+@interface bigmlObjcScoringServiceTests : bigmlObjcLocalTestCase
+
+@property (nonatomic, strong) NSArray* rows;
+
+@end
+
+@implementation bigmlObjcScoringServiceTests
+
+- (void)setUp {
+
+    [super setUp];
+    self.rows = [self.generator rowsWithCount:SERVICE_TEST_ROWS fieldCount:8];
+}
+
+- (void)testConcurrentCallers {
+
+    PredictiveEnsemble* ensemble =
+    [[PredictiveEnsemble alloc] initWithModels:[self.generator ensembleWithModelCount:21
+                                                                                depth:6
+                                                                           fieldCount:8
+                                                                           classCount:3]
+                                     maxModels:0
+                                 distributions:nil];
+    BMLScoringService* service = [[BMLScoringService alloc] initWithPredictor:ensemble
+                                                                 maxBatchSize:32
+                                                                     maxDelay:0.005];
+    NSArray* optionSets = @[ @{}, @{ @"distribution" : @YES } ];
+
+    __block NSUInteger mismatches = 0;
+    dispatch_apply(self.rows.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSDictionary* options = optionSets[i % optionSets.count];
+        NSDictionary* result = [service scoreArgumentsSync:self.rows[i] options:options];
+        if (![result isEqualToDictionary:[ensemble predictWithArguments:self.rows[i] options:options]]) {
+            @synchronized (self) {
+                ++mismatches;
+            }
+        }
+    });
+    XCTAssert(mismatches == 0);
+    XCTAssert(service.rowCount == SERVICE_TEST_ROWS);
+    XCTAssert(service.batchCount <= SERVICE_TEST_ROWS && [service meanBatchSize] >= 1);
+}
+
+- (void)testBatchSizeAndDelay {
+
+    PredictiveModel* model = [[PredictiveModel alloc] initWithJSONModel:[self.generator modelWithDepth:6
+                                                                                            fieldCount:8
+                                                                                            classCount:3]];
+    BMLScoringService* service = [[BMLScoringService alloc] initWithPredictor:model
+                                                                 maxBatchSize:10
+                                                                     maxDelay:60];
+
+    //-- a full batch is scored at once, however long the delay
+    XCTestExpectation* full = [self expectationWithDescription:@"full batch"];
+    __block NSUInteger completed = 0;
+    for (NSUInteger i = 0; i < 10; ++i) {
+        [service scoreArguments:self.rows[i] options:nil completion:^(NSDictionary* result) {
+            XCTAssertEqualObjects(result, [[model predictWithArguments:self.rows[i] options:nil] firstObject]);
+            @synchronized (self) {
+                if (++completed == 10)
+                    [full fulfill];
+            }
+        }];
+    }
+    [self waitForExpectationsWithTimeout:SERVICE_TEST_TIMEOUT handler:nil];
+    XCTAssert(service.batchCount == 1);
+
+    //-- an incomplete one waits for its delay, or a flush
+    XCTestExpectation* flushed = [self expectationWithDescription:@"flushed batch"];
+    [service scoreArguments:self.rows[0] options:nil completion:^(NSDictionary* result) {
+        XCTAssert(result[@"prediction"] != nil);
+        [flushed fulfill];
+    }];
+    [service flush];
+    [self waitForExpectationsWithTimeout:SERVICE_TEST_TIMEOUT handler:nil];
+    XCTAssert(service.batchCount == 2 && service.rowCount == 11);
+
+    Anomaly* anomaly = [[Anomaly alloc] initWithJSONAnomaly:[self.generator anomalyWithTreeCount:16
+                                                                                           depth:6
+                                                                                      fieldCount:8]];
+    BMLScoringService* anomalyService = [[BMLScoringService alloc] initWithPredictor:anomaly
+                                                                        maxBatchSize:100
+                                                                            maxDelay:0.001];
+    NSDictionary* score = [anomalyService scoreArgumentsSync:self.rows[0] options:nil];
+    XCTAssertEqualWithAccuracy([score[@"score"] doubleValue], [anomaly score:self.rows[0] options:nil], 1e-12);
+}
+
+@end
@@ -0,0 +1,71 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Generates synthetic BigML resources in the same JSON layout returned by
+ * BigML.io, so that local predictions can be exercised offline.
+ *
+ * All fields are numeric and named "field N", with ids "00000N"; values are
+ * drawn uniformly from [0, 100). Given the same seed, the same resources and
+ * rows are generated on every run and platform.
+ */
+@interface bigmlObjcSyntheticModels : NSObject
+
+- (instancetype)initWithSeed:(uint64_t)seed;
+
+/**
+ * A complete binary classification tree splitting on random input fields.
+ * @param depth The depth of the tree (the root has depth 0).
+ * @param fieldCount The number of input fields.
+ * @param classCount The number of categories of the objective field.
+ */
+- (NSDictionary*)modelWithDepth:(NSUInteger)depth
+                     fieldCount:(NSUInteger)fieldCount
+                     classCount:(NSUInteger)classCount;
+
+/**
+ * An array of models suitable for PredictiveEnsemble, all sharing the same
+ * fields and objective.
+ */
+- (NSArray*)ensembleWithModelCount:(NSUInteger)modelCount
+                             depth:(NSUInteger)depth
+                        fieldCount:(NSUInteger)fieldCount
+                        classCount:(NSUInteger)classCount;
+
+/**
+ * An isolation forest with complete trees of the given depth.
+ */
+- (NSDictionary*)anomalyWithTreeCount:(NSUInteger)treeCount
+                                depth:(NSUInteger)depth
+                           fieldCount:(NSUInteger)fieldCount;
+
+/**
+ * A cluster with the given number of centroids over numeric fields.
+ */
+- (NSDictionary*)clusterWithCentroidCount:(NSUInteger)centroidCount
+                               fieldCount:(NSUInteger)fieldCount;
+
+/**
+ * Input rows keyed by field id, covering all input fields.
+ */
+- (NSArray*)rowsWithCount:(NSUInteger)count fieldCount:(NSUInteger)fieldCount;
+
+/**
+ * The id of the field at the given index, as used by generated resources.
+ */
++ (NSString*)fieldIdAtIndex:(NSUInteger)index;
+
+@end
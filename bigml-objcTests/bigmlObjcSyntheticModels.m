@@ -0,0 +1,245 @@
+// Copyright 2015-2016 BigML
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License. You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+#import "bigmlObjcSyntheticModels.h"
+
+#define LEAF_INSTANCES 10
+#define VALUE_RANGE 100.0
+
+@implementation bigmlObjcSyntheticModels {
+
+    uint64_t _state;
+}
+
+- (instancetype)initWithSeed:(uint64_t)seed {
+
+    if (self = [super init]) {
+        _state = seed;
+    }
+    return self;
+}
+
+//-- splitmix64: small, fast and identical on every platform, unlike random()
+- (uint64_t)next {
+
+    uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+- (NSUInteger)nextIndex:(NSUInteger)bound {
+    return (NSUInteger)([self next] % bound);
+}
+
+- (double)nextValue {
+    return ([self next] >> 11) * (1.0 / 9007199254740992.0) * VALUE_RANGE;
+}
+
++ (NSString*)fieldIdAtIndex:(NSUInteger)index {
+    return [NSString stringWithFormat:@"%06lx", (unsigned long)index];
+}
+
+- (NSMutableDictionary*)numericFields:(NSUInteger)fieldCount {
+
+    NSMutableDictionary* fields = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+    for (NSUInteger i = 0; i < fieldCount; ++i) {
+        fields[[bigmlObjcSyntheticModels fieldIdAtIndex:i]] =
+        [@{ @"name" : [NSString stringWithFormat:@"field %lu", (unsigned long)i],
+            @"optype" : @"numeric",
+            @"column_number" : @(i),
+            @"summary" : [@{ @"minimum" : @0, @"maximum" : @(VALUE_RANGE) } mutableCopy] }
+         mutableCopy];
+    }
+    return fields;
+}
+
+#pragma mark Models
+
+- (NSDictionary*)treeNodeWithDepth:(NSUInteger)depth
+                        fieldCount:(NSUInteger)fieldCount
+                        categories:(NSArray*)categories
+                         predicate:(id)predicate {
+
+    NSMutableArray* children = [NSMutableArray array];
+    NSMutableArray* counts = [NSMutableArray arrayWithCapacity:categories.count];
+    if (depth == 0) {
+
+        //-- a leaf is dominated by one category, the rest share the remaining instances
+        NSUInteger winner = [self nextIndex:categories.count];
+        for (NSUInteger i = 0; i < categories.count; ++i) {
+            [counts addObject:@(i == winner ? LEAF_INSTANCES : [self nextIndex:LEAF_INSTANCES / 2])];
+        }
+    } else {
+
+        NSString* field = [bigmlObjcSyntheticModels fieldIdAtIndex:[self nextIndex:fieldCount]];
+        NSNumber* threshold = @([self nextValue]);
+        for (NSString* op in @[ @"<=", @">" ]) {
+            [children addObject:[self treeNodeWithDepth:depth - 1
+                                             fieldCount:fieldCount
+                                             categories:categories
+                                              predicate:@{ @"operator" : op,
+                                                           @"field" : field,
+                                                           @"value" : threshold }]];
+        }
+        for (NSUInteger i = 0; i < categories.count; ++i) {
+            NSUInteger count = 0;
+            for (NSDictionary* child in children) {
+                count += [[child[@"distribution"][i] lastObject] unsignedIntegerValue];
+            }
+            [counts addObject:@(count)];
+        }
+    }
+
+    NSUInteger total = 0, best = 0;
+    NSMutableArray* distribution = [NSMutableArray arrayWithCapacity:categories.count];
+    for (NSUInteger i = 0; i < categories.count; ++i) {
+        total += [counts[i] unsignedIntegerValue];
+        if ([counts[i] unsignedIntegerValue] > [counts[best] unsignedIntegerValue])
+            best = i;
+        [distribution addObject:@[ categories[i], counts[i] ]];
+    }
+    return @{ @"predicate" : predicate,
+              @"output" : categories[best],
+              @"confidence" : @((double)[counts[best] unsignedIntegerValue] / MAX(total, 1)),
+              @"count" : @(total),
+              @"distribution" : distribution,
+              @"children" : children };
+}
+
+- (NSDictionary*)modelWithDepth:(NSUInteger)depth
+                     fieldCount:(NSUInteger)fieldCount
+                     classCount:(NSUInteger)classCount {
+
+    NSString* objectiveId = [bigmlObjcSyntheticModels fieldIdAtIndex:fieldCount];
+    NSMutableArray* categories = [NSMutableArray arrayWithCapacity:classCount];
+    for (NSUInteger i = 0; i < classCount; ++i) {
+        [categories addObject:[NSString stringWithFormat:@"class %lu", (unsigned long)i]];
+    }
+
+    NSMutableDictionary* fields = [self numericFields:fieldCount];
+    fields[objectiveId] = [@{ @"name" : @"objective",
+                              @"optype" : @"categorical",
+                              @"column_number" : @(fieldCount),
+                              @"summary" : @{ @"categories" : @[] } } mutableCopy];
+
+    NSDictionary* root = [self treeNodeWithDepth:depth
+                                      fieldCount:fieldCount
+                                      categories:categories
+                                       predicate:@YES];
+    return @{ @"resource" : [NSString stringWithFormat:@"model/%016llx", [self next]],
+              @"object" : @{ @"status" : @{ @"code" : @5 },
+                             @"objective_fields" : @[ objectiveId ],
+                             @"model" : @{ @"model_fields" : fields,
+                                           @"fields" : fields,
+                                           @"root" : root } } };
+}
+
+- (NSArray*)ensembleWithModelCount:(NSUInteger)modelCount
+                             depth:(NSUInteger)depth
+                        fieldCount:(NSUInteger)fieldCount
+                        classCount:(NSUInteger)classCount {
+
+    NSMutableArray* models = [NSMutableArray arrayWithCapacity:modelCount];
+    for (NSUInteger i = 0; i < modelCount; ++i) {
+        [models addObject:[self modelWithDepth:depth fieldCount:fieldCount classCount:classCount]];
+    }
+    return models;
+}
+
+#pragma mark Anomalies
+
+- (NSDictionary*)anomalyNodeWithDepth:(NSUInteger)depth
+                           fieldCount:(NSUInteger)fieldCount
+                           predicates:(NSArray*)predicates {
+
+    NSMutableArray* children = [NSMutableArray array];
+    if (depth > 0) {
+        NSString* field = [bigmlObjcSyntheticModels fieldIdAtIndex:[self nextIndex:fieldCount]];
+        NSNumber* threshold = @([self nextValue]);
+        for (NSString* op in @[ @"<=", @">" ]) {
+            [children addObject:[self anomalyNodeWithDepth:depth - 1
+                                                fieldCount:fieldCount
+                                                predicates:@[ @{ @"op" : op,
+                                                                 @"field" : field,
+                                                                 @"value" : threshold } ]]];
+        }
+    }
+    return @{ @"predicates" : predicates,
+              @"population" : @(LEAF_INSTANCES << depth),
+              @"children" : children };
+}
+
+- (NSDictionary*)anomalyWithTreeCount:(NSUInteger)treeCount
+                                depth:(NSUInteger)depth
+                           fieldCount:(NSUInteger)fieldCount {
+
+    NSMutableArray* trees = [NSMutableArray arrayWithCapacity:treeCount];
+    for (NSUInteger i = 0; i < treeCount; ++i) {
+        [trees addObject:@{ @"root" : [self anomalyNodeWithDepth:depth
+                                                      fieldCount:fieldCount
+                                                      predicates:@[ @YES ]] }];
+    }
+    return @{ @"resource" : [NSString stringWithFormat:@"anomaly/%016llx", [self next]],
+              @"status" : @{ @"code" : @5 },
+              @"sample_size" : @(LEAF_INSTANCES << depth),
+              @"model" : @{ @"fields" : [self numericFields:fieldCount],
+                            @"mean_depth" : @(depth),
+                            @"top_anomalies" : @[],
+                            @"trees" : trees } };
+}
+
+#pragma mark Clusters
+
+- (NSDictionary*)clusterWithCentroidCount:(NSUInteger)centroidCount
+                               fieldCount:(NSUInteger)fieldCount {
+
+    NSMutableArray* centroids = [NSMutableArray arrayWithCapacity:centroidCount];
+    for (NSUInteger i = 0; i < centroidCount; ++i) {
+        NSMutableDictionary* center = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+        for (NSUInteger j = 0; j < fieldCount; ++j) {
+            center[[bigmlObjcSyntheticModels fieldIdAtIndex:j]] = @([self nextValue]);
+        }
+        [centroids addObject:@{ @"center" : center,
+                                @"count" : @(LEAF_INSTANCES),
+                                @"id" : [bigmlObjcSyntheticModels fieldIdAtIndex:i],
+                                @"name" : [NSString stringWithFormat:@"Cluster %lu", (unsigned long)i] }];
+    }
+    NSMutableDictionary* scales = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+    for (NSUInteger j = 0; j < fieldCount; ++j) {
+        scales[[bigmlObjcSyntheticModels fieldIdAtIndex:j]] = @(1.0 / VALUE_RANGE);
+    }
+    return @{ @"resource" : [NSString stringWithFormat:@"cluster/%016llx", [self next]],
+              @"status" : @{ @"code" : @5 },
+              @"scales" : scales,
+              @"clusters" : @{ @"fields" : [self numericFields:fieldCount],
+                               @"clusters" : centroids } };
+}
+
+#pragma mark Rows
+
+- (NSArray*)rowsWithCount:(NSUInteger)count fieldCount:(NSUInteger)fieldCount {
+
+    NSMutableArray* rows = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i) {
+        NSMutableDictionary* row = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+        for (NSUInteger j = 0; j < fieldCount; ++j) {
+            row[[bigmlObjcSyntheticModels fieldIdAtIndex:j]] = @([self nextValue]);
+        }
+        [rows addObject:row];
+    }
+    return rows;
+}
+
+@end